@@ -18,6 +18,7 @@ void op_par_loop_dirichlet(char const *name, op_set set,
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(1);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
   int  ninds   = 1;
   int  inds[1] = {0};
@@ -37,7 +38,8 @@ void op_par_loop_dirichlet(char const *name, op_set set,
 
   if (set->size >0) {
 
-    op_plan *Plan = op_plan_get_stage_upload(name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);
+    static op_plan_handle plan_handle = OP_PLAN_HANDLE_INIT;
+    op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);
 
     // execute plan
     int block_offset = 0;
@@ -75,6 +77,8 @@ void op_par_loop_dirichlet(char const *name, op_set set,
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 1, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[1].name      = name;
   OP_kernels[1].count    += 1;
   OP_kernels[1].time     += wall_t2 - wall_t1;
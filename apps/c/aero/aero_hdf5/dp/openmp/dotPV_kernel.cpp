@@ -23,6 +23,7 @@ void op_par_loop_dotPV(char const *name, op_set set,
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(4);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
 
   if (OP_diags>2) {
@@ -67,11 +68,13 @@ void op_par_loop_dotPV(char const *name, op_set set,
       arg2h[d] += arg2_l[d+thr*64];
     }
   }
-  op_mpi_reduce(&arg2,arg2h);
+  op_mpi_reduce_combined(args, nargs);
   op_mpi_set_dirtybit(nargs, args);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 3, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[4].name      = name;
   OP_kernels[4].count    += 1;
   OP_kernels[4].time     += wall_t2 - wall_t1;
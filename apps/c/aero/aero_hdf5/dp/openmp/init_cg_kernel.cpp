@@ -27,6 +27,7 @@ void op_par_loop_init_cg(char const *name, op_set set,
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(2);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
 
   if (OP_diags>2) {
@@ -73,11 +74,13 @@ void op_par_loop_init_cg(char const *name, op_set set,
       arg1h[d] += arg1_l[d+thr*64];
     }
   }
-  op_mpi_reduce(&arg1,arg1h);
+  op_mpi_reduce_combined(args, nargs);
   op_mpi_set_dirtybit(nargs, args);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 5, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[2].name      = name;
   OP_kernels[2].count    += 1;
   OP_kernels[2].time     += wall_t2 - wall_t1;
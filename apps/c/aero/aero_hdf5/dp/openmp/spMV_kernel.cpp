@@ -5,6 +5,46 @@
 //user function
 #include "../spMV.h"
 
+//user function -- SoA strides
+static int direct_spMV_stride_OP2CONSTANT;
+inline void spMV_soa(double **v, const double *K, const double **p) {
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+  v[0][0] += K[(0)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(1)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(1)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(2)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(3)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[1][0] += K[(4 + 1)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(4 + 2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(4 + 2)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(4 + 3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(4 + 3)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[2][0] += K[(8 + 2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(8 + 3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(8 + 3)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[3][0] += K[(15)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+}
+
 // host stub function
 void op_par_loop_spMV(char const *name, op_set set,
   op_arg arg0,
@@ -27,11 +67,13 @@ void op_par_loop_spMV(char const *name, op_set set,
     args[5 + v] = op_arg_dat(arg5.dat, v, arg5.map, 1, "double", OP_READ);
   }
 
+  direct_spMV_stride_OP2CONSTANT = getSetSizeFromOpArg(&args[4]);
 
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(3);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
   int  ninds   = 2;
   int  inds[9] = {0,0,0,0,-1,1,1,1,1};
@@ -49,51 +91,116 @@ void op_par_loop_spMV(char const *name, op_set set,
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
+  // use atomic increments instead of colouring?
+  #ifdef OP_ATOMICS_3
+    int atomics = OP_ATOMICS_3;
+  #else
+    int atomics = OP_atomics;
+  #endif
+
   if (set->size >0) {
 
-    op_plan *Plan = op_plan_get_stage_upload(name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);
+    if (atomics) {
+      // execute as a single parallel loop, with atomic increments
+      for ( int round=0; round<3; round++ ){
+        if (round==1 && set_size != set->core_size) {
+          op_mpi_wait_all(nargs, args);
+        }
+        int start = round==0 ? 0 : (round==1 ? set->core_size : set->size);
+        int end   = round==0 ? set->core_size : (round==1 ? set->size : set_size);
 
-    // execute plan
-    int block_offset = 0;
-    for ( int col=0; col<Plan->ncolors; col++ ){
-      if (col==Plan->ncolors_core) {
-        op_mpi_wait_all(nargs, args);
-      }
-      int nblocks = Plan->ncolblk[col];
-
-      #pragma omp parallel for
-      for ( int blockIdx=0; blockIdx<nblocks; blockIdx++ ){
-        int blockId  = Plan->blkmap[blockIdx + block_offset];
-        int nelem    = Plan->nelems[blockId];
-        int offset_b = Plan->offset[blockId];
-        for ( int n=offset_b; n<offset_b+nelem; n++ ){
+        #pragma omp parallel for
+        for ( int n=start; n<end; n++ ){
           int map0idx = arg0.map_data[n * arg0.map->dim + 0];
           int map1idx = arg0.map_data[n * arg0.map->dim + 1];
           int map2idx = arg0.map_data[n * arg0.map->dim + 2];
           int map3idx = arg0.map_data[n * arg0.map->dim + 3];
 
+          double arg0_l[4 * 1];
+          for ( int d=0; d<4 * 1; d++ ){
+            arg0_l[d] = ZERO_double;
+          }
           double* arg0_vec[] = {
-             &((double*)arg0.data)[1 * map0idx],
-             &((double*)arg0.data)[1 * map1idx],
-             &((double*)arg0.data)[1 * map2idx],
-             &((double*)arg0.data)[1 * map3idx]};
+             &arg0_l[1 * 0],
+             &arg0_l[1 * 1],
+             &arg0_l[1 * 2],
+             &arg0_l[1 * 3]};
           const double* arg5_vec[] = {
              &((double*)arg5.data)[1 * map0idx],
              &((double*)arg5.data)[1 * map1idx],
              &((double*)arg5.data)[1 * map2idx],
              &((double*)arg5.data)[1 * map3idx]};
 
-          spMV(
+          spMV_soa(
             arg0_vec,
-            &((double*)arg4.data)[16 * n],
+            &((double*)arg4.data)[n],
             arg5_vec);
+
+          for ( int d=0; d<1; d++ ){
+            #pragma omp atomic
+            ((double*)arg0.data)[1 * map0idx + d] += arg0_l[1 * 0 + d];
+          }
+          for ( int d=0; d<1; d++ ){
+            #pragma omp atomic
+            ((double*)arg0.data)[1 * map1idx + d] += arg0_l[1 * 1 + d];
+          }
+          for ( int d=0; d<1; d++ ){
+            #pragma omp atomic
+            ((double*)arg0.data)[1 * map2idx + d] += arg0_l[1 * 2 + d];
+          }
+          for ( int d=0; d<1; d++ ){
+            #pragma omp atomic
+            ((double*)arg0.data)[1 * map3idx + d] += arg0_l[1 * 3 + d];
+          }
         }
+
       }
+    } else {
+      static op_plan_handle plan_handle = OP_PLAN_HANDLE_INIT;
+      op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);
+
+      // execute plan
+      int block_offset = 0;
+      for ( int col=0; col<Plan->ncolors; col++ ){
+        if (col==Plan->ncolors_core) {
+          op_mpi_wait_all(nargs, args);
+        }
+        int nblocks = Plan->ncolblk[col];
+
+        #pragma omp parallel for
+        for ( int blockIdx=0; blockIdx<nblocks; blockIdx++ ){
+          int blockId  = Plan->blkmap[blockIdx + block_offset];
+          int nelem    = Plan->nelems[blockId];
+          int offset_b = Plan->offset[blockId];
+          for ( int n=offset_b; n<offset_b+nelem; n++ ){
+            int map0idx = arg0.map_data[n * arg0.map->dim + 0];
+            int map1idx = arg0.map_data[n * arg0.map->dim + 1];
+            int map2idx = arg0.map_data[n * arg0.map->dim + 2];
+            int map3idx = arg0.map_data[n * arg0.map->dim + 3];
+
+            double* arg0_vec[] = {
+               &((double*)arg0.data)[1 * map0idx],
+               &((double*)arg0.data)[1 * map1idx],
+               &((double*)arg0.data)[1 * map2idx],
+               &((double*)arg0.data)[1 * map3idx]};
+            const double* arg5_vec[] = {
+               &((double*)arg5.data)[1 * map0idx],
+               &((double*)arg5.data)[1 * map1idx],
+               &((double*)arg5.data)[1 * map2idx],
+               &((double*)arg5.data)[1 * map3idx]};
+
+            spMV_soa(
+              arg0_vec,
+              &((double*)arg4.data)[n],
+              arg5_vec);
+          }
+        }
 
-      block_offset += nblocks;
+        block_offset += nblocks;
+      }
+      OP_kernels[3].transfer  += Plan->transfer;
+      OP_kernels[3].transfer2 += Plan->transfer2;
     }
-    OP_kernels[3].transfer  += Plan->transfer;
-    OP_kernels[3].transfer2 += Plan->transfer2;
   }
 
   if (set_size == 0 || set_size == set->core_size) {
@@ -104,6 +211,8 @@ void op_par_loop_spMV(char const *name, op_set set,
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 9, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[3].name      = name;
   OP_kernels[3].count    += 1;
   OP_kernels[3].time     += wall_t2 - wall_t1;
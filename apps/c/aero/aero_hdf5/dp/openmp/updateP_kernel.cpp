@@ -22,6 +22,7 @@ void op_par_loop_updateP(char const *name, op_set set,
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(7);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
 
   if (OP_diags>2) {
@@ -57,6 +58,8 @@ void op_par_loop_updateP(char const *name, op_set set,
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 3, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[7].name      = name;
   OP_kernels[7].count    += 1;
   OP_kernels[7].time     += wall_t2 - wall_t1;
@@ -25,6 +25,7 @@ void op_par_loop_update(char const *name, op_set set,
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(8);
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument) op_instrument_begin();
 
 
   if (OP_diags>2) {
@@ -70,11 +71,13 @@ void op_par_loop_update(char const *name, op_set set,
       arg3h[d] += arg3_l[d+thr*64];
     }
   }
-  op_mpi_reduce(&arg3,arg3h);
+  op_mpi_reduce_combined(args, nargs);
   op_mpi_set_dirtybit(nargs, args);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 4, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[8].name      = name;
   OP_kernels[8].count    += 1;
   OP_kernels[8].time     += wall_t2 - wall_t1;
@@ -13,15 +13,15 @@ void op_par_loop_dirichlet(char const *name, op_set set,
   op_arg args[1];
 
   args[0] = arg0;
+  if (OP_diags>2) {
+    printf(" kernel routine with indirection: dirichlet\n");
+  }
 
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(1);
   op_timers_core(&cpu_t1, &wall_t1);
-
-  if (OP_diags>2) {
-    printf(" kernel routine with indirection: dirichlet\n");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -42,11 +42,13 @@ void op_par_loop_dirichlet(char const *name, op_set set,
   if (set_size == 0 || set_size == set->core_size) {
     op_mpi_wait_all(nargs, args);
   }
-  // combine reduction data
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 1, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[1].name      = name;
   OP_kernels[1].count    += 1;
   OP_kernels[1].time     += wall_t2 - wall_t1;
@@ -16,15 +16,15 @@ void op_par_loop_dotR(char const *name, op_set set,
   args[0] = arg0;
   args[1] = arg1;
 
+  if (OP_diags>2) {
+    printf(" kernel routine w/o indirection:  dotR");
+  }
+
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(6);
   op_timers_core(&cpu_t1, &wall_t1);
-
-
-  if (OP_diags>2) {
-    printf(" kernel routine w/o indirection:  dotR");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -37,12 +37,14 @@ void op_par_loop_dotR(char const *name, op_set set,
     }
   }
 
-  // combine reduction data
-  op_mpi_reduce_double(&arg1,(double*)arg1.data);
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
+  op_mpi_reduce_combined(args, nargs);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 2, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[6].name      = name;
   OP_kernels[6].count    += 1;
   OP_kernels[6].time     += wall_t2 - wall_t1;
@@ -22,15 +22,15 @@ void op_par_loop_init_cg(char const *name, op_set set,
   args[3] = arg3;
   args[4] = arg4;
 
+  if (OP_diags>2) {
+    printf(" kernel routine w/o indirection:  init_cg");
+  }
+
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(2);
   op_timers_core(&cpu_t1, &wall_t1);
-
-
-  if (OP_diags>2) {
-    printf(" kernel routine w/o indirection:  init_cg");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -46,12 +46,14 @@ void op_par_loop_init_cg(char const *name, op_set set,
     }
   }
 
-  // combine reduction data
-  op_mpi_reduce_double(&arg1,(double*)arg1.data);
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
+  op_mpi_reduce_combined(args, nargs);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 5, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[2].name      = name;
   OP_kernels[2].count    += 1;
   OP_kernels[2].time     += wall_t2 - wall_t1;
@@ -5,6 +5,77 @@
 //user function
 #include "../res_calc.h"
 
+//user function -- SoA strides
+static int direct_res_calc_stride_OP2CONSTANT;
+inline void res_calc_soa(const double **x, const double **phim, double *K,
+                      double **res, double **none) {
+  for (int j = 0; j < 4; j++) {
+    for (int k = 0; k < 4; k++) {
+      K[(j * 4 + k)*direct_res_calc_stride_OP2CONSTANT] = 0;
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    double det_x_xi = 0;
+    double N_x[8];
+
+    double a = 0;
+    for (int m = 0; m < 4; m++)
+      det_x_xi += Ng2_xi[4 * i + 16 + m] * x[m][1];
+    for (int m = 0; m < 4; m++)
+      N_x[m] = det_x_xi * Ng2_xi[4 * i + m];
+
+    a = 0;
+    for (int m = 0; m < 4; m++)
+      a += Ng2_xi[4 * i + m] * x[m][0];
+    for (int m = 0; m < 4; m++)
+      N_x[4 + m] = a * Ng2_xi[4 * i + 16 + m];
+
+    det_x_xi *= a;
+
+    a = 0;
+    for (int m = 0; m < 4; m++)
+      a += Ng2_xi[4 * i + m] * x[m][1];
+    for (int m = 0; m < 4; m++)
+      N_x[m] -= a * Ng2_xi[4 * i + 16 + m];
+
+    double b = 0;
+    for (int m = 0; m < 4; m++)
+      b += Ng2_xi[4 * i + 16 + m] * x[m][0];
+    for (int m = 0; m < 4; m++)
+      N_x[4 + m] -= b * Ng2_xi[4 * i + m];
+
+    det_x_xi -= a * b;
+
+    for (int j = 0; j < 8; j++)
+      N_x[j] /= det_x_xi;
+
+    double wt1 = wtg2[i] * det_x_xi;
+
+
+    double u[2] = {0.0, 0.0};
+    for (int j = 0; j < 4; j++) {
+      u[0] += N_x[j] * phim[j][0];
+      u[1] += N_x[4 + j] * phim[j][0];
+    }
+
+    double Dk = 1.0 + 0.5 * gm1 * (m2 - (u[0] * u[0] + u[1] * u[1]));
+    double rho = pow(Dk, gm1i);
+    double rc2 = rho / Dk;
+
+    for (int j = 0; j < 4; j++) {
+      res[j][0] += wt1 * rho * (u[0] * N_x[j] + u[1] * N_x[4 + j]);
+    }
+    for (int j = 0; j < 4; j++) {
+      for (int k = 0; k < 4; k++) {
+        K[(j * 4 + k)*direct_res_calc_stride_OP2CONSTANT] +=
+            wt1 * rho * (N_x[j] * N_x[k] + N_x[4 + j] * N_x[4 + k]) -
+            wt1 * rc2 * (u[0] * N_x[j] + u[1] * N_x[4 + j]) *
+                (u[0] * N_x[k] + u[1] * N_x[4 + k]);
+      }
+    }
+  }
+}
+
 // host stub function
 void op_par_loop_res_calc(char const *name, op_set set,
   op_arg arg0,
@@ -41,15 +112,16 @@ void op_par_loop_res_calc(char const *name, op_set set,
     args[13 + v] = op_opt_arg_dat(arg13.opt, arg13.dat, v, arg13.map, 2, "double", OP_INC);
   }
 
+  if (OP_diags>2) {
+    printf(" kernel routine with indirection: res_calc\n");
+  }
+  direct_res_calc_stride_OP2CONSTANT = getSetSizeFromOpArg(&args[8]);
 
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(0);
   op_timers_core(&cpu_t1, &wall_t1);
-
-  if (OP_diags>2) {
-    printf(" kernel routine with indirection: res_calc\n");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -85,10 +157,10 @@ void op_par_loop_res_calc(char const *name, op_set set,
          &((double*)arg13.data)[2 * map2idx],
          &((double*)arg13.data)[2 * map3idx]};
 
-      res_calc(
+      res_calc_soa(
         arg0_vec,
         arg4_vec,
-        &((double*)arg8.data)[16 * n],
+        &((double*)arg8.data)[n],
         arg9_vec,
         arg13_vec);
     }
@@ -97,11 +169,13 @@ void op_par_loop_res_calc(char const *name, op_set set,
   if (set_size == 0 || set_size == set->core_size) {
     op_mpi_wait_all(nargs, args);
   }
-  // combine reduction data
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 17, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[0].name      = name;
   OP_kernels[0].count    += 1;
   OP_kernels[0].time     += wall_t2 - wall_t1;
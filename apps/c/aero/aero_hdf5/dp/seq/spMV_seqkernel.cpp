@@ -5,6 +5,46 @@
 //user function
 #include "../spMV.h"
 
+//user function -- SoA strides
+static int direct_spMV_stride_OP2CONSTANT;
+inline void spMV_soa(double **v, const double *K, const double **p) {
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+  v[0][0] += K[(0)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(1)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(1)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(2)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[0][0] += K[(3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(3)*direct_spMV_stride_OP2CONSTANT] * p[0][0];
+  v[1][0] += K[(4 + 1)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(4 + 2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(4 + 2)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[1][0] += K[(4 + 3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(4 + 3)*direct_spMV_stride_OP2CONSTANT] * p[1][0];
+  v[2][0] += K[(8 + 2)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[2][0] += K[(8 + 3)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+  v[3][0] += K[(8 + 3)*direct_spMV_stride_OP2CONSTANT] * p[2][0];
+  v[3][0] += K[(15)*direct_spMV_stride_OP2CONSTANT] * p[3][0];
+}
+
 // host stub function
 void op_par_loop_spMV(char const *name, op_set set,
   op_arg arg0,
@@ -27,15 +67,16 @@ void op_par_loop_spMV(char const *name, op_set set,
     args[5 + v] = op_arg_dat(arg5.dat, v, arg5.map, 1, "double", OP_READ);
   }
 
+  if (OP_diags>2) {
+    printf(" kernel routine with indirection: spMV\n");
+  }
+  direct_spMV_stride_OP2CONSTANT = getSetSizeFromOpArg(&args[4]);
 
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(3);
   op_timers_core(&cpu_t1, &wall_t1);
-
-  if (OP_diags>2) {
-    printf(" kernel routine with indirection: spMV\n");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -61,9 +102,9 @@ void op_par_loop_spMV(char const *name, op_set set,
          &((double*)arg5.data)[1 * map2idx],
          &((double*)arg5.data)[1 * map3idx]};
 
-      spMV(
+      spMV_soa(
         arg0_vec,
-        &((double*)arg4.data)[16 * n],
+        &((double*)arg4.data)[n],
         arg5_vec);
     }
   }
@@ -71,11 +112,13 @@ void op_par_loop_spMV(char const *name, op_set set,
   if (set_size == 0 || set_size == set->core_size) {
     op_mpi_wait_all(nargs, args);
   }
-  // combine reduction data
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 9, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[3].name      = name;
   OP_kernels[3].count    += 1;
   OP_kernels[3].time     += wall_t2 - wall_t1;
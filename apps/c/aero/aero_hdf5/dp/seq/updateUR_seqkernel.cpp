@@ -22,15 +22,15 @@ void op_par_loop_updateUR(char const *name, op_set set,
   args[3] = arg3;
   args[4] = arg4;
 
+  if (OP_diags>2) {
+    printf(" kernel routine w/o indirection:  updateUR");
+  }
+
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(5);
   op_timers_core(&cpu_t1, &wall_t1);
-
-
-  if (OP_diags>2) {
-    printf(" kernel routine w/o indirection:  updateUR");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -46,11 +46,13 @@ void op_par_loop_updateUR(char const *name, op_set set,
     }
   }
 
-  // combine reduction data
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 5, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[5].name      = name;
   OP_kernels[5].count    += 1;
   OP_kernels[5].time     += wall_t2 - wall_t1;
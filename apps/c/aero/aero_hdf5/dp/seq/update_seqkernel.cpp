@@ -20,15 +20,15 @@ void op_par_loop_update(char const *name, op_set set,
   args[2] = arg2;
   args[3] = arg3;
 
+  if (OP_diags>2) {
+    printf(" kernel routine w/o indirection:  update");
+  }
+
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timing_realloc(8);
   op_timers_core(&cpu_t1, &wall_t1);
-
-
-  if (OP_diags>2) {
-    printf(" kernel routine w/o indirection:  update");
-  }
+  if (OP_instrument) op_instrument_begin();
 
   int set_size = op_mpi_halo_exchanges(set, nargs, args);
 
@@ -43,12 +43,14 @@ void op_par_loop_update(char const *name, op_set set,
     }
   }
 
-  // combine reduction data
-  op_mpi_reduce_double(&arg3,(double*)arg3.data);
   op_mpi_set_dirtybit(nargs, args);
+  // combine reduction data
+  op_mpi_reduce_combined(args, nargs);
 
   // update kernel record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument) op_instrument_end(name, set, 4, args, wall_t2 - wall_t1);
+  if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);
   OP_kernels[8].name      = name;
   OP_kernels[8].count    += 1;
   OP_kernels[8].time     += wall_t2 - wall_t1;
@@ -63,6 +63,9 @@ void op_fetch_data_hdf5_file(op_dat dat, char const *file_name);
 void op_fetch_data_hdf5_file_path(op_dat dat, char const *file_name,
                                   char const *path_name);
 
+/* wait for the background writes of op_fetch_data_hdf5_file (OP_ASYNC_IO) */
+void op_output_wait(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -81,6 +81,13 @@ op_map op_decl_map(op_set, op_set, int, int *, char const *);
 
 op_dat op_decl_dat_char(op_set, int, char const *, int, char *, char const *);
 
+/* declare a map / dat owning a malloc'ed user array, without copying it:
+ * OP2 may realloc the array (e.g. for MPI halos) and frees it at op_exit */
+op_map op_decl_map_adopt(op_set, op_set, int, int *, char const *);
+
+op_dat op_decl_dat_adopt_char(op_set, int, char const *, int, char *,
+                              char const *);
+
 op_dat op_decl_dat_temp_char(op_set, int, char const *, int, char const *);
 
 int op_free_dat_temp_char(op_dat dat);
@@ -100,6 +107,8 @@ void op_upload_all();
 
 void op_fetch_data_idx_char(op_dat, char *, int, int);
 
+void op_reduction_wait(void *);
+
 void op_exit();
 
 void op_timing_output();
@@ -81,6 +81,24 @@ extern int OP_cache_line_size;
 extern double OP_hybrid_balance;
 extern int OP_hybrid_gpu;
 extern int OP_maps_base_index;
+extern char *OP_plan_cache_dir;
+extern int OP_color_order;
+extern int OP_color_balance;
+extern int OP_atomics;
+extern int OP_instrument;
+extern char *OP_instrument_file;
+extern int OP_trace;
+extern char *OP_trace_file;
+extern int OP_halo_aggregate;
+extern int OP_halo_persistent;
+extern int OP_halo_shm;
+extern int OP_reduce_defer;
+extern int OP_lazy;
+extern int OP_tile_size;
+extern int OP_numa;
+extern int OP_hugepages;
+extern int OP_temp_nozero;
+extern int OP_async_io;
 
 /*
  * enum list for op_par_loop
@@ -102,6 +120,10 @@ extern int OP_maps_base_index;
 #define OP_STAGE_PERMUTE 3
 #define OP_COLOR2 4
 
+#define OP_COLOR_NATURAL 0
+#define OP_COLOR_LARGEST_FIRST 1
+#define OP_COLOR_SMALLEST_LAST 2
+
 typedef int op_access; // holds OP_READ, OP_WRITE, OP_RW, OP_INC, OP_MIN, OP_MAX
 typedef int op_arg_type; // holds OP_ARG_GBL, OP_ARG_DAT
 
@@ -150,6 +172,7 @@ typedef struct {
   int dirty_hd;     /* flag to indicate dirty status on host and device */
   int user_managed; /* indicates whether the user is managing memory */
   void *mpi_buffer; /* ponter to hold the mpi buffer struct for the op_dat*/
+  int soa;          /* host data is stored component-major (SoA) */
 } op_dat_core;
 
 typedef op_dat_core *op_dat;
@@ -182,6 +205,24 @@ typedef struct {
   float mpi_time;   /* time spent in MPI calls */
 } op_kernel;
 
+// a loop queued for lazy execution (OP_LAZY)
+typedef struct op_kernel_descriptor_core {
+  char const *name; /* name of kernel function */
+  op_set set;       /* iteration set */
+  int nargs;        /* number of arguments */
+  op_arg *args;     /* copies of the arguments */
+  char *gbl;        /* snapshot of the OP_READ globals */
+  void (*fun)(void);                                 /* user kernel */
+  void (*run)(struct op_kernel_descriptor_core *); /* executes the loop */
+  void (*run_list)(struct op_kernel_descriptor_core *, int const *,
+                   int); /* executes the listed iterations only */
+} op_kernel_descriptor_core;
+
+typedef op_kernel_descriptor_core *op_kernel_descriptor;
+
+// a sparse tiling of a loop chain (OP_TILE_SIZE)
+typedef struct op_tile_plan_core op_tile_plan;
+
 // struct definition for a double linked list entry to hold an op_dat
 struct op_dat_entry_core {
   op_dat dat;
@@ -237,6 +278,30 @@ op_dat op_decl_dat_temp_core(op_set, int, char const *, int, char *,
 
 int op_free_dat_temp_core(op_dat);
 
+char *op_temp_pool_alloc(op_dat, int, void **);
+
+void op_temp_pool_release(op_dat, int, void *);
+
+void op_temp_pool_free(void (*)(void *));
+
+int op_dat_soa_type(op_dat);
+
+int op_dat_soa_stride(op_dat);
+
+void op_dat_set_soa(op_dat, int);
+
+void op_dat_get_aos(op_dat, char *, int, int);
+
+void op_dat_put_aos(op_dat, char const *, int, int);
+
+char *op_numa_malloc(size_t);
+
+char *op_numa_alloc(char const *, int, int, size_t);
+
+void op_dat_numa_place(op_dat);
+
+void op_map_numa_place(op_map, int);
+
 void op_decl_const_core(int dim, char const *type, int typeSize, char *data,
                         char const *name);
 
@@ -258,12 +323,33 @@ op_arg op_arg_gbl_core(char *, int, const char *, int, op_access);
 
 void op_diagnostic_output(void);
 
+void op_numa_output(void);
+
 void op_timing_output_core(void);
 
 void op_timing_output_2_file(const char *);
 
+void op_timing_output_json(const char *);
+
+void op_timing_output_csv(const char *);
+
 void op_timing_realloc(int);
 
+void op_instrument_begin(void);
+
+void op_instrument_end(char const *name, op_set set, int nargs, op_arg *args,
+                       double time);
+
+void op_instrument_output_2_file(const char *);
+
+void op_trace_event(char const *name, char const *cat, double t0, double t1);
+
+void op_trace_phase(char const *name, double t);
+
+void op_trace_loop(char const *name, double t0, double t1);
+
+void op_trace_output_2_file(const char *);
+
 void op_timers_core(double *cpu, double *et);
 
 void op_dump_dat(op_dat data);
@@ -274,6 +360,35 @@ void op_print_dat_to_txtfile_core(op_dat dat, const char *file_name);
 
 void op_compute_moment(double t, double *first, double *second);
 
+int op_comm_size();
+
+int op_comm_rank();
+
+void op_gather_double(double *local, int n, double *gathered);
+
+void op_mpi_perf_halo_info(const char *name, int ndats, double *info);
+
+void op_enqueue_loop(char const *name, op_set set, int nargs, op_arg *args,
+                     void (*fun)(void), void (*run)(op_kernel_descriptor),
+                     void (*run_list)(op_kernel_descriptor, int const *, int));
+
+void op_flush();
+
+void op_mpi_chain_halo_exchanges(int nloops, op_kernel_descriptor *chain);
+
+int *op_tile_signature(int nloops, op_kernel_descriptor *chain, int *len);
+
+op_tile_plan *op_tile_plan_build(int nloops, op_kernel_descriptor *chain,
+                                 int *const *iters, int const *niters,
+                                 int const *nelems);
+
+void op_tile_plan_free(op_tile_plan *plan);
+
+void op_tile_run(op_tile_plan *plan, op_kernel_descriptor *chain,
+                 int const *nowned, double *time);
+
+int op_mpi_tile_chain(int nloops, op_kernel_descriptor *chain, double *time);
+
 int op_size_of_set(const char *);
 
 int op_get_size(op_set set);
@@ -329,6 +444,8 @@ void op_mpi_perf_comms(void *k_i, int nargs, op_arg *args);
 
 void op_renumber(op_map base);
 
+void op_renumber_method(op_map base, char const *method, op_dat coords);
+
 /*******************************************************************************
 * Utility function to compare two op_sets and return 1 if they are identical
 *******************************************************************************/
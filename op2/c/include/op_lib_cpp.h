@@ -119,6 +119,8 @@ extern op_kernel *OP_kernels;
 extern double OP_plan_time;
 
 op_dat op_decl_dat_char(op_set, int, char const *, int, char *, char const *);
+op_dat op_decl_dat_adopt_char(op_set, int, char const *, int, char *,
+                              char const *);
 op_dat op_decl_dat_temp_char(op_set, int, char const *, int, char const *);
 int op_free_dat_temp_char(op_dat dat);
 
@@ -136,6 +138,19 @@ op_dat op_decl_dat(op_set set, int dim, char const *type, T *data,
   return op_decl_dat_char(set, dim, type, sizeof(T), (char *)data, name);
 }
 
+template <class T>
+op_dat op_decl_dat_adopt(op_set set, int dim, char const *type, T *data,
+                         char const *name) {
+
+  if (type_error(data, type)) {
+    printf("incorrect type specified for dataset \"%s\" \n", name);
+    exit(1);
+  }
+
+  return op_decl_dat_adopt_char(set, dim, type, sizeof(T), (char *)data,
+                                name);
+}
+
 template <class T>
 void op_decl_const2(char const *name, int dim, char const *type, T *data) {
   if (type_error(data, type)) {
@@ -139,6 +139,23 @@ typedef struct {
 * Buffer struct used in non-blocking mpi halo sends/receives
 *******************************************************************************/
 
+typedef struct {
+  // persistent send requests, started with MPI_Startall
+  MPI_Request *s_req;
+  // persistent receive requests, started with MPI_Startall
+  MPI_Request *r_req;
+  // number of persistent send requests
+  int s_num_req;
+  // number of persistent receive requests
+  int r_num_req;
+  // buffers the requests are bound to, they are rebuilt if any of them moves
+  char *data;
+  char *buf_exec;
+  char *buf_nonexec;
+} op_mpi_persistent_core;
+
+typedef op_mpi_persistent_core *op_mpi_persistent;
+
 typedef struct {
   // buffer holding exec halo to be exported;
   char *buf_exec;
@@ -152,10 +169,52 @@ typedef struct {
   int s_num_req;
   // number of receive MPI_Reqests in flight at a given time for this op_dat
   int r_num_req;
+  // persistent requests, slot 0 for the full halo exchange and slot
+  // 1 + map->index for the partial exchange over that map
+  op_mpi_persistent *persistent;
+  // number of slots in persistent
+  int num_persistent;
+  // persistent requests started and not yet waited for
+  op_mpi_persistent p_in_flight;
+  // shared memory window holding buf_exec and buf_nonexec (OP_HALO_SHM),
+  // MPI_WIN_NULL if this op_dat exchanges by messages only
+  MPI_Win shm_win;
+  // export buffers of the on-node ranks, indexed by rank in OP_MPI_NODE
+  char **shm_base;
+  // MPI_Requests of the completion flags sent to on-node exporters
+  MPI_Request *d_s_req;
+  // MPI_Requests of the completion flags received from on-node importers
+  MPI_Request *d_r_req;
+  // 1 while an exchange through the shared memory window is in flight
+  int shm_in_flight;
 } op_mpi_buffer_core;
 
 typedef op_mpi_buffer_core *op_mpi_buffer;
 
+/*******************************************************************************
+* Data structure to hold the on-node neighbours of a set (OP_HALO_SHM)
+*******************************************************************************/
+
+typedef struct {
+  // rank in OP_MPI_NODE of each export exec/nonexec neighbour, -1 if off-node
+  int *exp_exec_node;
+  int *exp_nonexec_node;
+  // rank in OP_MPI_NODE of each import exec/nonexec neighbour, -1 if off-node
+  int *imp_exec_node;
+  int *imp_nonexec_node;
+  // element offset of this rank's import in the on-node exporter's buffer
+  int *imp_exec_offset;
+  int *imp_nonexec_offset;
+  // distinct on-node ranks exported to
+  int *exp_nodes;
+  int num_exp;
+  // distinct on-node ranks imported from
+  int *imp_nodes;
+  int num_imp;
+} op_shm_set_core;
+
+typedef op_shm_set_core *op_shm_set;
+
 /** external variables **/
 
 extern int OP_part_index;
@@ -170,6 +229,11 @@ extern int **export_nonexec_list_partial_d;
 extern int **import_nonexec_list_partial_d;
 extern int *set_import_buffer_size;
 
+/** on-node halo exchange through shared memory **/
+
+extern MPI_Comm OP_MPI_NODE;
+extern op_shm_set *OP_shm_set_list;
+
 /*******************************************************************************
 * Data Type to hold sliding planes info
 *******************************************************************************/
@@ -279,14 +343,46 @@ void op_halo_permap_create();
 
 void op_halo_destroy();
 
+void op_mpi_persistent_release(op_mpi_persistent p);
+
+void op_mpi_buffer_persistent_free(op_mpi_buffer buf);
+
+void op_mpi_reduce_free();
+
+void op_mpi_reduce_wait_args(int nargs, op_arg *args);
+
+void op_halo_shm_create();
+
+void op_halo_shm_destroy();
+
+void op_mpi_buffer_shm_free(op_mpi_buffer buf);
+
 op_dat op_mpi_get_data(op_dat dat);
 
+char *op_mpi_get_data_local(op_dat dat);
+
+op_dat op_mpi_get_data_comm(op_dat dat, char *data, MPI_Comm comm);
+
+char *op_fetch_data_local_char(op_dat dat);
+
+/*******************************************************************************
+ * Background output thread (OP_ASYNC_IO)
+ *******************************************************************************/
+
+extern MPI_Comm OP_MPI_OUTPUT_WORLD;
+
+void op_mpi_init_thread(int *argc, char ***argv);
+
+void op_mpi_io_submit(void (*run)(void *), void *arg);
+
 void fetch_data_hdf5(op_dat dat, char *usr_ptr, int low, int high);
 
 void mpi_timing_output();
 
 void op_mpi_exit();
 
+void op_mpi_tile_free();
+
 void print_dat_to_txtfile_mpi(op_dat dat, const char *file_name);
 
 void print_dat_to_binfile_mpi(op_dat dat, const char *file_name);
@@ -317,6 +413,10 @@ void op_partition_external(op_set primary_set, op_dat partvec);
 
 void op_partition_inertial(op_dat x);
 
+void op_partition_builtin_rcb(op_dat coords, op_map prime_map, int inertial);
+
+void op_partition_builtin_kway(op_map primary_map);
+
 #ifdef HAVE_PARMETIS
 /*******************************************************************************
 * ParMetis wrapper prototypes
@@ -365,6 +465,11 @@ void op_move_to_device();
 void op_exchange_halo(op_arg *arg, int exec_flag);
 void op_exchange_halo_partial(op_arg *arg, int exec_flag);
 void op_wait_all(op_arg *arg);
+void op_exchange_halo_aggregate(op_arg *arg, int exec_flag, int partial);
+void op_exchange_halo_aggregate_post();
+void op_wait_all_aggregate();
+void op_halo_aggregate_destroy();
+void op_halo_soa_destroy();
 void op_exchange_halo_cuda(op_arg *arg, int exec_flag);
 void op_exchange_halo_partial_cuda(op_arg *arg, int exec_flag);
 void op_wait_all_cuda(op_arg *arg);
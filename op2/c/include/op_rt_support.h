@@ -85,8 +85,22 @@ typedef struct {
   float transfer;    /* bytes of data transfer per kernel call */
   float transfer2;   /* bytes of cache line per kernel call */
   int count;         /* number of times called */
+  ull hash;          /* signature hash of the input arguments */
+  int hash_next;     /* next plan with the same signature hash, -1 if none */
 } op_plan;
 
+/*
+ * handle to an execution plan, held by a single op_par_loop call site so that
+ * the plan can be revalidated without a lookup in the plan hash table
+ */
+
+typedef struct {
+  int index; /* index of the plan in OP_plans, -1 if not yet bound */
+  int epoch; /* OP_plan_epoch at the time the handle was bound */
+} op_plan_handle;
+
+#define OP_PLAN_HANDLE_INIT {-1, -1}
+
 extern op_plan *OP_plans;
 
 #ifdef __cplusplus
@@ -111,6 +125,10 @@ op_plan *op_plan_get_stage_upload(char const *name, op_set set, int part_size,
 op_plan *op_plan_get(char const *name, op_set set, int part_size, int nargs,
                      op_arg *args, int ninds, int *inds);
 
+op_plan *op_plan_get_handle(op_plan_handle *handle, char const *name,
+                            op_set set, int part_size, int nargs, op_arg *args,
+                            int ninds, int *inds, int staging, int upload);
+
 void op_plan_check(op_plan OP_plan, int ninds, int *inds);
 
 void op_rt_exit(void);
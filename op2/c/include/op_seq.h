@@ -47,29 +47,271 @@ inline void op_arg_copy_in(int n, op_arg arg, char **p_arg) {
     p_arg[i] = arg.data + arg.map->map[i + n * arg.map->dim] * arg.size;
 }
 
+//
+// SoA dats hand the kernel an AoS copy of each element it touches, written
+// back after the call if the loop modifies the dat. Slots naming the same
+// element of the same dat share one copy, as they would share the element
+// with AoS storage.
+//
+inline char *op_arg_soa_stage(op_arg const &arg) {
+  if (arg.opt == 0 || arg.argtype != OP_ARG_DAT || !arg.dat->soa)
+    return NULL;
+  return (char *)op_malloc((arg.idx < -1 ? -arg.idx : 1) * arg.size);
+}
+
+inline int op_arg_soa_elem(int n, op_arg const &arg, int k) {
+  if (arg.map == NULL)
+    return n;
+  return arg.map->map[(arg.idx < -1 ? k : arg.idx) + n * arg.map->dim];
+}
+
+inline void op_args_soa_in(int n, int nargs, op_arg *args, char **p_a,
+                           char **s_a) {
+  for (int i = 0; i < nargs; i++) {
+    if (s_a[i] == NULL)
+      continue;
+    char **p = args[i].idx < -1 ? (char **)p_a[i] : &p_a[i];
+    for (int k = 0; k < (args[i].idx < -1 ? -args[i].idx : 1); k++) {
+      int e = op_arg_soa_elem(n, args[i], k);
+      p[k] = NULL;
+      for (int j = 0; j <= i && p[k] == NULL; j++) {
+        if (s_a[j] == NULL || args[j].dat != args[i].dat)
+          continue;
+        char **q = args[j].idx < -1 ? (char **)p_a[j] : &p_a[j];
+        int nq = j < i ? (args[j].idx < -1 ? -args[j].idx : 1) : k;
+        for (int l = 0; l < nq && p[k] == NULL; l++)
+          if (op_arg_soa_elem(n, args[j], l) == e)
+            p[k] = q[l];
+      }
+      if (p[k] == NULL) {
+        p[k] = s_a[i] + k * args[i].size;
+        op_dat_get_aos(args[i].dat, p[k], e, 1);
+      }
+    }
+  }
+}
+
+inline void op_args_soa_out(int n, int nargs, op_arg *args, char **p_a,
+                            char **s_a) {
+  for (int i = 0; i < nargs; i++) {
+    if (s_a[i] == NULL)
+      continue;
+    int written = 0;
+    for (int j = 0; j < nargs; j++)
+      written |= s_a[j] != NULL && args[j].dat == args[i].dat &&
+                 args[j].acc != OP_READ;
+    if (!written)
+      continue;
+    char **p = args[i].idx < -1 ? (char **)p_a[i] : &p_a[i];
+    for (int k = 0; k < (args[i].idx < -1 ? -args[i].idx : 1); k++)
+      if (p[k] == s_a[i] + k * args[i].size) // not a shared copy
+        op_dat_put_aos(args[i].dat, p[k], op_arg_soa_elem(n, args[i], k), 1);
+  }
+}
+
 inline void op_args_check(op_set set, int nargs, op_arg *args, int *ninds,
                           const char *name) {
   for (int n = 0; n < nargs; n++)
     op_arg_check(set, n, args[n], ninds, name);
 }
 
+// stages the SoA args of a loop, returns whether there are any
+inline int op_args_soa_stage(int nargs, op_arg *args, char **s_a) {
+  int soa = 0;
+  for (int i = 0; i < nargs; i++)
+    soa |= (s_a[i] = op_arg_soa_stage(args[i])) != NULL;
+  return soa;
+}
+
 #if __cplusplus >= 201103L
+#ifdef VECTORIZE
+//
+// vectorised execution path: direct args are addressed from precomputed base
+// pointers, indirect OP_READ args are gathered and indirect OP_INC args
+// accumulated in SIMD_VEC-wide staging arrays, and global reductions get one
+// private copy per lane, so the kernel calls of a chunk are independent
+//
+#include <tuple>
+#include <type_traits>
+
+#ifndef SIMD_VEC
+#define SIMD_VEC 4
+#endif
+
+enum op_simd_kind {
+  OP_SIMD_NONE = -1, // not supported, use the scalar path
+  OP_SIMD_DIRECT,
+  OP_SIMD_GBL_READ,
+  OP_SIMD_GBL_RED,
+  OP_SIMD_IND_READ,
+  OP_SIMD_IND_INC
+};
+
+inline int op_simd_classify(op_arg const &arg) {
+  if (arg.opt == 0)
+    return OP_SIMD_NONE;
+  if (arg.argtype == OP_ARG_GBL) {
+    if (arg.acc == OP_READ)
+      return OP_SIMD_GBL_READ;
+    if (arg.acc == OP_INC || arg.acc == OP_MIN || arg.acc == OP_MAX)
+      return OP_SIMD_GBL_RED;
+    return OP_SIMD_NONE;
+  }
+  if (arg.dat->soa) // staged element by element
+    return OP_SIMD_NONE;
+  if (arg.map == NULL)
+    return OP_SIMD_DIRECT;
+  if (arg.idx < 0)
+    return OP_SIMD_NONE;
+  if (arg.acc == OP_READ)
+    return OP_SIMD_IND_READ;
+  if (arg.acc == OP_INC)
+    return OP_SIMD_IND_INC;
+  return OP_SIMD_NONE;
+}
+
+template <typename T> struct op_simd_arg {
+  typedef typename std::remove_const<T>::type V;
+  int kind;
+  int dim;
+  size_t size; // bytes per element
+  char *base;  // dat or global data
+  int *map;    // map entries of this arg, already offset by idx
+  int mapdim;  // stride between map rows
+  V *stage;    // SIMD_VEC * dim staging values, lane-major
+  T *cur;      // kernel argument of lane 0 of the current chunk
+  int step;    // distance in T between the arguments of adjacent lanes
+};
+
+// staging memory of all the args of a loop, kept from loop to loop and
+// grown like blank_args
+static char *op_simd_stage = NULL;
+static size_t op_simd_stage_size = 0;
+
+// bytes of op_simd_stage an arg needs, rounded up to keep the next aligned
+inline size_t op_simd_stage_bytes(op_arg const &arg) {
+  return op_simd_classify(arg) >= OP_SIMD_GBL_RED
+             ? (SIMD_VEC * (size_t)arg.size + 63) & ~(size_t)63
+             : 0;
+}
+
+template <typename T>
+inline void op_simd_init(op_simd_arg<T> &a, op_arg const &arg,
+                         char *&stage) {
+  a.kind = op_simd_classify(arg);
+  a.dim = arg.dim;
+  a.size = arg.size;
+  a.base = arg.data;
+  a.map = NULL;
+  a.mapdim = 0;
+  a.stage = NULL;
+  if (a.kind == OP_SIMD_IND_READ || a.kind == OP_SIMD_IND_INC) {
+    a.map = arg.map_data + arg.idx;
+    a.mapdim = arg.map->dim;
+  }
+  if (a.kind >= OP_SIMD_GBL_RED) {
+    a.stage = (typename op_simd_arg<T>::V *)stage;
+    stage += op_simd_stage_bytes(arg);
+  }
+}
+
+template <typename T>
+inline void op_simd_gather(op_simd_arg<T> &a, op_arg const &arg, int n,
+                           int lanes) {
+  typedef typename op_simd_arg<T>::V V;
+  V *__restrict__ stage = a.stage;
+  a.cur = a.kind == OP_SIMD_DIRECT     ? (T *)(a.base + a.size * n)
+          : a.kind == OP_SIMD_GBL_READ ? (T *)a.base
+                                       : a.stage;
+  a.step = a.kind == OP_SIMD_GBL_READ ? 0 : a.dim;
+  if (a.kind == OP_SIMD_IND_READ) {
+    for (int i = 0; i < lanes; i++) {
+      V const *src = (V const *)(a.base + a.size * a.map[(n + i) * a.mapdim]);
+      for (int d = 0; d < a.dim; d++)
+        stage[i * a.dim + d] = src[d];
+    }
+  } else if (a.kind == OP_SIMD_IND_INC ||
+             (a.kind == OP_SIMD_GBL_RED && arg.acc == OP_INC)) {
+    for (int i = 0; i < lanes * a.dim; i++)
+      stage[i] = (V)0;
+  } else if (a.kind == OP_SIMD_GBL_RED) {
+    for (int i = 0; i < lanes; i++)
+      for (int d = 0; d < a.dim; d++)
+        stage[i * a.dim + d] = ((V *)a.base)[d];
+  }
+}
+
+template <typename T>
+inline void op_simd_scatter(op_simd_arg<T> &a, op_arg const &arg, int n,
+                            int lanes) {
+  typedef typename op_simd_arg<T>::V V;
+  if (a.kind == OP_SIMD_IND_INC) {
+    for (int i = 0; i < lanes; i++) {
+      V *dst = (V *)(a.base + a.size * a.map[(n + i) * a.mapdim]);
+      for (int d = 0; d < a.dim; d++)
+        dst[d] += a.stage[i * a.dim + d];
+    }
+  } else if (a.kind == OP_SIMD_GBL_RED) {
+    V *dst = (V *)a.base;
+    for (int i = 0; i < lanes; i++) {
+      for (int d = 0; d < a.dim; d++) {
+        V v = a.stage[i * a.dim + d];
+        if (arg.acc == OP_INC)
+          dst[d] += v;
+        else if (arg.acc == OP_MIN)
+          dst[d] = v < dst[d] ? v : dst[d];
+        else
+          dst[d] = v > dst[d] ? v : dst[d];
+      }
+    }
+  }
+}
+
+//
+// runs elements [begin, end) in chunks of SIMD_VEC
+//
+template <typename... T, size_t... I>
+inline void op_par_loop_simd(indices<I...>, void (*kernel)(T *...), int begin,
+                      int end, op_arg *args, op_simd_arg<T> &... a) {
+  for (int n = begin; n < end; n += SIMD_VEC) {
+    int lanes = MIN(SIMD_VEC, end - n);
+    (void)std::initializer_list<int>{
+        (op_simd_gather(a, args[I], n, lanes), 0)...};
+#pragma omp simd
+    for (int i = 0; i < lanes; i++)
+      kernel((a.cur + i * a.step)...);
+    (void)std::initializer_list<int>{
+        (op_simd_scatter(a, args[I], n, lanes), 0)...};
+  }
+}
+
+template <typename... OPARG>
+bool op_simd_eligible(OPARG const &... arguments) {
+  bool ok = true;
+  (void)std::initializer_list<int>{
+      (ok = ok && op_simd_classify(arguments) != OP_SIMD_NONE, 0)...};
+  return ok;
+}
+#endif
+
 //
 // op_par_loop routine implementation with index sequence
 //
-template <typename... T, typename... OPARG, size_t... I>
+template <typename... T, size_t... I>
 void op_par_loop_impl(indices<I...>, void (*kernel)(T *...), char const *name,
-                      op_set set, OPARG... arguments) {
-  constexpr int N = sizeof...(OPARG);
+                      op_set set, op_arg *args) {
+  constexpr int N = sizeof...(T);
 
-  char *p_a[N] = {((arguments.idx < -1)
-                       ? (char *)malloc(-1 * arguments.idx * sizeof(T))
+  char *p_a[N] = {((args[I].idx < -1)
+                       ? (char *)malloc(-1 * args[I].idx * sizeof(T))
                        : nullptr)...};
-  op_arg args[N] = {arguments...};
+  char *s_a[N] = {op_arg_soa_stage(args[I])...};
+  int soa = 0;
+  (void)std::initializer_list<int>{(soa |= s_a[I] != NULL, 0)...};
   // allocate scratch mememory to do double counting in indirect reduction
   (void)std::initializer_list<char *>{
-      ((arguments.argtype == OP_ARG_GBL && arguments.size > blank_args_size)
-           ? (blank_args_size = arguments.size,
+      ((args[I].argtype == OP_ARG_GBL && args[I].size > blank_args_size)
+           ? (blank_args_size = args[I].size,
               blank_args = (char *)op_malloc(blank_args_size))
            : nullptr)...};
   // consistency checks
@@ -86,53 +328,153 @@ void op_par_loop_impl(indices<I...>, void (*kernel)(T *...), char const *name,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, N, args);
   // loop over set elements
   int halo = 0;
+  int n_begin = 0;
+  int waited = 0;
 
-  for (int n = 0; n < n_upper; n++) {
-    if (n == set->core_size)
-      op_mpi_wait_all(20, args);
-    if (n == set->size)
+#ifdef VECTORIZE
+  // owned elements in SIMD_VEC chunks, exec halo left to the scalar loop
+  if (op_simd_eligible(args[I]...)) {
+    size_t bytes = 0;
+    (void)std::initializer_list<int>{
+        (bytes += op_simd_stage_bytes(args[I]), 0)...};
+    if (bytes > op_simd_stage_size) {
+      op_free(op_simd_stage);
+      op_simd_stage = (char *)op_malloc(bytes);
+      op_simd_stage_size = bytes;
+    }
+    char *stage = op_simd_stage;
+    std::tuple<op_simd_arg<T>...> a;
+    (void)std::initializer_list<int>{
+        (op_simd_init(std::get<I>(a), args[I], stage), 0)...};
+    int n_core = MIN(set->core_size, n_upper);
+    n_begin = MIN(set->size, n_upper);
+    op_par_loop_simd(indices<I...>{}, kernel, 0, n_core, args,
+                     std::get<I>(a)...);
+    if (n_core < n_upper) {
+      op_mpi_wait_all(N, args);
+      waited = 1;
+    }
+    op_par_loop_simd(indices<I...>{}, kernel, n_core, n_begin, args,
+                     std::get<I>(a)...);
+  }
+#endif
+
+  for (int n = n_begin; n < n_upper; n++) {
+    if (n == set->core_size && !waited) {
+      op_mpi_wait_all(N, args);
+      waited = 1;
+    }
+    if (n >= set->size)
       halo = 1;
     (void)std::initializer_list<int>{
-        (arguments.idx < -1 ? (op_arg_copy_in(n, arguments, (char **)p_a[I]), 0)
-                            : (op_arg_set(n, arguments, &p_a[I], halo), 0))...};
+        (s_a[I] ? 0
+         : args[I].idx < -1
+             ? (op_arg_copy_in(n, args[I], (char **)p_a[I]), 0)
+             : (op_arg_set(n, args[I], &p_a[I], halo), 0))...};
+    if (soa)
+      op_args_soa_in(n, N, args, p_a, s_a);
     kernel(((T *)p_a[I])...);
+    if (soa)
+      op_args_soa_out(n, N, args, p_a, s_a);
   }
-  if (n_upper == set->core_size || n_upper == 0)
+  if (!waited)
     op_mpi_wait_all(N, args);
 
   // set dirty bit on datasets touched
   op_mpi_set_dirtybit(N, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  (void)std::initializer_list<int>{
-      (op_mpi_reduce(&arguments, (T *)p_a[I]), 0)...};
+  op_mpi_reduce_combined(args, N);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, N, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
-  op_mpi_perf_comms(k_i, 20, args);
+  op_mpi_perf_comms(k_i, N, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
   (void)std::initializer_list<int>{
-      (arguments.idx < -1 ? free(p_a[I]), 0 : 0)...};
+      (args[I].idx < -1 ? free(p_a[I]), 0 : 0)...};
+  (void)std::initializer_list<int>{(op_free(s_a[I]), 0)...};
+}
+
+//
+// runs a loop queued by op_enqueue_loop
+//
+template <typename... T> void op_par_loop_run(op_kernel_descriptor desc) {
+  op_par_loop_impl(build_indices<sizeof...(T)>{},
+                   reinterpret_cast<void (*)(T *...)>(desc->fun), desc->name,
+                   desc->set, desc->args);
+}
+
+//
+// runs the listed elements of a queued loop, for sparse tiling
+//
+template <typename... T, size_t... I>
+void op_par_loop_list_impl(indices<I...>, void (*kernel)(T *...),
+                           op_arg *args, int const *list, int nlist) {
+  constexpr int N = sizeof...(T);
+
+  char *p_a[N] = {((args[I].idx < -1)
+                       ? (char *)malloc(-1 * args[I].idx * sizeof(T))
+                       : nullptr)...};
+  char *s_a[N] = {op_arg_soa_stage(args[I])...};
+  int soa = 0;
+  (void)std::initializer_list<int>{(soa |= s_a[I] != NULL, 0)...};
+  for (int i = 0; i < nlist; i++) {
+    int n = list[i];
+    (void)std::initializer_list<int>{
+        (s_a[I] ? 0
+         : args[I].idx < -1
+             ? (op_arg_copy_in(n, args[I], (char **)p_a[I]), 0)
+             : (op_arg_set(n, args[I], &p_a[I], 0), 0))...};
+    if (soa)
+      op_args_soa_in(n, N, args, p_a, s_a);
+    kernel(((T *)p_a[I])...);
+    if (soa)
+      op_args_soa_out(n, N, args, p_a, s_a);
+  }
+  (void)std::initializer_list<int>{
+      (args[I].idx < -1 ? free(p_a[I]), 0 : 0)...};
+  (void)std::initializer_list<int>{(op_free(s_a[I]), 0)...};
+}
+
+template <typename... T>
+void op_par_loop_run_list(op_kernel_descriptor desc, int const *list,
+                          int nlist) {
+  op_par_loop_list_impl(build_indices<sizeof...(T)>{},
+                        reinterpret_cast<void (*)(T *...)>(desc->fun),
+                        desc->args, list, nlist);
 }
 
 //
-// op_par_loop routine wrapper to create index sequence
+// op_par_loop routine wrapper to create index sequence, with OP_LAZY or
+// OP_TILE_SIZE the loop is queued instead and runs at the next
+// synchronisation point
 //
 template <typename... T, typename... OPARG>
 void op_par_loop(void (*kernel)(T *...), char const *name, op_set set,
                  OPARG... arguments) {
-  op_par_loop_impl(build_indices<sizeof...(T)>{}, kernel, name, set,
-                   arguments...);
+  op_arg args[sizeof...(T)] = {arguments...};
+  if (OP_lazy || OP_tile_size > 0) {
+    op_enqueue_loop(name, set, sizeof...(T), args,
+                    reinterpret_cast<void (*)(void)>(kernel),
+                    op_par_loop_run<T...>, op_par_loop_run_list<T...>);
+    return;
+  }
+  op_par_loop_impl(build_indices<sizeof...(T)>{}, kernel, name, set, args);
 }
 
 #else // pre c++11
@@ -150,6 +492,9 @@ void op_par_loop(void (*kernel)(T0 *), char const *name, op_set set,
     p_a[0] = (char *)op_malloc(-1 * args[0].idx * sizeof(T0));
   }
 
+  char *s_a[1];
+  int soa = op_args_soa_stage(1, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 1; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -170,6 +515,8 @@ void op_par_loop(void (*kernel)(T0 *), char const *name, op_set set,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 1, args);
@@ -187,7 +534,11 @@ void op_par_loop(void (*kernel)(T0 *), char const *name, op_set set,
     else
       op_arg_set(n, args[0], &p_a[0], halo);
 
+    if (soa)
+      op_args_soa_in(n, 1, args, p_a, s_a);
     kernel((T0 *)p_a[0]);
+    if (soa)
+      op_args_soa_out(n, 1, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(1, args);
@@ -196,17 +547,22 @@ void op_par_loop(void (*kernel)(T0 *), char const *name, op_set set,
   op_mpi_set_dirtybit(1, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
+  op_mpi_reduce_combined(args, 1);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 1, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 1, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 1; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -228,6 +584,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *), char const *name, op_set set,
     p_a[1] = (char *)op_malloc(-1 * args[1].idx * sizeof(T1));
   }
 
+  char *s_a[2];
+  int soa = op_args_soa_stage(2, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 2; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -248,6 +607,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *), char const *name, op_set set,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 2, args);
@@ -269,7 +630,11 @@ void op_par_loop(void (*kernel)(T0 *, T1 *), char const *name, op_set set,
     else
       op_arg_set(n, args[1], &p_a[1], halo);
 
+    if (soa)
+      op_args_soa_in(n, 2, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1]);
+    if (soa)
+      op_args_soa_out(n, 2, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(2, args);
@@ -278,18 +643,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *), char const *name, op_set set,
   op_mpi_set_dirtybit(2, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
+  op_mpi_reduce_combined(args, 2);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 2, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 2, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 2; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -317,6 +686,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *), char const *name, op_set set,
     p_a[2] = (char *)op_malloc(-1 * args[2].idx * sizeof(T2));
   }
 
+  char *s_a[3];
+  int soa = op_args_soa_stage(3, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 3; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -337,6 +709,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *), char const *name, op_set set,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 3, args);
@@ -362,7 +736,11 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *), char const *name, op_set set,
     else
       op_arg_set(n, args[2], &p_a[2], halo);
 
+    if (soa)
+      op_args_soa_in(n, 3, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2]);
+    if (soa)
+      op_args_soa_out(n, 3, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(3, args);
@@ -371,19 +749,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *), char const *name, op_set set,
   op_mpi_set_dirtybit(3, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
+  op_mpi_reduce_combined(args, 3);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 3, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 3, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 3; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -418,6 +799,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *), char const *name,
     p_a[3] = (char *)op_malloc(-1 * args[3].idx * sizeof(T3));
   }
 
+  char *s_a[4];
+  int soa = op_args_soa_stage(4, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 4; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -438,6 +822,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *), char const *name,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 4, args);
@@ -467,7 +853,11 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *), char const *name,
     else
       op_arg_set(n, args[3], &p_a[3], halo);
 
+    if (soa)
+      op_args_soa_in(n, 4, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3]);
+    if (soa)
+      op_args_soa_out(n, 4, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(4, args);
@@ -476,20 +866,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *), char const *name,
   op_mpi_set_dirtybit(4, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
+  op_mpi_reduce_combined(args, 4);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 4, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 4, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 4; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -530,6 +922,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *), char const *name,
     p_a[4] = (char *)op_malloc(-1 * args[4].idx * sizeof(T4));
   }
 
+  char *s_a[5];
+  int soa = op_args_soa_stage(5, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 5; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -550,6 +945,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *), char const *name,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 5, args);
@@ -583,8 +980,12 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *), char const *name,
     else
       op_arg_set(n, args[4], &p_a[4], halo);
 
+    if (soa)
+      op_args_soa_in(n, 5, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3],
            (T4 *)p_a[4]);
+    if (soa)
+      op_args_soa_out(n, 5, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(5, args);
@@ -593,21 +994,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *), char const *name,
   op_mpi_set_dirtybit(5, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
+  op_mpi_reduce_combined(args, 5);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 5, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 5, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 5; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -654,6 +1056,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *),
     p_a[5] = (char *)op_malloc(-1 * args[5].idx * sizeof(T5));
   }
 
+  char *s_a[6];
+  int soa = op_args_soa_stage(6, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 6; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -674,6 +1079,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *),
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 6, args);
@@ -711,8 +1118,12 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *),
     else
       op_arg_set(n, args[5], &p_a[5], halo);
 
+    if (soa)
+      op_args_soa_in(n, 6, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5]);
+    if (soa)
+      op_args_soa_out(n, 6, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(6, args);
@@ -721,22 +1132,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *),
   op_mpi_set_dirtybit(6, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
+  op_mpi_reduce_combined(args, 6);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 6, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 6, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 6; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -790,6 +1201,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *),
     p_a[6] = (char *)op_malloc(-1 * args[6].idx * sizeof(T6));
   }
 
+  char *s_a[7];
+  int soa = op_args_soa_stage(7, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 7; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -810,6 +1224,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *),
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 7, args);
@@ -851,8 +1267,12 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *),
     else
       op_arg_set(n, args[6], &p_a[6], halo);
 
+    if (soa)
+      op_args_soa_in(n, 7, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6]);
+    if (soa)
+      op_args_soa_out(n, 7, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(7, args);
@@ -861,23 +1281,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *),
   op_mpi_set_dirtybit(7, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
+  op_mpi_reduce_combined(args, 7);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 7, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 7, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 7; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -938,6 +1357,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *),
     p_a[7] = (char *)op_malloc(-1 * args[7].idx * sizeof(T7));
   }
 
+  char *s_a[8];
+  int soa = op_args_soa_stage(8, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 8; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -958,6 +1380,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *),
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 8, args);
@@ -1003,8 +1427,12 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *),
     else
       op_arg_set(n, args[7], &p_a[7], halo);
 
+    if (soa)
+      op_args_soa_in(n, 8, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7]);
+    if (soa)
+      op_args_soa_out(n, 8, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(8, args);
@@ -1013,24 +1441,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *),
   op_mpi_set_dirtybit(8, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
+  op_mpi_reduce_combined(args, 8);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 8, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 8, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 8; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -1098,6 +1524,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[8] = (char *)op_malloc(-1 * args[8].idx * sizeof(T8));
   }
 
+  char *s_a[9];
+  int soa = op_args_soa_stage(9, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 9; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -1118,6 +1547,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 9, args);
@@ -1167,8 +1598,12 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[8], &p_a[8], halo);
 
+    if (soa)
+      op_args_soa_in(n, 9, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8]);
+    if (soa)
+      op_args_soa_out(n, 9, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(9, args);
@@ -1177,25 +1612,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(9, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
+  op_mpi_reduce_combined(args, 9);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 9, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 9, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 9; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -1270,6 +1702,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[9] = (char *)op_malloc(-1 * args[9].idx * sizeof(T9));
   }
 
+  char *s_a[10];
+  int soa = op_args_soa_stage(10, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 10; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -1290,6 +1725,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 10, args);
@@ -1343,9 +1780,13 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[9], &p_a[9], halo);
 
+    if (soa)
+      op_args_soa_in(n, 10, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8],
            (T9 *)p_a[9]);
+    if (soa)
+      op_args_soa_out(n, 10, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(10, args);
@@ -1354,26 +1795,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(10, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
+  op_mpi_reduce_combined(args, 10);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 10, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 10, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 10; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -1455,6 +1892,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[10] = (char *)op_malloc(-1 * args[10].idx * sizeof(T10));
   }
 
+  char *s_a[11];
+  int soa = op_args_soa_stage(11, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 11; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -1475,6 +1915,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 11, args);
@@ -1532,9 +1974,13 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[10], &p_a[10], halo);
 
+    if (soa)
+      op_args_soa_in(n, 11, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10]);
+    if (soa)
+      op_args_soa_out(n, 11, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(11, args);
@@ -1543,27 +1989,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(11, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
+  op_mpi_reduce_combined(args, 11);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 11, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 11, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 11; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -1651,6 +2092,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[11] = (char *)op_malloc(-1 * args[11].idx * sizeof(T11));
   }
 
+  char *s_a[12];
+  int soa = op_args_soa_stage(12, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 12; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -1671,6 +2115,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 12, args);
@@ -1732,9 +2178,13 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[11], &p_a[11], halo);
 
+    if (soa)
+      op_args_soa_in(n, 12, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11]);
+    if (soa)
+      op_args_soa_out(n, 12, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(12, args);
@@ -1743,28 +2193,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(12, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
+  op_mpi_reduce_combined(args, 12);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 12, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 12, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 12; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -1858,6 +2302,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[12] = (char *)op_malloc(-1 * args[12].idx * sizeof(T12));
   }
 
+  char *s_a[13];
+  int soa = op_args_soa_stage(13, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 13; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -1878,6 +2325,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 13, args);
@@ -1943,9 +2392,13 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[12], &p_a[12], halo);
 
+    if (soa)
+      op_args_soa_in(n, 13, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12]);
+    if (soa)
+      op_args_soa_out(n, 13, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(13, args);
@@ -1954,29 +2407,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(13, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
+  op_mpi_reduce_combined(args, 13);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 13, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 13, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 13; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -2077,6 +2523,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[13] = (char *)op_malloc(-1 * args[13].idx * sizeof(T13));
   }
 
+  char *s_a[14];
+  int soa = op_args_soa_stage(14, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 14; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -2097,6 +2546,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 14, args);
@@ -2166,9 +2617,13 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[13], &p_a[13], halo);
 
+    if (soa)
+      op_args_soa_in(n, 14, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13]);
+    if (soa)
+      op_args_soa_out(n, 14, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(14, args);
@@ -2177,30 +2632,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(14, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
+  op_mpi_reduce_combined(args, 14);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 14, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 14, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 14; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -2308,6 +2755,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[14] = (char *)op_malloc(-1 * args[14].idx * sizeof(T14));
   }
 
+  char *s_a[15];
+  int soa = op_args_soa_stage(15, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 15; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -2328,6 +2778,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 15, args);
@@ -2401,10 +2853,14 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[14], &p_a[14], halo);
 
+    if (soa)
+      op_args_soa_in(n, 15, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14]);
+    if (soa)
+      op_args_soa_out(n, 15, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(15, args);
@@ -2413,31 +2869,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(15, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
+  op_mpi_reduce_combined(args, 15);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 15, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 15, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 15; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -2552,6 +2999,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[15] = (char *)op_malloc(-1 * args[15].idx * sizeof(T15));
   }
 
+  char *s_a[16];
+  int soa = op_args_soa_stage(16, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 16; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -2572,6 +3022,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 16, args);
@@ -2649,10 +3101,14 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[15], &p_a[15], halo);
 
+    if (soa)
+      op_args_soa_in(n, 16, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14], (T15 *)p_a[15]);
+    if (soa)
+      op_args_soa_out(n, 16, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(16, args);
@@ -2661,32 +3117,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(16, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
-  op_mpi_reduce(&arg15, (T15 *)p_a[15]);
+  op_mpi_reduce_combined(args, 16);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 16, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 16, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 16; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -2807,6 +3253,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[16] = (char *)op_malloc(-1 * args[16].idx * sizeof(T16));
   }
 
+  char *s_a[17];
+  int soa = op_args_soa_stage(17, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 17; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -2827,6 +3276,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 17, args);
@@ -2908,10 +3359,14 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[16], &p_a[16], halo);
 
+    if (soa)
+      op_args_soa_in(n, 17, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14], (T15 *)p_a[15], (T16 *)p_a[16]);
+    if (soa)
+      op_args_soa_out(n, 17, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(17, args);
@@ -2920,33 +3375,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(17, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
-  op_mpi_reduce(&arg15, (T15 *)p_a[15]);
-  op_mpi_reduce(&arg16, (T16 *)p_a[16]);
+  op_mpi_reduce_combined(args, 17);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 17, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 17, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 17; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -3074,6 +3518,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[17] = (char *)op_malloc(-1 * args[17].idx * sizeof(T17));
   }
 
+  char *s_a[18];
+  int soa = op_args_soa_stage(18, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 18; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -3094,6 +3541,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 18, args);
@@ -3179,10 +3628,14 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[17], &p_a[17], halo);
 
+    if (soa)
+      op_args_soa_in(n, 18, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14], (T15 *)p_a[15], (T16 *)p_a[16], (T17 *)p_a[17]);
+    if (soa)
+      op_args_soa_out(n, 18, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(18, args);
@@ -3191,34 +3644,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(18, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
-  op_mpi_reduce(&arg15, (T15 *)p_a[15]);
-  op_mpi_reduce(&arg16, (T16 *)p_a[16]);
-  op_mpi_reduce(&arg17, (T17 *)p_a[17]);
+  op_mpi_reduce_combined(args, 18);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 18, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 18, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 18; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -3353,6 +3794,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[18] = (char *)op_malloc(-1 * args[18].idx * sizeof(T18));
   }
 
+  char *s_a[19];
+  int soa = op_args_soa_stage(19, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 19; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -3373,6 +3817,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 19, args);
@@ -3462,11 +3908,15 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[18], &p_a[18], halo);
 
+    if (soa)
+      op_args_soa_in(n, 19, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14], (T15 *)p_a[15], (T16 *)p_a[16], (T17 *)p_a[17],
            (T18 *)p_a[18]);
+    if (soa)
+      op_args_soa_out(n, 19, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(19, args);
@@ -3475,35 +3925,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(19, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
-  op_mpi_reduce(&arg15, (T15 *)p_a[15]);
-  op_mpi_reduce(&arg16, (T16 *)p_a[16]);
-  op_mpi_reduce(&arg17, (T17 *)p_a[17]);
-  op_mpi_reduce(&arg18, (T18 *)p_a[18]);
+  op_mpi_reduce_combined(args, 19);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 19, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 19, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 19; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -3645,6 +4082,9 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     p_a[19] = (char *)op_malloc(-1 * args[19].idx * sizeof(T19));
   }
 
+  char *s_a[20];
+  int soa = op_args_soa_stage(20, args, s_a);
+
   // allocate scratch mememory to do double counting in indirect reduction
   for (int i = 0; i < 20; i++)
     if (args[i].argtype == OP_ARG_GBL && args[i].size > blank_args_size) {
@@ -3665,6 +4105,8 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   // initialise timers
   double cpu_t1, cpu_t2, wall_t1, wall_t2;
   op_timers_core(&cpu_t1, &wall_t1);
+  if (OP_instrument)
+    op_instrument_begin();
 
   // MPI halo exchange and dirty bit setting, if needed
   int n_upper = op_mpi_halo_exchanges(set, 20, args);
@@ -3758,11 +4200,15 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
     else
       op_arg_set(n, args[19], &p_a[19], halo);
 
+    if (soa)
+      op_args_soa_in(n, 20, args, p_a, s_a);
     kernel((T0 *)p_a[0], (T1 *)p_a[1], (T2 *)p_a[2], (T3 *)p_a[3], (T4 *)p_a[4],
            (T5 *)p_a[5], (T6 *)p_a[6], (T7 *)p_a[7], (T8 *)p_a[8], (T9 *)p_a[9],
            (T10 *)p_a[10], (T11 *)p_a[11], (T12 *)p_a[12], (T13 *)p_a[13],
            (T14 *)p_a[14], (T15 *)p_a[15], (T16 *)p_a[16], (T17 *)p_a[17],
            (T18 *)p_a[18], (T19 *)p_a[19]);
+    if (soa)
+      op_args_soa_out(n, 20, args, p_a, s_a);
   }
   if (n_upper == set->core_size || n_upper == 0)
     op_mpi_wait_all(20, args);
@@ -3771,36 +4217,22 @@ void op_par_loop(void (*kernel)(T0 *, T1 *, T2 *, T3 *, T4 *, T5 *, T6 *, T7 *,
   op_mpi_set_dirtybit(20, args);
 
   // global reduction for MPI execution, if needed
-  // p_a simply used to determine type for MPI reduction
-  op_mpi_reduce(&arg0, (T0 *)p_a[0]);
-  op_mpi_reduce(&arg1, (T1 *)p_a[1]);
-  op_mpi_reduce(&arg2, (T2 *)p_a[2]);
-  op_mpi_reduce(&arg3, (T3 *)p_a[3]);
-  op_mpi_reduce(&arg4, (T4 *)p_a[4]);
-  op_mpi_reduce(&arg5, (T5 *)p_a[5]);
-  op_mpi_reduce(&arg6, (T6 *)p_a[6]);
-  op_mpi_reduce(&arg7, (T7 *)p_a[7]);
-  op_mpi_reduce(&arg8, (T8 *)p_a[8]);
-  op_mpi_reduce(&arg9, (T9 *)p_a[9]);
-  op_mpi_reduce(&arg10, (T10 *)p_a[10]);
-  op_mpi_reduce(&arg11, (T11 *)p_a[11]);
-  op_mpi_reduce(&arg12, (T12 *)p_a[12]);
-  op_mpi_reduce(&arg13, (T13 *)p_a[13]);
-  op_mpi_reduce(&arg14, (T14 *)p_a[14]);
-  op_mpi_reduce(&arg15, (T15 *)p_a[15]);
-  op_mpi_reduce(&arg16, (T16 *)p_a[16]);
-  op_mpi_reduce(&arg17, (T17 *)p_a[17]);
-  op_mpi_reduce(&arg18, (T18 *)p_a[18]);
-  op_mpi_reduce(&arg19, (T19 *)p_a[19]);
+  op_mpi_reduce_combined(args, 20);
 
   // update timer record
   op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_instrument)
+    op_instrument_end(name, set, 20, args, wall_t2 - wall_t1);
+  if (OP_trace)
+    op_trace_loop(name, wall_t1, wall_t2);
 #ifdef COMM_PERF
   void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);
   op_mpi_perf_comms(k_i, 20, args);
 #else
   op_mpi_perf_time(name, wall_t2 - wall_t1);
 #endif
+  for (int i = 0; i < 20; i++)
+    op_free(s_a[i]);
 
   if (arg0.idx < -1) {
     free(p_a[0]);
@@ -35,10 +35,24 @@
  * OP2 implementation
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // syscall(), g++ predefines it
+#endif
+
 #include "op_lib_core.h"
+#include "op_lib_c.h"
 #include <malloc.h>
 #include <string.h>
 #include <sys/time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /*
  * OP2 global state variables
@@ -51,6 +65,24 @@ double OP_hybrid_balance = 1.0;
 int OP_hybrid_gpu = 0;
 int OP_auto_soa = 0;
 int OP_maps_base_index = 0;
+char *OP_plan_cache_dir = NULL;
+int OP_color_order = OP_COLOR_NATURAL;
+int OP_color_balance = 0;
+int OP_atomics = 0;
+int OP_instrument = 0;
+char *OP_instrument_file = NULL;
+int OP_trace = 0;
+char *OP_trace_file = NULL;
+int OP_halo_aggregate = 0;
+int OP_halo_persistent = 0;
+int OP_halo_shm = 0;
+int OP_reduce_defer = 0;
+int OP_lazy = 0;
+int OP_tile_size = 0;
+int OP_numa = 0;
+int OP_hugepages = 0;
+int OP_temp_nozero = 0;
+int OP_async_io = 0;
 
 int OP_set_index = 0, OP_set_max = 0, OP_map_index = 0, OP_map_max = 0,
     OP_dat_index = 0, OP_kern_max = 0, OP_kern_curr = 0;
@@ -64,6 +96,76 @@ op_map *OP_map_list;
 Double_linked_list OP_dat_list; /*Head of the double linked list*/
 op_kernel *OP_kernels;
 
+/*
+ * Per-loop instrumentation records, kept apart from OP_kernels since the
+ * header-only sequential op_par_loop does not have a kernel index
+ */
+
+#define OP_INSTR_CYCLES 0
+#define OP_INSTR_INSTRUCTIONS 1
+#define OP_INSTR_LLC_MISSES 2
+#define OP_INSTR_NCOUNTERS 3
+
+typedef struct {
+  char const *name; /* name of kernel function */
+  int count;        /* number of times called */
+  double time;      /* total execution time */
+  double bytes;     /* bytes moved, derived from the op_arg list */
+  double counters[OP_INSTR_NCOUNTERS]; /* hardware counter totals */
+} op_instr_kernel;
+
+static op_instr_kernel *OP_instr_kernels = NULL;
+static int OP_instr_index = 0, OP_instr_max = 0, OP_instr_curr = 0;
+static int OP_instr_fd[OP_INSTR_NCOUNTERS] = {-1, -1, -1};
+static int OP_instr_opened = 0;
+static long long OP_instr_start[OP_INSTR_NCOUNTERS];
+static int *OP_instr_touched = NULL; /* distinct targets per map, -1 if unset */
+static int OP_instr_touched_max = 0;
+
+/*
+ * Per-thread event rings of the tracer, registered in OP_trace_rings by a
+ * single atomic increment when a thread records its first event
+ */
+
+#define OP_TRACE_MAX_THREADS 256
+#define OP_TRACE_EVENTS (1 << 16)
+
+typedef struct {
+  char const *name; /* event name, a string that outlives the run */
+  char const *cat;  /* category: loop, halo, wait, compute, reduction, plan */
+  double t0, t1;    /* wall-clock begin and end */
+} op_trace_rec;
+
+typedef struct {
+  op_trace_rec *buf;
+  unsigned long head; /* number of events ever recorded */
+  char const *phase;  /* compute phase open on this thread, if any */
+  double phase_t0;
+} op_trace_ring;
+
+static op_trace_ring *OP_trace_rings[OP_TRACE_MAX_THREADS];
+static int OP_trace_nthreads = 0;
+static int OP_trace_generation = 0;
+static __thread op_trace_ring *OP_trace_mine = NULL;
+static __thread int OP_trace_mine_generation = -1;
+
+static op_trace_ring *op_trace_ring_get(void) {
+  if (OP_trace_mine_generation == OP_trace_generation)
+    return OP_trace_mine;
+  OP_trace_mine_generation = OP_trace_generation;
+  OP_trace_mine = NULL;
+  int tid = __sync_fetch_and_add(&OP_trace_nthreads, 1);
+  if (tid >= OP_TRACE_MAX_THREADS)
+    return NULL;
+  op_trace_ring *ring = (op_trace_ring *)calloc(1, sizeof(op_trace_ring));
+  ring->buf = (op_trace_rec *)malloc(OP_TRACE_EVENTS * sizeof(op_trace_rec));
+  OP_trace_rings[tid] = ring;
+  OP_trace_mine = ring;
+  return ring;
+}
+
+static void op_trace_free(void);
+
 const char *doublestr = "double";
 const char *floatstr = "float";
 const char *intstr = "int";
@@ -126,6 +228,21 @@ void check_map(char const *name, op_set from, op_set to, int dim, int *map) {
   }
 }
 
+// sets OP_color_order from the value of OP_COLOR_ORDER
+static void op_set_color_order(char const *order) {
+  if (strncmp(order, "largest-first", 13) == 0)
+    OP_color_order = OP_COLOR_LARGEST_FIRST;
+  else if (strncmp(order, "smallest-last", 13) == 0)
+    OP_color_order = OP_COLOR_SMALLEST_LAST;
+  else
+    OP_color_order = OP_COLOR_NATURAL;
+  op_printf("\n OP_color_order  = %s \n",
+            OP_color_order == OP_COLOR_LARGEST_FIRST
+                ? "largest-first"
+                : OP_color_order == OP_COLOR_SMALLEST_LAST ? "smallest-last"
+                                                           : "natural");
+}
+
 /* Special function to get commandline arguments, articularly useful as argv
 *  is not easy to pass through from frotran to C
 */
@@ -161,6 +278,103 @@ void op_set_args(int argc, char *argv) {
     OP_auto_soa = 1;
     op_printf("\n Enabling Automatic AoS->SoA Conversion\n");
   }
+  pch = strstr(argv, "OP_ATOMICS");
+  if (pch != NULL) {
+    OP_atomics = 1;
+    op_printf("\n Enabling atomic increments in OpenMP indirect loops\n");
+  }
+  pch = strstr(argv, "OP_INSTRUMENT");
+  if (pch != NULL) {
+    OP_instrument = 1;
+    if (pch[13] == '=') {
+      free(OP_instrument_file);
+      OP_instrument_file = copy_str(pch + 14);
+    }
+    op_printf("\n Enabling per-loop instrumentation\n");
+  }
+  pch = strstr(argv, "OP_TRACE");
+  if (pch != NULL) {
+    OP_trace = 1;
+    if (pch[8] == '=') {
+      free(OP_trace_file);
+      OP_trace_file = copy_str(pch + 9);
+    }
+    op_printf("\n Enabling event tracing\n");
+  }
+  pch = strstr(argv, "OP_HALO_AGGREGATE");
+  if (pch != NULL) {
+    OP_halo_aggregate = pch[17] == '=' ? atoi(pch + 18) != 0 : 1;
+    if (OP_halo_aggregate)
+      op_printf("\n Enabling aggregated halo messages\n");
+  }
+  pch = strstr(argv, "OP_HALO_PERSISTENT");
+  if (pch != NULL) {
+    OP_halo_persistent = pch[18] == '=' ? atoi(pch + 19) != 0 : 1;
+    if (OP_halo_persistent)
+      op_printf("\n Enabling persistent halo requests\n");
+  }
+  pch = strstr(argv, "OP_HALO_SHM");
+  if (pch != NULL) {
+    OP_halo_shm = pch[11] == '=' ? atoi(pch + 12) != 0 : 1;
+    if (OP_halo_shm)
+      op_printf("\n Enabling shared memory halo exchange within a node\n");
+  }
+  pch = strstr(argv, "OP_REDUCE_DEFER");
+  if (pch != NULL) {
+    OP_reduce_defer = pch[15] == '=' ? atoi(pch + 16) != 0 : 1;
+    if (OP_reduce_defer)
+      op_printf("\n Enabling deferred global reductions\n");
+  }
+  pch = strstr(argv, "OP_LAZY");
+  if (pch != NULL) {
+    OP_lazy = pch[7] == '=' ? atoi(pch + 8) != 0 : 1;
+    if (OP_lazy)
+      op_printf("\n Enabling lazy loop execution\n");
+  }
+  pch = strstr(argv, "OP_NUMA");
+  if (pch != NULL) {
+    OP_numa = 1;
+    op_printf("\n Enabling NUMA-aware first-touch allocation\n");
+  }
+  pch = strstr(argv, "OP_HUGEPAGES");
+  if (pch != NULL) {
+    OP_hugepages = 1;
+    op_printf("\n Enabling transparent huge pages for large arrays\n");
+  }
+  pch = strstr(argv, "OP_TEMP_NOZERO");
+  if (pch != NULL) {
+    OP_temp_nozero = 1;
+    op_printf("\n Recycled temporary op_dats are not zeroed\n");
+  }
+  pch = strstr(argv, "OP_ASYNC_IO");
+  if (pch != NULL) {
+    strncpy(temp, pch, 25);
+    OP_async_io = temp[11] == '=' ? atoi(temp + 12) : 2;
+    op_printf("\n Writing HDF5 output in the background, %d writes in "
+              "flight\n",
+              OP_async_io);
+  }
+  pch = strstr(argv, "OP_TILE_SIZE=");
+  if (pch != NULL) {
+    strncpy(temp, pch, 25);
+    OP_tile_size = atoi(temp + 13);
+    op_printf("\n OP_tile_size = %d \n", OP_tile_size);
+  }
+  pch = strstr(argv, "OP_PLAN_CACHE=");
+  if (pch != NULL) {
+    free(OP_plan_cache_dir);
+    OP_plan_cache_dir = copy_str(pch + 14);
+    op_printf("\n OP_plan_cache  = %s \n", OP_plan_cache_dir);
+  }
+  pch = strstr(argv, "OP_COLOR_ORDER=");
+  if (pch != NULL)
+    op_set_color_order(pch + 15);
+  pch = strstr(argv, "OP_COLOR_BALANCE=");
+  if (pch != NULL) {
+    strncpy(temp, pch, 20);
+    OP_color_balance = atoi(temp + 17);
+    op_printf("\n OP_color_balance  = %d \n", OP_color_balance);
+  }
   pch = strstr(argv, "OP_HYBRID_BALANCE=");
   if (pch != NULL) {
     strncpy(temp, pch, 25);
@@ -199,6 +413,76 @@ void op_init_core(int argc, char **argv, int diags) {
     op_printf("\n OP_hybrid_balance  = %g \n", OP_hybrid_balance);
   }
 
+  if (getenv("OP_PLAN_CACHE")) {
+    free(OP_plan_cache_dir);
+    OP_plan_cache_dir = copy_str(getenv("OP_PLAN_CACHE"));
+    op_printf("\n OP_plan_cache  = %s \n", OP_plan_cache_dir);
+  }
+
+  if (getenv("OP_INSTRUMENT")) {
+    char *val = getenv("OP_INSTRUMENT");
+    OP_instrument = strcmp(val, "0") != 0;
+    if (OP_instrument && val[0] != '\0' && strcmp(val, "1") != 0) {
+      free(OP_instrument_file);
+      OP_instrument_file = copy_str(val);
+    }
+    if (OP_instrument)
+      op_printf("\n Enabling per-loop instrumentation\n");
+  }
+
+  if (getenv("OP_TRACE")) {
+    char *val = getenv("OP_TRACE");
+    OP_trace = strcmp(val, "0") != 0;
+    if (OP_trace && val[0] != '\0' && strcmp(val, "1") != 0) {
+      free(OP_trace_file);
+      OP_trace_file = copy_str(val);
+    }
+    if (OP_trace)
+      op_printf("\n Enabling event tracing\n");
+  }
+
+  if (getenv("OP_HALO_AGGREGATE")) {
+    OP_halo_aggregate = strcmp(getenv("OP_HALO_AGGREGATE"), "0") != 0;
+    if (OP_halo_aggregate)
+      op_printf("\n Enabling aggregated halo messages\n");
+  }
+
+  if (getenv("OP_HALO_PERSISTENT")) {
+    OP_halo_persistent = strcmp(getenv("OP_HALO_PERSISTENT"), "0") != 0;
+    if (OP_halo_persistent)
+      op_printf("\n Enabling persistent halo requests\n");
+  }
+
+  if (getenv("OP_HALO_SHM")) {
+    OP_halo_shm = strcmp(getenv("OP_HALO_SHM"), "0") != 0;
+    if (OP_halo_shm)
+      op_printf("\n Enabling shared memory halo exchange within a node\n");
+  }
+
+  if (getenv("OP_REDUCE_DEFER")) {
+    OP_reduce_defer = strcmp(getenv("OP_REDUCE_DEFER"), "0") != 0;
+    if (OP_reduce_defer)
+      op_printf("\n Enabling deferred global reductions\n");
+  }
+
+  if (getenv("OP_LAZY")) {
+    OP_lazy = strcmp(getenv("OP_LAZY"), "0") != 0;
+    if (OP_lazy)
+      op_printf("\n Enabling lazy loop execution\n");
+  }
+
+  if (getenv("OP_COLOR_ORDER"))
+    op_set_color_order(getenv("OP_COLOR_ORDER"));
+
+  if (getenv("OP_COLOR_BALANCE")) {
+    OP_color_balance = atoi(getenv("OP_COLOR_BALANCE"));
+    op_printf("\n OP_color_balance  = %d \n", OP_color_balance);
+  }
+
+  if (getenv("OP_TILE_SIZE")) {
+    OP_tile_size = atoi(getenv("OP_TILE_SIZE"));
+    op_printf("\n OP_tile_size = %d \n", OP_tile_size);
+  }
   if (getenv("OP_AUTO_SOA") || OP_auto_soa == 1) {
     OP_auto_soa = 1;
     op_printf("\n Enabling Automatic AoS->SoA Conversion\n");
@@ -375,6 +659,7 @@ op_dat op_decl_dat_core(op_set set, int dim, char const *type, int size,
   dat->buffer_d = NULL;
   dat->buffer_d_r = NULL;
   dat->dirty_hd = 0;
+  dat->soa = 0;
 
   /* Create a pointer to an item in the op_dats doubly linked list */
   op_dat_entry *item;
@@ -442,6 +727,294 @@ int op_free_dat_temp_core(op_dat dat) {
   return success;
 }
 
+/*
+ * Pool of temporary dat data blocks: op_free_dat_temp hands the block (and
+ * the backend's halo buffers) back here, keyed by set and element size, and
+ * the next temporary dat of that shape on the set reuses it
+ */
+
+typedef struct {
+  int set;          /* index of the set */
+  int size;         /* element size in bytes */
+  size_t bytes;     /* size of the data block */
+  char *data;       /* data block */
+  void *mpi_buffer; /* halo buffers of the backend, or NULL */
+} op_temp_block;
+
+typedef struct {
+  int allocated;  /* blocks allocated */
+  int reused;     /* blocks taken from the pool */
+  size_t live;    /* bytes held by temporary dats */
+  size_t pooled;  /* bytes held by the pool */
+  size_t peak;    /* high-water mark of live + pooled */
+  int peak_live;  /* high-water mark of temporary dats */
+  int num_live;   /* temporary dats */
+} op_temp_stats;
+
+static op_temp_block *OP_temp_pool = NULL;
+static int OP_temp_pool_index = 0, OP_temp_pool_max = 0;
+static op_temp_stats *OP_temp_stats = NULL;
+static int OP_temp_stats_max = 0;
+
+static op_temp_stats *op_temp_stats_get(op_set set) {
+  if (set->index >= OP_temp_stats_max) {
+    int max = OP_set_max > set->index ? OP_set_max : set->index + 1;
+    OP_temp_stats = (op_temp_stats *)op_realloc(OP_temp_stats,
+                                                max * sizeof(op_temp_stats));
+    memset(&OP_temp_stats[OP_temp_stats_max], 0,
+           (max - OP_temp_stats_max) * sizeof(op_temp_stats));
+    OP_temp_stats_max = max;
+  }
+  return &OP_temp_stats[set->index];
+}
+
+/* data block of n elements for a temporary dat, zeroed unless it is recycled
+ * and OP_TEMP_NOZERO is set; *mpi_buffer returns the halo buffers kept with a
+ * recycled block, NULL if the backend has to create them */
+char *op_temp_pool_alloc(op_dat dat, int n, void **mpi_buffer) {
+  op_temp_stats *st = op_temp_stats_get(dat->set);
+  size_t bytes = (size_t)n * dat->size;
+  char *data = NULL;
+  *mpi_buffer = NULL;
+
+  for (int i = OP_temp_pool_index - 1; i >= 0; i--) { // latest freed first
+    op_temp_block *b = &OP_temp_pool[i];
+    if (b->set == dat->set->index && b->size == dat->size &&
+        b->bytes == bytes) {
+      data = b->data;
+      *mpi_buffer = b->mpi_buffer;
+      OP_temp_pool[i] = OP_temp_pool[--OP_temp_pool_index];
+      st->pooled -= bytes;
+      st->reused++;
+      if (!OP_temp_nozero)
+        memset(data, 0, bytes);
+      break;
+    }
+  }
+
+  if (data == NULL) {
+    data = dat->soa ? op_numa_alloc(NULL, dat->dim, n, dat->size / dat->dim)
+                    : op_numa_alloc(NULL, 1, n, dat->size);
+    st->allocated++;
+  }
+
+  st->live += bytes;
+  st->num_live++;
+  st->peak = MAX(st->peak, st->live + st->pooled);
+  st->peak_live = MAX(st->peak_live, st->num_live);
+  return data;
+}
+
+/* return the data block of n elements and the halo buffers of a temporary
+ * dat to the pool */
+void op_temp_pool_release(op_dat dat, int n, void *mpi_buffer) {
+  op_temp_stats *st = op_temp_stats_get(dat->set);
+  size_t bytes = (size_t)n * dat->size;
+
+  if (OP_temp_pool_index == OP_temp_pool_max) {
+    OP_temp_pool_max += 10;
+    OP_temp_pool = (op_temp_block *)op_realloc(
+        OP_temp_pool, OP_temp_pool_max * sizeof(op_temp_block));
+  }
+  op_temp_block *b = &OP_temp_pool[OP_temp_pool_index++];
+  b->set = dat->set->index;
+  b->size = dat->size;
+  b->bytes = bytes;
+  b->data = dat->data;
+  b->mpi_buffer = mpi_buffer;
+
+  dat->data = NULL;
+  dat->mpi_buffer = NULL;
+  st->live -= bytes;
+  st->pooled += bytes;
+  st->num_live--;
+}
+
+/* free the pooled blocks, passing their halo buffers to free_buffer */
+void op_temp_pool_free(void (*free_buffer)(void *)) {
+  for (int i = 0; i < OP_temp_pool_index; i++) {
+    free(OP_temp_pool[i].data);
+    if (OP_temp_pool[i].mpi_buffer != NULL)
+      free_buffer(OP_temp_pool[i].mpi_buffer);
+  }
+  free(OP_temp_pool);
+  OP_temp_pool = NULL;
+  OP_temp_pool_index = OP_temp_pool_max = 0;
+}
+
+static void op_temp_pool_output(void) {
+  int used = 0;
+  for (int n = 0; n < OP_temp_stats_max; n++)
+    used = used || OP_temp_stats[n].allocated > 0;
+  if (!used)
+    return;
+
+  printf("\n  temporary dat pool\n");
+  printf("       set  allocated     reused  peak dats    peak MB  pooled MB\n");
+  printf("  -------------------------------------------------------------\n");
+  for (int n = 0; n < OP_temp_stats_max && n < OP_set_index; n++) {
+    op_temp_stats *st = &OP_temp_stats[n];
+    if (st->allocated == 0)
+      continue;
+    printf("%10s %10d %10d %10d %10.2f %10.2f\n", OP_set_list[n]->name,
+           st->allocated, st->reused, st->peak_live, st->peak / 1e6,
+           st->pooled / 1e6);
+  }
+}
+
+/*
+ * NUMA-aware allocation (OP_NUMA): a page is placed on the node of the thread
+ * that first writes it, so arrays are written by the OpenMP threads with the
+ * element split of the OpenMP direct loops, thread thr taking elements
+ * [n * thr / nthreads, n * (thr + 1) / nthreads). With OP_HUGEPAGES arrays of
+ * 2MB or more are also advised to use transparent huge pages.
+ */
+
+#define OP_HUGEPAGE_SIZE (2 << 20)
+
+static void op_numa_range(int n, size_t *first, size_t *last) {
+  int thr = 0, nthreads = 1;
+#ifdef _OPENMP
+  thr = omp_get_thread_num();
+  nthreads = omp_get_num_threads();
+#endif
+  *first = (size_t)n * thr / nthreads;
+  *last = (size_t)n * (thr + 1) / nthreads;
+}
+
+char *op_numa_malloc(size_t bytes) {
+#ifdef MADV_HUGEPAGE
+  void *data = NULL;
+  if (OP_hugepages && bytes >= OP_HUGEPAGE_SIZE &&
+      posix_memalign(&data, OP_HUGEPAGE_SIZE, bytes) == 0) {
+    madvise(data, bytes, MADV_HUGEPAGE);
+    return (char *)data;
+  }
+#endif
+  return (char *)op_malloc(bytes > 0 ? bytes : 1);
+}
+
+/* ncomp consecutive runs of n elements of size bytes, copied from src or
+ * zeroed, each run split between the threads by element */
+char *op_numa_alloc(char const *src, int ncomp, int n, size_t size) {
+  char *data = op_numa_malloc((size_t)ncomp * n * size);
+#ifdef _OPENMP
+#pragma omp parallel if (OP_numa)
+#endif
+  {
+    size_t first, last;
+    op_numa_range(n, &first, &last);
+    for (int c = 0; c < ncomp; c++) {
+      size_t off = ((size_t)c * n + first) * size;
+      if (src != NULL)
+        memcpy(data + off, src + off, (last - first) * size);
+      else
+        memset(data + off, 0, (last - first) * size);
+    }
+  }
+  return data;
+}
+
+/* move the storage of a dat, halos included, to first-touched pages */
+void op_dat_numa_place(op_dat dat) {
+  if (dat->data == NULL)
+    return;
+  int n = op_dat_soa_stride(dat);
+  char *data =
+      dat->soa ? op_numa_alloc(dat->data, dat->dim, n, dat->size / dat->dim)
+               : op_numa_alloc(dat->data, 1, n, dat->size);
+  if (!dat->user_managed)
+    op_free(dat->data);
+  dat->data = data;
+  dat->user_managed = 0;
+}
+
+void op_map_numa_place(op_map map, int n) {
+  if (map->map == NULL)
+    return;
+  int *m = (int *)op_numa_alloc((char *)map->map, 1, n, map->dim * sizeof(int));
+  if (!map->user_managed)
+    op_free(map->map);
+  map->map = m;
+  map->user_managed = 0;
+}
+
+/*
+ * SoA host storage: a dat declared with a ":soa" type (or any multi-component
+ * dat when OP_auto_soa is set) is stored component-major on the host, with
+ * component d of element e at data[(d * stride + e) * size / dim]. The stride
+ * covers the owned elements and the import halos.
+ */
+
+int op_dat_soa_type(op_dat dat) {
+  return strstr(dat->type, ":soa") != NULL || (OP_auto_soa && dat->dim > 1);
+}
+
+int op_dat_soa_stride(op_dat dat) {
+  return dat->set->size + dat->set->exec_size + dat->set->nonexec_size;
+}
+
+void op_dat_set_soa(op_dat dat, int soa) {
+  soa = soa && dat->dim > 1; // a single component is laid out the same way
+  if (dat->soa == soa)
+    return;
+
+  if (dat->data != NULL) {
+    int stride = op_dat_soa_stride(dat);
+    size_t esz = dat->size / dat->dim;
+    char *data = op_numa_malloc((size_t)stride * dat->size);
+#ifdef _OPENMP
+#pragma omp parallel if (OP_numa)
+#endif
+    {
+      size_t first, last;
+      op_numa_range(stride, &first, &last);
+      for (int d = 0; d < dat->dim; d++) {
+        for (size_t e = first; e < last; e++) {
+          size_t aos = e * dat->size + d * esz;
+          size_t cm = ((size_t)d * stride + e) * esz;
+          if (soa)
+            memcpy(data + cm, dat->data + aos, esz);
+          else
+            memcpy(data + aos, dat->data + cm, esz);
+        }
+      }
+    }
+    if (!dat->user_managed)
+      op_free(dat->data);
+    dat->data = data;
+    dat->user_managed = 0;
+  }
+  dat->soa = soa;
+}
+
+/* copy elements [first, first+n) of dat out to / in from an AoS buffer */
+void op_dat_get_aos(op_dat dat, char *aos, int first, int n) {
+  if (!dat->soa) {
+    memcpy(aos, dat->data + (size_t)first * dat->size, (size_t)n * dat->size);
+    return;
+  }
+  int stride = op_dat_soa_stride(dat);
+  size_t esz = dat->size / dat->dim;
+  for (int e = 0; e < n; e++)
+    for (int d = 0; d < dat->dim; d++)
+      memcpy(aos + (size_t)e * dat->size + d * esz,
+             dat->data + ((size_t)d * stride + first + e) * esz, esz);
+}
+
+void op_dat_put_aos(op_dat dat, char const *aos, int first, int n) {
+  if (!dat->soa) {
+    memcpy(dat->data + (size_t)first * dat->size, aos, (size_t)n * dat->size);
+    return;
+  }
+  int stride = op_dat_soa_stride(dat);
+  size_t esz = dat->size / dat->dim;
+  for (int e = 0; e < n; e++)
+    for (int d = 0; d < dat->dim; d++)
+      memcpy(dat->data + ((size_t)d * stride + first + e) * esz,
+             aos + (size_t)e * dat->size + d * esz, esz);
+}
+
 void op_decl_const_core(int dim, char const *type, int typeSize, char *data,
                         char const *name) {
   (void)dim;
@@ -451,7 +1024,369 @@ void op_decl_const_core(int dim, char const *type, int typeSize, char *data,
   (void)name;
 }
 
+/*
+ * Lazy loop execution (OP_LAZY): loops are queued by op_enqueue_loop and run
+ * in order by op_flush, which is called at every synchronisation point
+ * (op_fetch_data, the end of a loop with a global reduction, op_exit, ...).
+ * Before the chain runs, op_mpi_chain_halo_exchanges posts every halo
+ * exchange that no earlier loop of the chain can invalidate.
+ */
+
+#define OP_LOOP_CHAIN_MAX 64
+
+static op_kernel_descriptor OP_loop_chain[OP_LOOP_CHAIN_MAX];
+static int OP_loop_chain_size = 0;
+
+void op_enqueue_loop(char const *name, op_set set, int nargs, op_arg *args,
+                     void (*fun)(void), void (*run)(op_kernel_descriptor),
+                     void (*run_list)(op_kernel_descriptor, int const *,
+                                      int)) {
+  op_kernel_descriptor desc =
+      (op_kernel_descriptor)op_malloc(sizeof(op_kernel_descriptor_core));
+  desc->name = name;
+  desc->set = set;
+  desc->nargs = nargs;
+  desc->args = (op_arg *)op_malloc(nargs * sizeof(op_arg));
+  desc->fun = fun;
+  desc->run = run;
+  desc->run_list = run_list;
+  memcpy(desc->args, args, nargs * sizeof(op_arg));
+
+  // the loop reads its OP_READ globals when it runs, so keep their values
+  // as they are now
+  int gbl_size = 0;
+  int reduction = 0;
+  for (int n = 0; n < nargs; n++) {
+    if (args[n].argtype != OP_ARG_GBL || args[n].data == NULL)
+      continue;
+    if (args[n].acc == OP_READ)
+      gbl_size += args[n].size;
+    else
+      reduction = 1;
+  }
+  desc->gbl = gbl_size > 0 ? (char *)op_malloc(gbl_size) : NULL;
+  gbl_size = 0;
+  for (int n = 0; n < nargs; n++) {
+    if (args[n].argtype == OP_ARG_GBL && args[n].data != NULL &&
+        args[n].acc == OP_READ) {
+      // a deferred reduction into the global has to land first
+      op_reduction_wait(args[n].data);
+      memcpy(desc->gbl + gbl_size, args[n].data, args[n].size);
+      desc->args[n].data = desc->gbl + gbl_size;
+      gbl_size += args[n].size;
+    }
+  }
+
+  OP_loop_chain[OP_loop_chain_size++] = desc;
+  // the result of a reduction is visible as soon as the loop returns
+  if (reduction || OP_loop_chain_size == OP_LOOP_CHAIN_MAX)
+    op_flush();
+}
+
+/*
+ * Sparse tiling of a queued loop chain (OP_TILE_SIZE=n). The iterations of
+ * every loop are spread over the tiles in proportion to their index, as the
+ * first loop's set is cut into tiles of n elements, and then moved to a later
+ * tile where needed so that no iteration runs in an earlier tile than an
+ * iteration of an earlier loop that touched the same set element. Running
+ * the tiles in order, and within a tile the loops in chain order, therefore
+ * keeps every dependency of the chain while the data of a tile stays in
+ * cache. Plans are cached by the shape of the chain. Under MPI the backend
+ * supplies the iterations of each loop, including redundant copies of
+ * iterations owned by other processes, see op_mpi_tile_chain.
+ */
+
+struct op_tile_plan_core {
+  int *sig;      /* shape of the chain the plan was built for */
+  int sig_len;
+  int nloops;
+  int ntiles;
+  int **offsets; /* per loop, start of each tile in elems */
+  int **elems;   /* per loop, iterations ordered by tile */
+  struct op_tile_plan_core *next;
+};
+
+static op_tile_plan *OP_tile_plans = NULL;
+
+int *op_tile_signature(int nloops, op_kernel_descriptor *chain, int *len) {
+  int n = 2;
+  for (int l = 0; l < nloops; l++)
+    n += 2 + 5 * chain[l]->nargs;
+  int *sig = (int *)op_malloc(n * sizeof(int));
+  int k = 0;
+  sig[k++] = OP_tile_size;
+  sig[k++] = nloops;
+  for (int l = 0; l < nloops; l++) {
+    sig[k++] = chain[l]->set->index;
+    sig[k++] = chain[l]->nargs;
+    for (int i = 0; i < chain[l]->nargs; i++) {
+      op_arg *arg = &chain[l]->args[i];
+      sig[k++] = arg->opt;
+      sig[k++] = arg->argtype;
+      sig[k++] = arg->map == NULL ? -1 : arg->map->index;
+      sig[k++] = arg->idx;
+      sig[k++] = arg->acc;
+    }
+  }
+  *len = n;
+  return sig;
+}
+
+// elements of set *s touched by arg at iteration e, returns their number
+static int op_tile_elements(op_arg *arg, op_set set, int e, int *elems,
+                            int *s) {
+  if (!arg->opt || arg->argtype != OP_ARG_DAT)
+    return 0;
+  if (arg->map == NULL) {
+    *s = set->index;
+    elems[0] = e;
+    return 1;
+  }
+  *s = arg->map->to->index;
+  int *row = arg->map->map + e * arg->map->dim;
+  if (arg->idx >= 0) {
+    elems[0] = row[arg->idx];
+    return 1;
+  }
+  for (int j = 0; j < -arg->idx; j++)
+    elems[j] = row[j];
+  return -arg->idx;
+}
+
+/*
+ * iters[l] lists the niters[l] iterations of loop l in ascending order, or is
+ * NULL for all of the loop's set, and nelems the number of local elements of
+ * each set (NULL for owned and halo elements)
+ */
+op_tile_plan *op_tile_plan_build(int nloops, op_kernel_descriptor *chain,
+                                 int *const *iters, int const *niters,
+                                 int const *nelems) {
+  op_tile_plan *plan = (op_tile_plan *)op_malloc(sizeof(op_tile_plan));
+  int seed = iters == NULL ? chain[0]->set->size : niters[0];
+  plan->sig = NULL;
+  plan->sig_len = 0;
+  plan->next = NULL;
+  plan->nloops = nloops;
+  plan->ntiles = MAX(1, (seed + OP_tile_size - 1) / OP_tile_size);
+  plan->offsets = (int **)op_malloc(nloops * sizeof(int *));
+  plan->elems = (int **)op_malloc(nloops * sizeof(int *));
+
+  // latest tile that touched each element of each set so far
+  int **tile_of = (int **)op_calloc(OP_set_index, sizeof(int *));
+  int max_dim = 1;
+  for (int l = 0; l < nloops; l++)
+    for (int i = 0; i < chain[l]->nargs; i++)
+      if (chain[l]->args[i].map != NULL)
+        max_dim = MAX(max_dim, chain[l]->args[i].map->dim);
+  int *elems = (int *)op_malloc(max_dim * sizeof(int));
+
+  for (int l = 0; l < nloops; l++) {
+    op_set set = chain[l]->set;
+    int nargs = chain[l]->nargs;
+    op_arg *args = chain[l]->args;
+    int *list = iters == NULL ? NULL : iters[l];
+    int size = list == NULL ? set->size : niters[l];
+    for (int i = 0; i < nargs; i++) {
+      if (!args[i].opt || args[i].argtype != OP_ARG_DAT)
+        continue;
+      op_set ts = args[i].map == NULL ? set : args[i].map->to;
+      if (tile_of[ts->index] == NULL)
+        tile_of[ts->index] = (int *)op_calloc(
+            nelems != NULL ? nelems[ts->index]
+                           : ts->size + ts->exec_size + ts->nonexec_size,
+            sizeof(int));
+    }
+
+    int *tile = (int *)op_malloc(MAX(size, 1) * sizeof(int));
+    for (int k = 0; k < size; k++) {
+      int e = list == NULL ? k : list[k];
+      int t = (int)((long long)k * plan->ntiles / size);
+      for (int i = 0; i < nargs; i++) {
+        int s;
+        int cnt = op_tile_elements(&args[i], set, e, elems, &s);
+        for (int j = 0; j < cnt; j++)
+          t = MAX(t, tile_of[s][elems[j]]);
+      }
+      tile[k] = t;
+    }
+    // iterations of one loop are independent, so record them only now
+    for (int k = 0; k < size; k++) {
+      int e = list == NULL ? k : list[k];
+      for (int i = 0; i < nargs; i++) {
+        int s;
+        int cnt = op_tile_elements(&args[i], set, e, elems, &s);
+        for (int j = 0; j < cnt; j++)
+          tile_of[s][elems[j]] = MAX(tile_of[s][elems[j]], tile[k]);
+      }
+    }
+
+    // bucket the iterations by tile, keeping their order within a tile
+    int *offsets = (int *)op_calloc(plan->ntiles + 1, sizeof(int));
+    for (int k = 0; k < size; k++)
+      offsets[tile[k] + 1]++;
+    for (int t = 0; t < plan->ntiles; t++)
+      offsets[t + 1] += offsets[t];
+    int *order = (int *)op_malloc(MAX(size, 1) * sizeof(int));
+    int *fill = (int *)op_malloc(plan->ntiles * sizeof(int));
+    memcpy(fill, offsets, plan->ntiles * sizeof(int));
+    for (int k = 0; k < size; k++)
+      order[fill[tile[k]]++] = list == NULL ? k : list[k];
+    op_free(fill);
+    op_free(tile);
+    plan->offsets[l] = offsets;
+    plan->elems[l] = order;
+  }
+
+  for (int s = 0; s < OP_set_index; s++)
+    op_free(tile_of[s]);
+  op_free(tile_of);
+  op_free(elems);
+  return plan;
+}
+
+void op_tile_plan_free(op_tile_plan *plan) {
+  for (int l = 0; l < plan->nloops; l++) {
+    op_free(plan->offsets[l]);
+    op_free(plan->elems[l]);
+  }
+  op_free(plan->offsets);
+  op_free(plan->elems);
+  op_free(plan->sig);
+  op_free(plan);
+}
+
+// runs the listed iterations of loop l, those from nowned on are redundant
+// copies of iterations owned by another process and must not reduce
+static void op_tile_run_list(op_kernel_descriptor desc, int const *list,
+                             int n, int nowned) {
+  int owned = 0;
+  while (owned < n && list[owned] < nowned)
+    owned++;
+  if (owned > 0)
+    desc->run_list(desc, list, owned);
+  if (owned == n)
+    return;
+  char **saved = (char **)op_malloc(desc->nargs * sizeof(char *));
+  for (int i = 0; i < desc->nargs; i++) {
+    op_arg *arg = &desc->args[i];
+    saved[i] = arg->data;
+    if (arg->opt && arg->argtype == OP_ARG_GBL && arg->acc != OP_READ)
+      arg->data = (char *)op_calloc(1, arg->size);
+  }
+  desc->run_list(desc, list + owned, n - owned);
+  for (int i = 0; i < desc->nargs; i++) {
+    if (desc->args[i].data != saved[i])
+      op_free(desc->args[i].data);
+    desc->args[i].data = saved[i];
+  }
+  op_free(saved);
+}
+
+/*
+ * runs the tiles of plan in order, nowned[l] (NULL for none) gives the first
+ * redundant iteration of loop l, which the plan keeps after the owned ones
+ * within each tile, and time[l] accumulates the time spent in loop l
+ */
+void op_tile_run(op_tile_plan *plan, op_kernel_descriptor *chain,
+                 int const *nowned, double *time) {
+  double cpu_t1, cpu_t2, wall_t1, wall_t2;
+  for (int t = 0; t < plan->ntiles; t++) {
+    for (int l = 0; l < plan->nloops; l++) {
+      int begin = plan->offsets[l][t];
+      int n = plan->offsets[l][t + 1] - begin;
+      if (n == 0)
+        continue;
+      op_timers_core(&cpu_t1, &wall_t1);
+      if (nowned == NULL)
+        chain[l]->run_list(chain[l], plan->elems[l] + begin, n);
+      else
+        op_tile_run_list(chain[l], plan->elems[l] + begin, n, nowned[l]);
+      op_timers_core(&cpu_t2, &wall_t2);
+      time[l] += wall_t2 - wall_t1;
+    }
+  }
+}
+
+// returns 0 if the backend cannot tile the chain and it has not run
+static int op_tile_chain(int nloops, op_kernel_descriptor *chain) {
+  // deferred reductions into the chain's globals are superseded by
+  // op_mpi_reduce_combined as in the untiled loops
+  double cpu_t1, cpu_t2, wall_t0, wall_t2;
+  double *time = (double *)op_calloc(nloops, sizeof(double));
+  op_timers_core(&cpu_t1, &wall_t0);
+  if (op_comm_size() > 1) {
+    if (!op_mpi_tile_chain(nloops, chain, time)) {
+      op_free(time);
+      return 0;
+    }
+  } else {
+    int sig_len;
+    int *sig = op_tile_signature(nloops, chain, &sig_len);
+    op_tile_plan *plan = OP_tile_plans;
+    while (plan != NULL &&
+           (plan->sig_len != sig_len ||
+            memcmp(plan->sig, sig, sig_len * sizeof(int)) != 0))
+      plan = plan->next;
+    if (plan == NULL) {
+      plan = op_tile_plan_build(nloops, chain, NULL, NULL, NULL);
+      plan->sig = sig;
+      plan->sig_len = sig_len;
+      plan->next = OP_tile_plans;
+      OP_tile_plans = plan;
+    } else {
+      op_free(sig);
+    }
+    op_tile_run(plan, chain, NULL, time);
+  }
+  for (int l = 0; l < nloops; l++) {
+    op_mpi_set_dirtybit(chain[l]->nargs, chain[l]->args);
+    op_mpi_reduce_combined(chain[l]->args, chain[l]->nargs);
+    op_mpi_perf_time(chain[l]->name, time[l]);
+  }
+  op_free(time);
+  op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_trace)
+    op_trace_event("tiled_chain", "loop", wall_t0, wall_t2);
+  return 1;
+}
+
+static void op_tile_plans_free() {
+  while (OP_tile_plans != NULL) {
+    op_tile_plan *plan = OP_tile_plans;
+    OP_tile_plans = plan->next;
+    op_tile_plan_free(plan);
+  }
+}
+
+void op_flush() {
+  if (OP_loop_chain_size == 0)
+    return;
+  int nloops = OP_loop_chain_size;
+  OP_loop_chain_size = 0;
+
+  int tiled = OP_tile_size > 0 && nloops > 1;
+  for (int i = 0; i < nloops && tiled; i++)
+    tiled = OP_loop_chain[i]->run_list != NULL;
+  if (tiled)
+    tiled = op_tile_chain(nloops, OP_loop_chain);
+  if (!tiled)
+    op_mpi_chain_halo_exchanges(nloops, OP_loop_chain);
+  for (int i = 0; i < nloops; i++) {
+    op_kernel_descriptor desc = OP_loop_chain[i];
+    if (!tiled)
+      desc->run(desc);
+    op_free(desc->args);
+    op_free(desc->gbl);
+    op_free(desc);
+  }
+}
+
 void op_exit_core() {
+  op_tile_plans_free();
+  op_temp_pool_free(free);
+  free(OP_temp_stats);
+  OP_temp_stats = NULL;
+  OP_temp_stats_max = 0;
   // free storage and pointers for sets, maps and data
 
   for (int i = 0; i < OP_set_index; i++) {
@@ -482,11 +1417,31 @@ void op_exit_core() {
     free(item);
   }
 
+  if (OP_trace)
+    op_trace_output_2_file(OP_trace_file != NULL ? OP_trace_file
+                                                 : "op2_trace.json");
+  op_trace_free();
+
   // free storage for timing info
 
   free(OP_kernels);
   OP_kernels = NULL;
 
+  free(OP_instr_kernels);
+  OP_instr_kernels = NULL;
+  OP_instr_index = OP_instr_max = OP_instr_curr = 0;
+  free(OP_instr_touched);
+  OP_instr_touched = NULL;
+  OP_instr_touched_max = 0;
+#ifdef __linux__
+  for (int c = 0; c < OP_INSTR_NCOUNTERS; c++) {
+    if (OP_instr_fd[c] >= 0)
+      close(OP_instr_fd[c]);
+    OP_instr_fd[c] = -1;
+  }
+#endif
+  OP_instr_opened = 0;
+
   // reset initial values
 
   OP_set_index = 0;
@@ -680,6 +1635,8 @@ op_arg op_arg_gbl_core(char *data, int dim, const char *typ, int size,
     arg.type = intstr;
   else if (strcmp(typ, "bool") == 0)
     arg.type = boolstr;
+  else // a literal, or the heap copy made by op_arg_gbl_copy
+    arg.type = typ;
 
   arg.acc = acc;
   arg.map_data_d = NULL;
@@ -728,10 +1685,339 @@ void op_diagnostic_output() {
       printf("%10s %10d %10s\n", (item->dat)->name, (item->dat)->dim,
              (item->dat)->set->name);
     }
+    op_temp_pool_output();
     printf("\n");
   }
 }
 
+#define OP_NUMA_MAX_NODES 64
+
+/* count the pages of [data, data + bytes) on each NUMA node; pages not yet
+ * touched go in count[OP_NUMA_MAX_NODES] */
+static int op_numa_pages(char const *data, size_t bytes, int *count) {
+#if defined(__linux__) && defined(SYS_move_pages)
+  if (data == NULL || bytes == 0)
+    return 0;
+  size_t psize = (size_t)sysconf(_SC_PAGESIZE);
+  size_t p0 = (size_t)data & ~(psize - 1);
+  size_t npages = ((size_t)data + bytes - p0 + psize - 1) / psize;
+  void *pages[1024];
+  int status[1024];
+  for (size_t i = 0; i < npages; i += 1024) {
+    int k = (int)MIN(npages - i, (size_t)1024);
+    for (int j = 0; j < k; j++)
+      pages[j] = (void *)(p0 + (i + j) * psize);
+    if (syscall(SYS_move_pages, 0, k, pages, NULL, status, 0) != 0)
+      return -1;
+    for (int j = 0; j < k; j++)
+      count[status[j] >= 0 && status[j] < OP_NUMA_MAX_NODES
+                ? status[j]
+                : OP_NUMA_MAX_NODES]++;
+  }
+  return 0;
+#else
+  (void)data;
+  (void)bytes;
+  (void)count;
+  return -1;
+#endif
+}
+
+static void op_numa_print(char const *name, char const *data, size_t bytes) {
+  int count[OP_NUMA_MAX_NODES + 1] = {0};
+  if (op_numa_pages(data, bytes, count) != 0) {
+    op_printf("%10s   page placement not available\n", name);
+    return;
+  }
+  op_printf("%10s ", name);
+  for (int n = 0; n < OP_NUMA_MAX_NODES; n++)
+    if (count[n] > 0)
+      op_printf("  node %d: %d", n, count[n]);
+  if (count[OP_NUMA_MAX_NODES] > 0)
+    op_printf("  untouched: %d", count[OP_NUMA_MAX_NODES]);
+  op_printf("\n");
+}
+
+/* pages of each map and dat on each NUMA node (OP_NUMA) */
+void op_numa_output() {
+  op_printf("\n  NUMA page placement\n");
+  op_printf("  -------------------\n");
+  for (int n = 0; n < OP_map_index; n++) {
+    op_map map = OP_map_list[n];
+    op_numa_print(map->name, (char *)map->map,
+                  (size_t)(map->from->size + map->from->exec_size) *
+                      map->dim * sizeof(int));
+  }
+  op_dat_entry *item;
+  TAILQ_FOREACH(item, &OP_dat_list, entries) {
+    op_dat dat = item->dat;
+    op_numa_print(dat->name, dat->data,
+                  (size_t)op_dat_soa_stride(dat) * dat->size);
+  }
+  op_printf("\n");
+}
+
+/*
+ * Per-loop instrumentation (OP_INSTRUMENT)
+ */
+
+#ifdef __linux__
+static int op_instrument_open_counter(unsigned int type,
+                                      unsigned long long config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  /* counts the thread issuing the loop; OpenMP workers are not included */
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static void op_instrument_open(void) {
+  OP_instr_opened = 1;
+#ifdef __linux__
+  OP_instr_fd[OP_INSTR_CYCLES] = op_instrument_open_counter(
+      PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  OP_instr_fd[OP_INSTR_INSTRUCTIONS] = op_instrument_open_counter(
+      PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  OP_instr_fd[OP_INSTR_LLC_MISSES] = op_instrument_open_counter(
+      PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  if (OP_instr_fd[OP_INSTR_LLC_MISSES] < 0)
+    OP_instr_fd[OP_INSTR_LLC_MISSES] = op_instrument_open_counter(
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  if (OP_diags > 1 && OP_instr_fd[OP_INSTR_CYCLES] < 0)
+    op_printf(" op_instrument: hardware counters unavailable, reporting "
+              "bytes moved only\n");
+#endif
+}
+
+static long long op_instrument_read(int c) {
+  long long val = 0;
+#ifdef __linux__
+  if (OP_instr_fd[c] >= 0 &&
+      read(OP_instr_fd[c], &val, sizeof(val)) != (ssize_t)sizeof(val))
+    val = 0;
+#else
+  (void)c;
+#endif
+  return val;
+}
+
+/*
+ * number of distinct target elements referenced by the owned rows of a map,
+ * computed on first use
+ */
+static int op_instrument_touched(op_map map) {
+  if (map->index >= OP_instr_touched_max) {
+    int max_new = OP_map_index > map->index ? OP_map_index : map->index + 1;
+    OP_instr_touched =
+        (int *)op_realloc(OP_instr_touched, max_new * sizeof(int));
+    for (int m = OP_instr_touched_max; m < max_new; m++)
+      OP_instr_touched[m] = -1;
+    OP_instr_touched_max = max_new;
+  }
+
+  if (OP_instr_touched[map->index] < 0) {
+    int to_size = map->to->size + map->to->exec_size + map->to->nonexec_size;
+    char *seen = (char *)op_calloc(to_size > 0 ? to_size : 1, sizeof(char));
+    int touched = 0;
+    for (int e = 0; e < map->from->size * map->dim; e++) {
+      int t = map->map[e];
+      if (t >= 0 && t < to_size && !seen[t]) {
+        seen[t] = 1;
+        touched++;
+      }
+    }
+    free(seen);
+    OP_instr_touched[map->index] = touched;
+  }
+  return OP_instr_touched[map->index];
+}
+
+/*
+ * bytes moved by one execution of a loop: each (dat, map) pair is counted
+ * once, elements touched times element size, doubled when it is both read
+ * and written
+ */
+static double op_instrument_bytes(op_set set, int nargs, op_arg *args) {
+  double bytes = 0.0;
+  for (int n = 0; n < nargs; n++) {
+    if (args[n].opt == 0)
+      continue;
+
+    if (args[n].argtype == OP_ARG_GBL) {
+      bytes += args[n].acc == OP_READ ? args[n].size : 2.0 * args[n].size;
+      continue;
+    }
+
+    int seen = 0;
+    for (int m = 0; m < n && !seen; m++)
+      seen = args[m].opt && args[m].argtype == OP_ARG_DAT &&
+             args[m].dat == args[n].dat && args[m].map == args[n].map;
+    if (seen)
+      continue;
+
+    int r = 0, w = 0;
+    for (int m = n; m < nargs; m++) {
+      if (args[m].opt && args[m].argtype == OP_ARG_DAT &&
+          args[m].dat == args[n].dat && args[m].map == args[n].map) {
+        r |= args[m].acc != OP_WRITE;
+        w |= args[m].acc != OP_READ;
+      }
+    }
+
+    double elems = args[n].map == NULL ? set->size
+                                       : op_instrument_touched(args[n].map);
+    bytes += (r && w ? 2.0 : 1.0) * elems * args[n].dat->size;
+  }
+  return bytes;
+}
+
+void op_instrument_begin(void) {
+  if (!OP_instr_opened)
+    op_instrument_open();
+  for (int c = 0; c < OP_INSTR_NCOUNTERS; c++)
+    OP_instr_start[c] = op_instrument_read(c);
+}
+
+void op_instrument_end(char const *name, op_set set, int nargs, op_arg *args,
+                       double time) {
+  long long stop[OP_INSTR_NCOUNTERS];
+  for (int c = 0; c < OP_INSTR_NCOUNTERS; c++)
+    stop[c] = op_instrument_read(c);
+
+  /* loops are usually called in the same order, so try the next record
+   * before searching */
+  int k = -1;
+  for (int i = 0; i < OP_instr_index && k < 0; i++) {
+    int j = (OP_instr_curr + i) % OP_instr_index;
+    if (OP_instr_kernels[j].name == name ||
+        strcmp(OP_instr_kernels[j].name, name) == 0)
+      k = j;
+  }
+  if (k < 0) {
+    if (OP_instr_index == OP_instr_max) {
+      OP_instr_max += 10;
+      OP_instr_kernels = (op_instr_kernel *)op_realloc(
+          OP_instr_kernels, OP_instr_max * sizeof(op_instr_kernel));
+    }
+    k = OP_instr_index++;
+    memset(&OP_instr_kernels[k], 0, sizeof(op_instr_kernel));
+    OP_instr_kernels[k].name = name;
+  }
+  OP_instr_curr = (k + 1) % OP_instr_index;
+
+  op_instr_kernel *rec = &OP_instr_kernels[k];
+  rec->count += 1;
+  rec->time += time;
+  rec->bytes += op_instrument_bytes(set, nargs, args);
+  for (int c = 0; c < OP_INSTR_NCOUNTERS; c++)
+    rec->counters[c] += (double)(stop[c] - OP_instr_start[c]);
+}
+
+/*
+ * per-kernel values averaged over MPI ranks; collective under MPI
+ */
+static void op_instrument_moments(op_instr_kernel *rec, double *vals) {
+  double second;
+  op_compute_moment(rec->time, &vals[0], &second);
+  op_compute_moment(rec->bytes, &vals[1], &second);
+  for (int c = 0; c < OP_INSTR_NCOUNTERS; c++)
+    op_compute_moment(rec->counters[c], &vals[2 + c], &second);
+}
+
+/*
+ * records are created in the order each rank first ran a loop; sort them by
+ * kernel name so the collective moments pair up the same loop on every rank
+ */
+static int op_instrument_cmp(const void *a, const void *b) {
+  return strcmp(((const op_instr_kernel *)a)->name,
+                ((const op_instr_kernel *)b)->name);
+}
+
+static void op_instrument_sort(void) {
+  qsort(OP_instr_kernels, OP_instr_index, sizeof(op_instr_kernel),
+        op_instrument_cmp);
+  OP_instr_curr = 0;
+}
+
+static void op_instrument_output(void) {
+  if (OP_instr_index == 0)
+    return;
+  op_instrument_sort();
+  if (op_is_root()) {
+    printf("\n  count      time   GB moved      GB/s    LLC misses        "
+           "cycles  instructions    IPC   kernel name ");
+    printf("\n "
+           "-----------------------------------------------------------------"
+           "-------------------------------------------\n");
+  }
+  for (int k = 0; k < OP_instr_index; k++) {
+    double v[2 + OP_INSTR_NCOUNTERS];
+    op_instrument_moments(&OP_instr_kernels[k], v);
+    if (!op_is_root())
+      continue;
+    printf(" %6d;  %8.4f; %9.4f; %8.4f;", OP_instr_kernels[k].count, v[0],
+           v[1] / 1e9, v[0] > 0.0 ? v[1] / (1e9 * v[0]) : 0.0);
+    if (OP_instr_fd[OP_INSTR_LLC_MISSES] >= 0)
+      printf(" %13.0f;", v[2 + OP_INSTR_LLC_MISSES]);
+    else
+      printf(" %13s;", "-");
+    if (OP_instr_fd[OP_INSTR_CYCLES] >= 0 &&
+        OP_instr_fd[OP_INSTR_INSTRUCTIONS] >= 0)
+      printf(" %13.0f; %13.0f; %6.2f;", v[2 + OP_INSTR_CYCLES],
+             v[2 + OP_INSTR_INSTRUCTIONS],
+             v[2 + OP_INSTR_CYCLES] > 0.0
+                 ? v[2 + OP_INSTR_INSTRUCTIONS] / v[2 + OP_INSTR_CYCLES]
+                 : 0.0);
+    else
+      printf(" %13s; %13s; %6s;", "-", "-", "-");
+    printf("   %s \n", OP_instr_kernels[k].name);
+  }
+}
+
+void op_instrument_output_2_file(const char *outputFileName) {
+  FILE *outputFile = NULL;
+  if (op_is_root()) {
+    outputFile = fopen(outputFileName, "w");
+    if (outputFile == NULL)
+      printf(" op_instrument_output_2_file: cannot open %s\n", outputFileName);
+    else
+      fprintf(outputFile, "kernel,count,time,bytes,bandwidth_gbs,llc_misses,"
+                          "cycles,instructions\n");
+  }
+
+  /* the moments are collective, so root still runs the loop without a file */
+  op_instrument_sort();
+  for (int k = 0; k < OP_instr_index; k++) {
+    double v[2 + OP_INSTR_NCOUNTERS];
+    op_instrument_moments(&OP_instr_kernels[k], v);
+    if (outputFile == NULL)
+      continue;
+    fprintf(outputFile, "%s,%d,%.6e,%.6e,%.6e", OP_instr_kernels[k].name,
+            OP_instr_kernels[k].count, v[0], v[1],
+            v[0] > 0.0 ? v[1] / (1e9 * v[0]) : 0.0);
+    int order[] = {OP_INSTR_LLC_MISSES, OP_INSTR_CYCLES,
+                   OP_INSTR_INSTRUCTIONS};
+    for (int i = 0; i < OP_INSTR_NCOUNTERS; i++) {
+      int c = order[i];
+      if (OP_instr_fd[c] >= 0)
+        fprintf(outputFile, ",%.0f", v[2 + c]);
+      else
+        fprintf(outputFile, ",");
+    }
+    fprintf(outputFile, "\n");
+  }
+
+  if (outputFile != NULL)
+    fclose(outputFile);
+}
+
 void op_timing_output_core() {
   if (OP_kern_max > 0) {
     if (op_is_root())
@@ -787,6 +2073,15 @@ void op_timing_output_core() {
       }
     }
   }
+
+  if (OP_instrument) {
+    op_instrument_output();
+    if (OP_instrument_file != NULL)
+      op_instrument_output_2_file(OP_instrument_file);
+  }
+
+  if (OP_numa && OP_diags > 1)
+    op_numa_output();
 }
 
 void op_timing_output_2_file(const char *outputFileName) {
@@ -827,6 +2122,315 @@ void op_timing_output_2_file(const char *outputFileName) {
   fclose(outputFile);
 }
 
+/*
+ * Machine-readable timing export: every per-kernel metric is gathered from
+ * all ranks onto root, and written with its min/max/mean and the per-rank
+ * values so that load imbalance can be tracked without parsing text
+ */
+
+#define OP_TIMING_NMETRICS 6
+static char const *op_timing_metrics[OP_TIMING_NMETRICS] = {
+    "count", "time", "compute_time", "mpi_time", "plan_time", "transfer"};
+
+typedef struct {
+  int nranks;
+  double *kernels; /* [kernel][metric][rank] */
+  double *halos;   /* [kernel][dat][count|bytes][rank] */
+  char const **dat_names;
+  int ndats;
+} op_timing_table;
+
+static void op_timing_gather(op_timing_table *tab) {
+  int nranks = op_comm_size();
+  int ndats = OP_dat_index;
+  tab->nranks = nranks;
+  tab->ndats = ndats;
+  tab->kernels = NULL;
+  tab->halos = NULL;
+  tab->dat_names = (char const **)op_calloc(ndats + 1, sizeof(char const *));
+  op_dat_entry *item;
+  TAILQ_FOREACH(item, &OP_dat_list, entries) {
+    if (item->dat->index < ndats)
+      tab->dat_names[item->dat->index] = item->dat->name;
+  }
+
+  double *local = (double *)op_malloc(
+      (OP_TIMING_NMETRICS + 2 * ndats + 1) * sizeof(double));
+  if (op_is_root()) {
+    tab->kernels = (double *)op_malloc((size_t)(OP_kern_max + 1) *
+                                       OP_TIMING_NMETRICS * nranks *
+                                       sizeof(double));
+    tab->halos = (double *)op_malloc((size_t)(OP_kern_max + 1) *
+                                     (2 * ndats + 1) * nranks *
+                                     sizeof(double));
+  }
+  for (int n = 0; n < OP_kern_max; n++) {
+    op_kernel *k = &OP_kernels[n];
+    local[0] = k->count;
+    local[1] = k->time;
+    local[2] = MAX(0.0, (double)k->time - k->mpi_time - k->plan_time);
+    local[3] = k->mpi_time;
+    local[4] = k->plan_time;
+    local[5] = k->transfer;
+    op_gather_double(
+        local, OP_TIMING_NMETRICS,
+        tab->kernels ? tab->kernels + (size_t)n * OP_TIMING_NMETRICS * nranks
+                     : NULL);
+    op_mpi_perf_halo_info(k->count > 0 ? k->name : NULL, ndats, local);
+    op_gather_double(local, 2 * ndats,
+                     tab->halos ? tab->halos + (size_t)n * 2 * ndats * nranks
+                                : NULL);
+  }
+  op_free(local);
+}
+
+static void op_timing_free(op_timing_table *tab) {
+  op_free(tab->kernels);
+  op_free(tab->halos);
+  op_free(tab->dat_names);
+}
+
+/* values gathered by op_gather_double are laid out rank by rank */
+static void op_timing_stats(double const *vals, int stride, int nranks,
+                            double *min, double *max, double *mean) {
+  *min = *max = vals[0];
+  *mean = 0.0;
+  for (int r = 0; r < nranks; r++) {
+    double v = vals[(size_t)r * stride];
+    *min = MIN(*min, v);
+    *max = MAX(*max, v);
+    *mean += v;
+  }
+  *mean /= nranks;
+}
+
+static void op_json_string(FILE *fp, char const *s) {
+  fputc('"', fp);
+  for (; s != NULL && *s != '\0'; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(fp, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(fp, "\\u%04x", (unsigned char)*s);
+    else
+      fputc(*s, fp);
+  }
+  fputc('"', fp);
+}
+
+static void op_json_metric(FILE *fp, char const *name, double const *vals,
+                           int stride, int nranks) {
+  double min, max, mean;
+  op_timing_stats(vals, stride, nranks, &min, &max, &mean);
+  fprintf(fp, "\"%s\": {\"min\": %.9g, \"max\": %.9g, \"mean\": %.9g, "
+              "\"ranks\": [",
+          name, min, max, mean);
+  for (int r = 0; r < nranks; r++)
+    fprintf(fp, "%s%.9g", r ? ", " : "", vals[(size_t)r * stride]);
+  fprintf(fp, "]}");
+}
+
+void op_timing_output_json(const char *outputFileName) {
+  op_timing_table tab;
+  op_timing_gather(&tab);
+  if (!op_is_root()) {
+    op_timing_free(&tab);
+    return;
+  }
+
+  FILE *fp = fopen(outputFileName, "w");
+  if (fp == NULL) {
+    printf(" op_timing_output_json: cannot open %s\n", outputFileName);
+    op_timing_free(&tab);
+    return;
+  }
+
+  int nranks = tab.nranks, ndats = tab.ndats;
+  fprintf(fp, "{\n  \"nranks\": %d,\n", nranks);
+  fprintf(fp, "  \"kernels\": [");
+  int first = 1;
+  for (int n = 0; n < OP_kern_max; n++) {
+    double const *km = tab.kernels + (size_t)n * OP_TIMING_NMETRICS * nranks;
+    double const *kh = tab.halos + (size_t)n * 2 * ndats * nranks;
+    double min, max, mean;
+    op_timing_stats(km, OP_TIMING_NMETRICS, nranks, &min, &max, &mean);
+    if (max <= 0.0)
+      continue;
+    fprintf(fp, "%s\n    {\"name\": ", first ? "" : ",");
+    op_json_string(fp, OP_kernels[n].name);
+    for (int m = 0; m < OP_TIMING_NMETRICS; m++) {
+      fprintf(fp, ",\n     ");
+      op_json_metric(fp, op_timing_metrics[m], km + m, OP_TIMING_NMETRICS,
+                     nranks);
+    }
+    fprintf(fp, ",\n     \"halos\": [");
+    int first_dat = 1;
+    for (int d = 0; d < ndats; d++) {
+      op_timing_stats(kh + 2 * d, 2 * ndats, nranks, &min, &max, &mean);
+      if (max <= 0.0)
+        continue;
+      fprintf(fp, "%s\n      {\"dat\": ", first_dat ? "" : ",");
+      op_json_string(fp, tab.dat_names[d]);
+      fprintf(fp, ", ");
+      op_json_metric(fp, "count", kh + 2 * d, 2 * ndats, nranks);
+      fprintf(fp, ",\n       ");
+      op_json_metric(fp, "bytes", kh + 2 * d + 1, 2 * ndats, nranks);
+      fprintf(fp, "}");
+      first_dat = 0;
+    }
+    fprintf(fp, "%s]}", first_dat ? "" : "\n     ");
+    first = 0;
+  }
+  fprintf(fp, "%s]\n}\n", first ? "" : "\n  ");
+  fclose(fp);
+  op_timing_free(&tab);
+}
+
+void op_timing_output_csv(const char *outputFileName) {
+  op_timing_table tab;
+  op_timing_gather(&tab);
+  if (!op_is_root()) {
+    op_timing_free(&tab);
+    return;
+  }
+
+  FILE *fp = fopen(outputFileName, "w");
+  if (fp == NULL) {
+    printf(" op_timing_output_csv: cannot open %s\n", outputFileName);
+    op_timing_free(&tab);
+    return;
+  }
+
+  /* one row per (kernel, dat, metric, rank); dat is empty for kernel rows */
+  int nranks = tab.nranks, ndats = tab.ndats;
+  fprintf(fp, "kernel,dat,metric,rank,value\n");
+  for (int n = 0; n < OP_kern_max; n++) {
+    double const *km = tab.kernels + (size_t)n * OP_TIMING_NMETRICS * nranks;
+    double const *kh = tab.halos + (size_t)n * 2 * ndats * nranks;
+    double min, max, mean;
+    op_timing_stats(km, OP_TIMING_NMETRICS, nranks, &min, &max, &mean);
+    if (max <= 0.0)
+      continue;
+    // a slot only named on other ranks gets an empty kernel field
+    char const *name = OP_kernels[n].name ? OP_kernels[n].name : "";
+    for (int m = 0; m < OP_TIMING_NMETRICS; m++)
+      for (int r = 0; r < nranks; r++)
+        fprintf(fp, "%s,,%s,%d,%.9g\n", name, op_timing_metrics[m], r,
+                km[(size_t)r * OP_TIMING_NMETRICS + m]);
+    for (int d = 0; d < ndats; d++) {
+      op_timing_stats(kh + 2 * d, 2 * ndats, nranks, &min, &max, &mean);
+      if (max <= 0.0)
+        continue;
+      for (int r = 0; r < nranks; r++) {
+        double const *v = kh + (size_t)r * 2 * ndats + 2 * d;
+        fprintf(fp, "%s,%s,halo_count,%d,%.9g\n", name,
+                tab.dat_names[d] ? tab.dat_names[d] : "", r, v[0]);
+        fprintf(fp, "%s,%s,halo_bytes,%d,%.9g\n", name,
+                tab.dat_names[d] ? tab.dat_names[d] : "", r, v[1]);
+      }
+    }
+  }
+  fclose(fp);
+  op_timing_free(&tab);
+}
+
+/*
+ * Event tracer (OP_TRACE): begin/end timestamps of loops, halo exchanges,
+ * waits, reductions and plan construction, written as Chrome trace-event
+ * JSON. Each thread records into its own ring buffer, so recording takes no
+ * locks; when a ring wraps, its oldest events are overwritten.
+ */
+
+void op_trace_event(char const *name, char const *cat, double t0, double t1) {
+  op_trace_ring *ring = op_trace_ring_get();
+  if (ring == NULL)
+    return;
+  op_trace_rec *rec = &ring->buf[ring->head % OP_TRACE_EVENTS];
+  rec->name = name;
+  rec->cat = cat;
+  rec->t0 = t0;
+  rec->t1 = t1;
+  ring->head++;
+}
+
+/*
+ * close the compute phase open on this thread at time t, and open a new
+ * one unless name is NULL
+ */
+void op_trace_phase(char const *name, double t) {
+  op_trace_ring *ring = op_trace_ring_get();
+  if (ring == NULL)
+    return;
+  if (ring->phase != NULL)
+    op_trace_event(ring->phase, "compute", ring->phase_t0, t);
+  ring->phase = name;
+  ring->phase_t0 = t;
+}
+
+void op_trace_loop(char const *name, double t0, double t1) {
+  op_trace_phase(NULL, t1);
+  op_trace_event(name, "loop", t0, t1);
+}
+
+void op_trace_output_2_file(const char *outputFileName) {
+  int rank = op_comm_rank(), nranks = op_comm_size();
+  unsigned long dropped = 0;
+
+  /* ranks append their events in turn, rank 0 opening the document */
+  for (int r = 0; r < nranks; r++) {
+    if (r == rank) {
+      FILE *fp = fopen(outputFileName, rank == 0 ? "w" : "a");
+      if (fp == NULL) {
+        printf(" op_trace_output_2_file: cannot open %s\n", outputFileName);
+      } else {
+        if (rank == 0)
+          fprintf(fp, "{\"traceEvents\": [\n");
+        fprintf(fp,
+                "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+                "\"args\": {\"name\": \"rank %d\"}}",
+                rank == 0 ? "" : ",\n", rank, rank);
+        int nthreads = MIN(OP_trace_nthreads, OP_TRACE_MAX_THREADS);
+        for (int t = 0; t < nthreads; t++) {
+          op_trace_ring *ring = OP_trace_rings[t];
+          if (ring == NULL)
+            continue;
+          unsigned long n = MIN(ring->head, (unsigned long)OP_TRACE_EVENTS);
+          dropped += ring->head - n;
+          for (unsigned long i = ring->head - n; i < ring->head; i++) {
+            op_trace_rec *rec = &ring->buf[i % OP_TRACE_EVENTS];
+            fprintf(fp, ",\n{\"name\": ");
+            op_json_string(fp, rec->name);
+            fprintf(fp,
+                    ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                    "\"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+                    rec->cat, rec->t0 * 1e6, (rec->t1 - rec->t0) * 1e6, rank,
+                    t);
+          }
+        }
+        if (rank == nranks - 1)
+          fprintf(fp, "\n]}\n");
+        fclose(fp);
+      }
+      if (dropped > 0 && OP_diags > 1)
+        printf(" op_trace: rank %d overwrote %lu events\n", rank, dropped);
+    }
+    op_mpi_barrier();
+  }
+}
+
+static void op_trace_free(void) {
+  int nthreads = MIN(OP_trace_nthreads, OP_TRACE_MAX_THREADS);
+  for (int t = 0; t < nthreads; t++) {
+    if (OP_trace_rings[t] != NULL) {
+      free(OP_trace_rings[t]->buf);
+      free(OP_trace_rings[t]);
+    }
+    OP_trace_rings[t] = NULL;
+  }
+  OP_trace_nthreads = 0;
+  /* invalidates the rings cached by every thread */
+  OP_trace_generation++;
+}
+
 void op_timers_core(double *cpu, double *et) {
   (void)cpu;
   struct timeval t;
@@ -861,6 +2465,7 @@ void op_timing_realloc(int kernel) {
   }
 }
 
+
 void op_dump_dat(op_dat data) {
   fflush(stdout);
 
@@ -899,10 +2504,17 @@ void op_print_dat_to_binfile_core(op_dat dat, const char *file_name) {
     exit(2);
   }
 
-  if (fwrite(dat->data, dat->size, dat->set->size, fp) < dat->set->size) {
+  char *data = dat->data;
+  if (dat->soa) {
+    data = (char *)op_malloc((size_t)dat->set->size * dat->size);
+    op_dat_get_aos(dat, data, 0, dat->set->size);
+  }
+  if (fwrite(data, dat->size, dat->set->size, fp) < dat->set->size) {
     printf("error writing to %s\n", file_name);
     exit(2);
   }
+  if (data != dat->data)
+    op_free(data);
   fclose(fp);
 }
 
@@ -918,13 +2530,15 @@ void op_print_dat_to_txtfile_core(op_dat dat, const char *file_name) {
     exit(2);
   }
 
+  int stride = op_dat_soa_stride(dat);
   for (int i = 0; i < dat->set->size; i++) {
     for (int j = 0; j < dat->dim; j++) {
+      size_t k = dat->soa ? (size_t)j * stride + i : (size_t)i * dat->dim + j;
       if (strcmp(dat->type, "double") == 0 ||
           strcmp(dat->type, "double:soa") == 0 ||
           strcmp(dat->type, "double precision") == 0 ||
           strcmp(dat->type, "real(8)") == 0) {
-        if (fprintf(fp, "%lf ", ((double *)dat->data)[i * dat->dim + j]) < 0) {
+        if (fprintf(fp, "%lf ", ((double *)dat->data)[k]) < 0) {
           printf("error writing to %s\n", file_name);
           exit(2);
         }
@@ -932,7 +2546,7 @@ void op_print_dat_to_txtfile_core(op_dat dat, const char *file_name) {
                  strcmp(dat->type, "float:soa") == 0 ||
                  strcmp(dat->type, "real(4)") == 0 ||
                  strcmp(dat->type, "real") == 0) {
-        if (fprintf(fp, "%f ", ((float *)dat->data)[i * dat->dim + j]) < 0) {
+        if (fprintf(fp, "%f ", ((float *)dat->data)[k]) < 0) {
           printf("error writing to %s\n", file_name);
           exit(2);
         }
@@ -941,13 +2555,13 @@ void op_print_dat_to_txtfile_core(op_dat dat, const char *file_name) {
                  strcmp(dat->type, "int(4)") == 0 ||
                  strcmp(dat->type, "integer") == 0 ||
                  strcmp(dat->type, "integer(4)") == 0) {
-        if (fprintf(fp, "%d ", ((int *)dat->data)[i * dat->dim + j]) < 0) {
+        if (fprintf(fp, "%d ", ((int *)dat->data)[k]) < 0) {
           printf("error writing to %s\n", file_name);
           exit(2);
         }
       } else if ((strcmp(dat->type, "long") == 0) ||
                  (strcmp(dat->type, "long:soa") == 0)) {
-        if (fprintf(fp, "%ld ", ((long *)dat->data)[i * dat->dim + j]) < 0) {
+        if (fprintf(fp, "%ld ", ((long *)dat->data)[k]) < 0) {
           printf("error writing to %s\n", file_name);
           exit(2);
         }
@@ -39,6 +39,23 @@
 
 #include "op_rt_support.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+// use uthash from - http://troydhanson.github.com/uthash/
+#include <uthash.h>
+
+/*
+ * hash table entry pointing to the first plan with a given signature hash;
+ * further plans with the same hash are chained through op_plan.hash_next
+ */
+
+typedef struct {
+  ull hash;  /* signature hash */
+  int index; /* index of the first plan in OP_plans */
+  UT_hash_handle hh;
+} op_plan_entry;
+
 /*
  * Global variables
  */
@@ -46,6 +63,8 @@
 int OP_plan_index = 0, OP_plan_max = 0;
 op_plan *OP_plans;
 double OP_plan_time = 0;
+int OP_plan_epoch = 0; /* incremented whenever OP_plans is emptied */
+op_plan_entry *OP_plan_tab = NULL;
 
 extern op_kernel *OP_kernels;
 extern int OP_kern_max;
@@ -82,9 +101,16 @@ void op_rt_exit() {
 
   OP_plan_index = 0;
   OP_plan_max = 0;
+  OP_plan_epoch++;
 
   free(OP_plans);
   OP_plans = NULL;
+
+  op_plan_entry *entry, *tmp;
+  HASH_ITER(hh, OP_plan_tab, entry, tmp) {
+    HASH_DEL(OP_plan_tab, entry);
+    op_free(entry);
+  }
 }
 
 /*
@@ -122,6 +148,356 @@ int comp2(const void *a, const void *b) {
   return 0;
 }
 
+/*
+ * per-thread scratch space for plan construction: the distinct elements an
+ * indirection set references within a block are found through an open
+ * addressing table whose slots are tagged with a stamp, so that the table
+ * never needs to be cleared between blocks
+ */
+
+typedef struct {
+  int size;      /* number of slots, a power of 2 */
+  int shift;     /* 32 - log2(size) */
+  int stamp;     /* stamp of the current block and indirection set */
+  int stride;    /* maximum block size, stride of lidx per argument */
+  int direct;    /* slots indexed directly by element, for very large blocks */
+  int *key;      /* element held in each slot */
+  int *tag;      /* stamp of the last insertion into each slot */
+  int *local;    /* local index of each element */
+  char *written; /* element accessed through an OP_INC or OP_RW argument */
+  int *list;     /* distinct elements in order of first reference */
+  int *tmp;      /* buffer for sorting list */
+  int *lidx;     /* slot, then local index, of each argument and element */
+  int *mask;     /* thread colouring masks, indexed by local index */
+} op_plan_scratch;
+
+static void op_plan_scratch_init(op_plan_scratch *s) {
+  memset(s, 0, sizeof(op_plan_scratch));
+}
+
+/* allocated on first use, so that threads without blocks allocate nothing */
+static void op_plan_scratch_reserve(op_plan_scratch *s, int nargs, int bsize,
+                                    int max_refs, int max_to) {
+  if (s->key != NULL)
+    return;
+  long nlist = MIN((long)max_refs * bsize, (long)max_to);
+  int logsize = 4;
+  while ((1L << logsize) < 2 * nlist)
+    logsize++;
+  s->size = 1 << logsize;
+  s->shift = 32 - logsize;
+  s->direct = s->size >= max_to;
+  if (s->direct)
+    s->size = max_to;
+  s->stamp = 0;
+  s->stride = bsize;
+  s->key = (int *)op_malloc(s->size * sizeof(int));
+  s->tag = (int *)op_calloc(s->size, sizeof(int));
+  s->local = (int *)op_malloc(s->size * sizeof(int));
+  s->written = (char *)op_malloc(s->size * sizeof(char));
+  s->list = (int *)op_malloc(nlist * sizeof(int));
+  s->tmp = (int *)op_malloc(nlist * sizeof(int));
+  s->lidx = (int *)op_malloc((size_t)nargs * bsize * sizeof(int));
+  s->mask = (int *)op_malloc((size_t)nargs * bsize * sizeof(int));
+}
+
+static void op_plan_scratch_free(op_plan_scratch *s) {
+  free(s->key);
+  free(s->tag);
+  free(s->local);
+  free(s->written);
+  free(s->list);
+  free(s->tmp);
+  free(s->lidx);
+  free(s->mask);
+}
+
+static inline int op_plan_scratch_find(op_plan_scratch *s, int key) {
+  if (s->direct)
+    return key;
+  uint h = ((uint)key * 2654435769u) >> s->shift;
+  while (s->tag[h] == s->stamp && s->key[h] != key)
+    h = (h + 1) & (s->size - 1);
+  return h;
+}
+
+/*
+ * collect the distinct elements of indirection set m referenced by set
+ * elements [from, to) into s->list, recording the slot of every reference in
+ * s->lidx; returns the number of distinct elements, and in nwritten the number
+ * of those accessed through an OP_INC or OP_RW argument
+ */
+
+static int op_plan_block_dedup(op_plan_scratch *s, int m, int from, int to,
+                               int nargs, op_arg *args, int *inds,
+                               int *nwritten) {
+  s->stamp++;
+  int ne = 0;
+  *nwritten = 0;
+  for (int m2 = 0; m2 < nargs; m2++) {
+    if (inds[m2] != m)
+      continue;
+    op_map map = args[m2].map;
+    int idx = args[m2].idx;
+    int write = (args[m2].acc == OP_INC || args[m2].acc == OP_RW) &&
+                args[m2].opt;
+    int *lidx = &s->lidx[m2 * s->stride];
+    for (int e = from; e < to; e++) {
+      int key = map->map[idx + e * map->dim];
+      int slot = op_plan_scratch_find(s, key);
+      if (s->tag[slot] != s->stamp) {
+        s->tag[slot] = s->stamp;
+        s->key[slot] = key;
+        s->local[slot] = ne;
+        s->written[slot] = 0;
+        s->list[ne++] = key;
+      }
+      if (write && !s->written[slot]) {
+        s->written[slot] = 1;
+        (*nwritten)++;
+      }
+      lidx[e - from] = slot;
+    }
+  }
+  return ne;
+}
+
+/*
+ * sort a list of distinct non-negative integers, with a radix sort for all
+ * but the shortest lists
+ */
+
+static void op_plan_sort(int *list, int *tmp, int n) {
+  if (n < 64) {
+    qsort(list, n, sizeof(int), comp);
+    return;
+  }
+  uint max = 0;
+  for (int i = 0; i < n; i++)
+    max = MAX(max, (uint)list[i]);
+
+  int *src = list, *dst = tmp;
+  for (int shift = 0; shift < 32 && (max >> shift) > 0; shift += 8) {
+    int count[257];
+    memset(count, 0, sizeof(count));
+    for (int i = 0; i < n; i++)
+      count[(((uint)src[i] >> shift) & 0xff) + 1]++;
+    for (int d = 0; d < 256; d++)
+      count[d + 1] += count[d];
+    for (int i = 0; i < n; i++)
+      dst[count[((uint)src[i] >> shift) & 0xff]++] = src[i];
+    int *t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != list)
+    memcpy(list, src, n * sizeof(int));
+}
+
+/*
+ * greedy distance-2 colouring of the single block used by OP_COLOR2:
+ * elements referencing the same element through an OP_INC or OP_RW argument
+ * get different colours. The elements are visited in the order selected by
+ * OP_COLOR_ORDER, and with OP_COLOR_BALANCE=1 a second pass moves elements of
+ * over-full colours into under-full ones, so that the last colours are not
+ * left with only a few elements each.
+ *
+ * lidx of the scratch space holds the local index of the element each
+ * argument references, as set up by pass 2 of op_plan_build
+ */
+
+static int op_plan_color2(op_plan_scratch *s, int from, int to, int nlocal,
+                          int nargs, op_arg *args, int *inds, int core_size,
+                          int halo_exchange, int *thrcol) {
+  int n = to - from;
+  int *color = &thrcol[from];
+
+  int **lidx = (int **)op_malloc(nargs * sizeof(int *));
+  int ncargs = 0;
+  for (int m = 0; m < nargs; m++)
+    if (inds[m] >= 0 && (args[m].acc == OP_INC || args[m].acc == OP_RW) &&
+        args[m].opt)
+      lidx[ncargs++] = &s->lidx[m * s->stride];
+
+  /* vertex ordering, by the (not necessarily distinct) number of
+   * conflicting elements */
+
+  int *order = (int *)op_malloc((n + 1) * sizeof(int));
+  if (OP_color_order == OP_COLOR_NATURAL) {
+    for (int e = 0; e < n; e++)
+      order[e] = e;
+  } else {
+    int *adj_start = (int *)op_calloc(nlocal + 1, sizeof(int));
+    for (int k = 0; k < ncargs; k++)
+      for (int e = 0; e < n; e++)
+        adj_start[lidx[k][e] + 1]++;
+    for (int l = 0; l < nlocal; l++)
+      adj_start[l + 1] += adj_start[l];
+
+    int *degree = (int *)op_malloc((n + 1) * sizeof(int));
+    int max_degree = 0;
+    for (int e = 0; e < n; e++) {
+      degree[e] = 0;
+      for (int k = 0; k < ncargs; k++)
+        degree[e] += adj_start[lidx[k][e] + 1] - adj_start[lidx[k][e]] - 1;
+      max_degree = MAX(max_degree, degree[e]);
+    }
+
+    if (OP_color_order == OP_COLOR_LARGEST_FIRST) {
+      int *count = (int *)op_calloc(max_degree + 2, sizeof(int));
+      for (int e = 0; e < n; e++)
+        count[max_degree - degree[e] + 1]++;
+      for (int d = 0; d <= max_degree; d++)
+        count[d + 1] += count[d];
+      for (int e = 0; e < n; e++)
+        order[count[max_degree - degree[e]]++] = e;
+      free(count);
+    } else {
+      /* smallest-last: repeatedly remove an element of smallest remaining
+       * degree, kept in doubly linked degree buckets, and colour in reverse
+       * order of removal; needs the elements referencing each local element */
+      int *adj = (int *)op_malloc((n * ncargs + 1) * sizeof(int));
+      int *pos = (int *)op_malloc((nlocal + 1) * sizeof(int));
+      memcpy(pos, adj_start, (nlocal + 1) * sizeof(int));
+      for (int k = 0; k < ncargs; k++)
+        for (int e = 0; e < n; e++)
+          adj[pos[lidx[k][e]]++] = e;
+
+      int *head = (int *)op_malloc((max_degree + 1) * sizeof(int));
+      int *next = (int *)op_malloc((n + 1) * sizeof(int));
+      int *prev = (int *)op_malloc((n + 1) * sizeof(int));
+      for (int d = 0; d <= max_degree; d++)
+        head[d] = -1;
+      for (int e = n - 1; e >= 0; e--) {
+        prev[e] = -1;
+        next[e] = head[degree[e]];
+        if (head[degree[e]] >= 0)
+          prev[head[degree[e]]] = e;
+        head[degree[e]] = e;
+      }
+
+      int d = 0;
+      for (int i = n - 1; i >= 0; i--) {
+        while (head[d] < 0)
+          d++;
+        int e = head[d];
+        head[d] = next[e];
+        if (next[e] >= 0)
+          prev[next[e]] = -1;
+        degree[e] = -1; /* removed */
+        order[i] = e;
+
+        for (int k = 0; k < ncargs; k++) {
+          int l = lidx[k][e];
+          for (int j = adj_start[l]; j < adj_start[l + 1]; j++) {
+            int u = adj[j];
+            if (u == e || degree[u] <= 0)
+              continue;
+            if (prev[u] >= 0)
+              next[prev[u]] = next[u];
+            else
+              head[degree[u]] = next[u];
+            if (next[u] >= 0)
+              prev[next[u]] = prev[u];
+            degree[u]--;
+            /* u loses one per slot it shares with e */
+            d = MIN(d, degree[u]);
+            prev[u] = -1;
+            next[u] = head[degree[u]];
+            if (head[degree[u]] >= 0)
+              prev[head[degree[u]]] = u;
+            head[degree[u]] = u;
+          }
+        }
+      }
+      free(adj);
+      free(pos);
+      free(head);
+      free(next);
+      free(prev);
+    }
+    free(adj_start);
+    free(degree);
+  }
+
+  /* first-fit colouring, 64 colours per pass; with halo exchanges, only core
+   * elements may take colour 0 */
+
+  ull *mask = (ull *)op_malloc((nlocal + 1) * sizeof(ull));
+  int repeat = 1;
+  int ncolor = 0;
+  int ncolors = 0;
+
+  for (int e = 0; e < n; e++)
+    color[e] = -1;
+
+  while (repeat) {
+    repeat = 0;
+    memset(mask, 0, nlocal * sizeof(ull));
+
+    for (int i = 0; i < n; i++) {
+      int e = order[i];
+      if (color[e] != -1)
+        continue;
+      ull used = (ncolor == 0 && halo_exchange && from + e >= core_size);
+      for (int k = 0; k < ncargs; k++)
+        used |= mask[lidx[k][e]];
+      if (~used == 0) { /* run out of colors on this pass */
+        repeat = 1;
+        continue;
+      }
+      int c = __builtin_ctzll(~used);
+      color[e] = ncolor + c;
+      ncolors = MAX(ncolors, ncolor + c + 1);
+      for (int k = 0; k < ncargs; k++)
+        mask[lidx[k][e]] |= 1ULL << c;
+    }
+
+    ncolor += 64;
+  }
+
+  /* balancing: move elements of colours above the average size into the
+   * smallest permissible colour below it. The masks still hold the colours
+   * around each local element, and an element's own colour bit is set by no
+   * other element, so it can be moved by just flipping bits */
+
+  if (OP_color_balance && ncolors > 1 && ncolors <= 64) {
+    int *size = (int *)op_calloc(ncolors, sizeof(int));
+    for (int e = 0; e < n; e++)
+      size[color[e]]++;
+    int target = (n + ncolors - 1) / ncolors;
+
+    for (int i = n - 1; i >= 0; i--) {
+      int e = order[i];
+      int c = color[e];
+      if (size[c] <= target)
+        continue;
+      ull used = (halo_exchange && from + e >= core_size);
+      for (int k = 0; k < ncargs; k++)
+        used |= mask[lidx[k][e]];
+
+      int best = -1;
+      for (int c2 = 0; c2 < ncolors; c2++)
+        if (size[c2] < target && !((used >> c2) & 1) &&
+            (best < 0 || size[c2] < size[best]))
+          best = c2;
+      if (best >= 0) {
+        size[c]--;
+        size[best]++;
+        color[e] = best;
+        for (int k = 0; k < ncargs; k++)
+          mask[lidx[k][e]] = (mask[lidx[k][e]] & ~(1ULL << c)) | (1ULL << best);
+      }
+    }
+    free(size);
+  }
+
+  free(lidx);
+  free(order);
+  free(mask);
+  return ncolors;
+}
+
 /*
  * plan check routine
  */
@@ -295,138 +671,161 @@ void op_plan_check(op_plan OP_plan, int ninds, int *inds) {
 }
 
 /*
- * OP plan construction
+ * plan signature: hash over everything op_plan_match compares, FNV-1a over
+ * the kernel name and a multiply-xorshift mix over the remaining words
  */
 
-op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
-                      op_arg *args, int ninds, int *inds, int staging) {
-  // set exec length
-  int exec_length = set->size;
-  for (int i = 0; i < nargs; i++) {
-    if (args[i].opt && args[i].idx != -1 && args[i].acc != OP_READ) {
-      exec_length += set->exec_size;
-      break;
-    }
+static inline ull op_plan_hash_mix(ull hash, ull value) {
+  hash = (hash ^ value) * 0x9E3779B97F4A7C15ULL;
+  return hash ^ (hash >> 32);
+}
+
+static ull op_plan_signature(char const *name, op_set set, int part_size,
+                             int nargs, op_arg *args, int ninds) {
+  ull hash = 14695981039346656037ULL;
+  for (char const *c = name; *c != '\0'; c++) {
+    hash ^= (unsigned char)*c;
+    hash *= 1099511628211ULL;
+  }
+  hash = op_plan_hash_mix(hash, (ull)(size_t)set);
+  hash = op_plan_hash_mix(hash, (ull)part_size);
+  hash = op_plan_hash_mix(hash, ((ull)nargs << 32) | (ull)ninds);
+  for (int m = 0; m < nargs; m++) {
+    if (args[m].dat != NULL)
+      hash = op_plan_hash_mix(hash, ((ull)args[m].dat->size << 32) |
+                                        (ull)args[m].dat->dim);
+    else
+      hash = op_plan_hash_mix(hash, 0);
+    hash = op_plan_hash_mix(hash, (ull)(size_t)args[m].map);
+    hash = op_plan_hash_mix(hash, ((ull)(unsigned int)args[m].idx << 32) |
+                                      (ull)(unsigned int)args[m].acc);
   }
+  return hash;
+}
 
-  /* first look for an existing execution plan */
+/*
+ * check whether an existing plan can be reused for the given arguments
+ */
 
-  int ip = 0, match = 0;
-
-  while (match == 0 && ip < OP_plan_index) {
-    if ((strcmp(name, OP_plans[ip].name) == 0) && (set == OP_plans[ip].set) &&
-        (nargs == OP_plans[ip].nargs) && (ninds == OP_plans[ip].ninds) &&
-        (part_size == OP_plans[ip].part_size)) {
-      match = 1;
-      for (int m = 0; m < nargs; m++) {
-        if (args[m].dat != NULL && OP_plans[ip].dats[m] != NULL)
-          match = match && (args[m].dat->size == OP_plans[ip].dats[m]->size) &&
-                  (args[m].dat->dim == OP_plans[ip].dats[m]->dim) &&
-                  (args[m].map == OP_plans[ip].maps[m]) &&
-                  (args[m].idx == OP_plans[ip].idxs[m]) &&
-                  (args[m].acc == OP_plans[ip].accs[m]);
-        else
-          match = match && (args[m].dat == OP_plans[ip].dats[m]) &&
-                  (args[m].map == OP_plans[ip].maps[m]) &&
-                  (args[m].idx == OP_plans[ip].idxs[m]) &&
-                  (args[m].acc == OP_plans[ip].accs[m]);
-      }
+static int op_plan_match(op_plan *plan, char const *name, op_set set,
+                         int part_size, int nargs, op_arg *args, int ninds) {
+  if (set != plan->set || nargs != plan->nargs || ninds != plan->ninds ||
+      part_size != plan->part_size)
+    return 0;
+  if (name != plan->name && strcmp(name, plan->name) != 0)
+    return 0;
+  for (int m = 0; m < nargs; m++) {
+    if (args[m].map != plan->maps[m] || args[m].idx != plan->idxs[m] ||
+        args[m].acc != plan->accs[m])
+      return 0;
+    if (args[m].dat != NULL && plan->dats[m] != NULL) {
+      if (args[m].dat->size != plan->dats[m]->size ||
+          args[m].dat->dim != plan->dats[m]->dim)
+        return 0;
+    } else if (args[m].dat != plan->dats[m]) {
+      return 0;
     }
-    ip++;
   }
+  return 1;
+}
 
-  if (match) {
-    ip--;
-    if (OP_diags > 3)
-      printf(" old execution plan #%d\n", ip);
-    OP_plans[ip].count++;
-    return &(OP_plans[ip]);
-  } else {
-    if (OP_diags > 1)
-      printf(" new execution plan #%d for kernel %s\n", ip, name);
-  }
-  double wall_t1, wall_t2, cpu_t1, cpu_t2;
-  op_timers_core(&cpu_t1, &wall_t1);
-  /* work out worst case shared memory requirement per element */
+/*
+ * look up an existing plan in the plan hash table, returns -1 if none found
+ */
 
-  int halo_exchange = 0;
-  for (int i = 0; i < nargs; i++) {
-    if (args[i].opt && args[i].idx != -1 && args[i].acc != OP_WRITE &&
-        args[i].acc != OP_INC) {
-      halo_exchange = 1;
-      break;
-    }
+static int op_plan_find(ull hash, char const *name, op_set set, int part_size,
+                        int nargs, op_arg *args, int ninds) {
+  op_plan_entry *entry;
+  HASH_FIND(hh, OP_plan_tab, &hash, sizeof(ull), entry);
+  if (entry == NULL)
+    return -1;
+  for (int ip = entry->index; ip != -1; ip = OP_plans[ip].hash_next) {
+    if (op_plan_match(&OP_plans[ip], name, set, part_size, nargs, args, ninds))
+      return ip;
   }
+  return -1;
+}
 
-  int maxbytes = 0;
-  for (int m = 0; m < nargs; m++) {
-    if (args[m].opt && inds[m] >= 0) {
-      if ((staging == OP_STAGE_INC && args[m].acc == OP_INC) ||
-          (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE))
-        maxbytes += args[m].dat->size;
-    }
+static void op_plan_register(int ip, ull hash) {
+  op_plan_entry *entry;
+  OP_plans[ip].hash = hash;
+  OP_plans[ip].hash_next = -1;
+  HASH_FIND(hh, OP_plan_tab, &hash, sizeof(ull), entry);
+  if (entry == NULL) {
+    entry = (op_plan_entry *)op_malloc(sizeof(op_plan_entry));
+    entry->hash = hash;
+    entry->index = ip;
+    HASH_ADD(hh, OP_plan_tab, hash, sizeof(ull), entry);
+  } else {
+    int last = entry->index;
+    while (OP_plans[last].hash_next != -1)
+      last = OP_plans[last].hash_next;
+    OP_plans[last].hash_next = ip;
   }
+}
 
-  /* set blocksize and number of blocks; adaptive size based on 48kB of shared
-   * memory */
+/*
+ * plan lookup through a call site handle: revalidates the plan the handle was
+ * bound to and only falls back to the backend specific plan construction
+ * (and the hash table lookup in op_plan_core) when the arguments changed
+ */
 
-  int bsize = part_size; // blocksize
-  if (bsize == 0 && maxbytes > 0)
-    bsize = MAX((24 * 1024 / (64 * maxbytes)) * 64,
-                256); // 48kB exactly is too much, make it 24
-  else if (bsize == 0 && maxbytes == 0)
-    bsize = 256;
+op_plan *op_plan_get_handle(op_plan_handle *handle, char const *name,
+                            op_set set, int part_size, int nargs, op_arg *args,
+                            int ninds, int *inds, int staging, int upload) {
+  if (handle->epoch == OP_plan_epoch && handle->index >= 0 &&
+      handle->index < OP_plan_index) {
+    op_plan *plan = &OP_plans[handle->index];
+    if (op_plan_match(plan, name, set, part_size, nargs, args, ninds)) {
+      if (OP_diags > 3)
+        printf(" old execution plan #%d\n", handle->index);
+      plan->count++;
+      return plan;
+    }
+  }
 
-  // If we do 1 level of coloring, do it in one go
-  if (staging == OP_COLOR2)
-    bsize = exec_length;
+  op_plan *plan = op_plan_get_stage_upload(name, set, part_size, nargs, args,
+                                           ninds, inds, staging, upload);
+  handle->index = (int)(plan - OP_plans);
+  handle->epoch = OP_plan_epoch;
+  return plan;
+}
 
-  int nblocks = 0;
+/*
+ * build the execution plan OP_plans[ip], whose input arguments and arrays
+ * have been set up by op_plan_core
+ */
 
-  int indirect_reduce = 0;
-  for (int m = 0; m < nargs; m++) {
-    indirect_reduce |=
-        (args[m].acc != OP_READ && args[m].argtype == OP_ARG_GBL);
-  }
-  indirect_reduce &= (ninds > 0);
+static void op_plan_build(int ip, op_arg *args, int *inds, int staging,
+                          int exec_length, int bsize, int indirect_reduce,
+                          int halo_exchange, int maxbytes,
+                          int *invinds_staged) {
+  op_set set = OP_plans[ip].set;
+  int nargs = OP_plans[ip].nargs;
+  int ninds = OP_plans[ip].ninds;
+  int ninds_staged = OP_plans[ip].ninds_staged;
+  int *inds_staged = OP_plans[ip].inds_staged;
+  int nblocks = OP_plans[ip].nblocks;
+  int prev_offset, next_offset;
 
-  /* Work out indirection arrays for OP_INCs */
-  int ninds_staged = 0; // number of distinct (unique dat) indirect incs
-  int *inds_staged = (int *)op_malloc(nargs * sizeof(int));
-  int *inds_to_inds_staged = (int *)op_malloc(ninds * sizeof(int));
+  /* define aliases */
 
-  for (int i = 0; i < nargs; i++)
-    inds_staged[i] = -1;
-  for (int i = 0; i < ninds; i++)
-    inds_to_inds_staged[i] = -1;
-  for (int i = 0; i < nargs; i++) {
-    if (inds[i] >= 0 &&
-        ((staging == OP_STAGE_INC && args[i].acc == OP_INC) ||
-         (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE))) {
-      if (inds_to_inds_staged[inds[i]] == -1) {
-        inds_to_inds_staged[inds[i]] = ninds_staged;
-        inds_staged[i] = ninds_staged;
-        ninds_staged++;
-      } else {
-        inds_staged[i] = inds_to_inds_staged[inds[i]];
-      }
-    }
-  }
+  op_dat *dats = OP_plans[ip].dats;
+  op_map *maps = OP_plans[ip].maps;
+  op_access *accs = OP_plans[ip].accs;
 
-  int *invinds_staged = (int *)op_malloc(ninds_staged * sizeof(int));
-  for (int i = 0; i < ninds_staged; i++)
-    invinds_staged[i] = -1;
-  for (int i = 0; i < nargs; i++)
-    if (inds[i] >= 0 &&
-        ((staging == OP_STAGE_INC && args[i].acc == OP_INC) ||
-         (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE)) &&
-        invinds_staged[inds_staged[i]] == -1)
-      invinds_staged[inds_staged[i]] = i;
+  int *offset = OP_plans[ip].offset;
+  int *nelems = OP_plans[ip].nelems;
+  int **ind_maps = OP_plans[ip].ind_maps;
+  int *ind_offs = OP_plans[ip].ind_offs;
+  int *ind_sizes = OP_plans[ip].ind_sizes;
+  int *nindirect = OP_plans[ip].nindirect;
 
-  int prev_offset = 0;
-  int next_offset = 0;
+  /* work out block offsets and sizes */
 
-  while (next_offset < exec_length) {
+  prev_offset = 0;
+  next_offset = 0;
+  for (int b = 0; b < nblocks; b++) {
     prev_offset = next_offset;
     if (prev_offset + bsize >= set->core_size && prev_offset < set->core_size) {
       next_offset = set->core_size;
@@ -439,306 +838,236 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
     } else {
       next_offset = prev_offset + bsize;
     }
-    nblocks++;
+
+    if (staging == OP_COLOR2) {
+      prev_offset = 0;
+      next_offset = exec_length;
+    };
+
+    offset[b] = prev_offset;               /* offset for block */
+    nelems[b] = next_offset - prev_offset; /* size of block */
   }
 
-  // If we do 1 level of coloring, we have a single "block"
-  if (staging == OP_COLOR2) {
-    nblocks = 1;
-    prev_offset = 0;
-    next_offset = exec_length;
-  };
+  /* classify the indirection sets: staged ones get ind_maps and loc_maps,
+   * coloured ones are written through OP_INC or OP_RW and drive colouring */
 
-  /* enlarge OP_plans array if needed */
+  int *ind_first = (int *)op_malloc(ninds * sizeof(int));
+  int *ind_colour = (int *)op_malloc(ninds * sizeof(int));
+  int max_refs = 1; /* max number of arguments sharing an indirection set */
+  int max_to = 1;   /* max size of an indirectly referenced set */
 
-  if (ip == OP_plan_max) {
-    // printf("allocating more memory for OP_plans %d\n", OP_plan_max);
-    OP_plan_max += 10;
-    OP_plans = (op_plan *)op_realloc(OP_plans, OP_plan_max * sizeof(op_plan));
-    if (OP_plans == NULL) {
-      printf(" op_plan error -- error reallocating memory for OP_plans\n");
-      exit(-1);
+  for (int m = 0; m < ninds; m++) {
+    int m2 = 0;
+    while (inds[m2] != m)
+      m2++;
+    ind_first[m] = m2;
+    ind_colour[m] = 0;
+    if (args[m2].opt == 0)
+      continue;
+
+    int refs = 0;
+    for (int m2 = 0; m2 < nargs; m2++) {
+      if (inds[m2] == m) {
+        refs++;
+        if ((accs[m2] == OP_INC || accs[m2] == OP_RW) && args[m2].opt)
+          ind_colour[m] = 1;
+      }
     }
+    max_refs = MAX(max_refs, refs);
+    max_to = MAX(max_to, (maps[m2]->to)->exec_size +
+                             (maps[m2]->to)->nonexec_size +
+                             (maps[m2]->to)->size);
   }
 
-  /* allocate memory for new execution plan and store input arguments */
-
-  OP_plans[ip].dats = (op_dat *)op_malloc(nargs * sizeof(op_dat));
-  OP_plans[ip].idxs = (int *)op_malloc(nargs * sizeof(int));
-  OP_plans[ip].optflags = (int *)op_malloc(nargs * sizeof(int));
-  OP_plans[ip].maps = (op_map *)op_malloc(nargs * sizeof(op_map));
-  OP_plans[ip].accs = (op_access *)op_malloc(nargs * sizeof(op_access));
-  OP_plans[ip].inds_staged = NULL;
+  /* number (and then offsets) of the distinct elements of each coloured
+   * indirection set written by each block */
+  int *col_start = (int *)op_calloc(nblocks * ninds + 1, sizeof(int));
 
-  OP_plans[ip].nthrcol = (int *)op_malloc(nblocks * sizeof(int));
-  OP_plans[ip].thrcol = (int *)op_malloc(exec_length * sizeof(int));
-  OP_plans[ip].col_reord = (int *)op_malloc((exec_length + 16) * sizeof(int));
-  OP_plans[ip].col_offsets = NULL;
-  OP_plans[ip].offset = (int *)op_malloc(nblocks * sizeof(int));
-  OP_plans[ip].ind_maps = (int **)op_malloc(ninds_staged * sizeof(int *));
-  OP_plans[ip].ind_offs =
-      (int *)op_malloc(nblocks * ninds_staged * sizeof(int));
-  OP_plans[ip].ind_sizes =
-      (int *)op_malloc(nblocks * ninds_staged * sizeof(int));
-  OP_plans[ip].nindirect = (int *)op_calloc(ninds, sizeof(int));
-  OP_plans[ip].loc_maps = (short **)op_malloc(nargs * sizeof(short *));
-  OP_plans[ip].nelems = (int *)op_malloc(nblocks * sizeof(int));
-  OP_plans[ip].ncolblk =
-      (int *)op_calloc(exec_length, sizeof(int)); /* max possibly needed */
-  OP_plans[ip].blkmap = (int *)op_calloc(nblocks, sizeof(int));
+  /* pass 1: count the distinct elements referenced by each block; a single
+   * block (e.g. OP_COLOR2) needs no layout, and always gets block color 0 */
 
-  int *offsets = (int *)op_malloc((ninds_staged + 1) * sizeof(int));
-  offsets[0] = 0;
-  for (int m = 0; m < ninds_staged; m++) {
-    int count = 0;
-    for (int m2 = 0; m2 < nargs; m2++)
-      if (inds_staged[m2] == m)
-        count++;
-    offsets[m + 1] = offsets[m] + count;
-  }
-  OP_plans[ip].ind_map =
-      (int *)op_malloc(offsets[ninds_staged] * exec_length * sizeof(int));
-  for (int m = 0; m < ninds_staged; m++) {
-    OP_plans[ip].ind_maps[m] = &OP_plans[ip].ind_map[exec_length * offsets[m]];
-  }
-  free(offsets);
-
-  int counter = 0;
-  for (int m = 0; m < nargs; m++) {
-    if (inds_staged[m] >= 0)
-      counter++;
-    else
-      OP_plans[ip].loc_maps[m] = NULL;
-
-    OP_plans[ip].dats[m] = args[m].dat;
-    OP_plans[ip].idxs[m] = args[m].idx;
-    OP_plans[ip].optflags[m] = args[m].opt;
-    OP_plans[ip].maps[m] = args[m].map;
-    OP_plans[ip].accs[m] = args[m].acc;
-  }
-
-  OP_plans[ip].loc_map =
-      (short *)op_malloc(counter * exec_length * sizeof(short));
-  counter = 0;
-  for (int m = 0; m < nargs; m++) {
-    if (inds_staged[m] >= 0) {
-      OP_plans[ip].loc_maps[m] = &OP_plans[ip].loc_map[exec_length * (counter)];
-      counter++;
+  if (nblocks > 1) {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      op_plan_scratch s;
+      op_plan_scratch_init(&s);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+      for (int b = 0; b < nblocks; b++) {
+        op_plan_scratch_reserve(&s, nargs, bsize, max_refs, max_to);
+        for (int m = 0; m < ninds; m++) {
+          int m3 = inds_staged[ind_first[m]];
+          if (m3 >= 0)
+            ind_sizes[m3 + b * ninds_staged] = 0;
+          if (args[ind_first[m]].opt == 0 || (m3 < 0 && !ind_colour[m]))
+            continue;
+          int nwritten;
+          int ne = op_plan_block_dedup(&s, m, offset[b],
+                                       offset[b] + nelems[b], nargs, args,
+                                       inds, &nwritten);
+          if (m3 >= 0)
+            ind_sizes[m3 + b * ninds_staged] = ne;
+          col_start[b * ninds + m] = ind_colour[m] ? nwritten : 0;
+        }
+    }
+    op_plan_scratch_free(&s);
     }
   }
 
-  OP_plans[ip].name = name;
-  OP_plans[ip].set = set;
-  OP_plans[ip].nargs = nargs;
-  OP_plans[ip].ninds = ninds;
-  OP_plans[ip].ninds_staged = ninds_staged;
-  OP_plans[ip].part_size = part_size;
-  OP_plans[ip].nblocks = nblocks;
-  OP_plans[ip].ncolors_core = 0;
-  OP_plans[ip].ncolors_owned = 0;
-  OP_plans[ip].count = 1;
-  OP_plans[ip].inds_staged = inds_staged;
-
-  OP_plan_index++;
-
-  /* define aliases */
-
-  op_dat *dats = OP_plans[ip].dats;
-  int *idxs = OP_plans[ip].idxs;
-  op_map *maps = OP_plans[ip].maps;
-  op_access *accs = OP_plans[ip].accs;
-
-  int *offset = OP_plans[ip].offset;
-  int *nelems = OP_plans[ip].nelems;
-  int **ind_maps = OP_plans[ip].ind_maps;
-  int *ind_offs = OP_plans[ip].ind_offs;
-  int *ind_sizes = OP_plans[ip].ind_sizes;
-  int *nindirect = OP_plans[ip].nindirect;
-
-  /* allocate working arrays */
-  uint **work;
-  work = (uint **)op_malloc(ninds * sizeof(uint *));
+  /* prefix sums give the block offsets into ind_maps and the colour lists */
 
   for (int m = 0; m < ninds; m++) {
-    int m2 = 0;
-    while (inds[m2] != m)
-      m2++;
-    if (args[m2].opt == 0) {
-      work[m] = NULL;
+    int m3 = inds_staged[ind_first[m]];
+    if (m3 < 0)
       continue;
+    for (int b = 0; b < nblocks; b++) {
+      if (b == 0)
+        ind_offs[m3 + b * ninds_staged] = 0;
+      else
+        ind_offs[m3 + b * ninds_staged] =
+            ind_offs[m3 + (b - 1) * ninds_staged] +
+            ind_sizes[m3 + (b - 1) * ninds_staged];
     }
-
-    int to_size = (maps[m2]->to)->exec_size + (maps[m2]->to)->nonexec_size +
-                  (maps[m2]->to)->size;
-    work[m] = (uint *)op_malloc(to_size * sizeof(uint));
   }
 
-  int *work2;
-  work2 =
-      (int *)op_malloc(nargs * bsize * sizeof(int)); /* max possibly needed */
+  int col_total = 0;
+  for (int i = 0; i < nblocks * ninds; i++) {
+    int count = col_start[i];
+    col_start[i] = col_total;
+    col_total += count;
+  }
+  col_start[nblocks * ninds] = col_total;
+  int *col_elems = (int *)op_malloc((col_total + 1) * sizeof(int));
 
-  /* process set one block at a time */
+  /* pass 2: store the sorted mappings and renumbered mappings in the
+   * execution plan and colour the elements of each block */
 
   float total_colors = 0;
 
-  prev_offset = 0;
-  next_offset = 0;
-  for (int b = 0; b < nblocks; b++) {
-    prev_offset = next_offset;
-    if (prev_offset + bsize >= set->core_size && prev_offset < set->core_size) {
-      next_offset = set->core_size;
-    } else if (prev_offset + bsize >= set->size && prev_offset < set->size &&
-               indirect_reduce) {
-      next_offset = set->size;
-    } else if (prev_offset + bsize >= exec_length &&
-               prev_offset < exec_length) {
-      next_offset = exec_length;
-    } else {
-      next_offset = prev_offset + bsize;
-    }
-
-    if (staging == OP_COLOR2) {
-      prev_offset = 0;
-      next_offset = exec_length;
-    };
-    int bs = next_offset - prev_offset;
-
-    offset[b] = prev_offset; /* offset for block */
-    nelems[b] = bs;          /* size of block */
-
-    /* loop over indirection sets */
-    for (int m = 0; m < ninds; m++) {
-      int m2 = 0;
-      while (inds[m2] != m)
-        m2++;
-      int m3 = inds_staged[m2];
-      if (m3 < 0)
-        continue;
-      if (args[m2].opt == 0) {
-        if (b == 0) {
-          ind_offs[m3 + b * ninds_staged] = 0;
-          ind_sizes[m3 + b * ninds_staged] = 0;
-        } else {
-          ind_offs[m3 + b * ninds_staged] =
-              ind_offs[m3 + (b - 1) * ninds_staged];
+#ifdef _OPENMP
+#pragma omp parallel reduction(+ : total_colors)
+#endif
+  {
+    op_plan_scratch s;
+    op_plan_scratch_init(&s);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (int b = 0; b < nblocks; b++) {
+      op_plan_scratch_reserve(&s, nargs, bsize, max_refs, max_to);
+      int from = offset[b];
+      int to = offset[b] + nelems[b];
+      int nlocal = 0;
+
+      for (int m = 0; m < ninds; m++) {
+        int m3 = inds_staged[ind_first[m]];
+        if (m3 >= 0 && args[ind_first[m]].opt == 0)
           ind_sizes[m3 + b * ninds_staged] = 0;
+        if (args[ind_first[m]].opt == 0 || (m3 < 0 && !ind_colour[m]))
+          continue;
+        int nwritten;
+        int ne = op_plan_block_dedup(&s, m, from, to, nargs, args, inds,
+                                     &nwritten);
+        if (m3 >= 0)
+          ind_sizes[m3 + b * ninds_staged] = ne;
+
+        /* staged sets are renumbered in increasing order, others keep the
+         * order of first reference */
+        int *list = s.list;
+        if (m3 >= 0) {
+          list = &ind_maps[m3][ind_offs[m3 + b * ninds_staged]];
+          op_plan_sort(s.list, s.tmp, ne);
+          memcpy(list, s.list, ne * sizeof(int));
         }
-        continue;
-      }
-      /* build the list of elements indirectly referenced in this block */
 
-      int ne = 0; /* number of elements */
-      for (int m2 = 0; m2 < nargs; m2++) {
-        if (inds[m2] == m) {
-          for (int e = prev_offset; e < next_offset; e++)
-            work2[ne++] = maps[m2]->map[idxs[m2] + e * maps[m2]->dim];
+        int c = col_start[b * ninds + m];
+        for (int e = 0; e < ne; e++) {
+          int slot = op_plan_scratch_find(&s, list[e]);
+          s.local[slot] = e;
+          if (ind_colour[m] && s.written[slot] && nblocks > 1)
+            col_elems[c++] = list[e];
         }
-      }
-
-      /* sort them, then eliminate duplicates */
-
-      qsort(work2, ne, sizeof(int), comp);
 
-      int nde = 0;
-      int p = 0;
-      while (p < ne) {
-        work2[nde] = work2[p];
-        while (p < ne && work2[p] == work2[nde])
-          p++;
-        nde++;
+        for (int m2 = 0; m2 < nargs; m2++) {
+          if (inds[m2] == m) {
+            int *lidx = &s.lidx[m2 * s.stride];
+            for (int e = 0; e < to - from; e++)
+              lidx[e] = s.local[lidx[e]];
+            if (m3 >= 0 && OP_plans[ip].loc_maps[m2] != NULL)
+              for (int e = 0; e < to - from; e++)
+                OP_plans[ip].loc_maps[m2][from + e] = (short)lidx[e];
+            for (int e = 0; e < to - from; e++)
+              lidx[e] += nlocal; /* offset into the colour masks */
+          }
+        }
+        nlocal += ne;
       }
-      ne = nde; /* number of distinct elements */
-
-      /*
-         if (OP_diags > 5) { printf(" indirection set %d: ",m); for (int e=0;
-         e<ne; e++) printf("
-         %d",work2[e]); printf(" \n"); } */
 
-      /* store mapping and renumbered mappings in execution plan */
+      /* now colour main set elements */
 
-      for (int e = 0; e < ne; e++) {
-        ind_maps[m3][nindirect[m]++] = work2[e];
-        work[m][work2[e]] = e; // inverse mapping
-      }
-
-      for (int m2 = 0; m2 < nargs; m2++) {
-        if (inds[m2] == m) {
-          for (int e = prev_offset; e < next_offset; e++)
-            OP_plans[ip].loc_maps[m2][e] =
-                (short)(work[m][maps[m2]->map[idxs[m2] + e * maps[m2]->dim]]);
-        }
-      }
+      int repeat = 1;
+      int ncolor = 0;
+      int ncolors = 0;
 
-      if (b == 0) {
-        ind_offs[m3 + b * ninds_staged] = 0;
-        ind_sizes[m3 + b * ninds_staged] = nindirect[m];
+      if (staging == OP_COLOR2) {
+        ncolors = op_plan_color2(&s, from, to, nlocal, nargs, args, inds,
+                                 set->core_size, halo_exchange,
+                                 OP_plans[ip].thrcol);
+        repeat = 0;
       } else {
-        ind_offs[m3 + b * ninds_staged] =
-            ind_offs[m3 + (b - 1) * ninds_staged] +
-            ind_sizes[m3 + (b - 1) * ninds_staged];
-        ind_sizes[m3 + b * ninds_staged] =
-            nindirect[m] - ind_offs[m3 + b * ninds_staged];
+        for (int e = from; e < to; e++)
+          OP_plans[ip].thrcol[e] = -1;
       }
-    }
-
-    /* now colour main set elements */
 
-    for (int e = prev_offset; e < next_offset; e++)
-      OP_plans[ip].thrcol[e] = -1;
+      while (repeat) {
+        repeat = 0;
 
-    int repeat = 1;
-    int ncolor = 0;
-    int ncolors = 0;
-
-    while (repeat) {
-      repeat = 0;
-
-      for (int m = 0; m < nargs; m++) {
-        if (inds[m] >= 0 && args[m].opt)
-          for (int e = prev_offset; e < next_offset; e++)
-            work[inds[m]][maps[m]->map[idxs[m] + e * maps[m]->dim]] =
-                0; /* zero out color array */
-      }
-
-      for (int e = prev_offset; e < next_offset; e++) {
-        if (OP_plans[ip].thrcol[e] == -1) {
-          int mask = 0;
-          if (staging == OP_COLOR2 && halo_exchange && e >= set->core_size &&
-              ncolor == 0)
-            mask = 1;
-          for (int m = 0; m < nargs; m++)
-            if (inds[m] >= 0 && (accs[m] == OP_INC || accs[m] == OP_RW) &&
-                args[m].opt)
-              mask |=
-                  work[inds[m]]
-                      [maps[m]->map[idxs[m] +
-                                    e * maps[m]->dim]]; /* set bits of mask */
-
-          int color = ffs(~mask) - 1; /* find first bit not set */
-          if (color == -1) {          /* run out of colors on this pass */
-            repeat = 1;
-          } else {
-            OP_plans[ip].thrcol[e] = ncolor + color;
-            mask = 1 << color;
-            ncolors = MAX(ncolors, ncolor + color + 1);
+        for (int i = 0; i < nlocal; i++)
+          s.mask[i] = 0; /* zero out color array */
 
+        for (int e = from; e < to; e++) {
+          if (OP_plans[ip].thrcol[e] == -1) {
+            int mask = 0;
             for (int m = 0; m < nargs; m++)
               if (inds[m] >= 0 && (accs[m] == OP_INC || accs[m] == OP_RW) &&
                   args[m].opt)
-                work[inds[m]][maps[m]->map[idxs[m] + e * maps[m]->dim]] |=
-                    mask; /* set color bit */
+                mask |= s.mask[s.lidx[m * s.stride + e - from]]; /* set bits of
+                                                                  mask */
+
+            int color = ffs(~mask) - 1; /* find first bit not set */
+            if (color == -1) {          /* run out of colors on this pass */
+              repeat = 1;
+            } else {
+              OP_plans[ip].thrcol[e] = ncolor + color;
+              mask = 1 << color;
+              ncolors = MAX(ncolors, ncolor + color + 1);
+
+              for (int m = 0; m < nargs; m++)
+                if (inds[m] >= 0 && (accs[m] == OP_INC || accs[m] == OP_RW) &&
+                    args[m].opt)
+                  s.mask[s.lidx[m * s.stride + e - from]] |=
+                      mask; /* set color bit */
+            }
           }
         }
+
+        ncolor += 32; /* increment base level */
       }
 
-      ncolor += 32; /* increment base level */
+      OP_plans[ip].nthrcol[b] =
+          ncolors; /* number of thread colors in this block */
+      total_colors += ncolors;
     }
-
-    OP_plans[ip].nthrcol[b] =
-        ncolors; /* number of thread colors in this block */
-    total_colors += ncolors;
-
-    // if(ncolors>1) printf(" number of colors in this block = %d \n",ncolors);
+    op_plan_scratch_free(&s);
+  }
+  for (int m = 0; m < ninds; m++) {
+    int m3 = inds_staged[ind_first[m]];
+    if (m3 >= 0)
+      for (int b = 0; b < nblocks; b++)
+        nindirect[m] += ind_sizes[m3 + b * ninds_staged];
   }
 
   /* create element permutation by color */
@@ -785,12 +1114,29 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
 
   /* color the blocks, after initialising colors to 0 */
 
+  uint **work;
+  work = (uint **)op_malloc(ninds * sizeof(uint *));
+  for (int m = 0; m < ninds; m++) {
+    int m2 = ind_first[m];
+    if (!ind_colour[m]) {
+      work[m] = NULL;
+      continue;
+    }
+    int to_size = (maps[m2]->to)->exec_size + (maps[m2]->to)->nonexec_size +
+                  (maps[m2]->to)->size;
+    work[m] = (uint *)op_calloc(to_size, sizeof(uint));
+  }
+
   int *blk_col;
 
   blk_col = (int *)op_malloc(nblocks * sizeof(int));
   for (int b = 0; b < nblocks; b++)
     blk_col[b] = -1;
 
+  int *blk_done = (int *)op_malloc(nblocks * sizeof(int)); /* blocks colored
+                                                              in last pass */
+  int nblk_done = 0;
+
   int repeat = 1;
   int ncolor = 0;
   int ncolors = 0;
@@ -798,14 +1144,16 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
   while (repeat) {
     repeat = 0;
 
-    for (int m = 0; m < nargs; m++) {
-      if (inds[m] >= 0 && args[m].opt) {
-        int to_size = (maps[m]->to)->exec_size + (maps[m]->to)->nonexec_size +
-                      (maps[m]->to)->size;
-        for (int e = 0; e < to_size; e++)
-          work[inds[m]][e] = 0; // zero out color arrays
-      }
+    /* only the entries set in the previous pass need zeroing out */
+    for (int i = 0; i < nblk_done; i++) {
+      int b = blk_done[i];
+      for (int m = 0; m < ninds; m++)
+        for (int c = col_start[b * ninds + m]; c < col_start[b * ninds + m + 1];
+             c++)
+          work[m][col_elems[c]] = 0;
     }
+    nblk_done = 0;
+
     prev_offset = 0;
     next_offset = 0;
     for (int b = 0; b < nblocks; b++) {
@@ -840,15 +1188,10 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
             mask |= 1 << shifter;
         }
 
-        for (int m = 0; m < nargs; m++) {
-          if (inds[m] >= 0 && (accs[m] == OP_INC || accs[m] == OP_RW) &&
-              args[m].opt)
-            for (int e = prev_offset; e < next_offset; e++)
-              mask |= work[inds[m]]
-                          [maps[m]->map[idxs[m] + e * maps[m]->dim]]; // set
-                                                                      // bits of
-                                                                      // mask
-        }
+        for (int m = 0; m < ninds; m++)
+          for (int c = col_start[b * ninds + m];
+               c < col_start[b * ninds + m + 1]; c++)
+            mask |= work[m][col_elems[c]]; // set bits of mask
 
         int color = ffs(~mask) - 1; // find first bit not set
         if (color == -1) {          // run out of colors on this pass
@@ -857,13 +1200,12 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
           blk_col[b] = ncolor + color;
           mask = 1 << color;
           ncolors = MAX(ncolors, ncolor + color + 1);
+          blk_done[nblk_done++] = b;
 
-          for (int m = 0; m < nargs; m++) {
-            if (inds[m] >= 0 && (accs[m] == OP_INC || accs[m] == OP_RW) &&
-                args[m].opt)
-              for (int e = prev_offset; e < next_offset; e++)
-                work[inds[m]][maps[m]->map[idxs[m] + e * maps[m]->dim]] |= mask;
-          }
+          for (int m = 0; m < ninds; m++)
+            for (int c = col_start[b * ninds + m];
+                 c < col_start[b * ninds + m + 1]; c++)
+              work[m][col_elems[c]] |= mask;
         }
       }
     }
@@ -892,6 +1234,7 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
   for (int c = 1; c < ncolors; c++)
     OP_plans[ip].ncolblk[c] += OP_plans[ip].ncolblk[c - 1]; // cumsum
 
+  int *work2 = (int *)op_malloc(ncolors * sizeof(int));
   for (int c = 0; c < ncolors; c++)
     work2[c] = 0;
 
@@ -914,26 +1257,19 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
   /* work out shared memory requirements */
   OP_plans[ip].nsharedCol = (int *)op_malloc(ncolors * sizeof(int));
   float total_shared = 0;
-  for (int col = 0; col < ncolors; col++) {
+  for (int col = 0; col < ncolors; col++)
     OP_plans[ip].nsharedCol[col] = 0;
-    for (int b = 0; b < nblocks; b++) {
-      if (blk_col[b] == col) {
-        int nbytes = 0;
-        for (int m = 0; m < ninds_staged; m++) {
-          int m2 = 0;
-          while (inds_staged[m2] != m)
-            m2++;
-          if (args[m2].opt == 0)
-            continue;
+  for (int b = 0; b < nblocks; b++) {
+    int nbytes = 0;
+    for (int m = 0; m < ninds_staged; m++) {
+      int m2 = invinds_staged[m];
+      if (args[m2].opt == 0)
+        continue;
 
-          nbytes +=
-              ROUND_UP_64(ind_sizes[m + b * ninds_staged] * dats[m2]->size);
-        }
-        OP_plans[ip].nsharedCol[col] =
-            MAX(OP_plans[ip].nsharedCol[col], nbytes);
-        total_shared += nbytes;
-      }
+      nbytes += ROUND_UP_64(ind_sizes[m + b * ninds_staged] * dats[m2]->size);
     }
+    OP_plans[ip].nsharedCol[blk_col[b]] =
+        MAX(OP_plans[ip].nsharedCol[blk_col[b]], nbytes);
   }
 
   OP_plans[ip].nshared = 0;
@@ -1078,6 +1414,19 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
     for (int i = 0; i < ncolors - 1; i++)
       printf(" %.2f KB,", OP_plans[ip].nsharedCol[i] / 1024.0f);
     printf(" %.2f KB\n", OP_plans[ip].nsharedCol[ncolors - 1] / 1024.0f);
+    if (staging == OP_COLOR2) {
+      int *col_offsets = OP_plans[ip].color2_offsets;
+      int min_size = exec_length, max_size = 0;
+      printf(" thread color sizes     = ");
+      for (int c = 0; c < OP_plans[ip].ncolors; c++) {
+        int size = col_offsets[c + 1] - col_offsets[c];
+        min_size = MIN(min_size, size);
+        max_size = MAX(max_size, size);
+        printf(" %d%s", size, c < OP_plans[ip].ncolors - 1 ? "," : "\n");
+      }
+      printf(" min/avg/max color size = %d / %.1f / %d \n", min_size,
+             exec_length / (float)OP_plans[ip].ncolors, max_size);
+    }
     printf(" average data reuse     = %.2f \n",
            maxbytes * (exec_length / total_shared));
     printf(" data transfer (used)   = %.2f MB \n",
@@ -1088,10 +1437,6 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
            transfer3 / OP_plans[ip].transfer2);
   }
 
-  /* validate plan info */
-
-  op_plan_check(OP_plans[ip], ninds_staged, inds_staged);
-
   /* free work arrays */
 
   for (int m = 0; m < ninds; m++)
@@ -1099,6 +1444,603 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
   free(work);
   free(work2);
   free(blk_col);
+  free(blk_done);
+  free(col_start);
+  free(col_elems);
+  free(ind_first);
+  free(ind_colour);
+}
+
+/*
+ * on-disk plan cache (OP_PLAN_CACHE=dir): plans are stored after they are
+ * built and reloaded by later runs on the same mesh and partitioning
+ */
+
+#define OP_PLAN_CACHE_VERSION 2
+
+typedef struct {
+  char magic[8];
+  int version;
+  int nargs, ninds, ninds_staged, nblocks, exec_length, staging;
+  int ncolors, ncolors_core, ncolors_owned, nshared;
+  float transfer, transfer2;
+  ull key;
+} op_plan_cache_header;
+
+static ull op_plan_hash_bytes(ull hash, const void *data, size_t bytes) {
+  const char *c = (const char *)data;
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    ull word;
+    memcpy(&word, c + i, 8);
+    hash = op_plan_hash_mix(hash, word);
+  }
+  for (; i < bytes; i++)
+    hash = op_plan_hash_mix(hash, (unsigned char)c[i]);
+  return hash;
+}
+
+static ull op_plan_hash_set(ull hash, op_set set) {
+  hash = op_plan_hash_mix(hash, ((ull)set->size << 32) | (uint)set->core_size);
+  return op_plan_hash_mix(hash,
+                          ((ull)set->exec_size << 32) | (uint)set->nonexec_size);
+}
+
+/*
+ * cache key: everything the plan depends on that does not persist across
+ * runs, i.e. the contents of the maps and the (MPI) sizes of the sets
+ */
+
+static ull op_plan_cache_key(int ip, op_arg *args, int *inds, int staging,
+                             int exec_length) {
+  op_plan *plan = &OP_plans[ip];
+  ull hash = 14695981039346656037ULL;
+  for (char const *c = plan->name; *c != '\0'; c++) {
+    hash ^= (unsigned char)*c;
+    hash *= 1099511628211ULL;
+  }
+  hash = op_plan_hash_mix(hash, OP_PLAN_CACHE_VERSION);
+  hash = op_plan_hash_mix(hash, ((ull)plan->part_size << 32) | (uint)staging);
+  hash = op_plan_hash_mix(hash, ((ull)plan->nargs << 32) | (uint)plan->ninds);
+  hash = op_plan_hash_mix(hash,
+                          ((ull)exec_length << 32) | (uint)OP_cache_line_size);
+  hash = op_plan_hash_set(hash, plan->set);
+  if (staging == OP_COLOR2)
+    hash = op_plan_hash_mix(hash, ((ull)OP_color_order << 32) |
+                                      (uint)OP_color_balance);
+
+  for (int m = 0; m < plan->nargs; m++) {
+    hash = op_plan_hash_mix(hash, ((ull)(uint)inds[m] << 32) | (uint)args[m].opt);
+    if (args[m].dat != NULL)
+      hash = op_plan_hash_mix(hash, ((ull)args[m].dat->size << 32) |
+                                        (uint)args[m].dat->dim);
+    hash = op_plan_hash_mix(hash, ((ull)(uint)args[m].idx << 32) |
+                                      (uint)args[m].acc);
+    if (args[m].map == NULL || !args[m].opt)
+      continue;
+
+    /* hash the contents of each map only once */
+    int m2 = 0;
+    while (args[m2].map != args[m].map || !args[m2].opt)
+      m2++;
+    if (m2 < m) {
+      hash = op_plan_hash_mix(hash, m2);
+    } else {
+      op_map map = args[m].map;
+      hash = op_plan_hash_mix(hash, map->dim);
+      hash = op_plan_hash_set(hash, map->to);
+      hash = op_plan_hash_bytes(hash, map->map,
+                                (size_t)exec_length * map->dim * sizeof(int));
+    }
+  }
+  return hash;
+}
+
+static void op_plan_cache_path(char *path, size_t len, char const *name,
+                               ull key) {
+  snprintf(path, len, "%s/%s_%016llx.plan", OP_plan_cache_dir, name, key);
+}
+
+/* read or write a block of the payload, accumulating its checksum */
+static int op_plan_cache_rw(FILE *fp, void *data, size_t bytes, int store,
+                            ull *sum) {
+  size_t done =
+      store ? fwrite(data, 1, bytes, fp) : fread(data, 1, bytes, fp);
+  *sum = op_plan_hash_bytes(*sum, data, bytes);
+  return done == bytes;
+}
+
+/*
+ * the plan contents built by op_plan_build; when loading, the plan arrays
+ * sized by op_plan_core are filled in and the remaining ones allocated
+ */
+
+static int op_plan_cache_payload(FILE *fp, int ip, int store, int staging,
+                                 int exec_length, ull *sum) {
+  op_plan *plan = &OP_plans[ip];
+  int nblocks = plan->nblocks;
+  int ninds_staged = plan->ninds_staged;
+  int ok = 1;
+
+  ok = ok && op_plan_cache_rw(fp, plan->offset, nblocks * sizeof(int), store,
+                              sum);
+  ok = ok && op_plan_cache_rw(fp, plan->nelems, nblocks * sizeof(int), store,
+                              sum);
+  ok = ok && op_plan_cache_rw(fp, plan->nthrcol, nblocks * sizeof(int), store,
+                              sum);
+  ok = ok && op_plan_cache_rw(fp, plan->blkmap, nblocks * sizeof(int), store,
+                              sum);
+  ok = ok && op_plan_cache_rw(fp, plan->ncolblk, plan->ncolors * sizeof(int),
+                              store, sum);
+  ok = ok && op_plan_cache_rw(fp, plan->nsharedCol,
+                              plan->ncolors * sizeof(int), store, sum);
+  ok = ok && op_plan_cache_rw(fp, plan->ind_offs,
+                              nblocks * ninds_staged * sizeof(int), store, sum);
+  ok = ok && op_plan_cache_rw(fp, plan->ind_sizes,
+                              nblocks * ninds_staged * sizeof(int), store, sum);
+  ok = ok && op_plan_cache_rw(fp, plan->nindirect, plan->ninds * sizeof(int),
+                              store, sum);
+  if (!ok)
+    return 0;
+
+  int nloc = 0;
+  for (int m = 0; m < plan->nargs; m++)
+    nloc += (plan->inds_staged[m] >= 0);
+
+  for (int m = 0; m < ninds_staged; m++) {
+    long used = 0, capacity = 0;
+    for (int b = 0; b < nblocks; b++)
+      used += plan->ind_sizes[m + b * ninds_staged];
+    for (int m2 = 0; m2 < plan->nargs; m2++)
+      capacity += (plan->inds_staged[m2] == m) ? exec_length : 0;
+    if (used < 0 || used > capacity)
+      return 0;
+    ok = ok && op_plan_cache_rw(fp, plan->ind_maps[m], used * sizeof(int),
+                                store, sum);
+  }
+  ok = ok && op_plan_cache_rw(fp, plan->loc_map,
+                              (size_t)nloc * exec_length * sizeof(short), store,
+                              sum);
+  ok = ok && op_plan_cache_rw(fp, plan->thrcol, exec_length * sizeof(int),
+                              store, sum);
+  if (!ok)
+    return 0;
+
+  if (staging == OP_STAGE_PERMUTE || staging == OP_COLOR2) {
+    ok = ok && op_plan_cache_rw(fp, plan->col_reord,
+                                (exec_length + 16) * sizeof(int), store, sum);
+    long size_of_col_offsets = 0;
+    for (int b = 0; b < nblocks; b++) {
+      if (plan->nthrcol[b] < 0 || plan->nthrcol[b] > exec_length + 32)
+        return 0;
+      size_of_col_offsets += plan->nthrcol[b] + 1;
+    }
+    if (!store) {
+      plan->col_offsets = (int **)op_malloc(nblocks * sizeof(int *));
+      plan->col_offsets[0] =
+          (int *)op_malloc(size_of_col_offsets * sizeof(int));
+      for (int b = 1; b < nblocks; b++)
+        plan->col_offsets[b] =
+            plan->col_offsets[b - 1] + plan->nthrcol[b - 1] + 1;
+      if (staging == OP_COLOR2)
+        plan->color2_offsets = plan->col_offsets[0];
+    }
+    ok = ok && op_plan_cache_rw(fp, plan->col_offsets[0],
+                                size_of_col_offsets * sizeof(int), store, sum);
+  }
+  return ok;
+}
+
+static int op_plan_cache_load(int ip, op_arg *args, int *inds, int staging,
+                              int exec_length) {
+  op_plan *plan = &OP_plans[ip];
+  ull key = op_plan_cache_key(ip, args, inds, staging, exec_length);
+  char path[1024];
+  op_plan_cache_path(path, sizeof(path), plan->name, key);
+
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL)
+    return 0;
+
+  op_plan_cache_header header;
+  int ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+           memcmp(header.magic, "OP2PLAN", sizeof(header.magic)) == 0 &&
+           header.version == OP_PLAN_CACHE_VERSION && header.key == key &&
+           header.nargs == plan->nargs && header.ninds == plan->ninds &&
+           header.ninds_staged == plan->ninds_staged &&
+           header.nblocks == plan->nblocks &&
+           header.exec_length == exec_length && header.staging == staging &&
+           header.ncolors >= 0 && header.ncolors <= exec_length;
+
+  if (ok) {
+    plan->ncolors = header.ncolors;
+    plan->ncolors_core = header.ncolors_core;
+    plan->ncolors_owned = header.ncolors_owned;
+    plan->nshared = header.nshared;
+    plan->transfer = header.transfer;
+    plan->transfer2 = header.transfer2;
+    plan->nsharedCol = (int *)op_malloc(header.ncolors * sizeof(int));
+
+    ull sum = key, stored;
+    ok = op_plan_cache_payload(fp, ip, 0, staging, exec_length, &sum) &&
+         fread(&stored, sizeof(ull), 1, fp) == 1 && stored == sum &&
+         fgetc(fp) == EOF;
+  }
+  fclose(fp);
+
+  if (!ok) {
+    /* restore the state op_plan_build expects */
+    if (OP_diags > 1)
+      printf(" invalid plan cache file %s, rebuilding\n", path);
+    memset(plan->nindirect, 0, plan->ninds * sizeof(int));
+    memset(plan->ncolblk, 0, exec_length * sizeof(int));
+    plan->ncolors_core = 0;
+    plan->ncolors_owned = 0;
+    free(plan->nsharedCol);
+    plan->nsharedCol = NULL;
+    if (plan->col_offsets != NULL) {
+      op_free(plan->col_offsets[0]);
+      op_free(plan->col_offsets);
+      plan->col_offsets = NULL;
+    }
+    return 0;
+  }
+
+  if (OP_diags > 1)
+    printf(" execution plan #%d for kernel %s loaded from %s\n", ip,
+           plan->name, path);
+  return 1;
+}
+
+static void op_plan_cache_store(int ip, op_arg *args, int *inds, int staging,
+                                int exec_length) {
+  op_plan *plan = &OP_plans[ip];
+  ull key = op_plan_cache_key(ip, args, inds, staging, exec_length);
+  char path[1024], tmp_path[1100];
+  op_plan_cache_path(path, sizeof(path), plan->name, key);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int)getpid());
+
+  mkdir(OP_plan_cache_dir, 0755);
+  FILE *fp = fopen(tmp_path, "wb");
+  if (fp == NULL) {
+    if (OP_diags > 1)
+      printf(" could not write plan cache file %s\n", tmp_path);
+    return;
+  }
+
+  op_plan_cache_header header;
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, "OP2PLAN");
+  header.version = OP_PLAN_CACHE_VERSION;
+  header.nargs = plan->nargs;
+  header.ninds = plan->ninds;
+  header.ninds_staged = plan->ninds_staged;
+  header.nblocks = plan->nblocks;
+  header.exec_length = exec_length;
+  header.staging = staging;
+  header.ncolors = plan->ncolors;
+  header.ncolors_core = plan->ncolors_core;
+  header.ncolors_owned = plan->ncolors_owned;
+  header.nshared = plan->nshared;
+  header.transfer = plan->transfer;
+  header.transfer2 = plan->transfer2;
+  header.key = key;
+
+  ull sum = key;
+  int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+           op_plan_cache_payload(fp, ip, 1, staging, exec_length, &sum) &&
+           fwrite(&sum, sizeof(ull), 1, fp) == 1;
+  ok = (fclose(fp) == 0) && ok;
+
+  /* files are renamed into place so that concurrent runs (or MPI ranks with
+   * identical local meshes) never see a partially written plan */
+  if (!ok || rename(tmp_path, path) != 0) {
+    if (OP_diags > 1)
+      printf(" could not write plan cache file %s\n", path);
+    remove(tmp_path);
+  }
+}
+
+/*
+ * OP plan construction
+ */
+
+/*
+ * OP_NUMA: move the per-element plan arrays to pages first touched by the
+ * thread that executes each block, with the OpenMP loops' static split of
+ * each colour's blocks between the threads
+ */
+
+static void op_plan_numa_place(op_plan *plan, int exec_length) {
+  int covered = 0;
+  for (int b = 0; b < plan->nblocks; b++)
+    covered += plan->nelems[b];
+  if (covered != exec_length)
+    return;
+
+  int nloc = 0;
+  for (int m = 0; m < plan->nargs; m++)
+    if (plan->loc_maps[m] != NULL)
+      nloc++;
+
+  int *thrcol = (int *)op_numa_malloc(exec_length * sizeof(int));
+  int *col_reord = (int *)op_numa_malloc((exec_length + 16) * sizeof(int));
+  short *loc_map =
+      (short *)op_numa_malloc((size_t)nloc * exec_length * sizeof(short));
+
+  int block_offset = 0;
+  for (int col = 0; col < plan->ncolors; col++) {
+    int nblocks = plan->ncolblk[col];
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < nblocks; i++) {
+      int b = plan->blkmap[block_offset + i];
+      int first = plan->offset[b];
+      int n = plan->nelems[b];
+      memcpy(&thrcol[first], &plan->thrcol[first], n * sizeof(int));
+      memcpy(&col_reord[first], &plan->col_reord[first], n * sizeof(int));
+      for (int l = 0; l < nloc; l++) {
+        size_t off = (size_t)l * exec_length + first;
+        memcpy(&loc_map[off], &plan->loc_map[off], n * sizeof(short));
+      }
+    }
+    block_offset += nblocks;
+  }
+  memcpy(&col_reord[exec_length], &plan->col_reord[exec_length],
+         16 * sizeof(int));
+
+  free(plan->thrcol);
+  op_free(plan->col_reord);
+  free(plan->loc_map);
+  plan->thrcol = thrcol;
+  plan->col_reord = col_reord;
+  plan->loc_map = loc_map;
+  for (int m = 0, l = 0; m < plan->nargs; m++)
+    if (plan->loc_maps[m] != NULL)
+      plan->loc_maps[m] = &loc_map[(size_t)exec_length * l++];
+}
+
+op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
+                      op_arg *args, int ninds, int *inds, int staging) {
+  // set exec length
+  int exec_length = set->size;
+  for (int i = 0; i < nargs; i++) {
+    if (args[i].opt && args[i].idx != -1 && args[i].acc != OP_READ) {
+      exec_length += set->exec_size;
+      break;
+    }
+  }
+
+  /* first look for an existing execution plan */
+
+  ull hash = op_plan_signature(name, set, part_size, nargs, args, ninds);
+  int ip = op_plan_find(hash, name, set, part_size, nargs, args, ninds);
+
+  if (ip >= 0) {
+    if (OP_diags > 3)
+      printf(" old execution plan #%d\n", ip);
+    OP_plans[ip].count++;
+    return &(OP_plans[ip]);
+  } else {
+    ip = OP_plan_index;
+    if (OP_diags > 1)
+      printf(" new execution plan #%d for kernel %s\n", ip, name);
+  }
+  double wall_t1, wall_t2, cpu_t1, cpu_t2;
+  op_timers_core(&cpu_t1, &wall_t1);
+  /* work out worst case shared memory requirement per element */
+
+  int halo_exchange = 0;
+  for (int i = 0; i < nargs; i++) {
+    if (args[i].opt && args[i].idx != -1 && args[i].acc != OP_WRITE &&
+        args[i].acc != OP_INC) {
+      halo_exchange = 1;
+      break;
+    }
+  }
+
+  int maxbytes = 0;
+  for (int m = 0; m < nargs; m++) {
+    if (args[m].opt && inds[m] >= 0) {
+      if ((staging == OP_STAGE_INC && args[m].acc == OP_INC) ||
+          (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE))
+        maxbytes += args[m].dat->size;
+    }
+  }
+
+  /* set blocksize and number of blocks; adaptive size based on 48kB of shared
+   * memory */
+
+  int bsize = part_size; // blocksize
+  if (bsize == 0 && maxbytes > 0)
+    bsize = MAX((24 * 1024 / (64 * maxbytes)) * 64,
+                256); // 48kB exactly is too much, make it 24
+  else if (bsize == 0 && maxbytes == 0)
+    bsize = 256;
+
+  // If we do 1 level of coloring, do it in one go
+  if (staging == OP_COLOR2)
+    bsize = exec_length;
+
+  int nblocks = 0;
+
+  int indirect_reduce = 0;
+  for (int m = 0; m < nargs; m++) {
+    indirect_reduce |=
+        (args[m].acc != OP_READ && args[m].argtype == OP_ARG_GBL);
+  }
+  indirect_reduce &= (ninds > 0);
+
+  /* Work out indirection arrays for OP_INCs */
+  int ninds_staged = 0; // number of distinct (unique dat) indirect incs
+  int *inds_staged = (int *)op_malloc(nargs * sizeof(int));
+  int *inds_to_inds_staged = (int *)op_malloc(ninds * sizeof(int));
+
+  for (int i = 0; i < nargs; i++)
+    inds_staged[i] = -1;
+  for (int i = 0; i < ninds; i++)
+    inds_to_inds_staged[i] = -1;
+  for (int i = 0; i < nargs; i++) {
+    if (inds[i] >= 0 &&
+        ((staging == OP_STAGE_INC && args[i].acc == OP_INC) ||
+         (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE))) {
+      if (inds_to_inds_staged[inds[i]] == -1) {
+        inds_to_inds_staged[inds[i]] = ninds_staged;
+        inds_staged[i] = ninds_staged;
+        ninds_staged++;
+      } else {
+        inds_staged[i] = inds_to_inds_staged[inds[i]];
+      }
+    }
+  }
+
+  int *invinds_staged = (int *)op_malloc(ninds_staged * sizeof(int));
+  for (int i = 0; i < ninds_staged; i++)
+    invinds_staged[i] = -1;
+  for (int i = 0; i < nargs; i++)
+    if (inds[i] >= 0 &&
+        ((staging == OP_STAGE_INC && args[i].acc == OP_INC) ||
+         (staging == OP_STAGE_ALL || staging == OP_STAGE_PERMUTE)) &&
+        invinds_staged[inds_staged[i]] == -1)
+      invinds_staged[inds_staged[i]] = i;
+
+  int prev_offset = 0;
+  int next_offset = 0;
+
+  while (next_offset < exec_length) {
+    prev_offset = next_offset;
+    if (prev_offset + bsize >= set->core_size && prev_offset < set->core_size) {
+      next_offset = set->core_size;
+    } else if (prev_offset + bsize >= set->size && prev_offset < set->size &&
+               indirect_reduce) {
+      next_offset = set->size;
+    } else if (prev_offset + bsize >= exec_length &&
+               prev_offset < exec_length) {
+      next_offset = exec_length;
+    } else {
+      next_offset = prev_offset + bsize;
+    }
+    nblocks++;
+  }
+
+  // If we do 1 level of coloring, we have a single "block"
+  if (staging == OP_COLOR2) {
+    nblocks = 1;
+    prev_offset = 0;
+    next_offset = exec_length;
+  };
+
+  /* enlarge OP_plans array if needed */
+
+  if (ip == OP_plan_max) {
+    // printf("allocating more memory for OP_plans %d\n", OP_plan_max);
+    OP_plan_max += 10;
+    OP_plans = (op_plan *)op_realloc(OP_plans, OP_plan_max * sizeof(op_plan));
+    if (OP_plans == NULL) {
+      printf(" op_plan error -- error reallocating memory for OP_plans\n");
+      exit(-1);
+    }
+  }
+
+  /* allocate memory for new execution plan and store input arguments */
+
+  OP_plans[ip].dats = (op_dat *)op_malloc(nargs * sizeof(op_dat));
+  OP_plans[ip].idxs = (int *)op_malloc(nargs * sizeof(int));
+  OP_plans[ip].optflags = (int *)op_malloc(nargs * sizeof(int));
+  OP_plans[ip].maps = (op_map *)op_malloc(nargs * sizeof(op_map));
+  OP_plans[ip].accs = (op_access *)op_malloc(nargs * sizeof(op_access));
+  OP_plans[ip].inds_staged = NULL;
+
+  OP_plans[ip].nthrcol = (int *)op_malloc(nblocks * sizeof(int));
+  OP_plans[ip].thrcol = (int *)op_malloc(exec_length * sizeof(int));
+  OP_plans[ip].col_reord = (int *)op_malloc((exec_length + 16) * sizeof(int));
+  OP_plans[ip].col_offsets = NULL;
+  OP_plans[ip].offset = (int *)op_malloc(nblocks * sizeof(int));
+  OP_plans[ip].ind_maps = (int **)op_malloc(ninds_staged * sizeof(int *));
+  OP_plans[ip].ind_offs =
+      (int *)op_malloc(nblocks * ninds_staged * sizeof(int));
+  OP_plans[ip].ind_sizes =
+      (int *)op_malloc(nblocks * ninds_staged * sizeof(int));
+  OP_plans[ip].nindirect = (int *)op_calloc(ninds, sizeof(int));
+  OP_plans[ip].loc_maps = (short **)op_malloc(nargs * sizeof(short *));
+  OP_plans[ip].nelems = (int *)op_malloc(nblocks * sizeof(int));
+  OP_plans[ip].ncolblk =
+      (int *)op_calloc(exec_length, sizeof(int)); /* max possibly needed */
+  OP_plans[ip].blkmap = (int *)op_calloc(nblocks, sizeof(int));
+
+  int *offsets = (int *)op_malloc((ninds_staged + 1) * sizeof(int));
+  offsets[0] = 0;
+  for (int m = 0; m < ninds_staged; m++) {
+    int count = 0;
+    for (int m2 = 0; m2 < nargs; m2++)
+      if (inds_staged[m2] == m)
+        count++;
+    offsets[m + 1] = offsets[m] + count;
+  }
+  OP_plans[ip].ind_map =
+      (int *)op_malloc(offsets[ninds_staged] * exec_length * sizeof(int));
+  for (int m = 0; m < ninds_staged; m++) {
+    OP_plans[ip].ind_maps[m] = &OP_plans[ip].ind_map[exec_length * offsets[m]];
+  }
+  free(offsets);
+
+  int counter = 0;
+  for (int m = 0; m < nargs; m++) {
+    if (inds_staged[m] >= 0)
+      counter++;
+    else
+      OP_plans[ip].loc_maps[m] = NULL;
+
+    OP_plans[ip].dats[m] = args[m].dat;
+    OP_plans[ip].idxs[m] = args[m].idx;
+    OP_plans[ip].optflags[m] = args[m].opt;
+    OP_plans[ip].maps[m] = args[m].map;
+    OP_plans[ip].accs[m] = args[m].acc;
+  }
+
+  OP_plans[ip].loc_map =
+      (short *)op_malloc(counter * exec_length * sizeof(short));
+  counter = 0;
+  for (int m = 0; m < nargs; m++) {
+    if (inds_staged[m] >= 0) {
+      OP_plans[ip].loc_maps[m] = &OP_plans[ip].loc_map[exec_length * (counter)];
+      counter++;
+    }
+  }
+
+  OP_plans[ip].name = name;
+  OP_plans[ip].set = set;
+  OP_plans[ip].nargs = nargs;
+  OP_plans[ip].ninds = ninds;
+  OP_plans[ip].ninds_staged = ninds_staged;
+  OP_plans[ip].part_size = part_size;
+  OP_plans[ip].nblocks = nblocks;
+  OP_plans[ip].ncolors_core = 0;
+  OP_plans[ip].ncolors_owned = 0;
+  OP_plans[ip].count = 1;
+  OP_plans[ip].inds_staged = inds_staged;
+
+  OP_plan_index++;
+  op_plan_register(ip, hash);
+
+  if (OP_plan_cache_dir == NULL ||
+      !op_plan_cache_load(ip, args, inds, staging, exec_length)) {
+    op_plan_build(ip, args, inds, staging, exec_length, bsize, indirect_reduce,
+                  halo_exchange, maxbytes, invinds_staged);
+    if (OP_plan_cache_dir != NULL)
+      op_plan_cache_store(ip, args, inds, staging, exec_length);
+  }
+
+  /* validate plan info */
+
+  op_plan_check(OP_plans[ip], ninds_staged, inds_staged);
+
+  if (OP_numa)
+    op_plan_numa_place(&OP_plans[ip], exec_length);
+
+  /* free work arrays */
+
   free(inds_to_inds_staged);
   free(invinds_staged);
   op_timers_core(&cpu_t2, &wall_t2);
@@ -1108,6 +2050,8 @@ op_plan *op_plan_core(char const *name, op_set set, int part_size, int nargs,
       break;
     }
   }
+  if (OP_trace)
+    op_trace_event(name, "plan", wall_t1, wall_t2);
   /* return pointer to plan */
   OP_plan_time += wall_t2 - wall_t1;
   return &(OP_plans[ip]);
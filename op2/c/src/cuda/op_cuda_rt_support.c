@@ -458,6 +458,20 @@ void op_mpi_perf_comms(void *k_i, int nargs, op_arg *args) {
 }
 #endif
 
+void op_reduction_wait(void *handle) { (void)handle; }
+
+void op_mpi_chain_halo_exchanges(int nloops, op_kernel_descriptor *chain) {
+  (void)nloops;
+  (void)chain;
+}
+
+int op_mpi_tile_chain(int nloops, op_kernel_descriptor *chain, double *time) {
+  (void)nloops;
+  (void)chain;
+  (void)time;
+  return 0;
+}
+
 void op_mpi_reduce_float(op_arg *args, float *data) {
   (void)args;
   (void)data;
@@ -478,6 +492,11 @@ void op_mpi_reduce_bool(op_arg *args, bool *data) {
   (void)data;
 }
 
+void op_mpi_reduce_combined(op_arg *args, int nargs) {
+  (void)args;
+  (void)nargs;
+}
+
 void op_partition(const char *lib_name, const char *lib_routine,
                   op_set prime_set, op_map prime_map, op_dat coords) {
   (void)lib_name;
@@ -494,5 +513,19 @@ void op_compute_moment(double t, double *first, double *second) {
   *second = t * t;
 }
 
+int op_comm_size() { return 1; }
+
+int op_comm_rank() { return 0; }
+
+void op_gather_double(double *local, int n, double *gathered) {
+  if (gathered != NULL)
+    memcpy(gathered, local, n * sizeof(double));
+}
+
+void op_mpi_perf_halo_info(const char *name, int ndats, double *info) {
+  (void)name;
+  memset(info, 0, 2 * ndats * sizeof(double));
+}
+
 int op_is_root() { return 1; }
 #endif
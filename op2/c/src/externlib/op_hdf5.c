@@ -219,9 +219,7 @@ op_map op_decl_map_hdf5(op_set from, op_set to, int dim, char const *file,
 
   free((char*)dset_props.type_str);
 
-  op_map new_map = op_decl_map(from, to, dim, map, name);
-  new_map->user_managed = 0;
-  return new_map;
+  return op_decl_map_adopt(from, to, dim, map, name);
 }
 
 /*******************************************************************************
@@ -324,9 +322,7 @@ op_dat op_decl_dat_hdf5(op_set set, int dim, char const *type, char const *file,
 
   free((char*)dset_props.type_str);
 
-  op_dat new_dat = op_decl_dat_char(set, dim, type, type_size, data, name);
-  new_dat->user_managed = 0;
-  return new_dat;
+  return op_decl_dat_adopt_char(set, dim, type, type_size, data, name);
 }
 
 /*******************************************************************************
@@ -334,6 +330,7 @@ op_dat op_decl_dat_hdf5(op_set set, int dim, char const *type, char const *file,
 *******************************************************************************/
 
 void op_dump_to_hdf5(char const *file_name) {
+  op_flush();
   op_printf("Writing to %s\n", file_name);
 
   // declare timers
@@ -475,6 +472,13 @@ void op_dump_to_hdf5(char const *file_name) {
     // create dateset path
     create_path(dat->name, file_id);
 
+    // SoA dats are written element by element, as they were declared
+    char *data = dat->data;
+    if (dat->soa) {
+      data = (char *)op_malloc((size_t)dat->set->size * dat->size);
+      op_dat_get_aos(dat, data, 0, dat->set->size);
+    }
+
     // Create the dataset with default properties and write data
     if (strcmp(dat->type, "double") == 0 ||
         strcmp(dat->type, "double:soa") == 0 ||
@@ -483,7 +487,7 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_DOUBLE, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, H5S_ALL, dataspace, H5P_DEFAULT,
-               dat->data);
+               data);
     } else if (strcmp(dat->type, "float") == 0 ||
                strcmp(dat->type, "float:soa") == 0 ||
                strcmp(dat->type, "real(4)") == 0 ||
@@ -491,7 +495,7 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_FLOAT, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_FLOAT, H5S_ALL, dataspace, H5P_DEFAULT,
-               dat->data);
+               data);
     } else if (strcmp(dat->type, "int") == 0 ||
                strcmp(dat->type, "int:soa") == 0 ||
                strcmp(dat->type, "int(4)") == 0 ||
@@ -500,24 +504,27 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_INT, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_INT, H5S_ALL, dataspace, H5P_DEFAULT,
-               dat->data);
+               data);
     } else if ((strcmp(dat->type, "long") == 0) ||
                (strcmp(dat->type, "long:soa") == 0)) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_LONG, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_LONG, H5S_ALL, dataspace, H5P_DEFAULT,
-               dat->data);
+               data);
     } else if ((strcmp(dat->type, "long long") == 0) ||
                (strcmp(dat->type, "long long:soa") == 0)) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_LLONG, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_LLONG, H5S_ALL, dataspace, H5P_DEFAULT,
-               dat->data);
+               data);
     } else {
       op_printf("Unknown type for data elements %s\n", dat->type);
       exit(2);
     }
 
+    if (data != dat->data)
+      op_free(data);
+
     H5Sclose(dataspace);
     H5Dclose(dset_id);
 
@@ -810,11 +817,15 @@ void op_write_const_hdf5(char const *name, int dim, char const *type,
 
 void op_fetch_data_hdf5(op_dat dat, char const *file_name,
                         char const *path_name) {
+  op_flush();
   // letting know that writing is happening ...
   op_printf("Writing '%s' to file '%s'\n", path_name, file_name);
 
-  // fetch data based on the backend
-  op_fetch_data_char(dat, dat->data);
+  // fetch data based on the backend, SoA host data into an AoS copy
+  char *data = dat->data;
+  if (dat->soa)
+    data = (char *)op_malloc((size_t)dat->set->size * dat->size);
+  op_fetch_data_char(dat, data);
 
   // HDF5 APIs definitions
   hid_t file_id;   // file identifier
@@ -928,28 +939,28 @@ void op_fetch_data_hdf5(op_dat dat, char const *file_name,
           strcmp(dat->type, "double precision") == 0 ||
           strcmp(dat->type, "real(8)") == 0)
         H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, H5S_ALL, dataspace, H5P_DEFAULT,
-                 dat->data);
+                 data);
       else if (strcmp(dat->type, "float") == 0 ||
                strcmp(dat->type, "float:soa") == 0 ||
                strcmp(dat->type, "real(4)") == 0 ||
                strcmp(dat->type, "real") == 0)
         H5Dwrite(dset_id, H5T_NATIVE_FLOAT, H5S_ALL, dataspace, H5P_DEFAULT,
-                 dat->data);
+                 data);
       else if (strcmp(dat->type, "int") == 0 ||
                strcmp(dat->type, "int:soa") == 0 ||
                strcmp(dat->type, "int(4)") == 0 ||
                strcmp(dat->type, "integer") == 0 ||
                strcmp(dat->type, "integer(4)") == 0)
         H5Dwrite(dset_id, H5T_NATIVE_INT, H5S_ALL, dataspace, H5P_DEFAULT,
-                 dat->data);
+                 data);
       else if ((strcmp(dat->type, "long") == 0) ||
                (strcmp(dat->type, "long:soa") == 0))
         H5Dwrite(dset_id, H5T_NATIVE_LONG, H5S_ALL, dataspace, H5P_DEFAULT,
-                 dat->data);
+                 data);
       else if ((strcmp(dat->type, "long long") == 0) ||
                (strcmp(dat->type, "long long:soa") == 0))
         H5Dwrite(dset_id, H5T_NATIVE_LLONG, H5S_ALL, dataspace, H5P_DEFAULT,
-                 dat->data);
+                 data);
       else {
         op_printf("Unknown type for data elements\n");
         exit(2);
@@ -958,6 +969,8 @@ void op_fetch_data_hdf5(op_dat dat, char const *file_name,
       H5Dclose(dset_id);
       H5Sclose(dataspace);
       H5Fclose(file_id);
+      if (data != dat->data)
+        op_free(data);
       return;
     } else {
       if (OP_diags > 3) {
@@ -985,31 +998,31 @@ void op_fetch_data_hdf5(op_dat dat, char const *file_name,
     dset_id = H5Dcreate(file_id, path_name, H5T_NATIVE_DOUBLE, dataspace,
                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, H5S_ALL, dataspace, H5P_DEFAULT,
-             dat->data);
+             data);
   } else if ((strcmp(dat->type, "float") == 0) ||
              (strcmp(dat->type, "float:soa") == 0)) {
     dset_id = H5Dcreate(file_id, path_name, H5T_NATIVE_FLOAT, dataspace,
                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     H5Dwrite(dset_id, H5T_NATIVE_FLOAT, H5S_ALL, dataspace, H5P_DEFAULT,
-             dat->data);
+             data);
   } else if ((strcmp(dat->type, "int") == 0) ||
              (strcmp(dat->type, "int:soa") == 0)) {
     dset_id = H5Dcreate(file_id, path_name, H5T_NATIVE_INT, dataspace,
                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     H5Dwrite(dset_id, H5T_NATIVE_INT, H5S_ALL, dataspace, H5P_DEFAULT,
-             dat->data);
+             data);
   } else if ((strcmp(dat->type, "long") == 0) ||
              (strcmp(dat->type, "long:soa") == 0)) {
     dset_id = H5Dcreate(file_id, path_name, H5T_NATIVE_LONG, dataspace,
                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     H5Dwrite(dset_id, H5T_NATIVE_LONG, H5S_ALL, dataspace, H5P_DEFAULT,
-             dat->data);
+             data);
   } else if ((strcmp(dat->type, "long long") == 0) ||
              (strcmp(dat->type, "long long:soa") == 0)) {
     dset_id = H5Dcreate(file_id, path_name, H5T_NATIVE_LLONG, dataspace,
                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     H5Dwrite(dset_id, H5T_NATIVE_LLONG, H5S_ALL, dataspace, H5P_DEFAULT,
-             dat->data);
+             data);
   } else {
     op_printf("Unknown type for data elements\n");
     exit(2);
@@ -1054,6 +1067,8 @@ void op_fetch_data_hdf5(op_dat dat, char const *file_name,
   H5Sclose(dataspace);
   H5Dclose(dset_id);
   H5Fclose(file_id);
+  if (data != dat->data)
+    op_free(data);
 }
 
 /*******************************************************************************
@@ -1077,3 +1092,9 @@ void op_fetch_data_hdf5_file_path(op_dat dat, char const *file_name,
                                   char const *path_name) {
   op_fetch_data_hdf5(dat, file_name, path_name);
 }
+
+/*******************************************************************************
+* Writes are synchronous without MPI, there is nothing to wait for
+*******************************************************************************/
+
+void op_output_wait() {}
@@ -165,13 +165,17 @@ void reorder_set(op_set set, std::vector<std::vector<int> > &set_permutations,
   for (int mapidx = 0; mapidx < OP_map_index; mapidx++) {
     op_map map = OP_map_list[mapidx];
     if (map->from == set) {
-      int *tempmap = (int *)malloc((set->size+set->exec_size) * sizeof(int) * map->dim);
+      // first touched with the OpenMP element split, as op_map_numa_place
+      int *tempmap = (int *)op_numa_alloc(NULL, 1, set->size + set->exec_size,
+                                          map->dim * sizeof(int));
 
       for (int i = 0; i < set->size+set->exec_size; i++)
         std::copy(map->map + map->dim * i, map->map + map->dim * (i + 1),
                   tempmap + map->dim * set_permutations[set->index][i]);
-      free(map->map);
+      if (!map->user_managed)
+        op_free(map->map);
       map->map = tempmap;
+      map->user_managed = 0;
 
     } else if (map->to == set) {
       for (int i = 0; i < (map->from->size+map->from->exec_size) * map->dim; i++)
@@ -184,15 +188,23 @@ void reorder_set(op_set set, std::vector<std::vector<int> > &set_permutations,
   TAILQ_FOREACH(item, &OP_dat_list, entries) {
     op_dat dat = item->dat;
     if (dat->set == set && dat->data != NULL) {
-      char *tempdata = (char *)malloc((size_t)(set->size+set->exec_size+set->nonexec_size) * (size_t)dat->size);
-      for (unsigned long int i = 0; i < (unsigned long int)(set->size+set->exec_size+set->nonexec_size); i++)
-        std::copy(dat->data + (unsigned long int)dat->size * i,
-                  dat->data + (unsigned long int)dat->size * (i + 1),
-                  tempdata +
-                      (unsigned long int)dat->size *
-                          (unsigned long int)set_permutations[set->index][i]);
-      free(dat->data);
+      // op_partition may already have made the dat component-major, then
+      // each of the dim component runs is permuted on its own
+      int n = op_dat_soa_stride(dat);
+      int ncomp = dat->soa ? dat->dim : 1;
+      size_t esz = dat->size / ncomp;
+      char *tempdata = op_numa_alloc(NULL, ncomp, n, esz);
+      for (int c = 0; c < ncomp; c++)
+        for (int i = 0; i < n; i++)
+          std::copy(dat->data + ((size_t)c * n + i) * esz,
+                    dat->data + ((size_t)c * n + i + 1) * esz,
+                    tempdata +
+                        ((size_t)c * n + set_permutations[set->index][i]) *
+                            esz);
+      if (!dat->user_managed)
+        op_free(dat->data);
       dat->data = tempdata;
+      dat->user_managed = 0;
     }
   }
 
@@ -220,12 +232,224 @@ void reorder_set(op_set set, std::vector<std::vector<int> > &set_permutations,
   OP_part_list[set->index]->g_index = new_g_index; 
 }
 
-void op_renumber(op_map base) {
-#ifndef HAVE_PTSCOTCH
-  op_printf("OP2 was not compiled with Scotch, no reordering.\n");
-#else
-  op_printf("Renumbering using base map %s\n", base->name);
-  int generated_partvec = 0;
+// Reverse Cuthill-McKee: breadth first search from a pseudo-peripheral vertex
+// of each connected component, visiting neighbours by increasing degree
+
+// breadth first search from root, returns the number of levels and a vertex of
+// minimum degree in the last level
+int rcm_last_level(int root, int stamp, std::vector<int> &row_offsets,
+                   std::vector<int> &col_indices, std::vector<int> &mark,
+                   std::vector<int> &queue, int *last) {
+  queue.clear();
+  queue.push_back(root);
+  mark[root] = stamp;
+  size_t head = 0, level_start = 0, level_end = 1;
+  int depth = 1;
+  while (true) {
+    for (; head < level_end; head++) {
+      int v = queue[head];
+      for (int j = row_offsets[v]; j < row_offsets[v + 1]; j++) {
+        if (mark[col_indices[j]] != stamp) {
+          mark[col_indices[j]] = stamp;
+          queue.push_back(col_indices[j]);
+        }
+      }
+    }
+    if (queue.size() == level_end)
+      break;
+    level_start = level_end;
+    level_end = queue.size();
+    depth++;
+  }
+  *last = queue[level_start];
+  for (size_t i = level_start; i < level_end; i++) {
+    int v = queue[i];
+    if (row_offsets[v + 1] - row_offsets[v] <
+        row_offsets[*last + 1] - row_offsets[*last])
+      *last = v;
+  }
+  return depth;
+}
+
+void renumber_rcm(int nvert, std::vector<int> &row_offsets,
+                  std::vector<int> &col_indices, std::vector<int> &permutation) {
+  std::vector<int> order;
+  order.reserve(nvert);
+  std::vector<int> mark(nvert, -1);
+  std::vector<int> queue;
+  std::vector<std::pair<int, int> > nbrs;
+  int stamp = 0;
+
+  for (int seed = 0; seed < nvert; seed++) {
+    if (mark[seed] == -2)
+      continue;
+
+    // pseudo-peripheral root: move to the far end of the level structure
+    // while its depth keeps growing
+    int root = seed, last;
+    int depth = rcm_last_level(root, stamp++, row_offsets, col_indices, mark,
+                               queue, &last);
+    for (int iter = 0; iter < 8; iter++) {
+      int next;
+      int d = rcm_last_level(last, stamp++, row_offsets, col_indices, mark,
+                             queue, &next);
+      if (d <= depth)
+        break;
+      root = last;
+      depth = d;
+      last = next;
+    }
+
+    // Cuthill-McKee ordering of the component, visited vertices marked -2
+    size_t head = order.size();
+    order.push_back(root);
+    mark[root] = -2;
+    while (head < order.size()) {
+      int v = order[head++];
+      nbrs.clear();
+      for (int j = row_offsets[v]; j < row_offsets[v + 1]; j++) {
+        int u = col_indices[j];
+        if (mark[u] != -2) {
+          mark[u] = -2;
+          nbrs.push_back(std::make_pair(row_offsets[u + 1] - row_offsets[u], u));
+        }
+      }
+      std::sort(nbrs.begin(), nbrs.end());
+      for (size_t i = 0; i < nbrs.size(); i++)
+        order.push_back(nbrs[i].second);
+    }
+  }
+
+  // reverse
+  for (int i = 0; i < nvert; i++)
+    permutation[order[i]] = nvert - 1 - i;
+}
+
+// Space filling curve orderings of the coordinates of the core elements of
+// base->to; coordinates on another set are averaged over a map from base->to
+
+double coord_value(op_dat coords, int i, int d) {
+  size_t k = coords->soa ? (size_t)d * op_dat_soa_stride(coords) + i
+                         : (size_t)i * coords->dim + d;
+  if (strncmp(coords->type, "float", 5) == 0)
+    return ((float *)coords->data)[k];
+  return ((double *)coords->data)[k];
+}
+
+// interleave the bits of the ndim coordinates, most significant first
+unsigned long long interleave_bits(unsigned int *X, int ndim, int bits) {
+  unsigned long long key = 0;
+  for (int b = bits - 1; b >= 0; b--)
+    for (int i = 0; i < ndim; i++)
+      key = (key << 1) | ((X[i] >> b) & 1);
+  return key;
+}
+
+// Hilbert index, transposed form as in J. Skilling, "Programming the Hilbert
+// curve", AIP Conf. Proc. 707 (2004)
+unsigned long long hilbert_key(unsigned int *X, int ndim, int bits) {
+  unsigned int M = 1U << (bits - 1), P, Q, t;
+  for (Q = M; Q > 1; Q >>= 1) {
+    P = Q - 1;
+    for (int i = 0; i < ndim; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+  for (int i = 1; i < ndim; i++)
+    X[i] ^= X[i - 1];
+  t = 0;
+  for (Q = M; Q > 1; Q >>= 1)
+    if (X[ndim - 1] & Q)
+      t ^= Q - 1;
+  for (int i = 0; i < ndim; i++)
+    X[i] ^= t;
+  return interleave_bits(X, ndim, bits);
+}
+
+int renumber_sfc(op_map base, op_dat coords, int hilbert,
+                 std::vector<int> &permutation) {
+  op_set set = base->to;
+  int n = set->core_size;
+  if (coords == NULL || (strcmp(coords->type, "double") != 0 &&
+                         strcmp(coords->type, "float") != 0)) {
+    op_printf("Space filling curve renumbering needs double or float "
+              "coordinates, aborting renumbering...\n");
+    return 0;
+  }
+
+  op_map cmap = NULL;
+  if (coords->set != set) {
+    for (int mapidx = 0; mapidx < OP_map_index; mapidx++)
+      if (OP_map_list[mapidx]->from == set &&
+          OP_map_list[mapidx]->to == coords->set) {
+        cmap = OP_map_list[mapidx];
+        break;
+      }
+    if (cmap == NULL) {
+      op_printf("No map from %s to coordinate set %s, aborting "
+                "renumbering...\n",
+                set->name, coords->set->name);
+      return 0;
+    }
+  }
+
+  int ndim = std::min(coords->dim, 3);
+  std::vector<double> xyz((size_t)n * ndim, 0.0);
+  for (int i = 0; i < n; i++) {
+    for (int d = 0; d < ndim; d++) {
+      if (cmap == NULL) {
+        xyz[(size_t)i * ndim + d] = coord_value(coords, i, d);
+      } else {
+        for (int k = 0; k < cmap->dim; k++)
+          xyz[(size_t)i * ndim + d] +=
+              coord_value(coords, cmap->map[i * cmap->dim + k], d);
+        xyz[(size_t)i * ndim + d] /= cmap->dim;
+      }
+    }
+  }
+
+  // scale the bounding box onto a 2^bits grid, bits such that the key fits
+  // 64 bits
+  int bits = ndim == 1 ? 32 : (ndim == 2 ? 31 : 21);
+  double lo[3], hi[3];
+  for (int d = 0; d < ndim; d++) {
+    lo[d] = 1e308;
+    hi[d] = -1e308;
+  }
+  for (int i = 0; i < n; i++)
+    for (int d = 0; d < ndim; d++) {
+      lo[d] = std::min(lo[d], xyz[(size_t)i * ndim + d]);
+      hi[d] = std::max(hi[d], xyz[(size_t)i * ndim + d]);
+    }
+  double extent = 0.0;
+  for (int d = 0; d < ndim; d++)
+    extent = std::max(extent, hi[d] - lo[d]);
+  double scale = extent > 0.0 ? ((double)(1ULL << bits) - 1.0) / extent : 0.0;
+
+  std::vector<std::pair<unsigned long long, int> > keys(n);
+  for (int i = 0; i < n; i++) {
+    unsigned int X[3];
+    for (int d = 0; d < ndim; d++)
+      X[d] = (unsigned int)((xyz[(size_t)i * ndim + d] - lo[d]) * scale);
+    keys[i].first =
+        hilbert ? hilbert_key(X, ndim, bits) : interleave_bits(X, ndim, bits);
+    keys[i].second = i;
+  }
+  std::sort(keys.begin(), keys.end());
+  for (int i = 0; i < n; i++)
+    permutation[keys[i].second] = i;
+  return 1;
+}
+
+// graph based renumbering: the adjacency of base->to through base is ordered
+// by RCM or by Scotch
+int renumber_graph(op_map base, int scotch, std::vector<int> &permutation) {
 /*
   if (FILE *file = fopen("partvec0001_0001", "r")) {
     fclose(file);
@@ -318,7 +542,7 @@ void op_renumber(op_map base) {
             base->map[base->dim * loopback[0].b + i];
     }
     int nodectr = 0;
-    for (int i = 1; i < loopback.size(); i++) {
+    for (size_t i = 1; i < loopback.size(); i++) {
       if (loopback[i].a != loopback[i - 1].a) {
         nodectr++;
         row_offsets[nodectr + 1] = row_offsets[nodectr];
@@ -340,7 +564,7 @@ void op_renumber(op_map base) {
       printf(
           "Map %s is not an onto map from %s to %s, or bad partitioning, aborting renumbering...\n",
           base->name, base->from->name, base->to->name);
-      return;
+      return 0;
     }
     col_indices.resize(row_offsets[base->to->core_size]);
     if (OP_diags>2) op_printf("Loopback map %s->%s constructed: %d, from set %s (%d)\n",
@@ -348,10 +572,11 @@ void op_renumber(op_map base) {
            base->from->name, base->from->size);
   }
   //sanity check
-  for (int row = 0; row < row_offsets.size()-1; row++) {
+  for (int row = 0; row < (int)row_offsets.size() - 1; row++) {
     if (row_offsets[row] == row_offsets[row+1]) printf("Zero length row\n");
     for (int col = row_offsets[row]; col < row_offsets[row+1]; col++) {
-      if (col_indices[col]<0 || col_indices[col]>=row_offsets.size()-1)
+      if (col_indices[col] < 0 ||
+          col_indices[col] >= (int)row_offsets.size() - 1)
         printf("Error col idx %d, but num rows is %lu\n", col_indices[col],
                row_offsets.size() - 1);
       else {
@@ -364,18 +589,6 @@ void op_renumber(op_map base) {
       }
     }
   }
-  //Statistics
-  int max_dist = 0;
-  long avg_dist = 0;
-  for (int i = 0; i < base->from->size; i++) {
-    int dist = 0;
-    for (int d1 = 0; d1 < base->dim; d1++)
-      for (int d2 = 0; d2 < base->dim; d2++)
-        dist = std::max(dist,std::abs(base->map[i*base->dim+d1]-base->map[i*base->dim+d2]));
-    max_dist = std::max(max_dist,dist);
-    avg_dist += dist;
-  }
-  avg_dist /= base->from->size;
 /*
   if (generated_partvec == 0) {
 #ifdef PARMETIS_VER_4
@@ -407,6 +620,10 @@ void op_renumber(op_map base) {
 #endif
   }
 */
+  if (!scotch) {
+    renumber_rcm(base->to->core_size, row_offsets, col_indices, permutation);
+  } else {
+#ifdef HAVE_PTSCOTCH
   //
   // Using SCOTCH for reordering
   //
@@ -427,7 +644,7 @@ void op_renumber(op_map base) {
   SCOTCH_Num *edgetab = &col_indices[0];
 
   SCOTCH_Num *edlotab = NULL; // Edge load = edge weight
-  SCOTCH_Num *permutation =
+  SCOTCH_Num *scotch_permutation =
       (SCOTCH_Num *)malloc(base->to->core_size * sizeof(SCOTCH_Num));
   SCOTCH_Num *ipermutation =
       (SCOTCH_Num *)malloc(base->to->core_size * sizeof(SCOTCH_Num));
@@ -456,7 +673,7 @@ void op_renumber(op_map base) {
     exit(-1);
   }
 
-  mesg = SCOTCH_graphOrder(graphptr, straptr, permutation, ipermutation,
+  mesg = SCOTCH_graphOrder(graphptr, straptr, scotch_permutation, ipermutation,
                            cblkptr, rangtab, treetab);
   if (mesg != 0) {
     op_printf("Error during SCOTCH_graphOrder() \n");
@@ -465,40 +682,99 @@ void op_renumber(op_map base) {
   SCOTCH_graphExit(graphptr);
   SCOTCH_stratExit(straptr);
 
+  std::copy(scotch_permutation, scotch_permutation + base->to->core_size,
+            permutation.begin());
+  free(scotch_permutation);
+  free(ipermutation);
+  free(cblkptr);
+#endif
+  }
+  return 1;
+}
+
+// bandwidth of the base map, i.e. the largest index difference within its
+// elements
+void map_bandwidth(op_map base, int *max_dist, long *avg_dist) {
+  *max_dist = 0;
+  *avg_dist = 0;
+  for (int i = 0; i < base->from->size; i++) {
+    int dist = 0;
+    for (int d1 = 0; d1 < base->dim; d1++)
+      for (int d2 = 0; d2 < base->dim; d2++)
+        dist = std::max(dist,std::abs(base->map[i*base->dim+d1]-base->map[i*base->dim+d2]));
+    *max_dist = std::max(*max_dist,dist);
+    *avg_dist += dist;
+  }
+  if (base->from->size > 0)
+    *avg_dist /= base->from->size;
+}
+
+void op_renumber(op_map base) {
+#ifdef HAVE_PTSCOTCH
+  op_renumber_method(base, "SCOTCH", NULL);
+#else
+  op_renumber_method(base, "RCM", NULL);
+#endif
+}
+
+/*
+ * renumber base->to with the given method, and propagate the renumbering to
+ * all other sets through the maps: "SCOTCH" (needs HAVE_PTSCOTCH), "RCM",
+ * or the "HILBERT" and "MORTON" space filling curves over coords
+ */
+void op_renumber_method(op_map base, char const *method, op_dat coords) {
+  op_printf("Renumbering using base map %s (%s)\n", base->name, method);
+  int hilbert = strcmp(method, "HILBERT") == 0;
+  int sfc = hilbert || strcmp(method, "MORTON") == 0;
+  int scotch = strcmp(method, "SCOTCH") == 0;
+  if (!sfc && !scotch && strcmp(method, "RCM") != 0) {
+    op_printf("Unknown renumbering method %s, no reordering.\n", method);
+    return;
+  }
+#ifndef HAVE_PTSCOTCH
+  if (scotch) {
+    op_printf("OP2 was not compiled with Scotch, no reordering.\n");
+    return;
+  }
+#endif
+
+  //Statistics
+  int max_dist;
+  long avg_dist;
+  map_bandwidth(base, &max_dist, &avg_dist);
+
+  std::vector<int> permutation(base->to->core_size);
+  if (sfc) {
+    if (!renumber_sfc(base, coords, hilbert, permutation))
+      return;
+  } else {
+    if (!renumber_graph(base, scotch, permutation))
+      return;
+  }
+
   std::vector<std::vector<int> > set_permutations(OP_set_index);
   std::vector<std::vector<int> > set_ipermutations(OP_set_index);
-  set_permutations[base->to->index].resize(base->to->size + base->to->exec_size + base->to->nonexec_size);
-  std::copy(permutation, permutation + base->to->size,
+  int total = base->to->size + base->to->exec_size + base->to->nonexec_size;
+  set_permutations[base->to->index].resize(total);
+  std::copy(permutation.begin(), permutation.end(),
             set_permutations[base->to->index].begin());
-  for (int i = base->to->core_size; i < base->to->size + base->to->exec_size + base->to->nonexec_size; i++)
-    set_permutations[base->to->index][i] = i;
-  check_permutation(&set_permutations[base->to->index][0],base->to->size + base->to->exec_size + base->to->nonexec_size);
-  set_ipermutations[base->to->index].resize(base->to->size + base->to->exec_size + base->to->nonexec_size);
-  std::copy(ipermutation, ipermutation + base->to->size,
-            set_ipermutations[base->to->index].begin());
-  for (int i = base->to->core_size; i < base->to->size + base->to->exec_size + base->to->nonexec_size; i++)
+  for (int i = base->to->core_size; i < total; i++)
     set_permutations[base->to->index][i] = i;
+  check_permutation(&set_permutations[base->to->index][0], total);
+  set_ipermutations[base->to->index].resize(total);
+  for (int i = 0; i < total; i++)
+    set_ipermutations[base->to->index][set_permutations[base->to->index][i]] = i;
   propagate_reordering(base->to, base->to, set_permutations, set_ipermutations);
+  // deep halos of tiled chains hold positions in the old numbering
+  op_mpi_tile_free();
   for (int i = 0; i < OP_set_index; i++) {
     reorder_set(OP_set_list[i], set_permutations, set_ipermutations);
   }
 
   op_move_to_device();
 
-  op_printf("Before renumbering: maximum bandwidth = %d average bandwidth = %d\n",max_dist,avg_dist);
+  op_printf("Before renumbering: maximum bandwidth = %d average bandwidth = %ld\n",max_dist,avg_dist);
   //Statistics
-  max_dist = 0;
-  avg_dist = 0;
-  for (int i = 0; i < base->from->size; i++) {
-    int dist = 0;
-    for (int d1 = 0; d1 < base->dim; d1++)
-      for (int d2 = 0; d2 < base->dim; d2++)
-        dist = std::max(dist,std::abs(base->map[i*base->dim+d1]-base->map[i*base->dim+d2]));
-    max_dist = std::max(max_dist,dist);
-    avg_dist += dist;
-  }
-  avg_dist /= base->from->size;
-  op_printf("After renumbering: maximum bandwidth = %d average bandwidth = %d\n",max_dist,avg_dist);
-
-#endif
+  map_bandwidth(base, &max_dist, &avg_dist);
+  op_printf("After renumbering: maximum bandwidth = %d average bandwidth = %ld\n",max_dist,avg_dist);
 }
@@ -41,6 +41,7 @@
 
 // mpi header
 #include <mpi.h>
+#include <pthread.h>
 
 //#include <op_lib_core.h>
 #include <op_lib_c.h>
@@ -67,6 +68,13 @@ int *OP_map_partial_exchange; // flag for each map
 halo_list *OP_import_nonexec_permap;
 halo_list *OP_export_nonexec_permap;
 int *set_import_buffer_size;
+
+//
+// On-node halo exchange through shared memory (OP_HALO_SHM)
+//
+
+MPI_Comm OP_MPI_NODE = MPI_COMM_NULL;
+op_shm_set *OP_shm_set_list = NULL;
 //
 // global array to hold dirty_bits for op_dats
 //
@@ -150,11 +158,19 @@ void get_part_range(int **part_range, int my_rank, int comm_size,
 
 int get_partition(int global_index, int *part_range, int *local_index,
                   int comm_size) {
-  for (int i = 0; i < comm_size; i++) {
-    if (global_index >= part_range[2 * i] &&
-        global_index <= part_range[2 * i + 1]) {
-      *local_index = global_index - part_range[2 * i];
-      return i;
+  // the ranges are contiguous and ascending by rank, an empty range ends one
+  // before it starts
+  int lo = 0;
+  int hi = comm_size - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (global_index < part_range[2 * mid])
+      hi = mid - 1;
+    else if (global_index > part_range[2 * mid + 1])
+      lo = mid + 1;
+    else {
+      *local_index = global_index - part_range[2 * mid];
+      return mid;
     }
   }
   printf("Error: orphan global index\n");
@@ -181,9 +197,63 @@ int get_global_index(int local_index, int partition, int *part_range,
  * Routine to find the MPI neighbors given a halo list
  *******************************************************************************/
 
+#define OP_NEIGHBOR_TAG 32766
+
 void find_neighbors_set(halo_list List, int *neighbors, int *sizes,
                         int *ranks_size, int my_rank, int comm_size,
                         MPI_Comm Comm) {
+#if MPI_VERSION >= 3
+  // sparse discovery (NBX): send each neighbour its size with a synchronous
+  // send and receive whatever arrives, once all own sends have been matched
+  // join a non-blocking barrier, when it completes every rank has received
+  // all messages addressed to it
+  // a rank leaving the barrier may already be sending for the next call while
+  // others still probe for this one, so consecutive calls alternate tags;
+  // counted per thread, the output thread (OP_ASYNC_IO) has its own comm
+  static __thread int round = 0;
+  int tag = OP_NEIGHBOR_TAG - (round++ & 1);
+  (void)comm_size;
+  MPI_Request *send_req =
+      (MPI_Request *)xmalloc((List->ranks_size + 1) * sizeof(MPI_Request));
+  int num_send = 0;
+  for (int r = 0; r < List->ranks_size; r++) {
+    if (List->ranks[r] >= 0 && List->ranks[r] != my_rank &&
+        List->sizes[r] > 0)
+      MPI_Issend(&List->sizes[r], 1, MPI_INT, List->ranks[r], tag, Comm,
+                 &send_req[num_send++]);
+  }
+
+  int n = 0;
+  int done = 0;
+  int barrier_active = 0;
+  MPI_Request barrier;
+  while (!done) {
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, tag, Comm, &flag, &status);
+    if (flag) {
+      MPI_Recv(&sizes[n], 1, MPI_INT, status.MPI_SOURCE, tag, Comm,
+               MPI_STATUS_IGNORE);
+      neighbors[n++] = status.MPI_SOURCE;
+    }
+    if (barrier_active) {
+      MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+    } else {
+      int sent;
+      MPI_Testall(num_send, send_req, &sent, MPI_STATUSES_IGNORE);
+      if (sent) {
+        MPI_Ibarrier(Comm, &barrier);
+        barrier_active = 1;
+      }
+    }
+  }
+  op_free(send_req);
+
+  // same order as the dense version, by rank
+  if (n > 1)
+    quickSort_2(neighbors, sizes, 0, n - 1);
+  *ranks_size = n;
+#else
   int *temp = (int *)xmalloc(comm_size * sizeof(int));
   int *r_temp = (int *)xmalloc(comm_size * comm_size * sizeof(int));
 
@@ -213,6 +283,7 @@ void find_neighbors_set(halo_list List, int *neighbors, int *sizes,
   *ranks_size = n;
   op_free(temp);
   op_free(r_temp);
+#endif
 }
 
 /*******************************************************************************
@@ -233,32 +304,40 @@ void create_list(int *list, int *ranks, int *disps, int *sizes, int *ranks_size,
     disps[r] = ranks[r] = -99;
     sizes[r] = 0;
   }
-  for (int r = 0; r < comm_size; r++) {
-    sizes[index] = disps[index] = 0;
 
-    int *temp = (int *)xmalloc((size / 2) * sizeof(int));
-    for (int i = 0; i < size; i = i + 2) {
-      if (temp_list[i] == r)
-        temp[sizes[index]++] = temp_list[i + 1];
-    }
-    if (sizes[index] > 0) {
-      ranks[index] = r;
-      // sort temp,
-      quickSort(temp, 0, sizes[index] - 1);
-      // eliminate duplicates in temp
-      sizes[index] = removeDups(temp, sizes[index]);
-      total_size = total_size + sizes[index];
-
-      if (index > 0)
-        disps[index] = disps[index - 1] + sizes[index - 1];
-      // add to end of exp_list
-      for (int e = 0; e < sizes[index]; e++)
-        list[disps[index] + e] = temp[e];
+  // bucket the elements by rank
+  int n = size / 2;
+  int *start = (int *)xcalloc(comm_size + 1, sizeof(int));
+  for (int i = 0; i < n; i++)
+    start[temp_list[2 * i] + 1]++;
+  for (int r = 0; r < comm_size; r++)
+    start[r + 1] += start[r];
+  int *fill = (int *)xmalloc(comm_size * sizeof(int));
+  memcpy(fill, start, comm_size * sizeof(int));
+  int *temp = (int *)xmalloc((n + 1) * sizeof(int));
+  for (int i = 0; i < n; i++)
+    temp[fill[temp_list[2 * i]]++] = temp_list[2 * i + 1];
 
-      index++;
-    }
-    op_free(temp);
+  for (int r = 0; r < comm_size; r++) {
+    int count = start[r + 1] - start[r];
+    if (count == 0)
+      continue;
+    int *elems = &temp[start[r]];
+    // sort and eliminate duplicates
+    quickSort(elems, 0, count - 1);
+    count = removeDups(elems, count);
+
+    ranks[index] = r;
+    sizes[index] = count;
+    disps[index] = index > 0 ? disps[index - 1] + sizes[index - 1] : 0;
+    total_size = total_size + count;
+    // add to end of exp_list
+    memcpy(&list[disps[index]], elems, count * sizeof(int));
+    index++;
   }
+  op_free(temp);
+  op_free(fill);
+  op_free(start);
 
   *total = total_size;
   *ranks_size = index;
@@ -1038,6 +1117,14 @@ void op_halo_create() {
 
     mpi_buf->s_num_req = 0;
     mpi_buf->r_num_req = 0;
+    mpi_buf->persistent = NULL;
+    mpi_buf->num_persistent = 0;
+    mpi_buf->p_in_flight = NULL;
+    mpi_buf->shm_win = MPI_WIN_NULL;
+    mpi_buf->shm_base = NULL;
+    mpi_buf->d_s_req = NULL;
+    mpi_buf->d_r_req = NULL;
+    mpi_buf->shm_in_flight = 0;
     dat->mpi_buffer = mpi_buf;
   }
 
@@ -1999,11 +2086,266 @@ void op_halo_permap_create() {
  *application)
  *******************************************************************************/
 
+/*******************************************************************************
+ * Routines to set up and tear down on-node halo exchanges through MPI-3 shared
+ * memory windows (OP_HALO_SHM)
+ *
+ * The export buffers (buf_exec, buf_nonexec) of every op_dat are placed in a
+ * shared memory window over the ranks of the node, so an on-node importer
+ * copies its halo straight out of the exporter's buffer instead of receiving
+ * it as a message. Off-node neighbours keep exchanging messages.
+ *******************************************************************************/
+
+// distinct non-negative entries of nodes[0..n) appended to list
+static int op_shm_unique(int *nodes, int n, int *list, int num) {
+  for (int i = 0; i < n; i++) {
+    if (nodes[i] < 0)
+      continue;
+    int found = 0;
+    for (int k = 0; k < num; k++)
+      if (list[k] == nodes[i])
+        found = 1;
+    if (!found)
+      list[num++] = nodes[i];
+  }
+  return num;
+}
+
+void op_halo_shm_create() {
+#if MPI_VERSION >= 3
+  int comm_size, node_size;
+  MPI_Comm_size(OP_MPI_WORLD, &comm_size);
+  MPI_Comm_split_type(OP_MPI_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+                      &OP_MPI_NODE);
+  MPI_Comm_size(OP_MPI_NODE, &node_size);
+
+  // rank in OP_MPI_NODE of every rank in OP_MPI_WORLD
+  MPI_Group world_group, node_group;
+  MPI_Comm_group(OP_MPI_WORLD, &world_group);
+  MPI_Comm_group(OP_MPI_NODE, &node_group);
+  int *world_ranks = (int *)xmalloc(comm_size * sizeof(int));
+  int *node_ranks = (int *)xmalloc(comm_size * sizeof(int));
+  for (int r = 0; r < comm_size; r++)
+    world_ranks[r] = r;
+  MPI_Group_translate_ranks(world_group, comm_size, world_ranks, node_group,
+                            node_ranks);
+  for (int r = 0; r < comm_size; r++)
+    if (node_ranks[r] == MPI_UNDEFINED)
+      node_ranks[r] = -1;
+  MPI_Group_free(&world_group);
+  MPI_Group_free(&node_group);
+  op_free(world_ranks);
+
+  OP_shm_set_list = (op_shm_set *)xmalloc(OP_set_index * sizeof(op_shm_set));
+  for (int s = 0; s < OP_set_index; s++) {
+    halo_list exp_exec_list = OP_export_exec_list[s];
+    halo_list exp_nonexec_list = OP_export_nonexec_list[s];
+    halo_list imp_exec_list = OP_import_exec_list[s];
+    halo_list imp_nonexec_list = OP_import_nonexec_list[s];
+
+    op_shm_set sh = (op_shm_set)xmalloc(sizeof(op_shm_set_core));
+    sh->exp_exec_node =
+        (int *)xmalloc(exp_exec_list->ranks_size * sizeof(int));
+    sh->exp_nonexec_node =
+        (int *)xmalloc(exp_nonexec_list->ranks_size * sizeof(int));
+    sh->imp_exec_node =
+        (int *)xmalloc(imp_exec_list->ranks_size * sizeof(int));
+    sh->imp_nonexec_node =
+        (int *)xmalloc(imp_nonexec_list->ranks_size * sizeof(int));
+    sh->imp_exec_offset =
+        (int *)xmalloc(imp_exec_list->ranks_size * sizeof(int));
+    sh->imp_nonexec_offset =
+        (int *)xmalloc(imp_nonexec_list->ranks_size * sizeof(int));
+    for (int i = 0; i < exp_exec_list->ranks_size; i++)
+      sh->exp_exec_node[i] = node_ranks[exp_exec_list->ranks[i]];
+    for (int i = 0; i < exp_nonexec_list->ranks_size; i++)
+      sh->exp_nonexec_node[i] = node_ranks[exp_nonexec_list->ranks[i]];
+    for (int i = 0; i < imp_exec_list->ranks_size; i++)
+      sh->imp_exec_node[i] = node_ranks[imp_exec_list->ranks[i]];
+    for (int i = 0; i < imp_nonexec_list->ranks_size; i++)
+      sh->imp_nonexec_node[i] = node_ranks[imp_nonexec_list->ranks[i]];
+
+    sh->exp_nodes = (int *)xmalloc(
+        (exp_exec_list->ranks_size + exp_nonexec_list->ranks_size) *
+        sizeof(int));
+    sh->num_exp = op_shm_unique(sh->exp_exec_node, exp_exec_list->ranks_size,
+                                sh->exp_nodes, 0);
+    sh->num_exp =
+        op_shm_unique(sh->exp_nonexec_node, exp_nonexec_list->ranks_size,
+                      sh->exp_nodes, sh->num_exp);
+    sh->imp_nodes = (int *)xmalloc(
+        (imp_exec_list->ranks_size + imp_nonexec_list->ranks_size) *
+        sizeof(int));
+    sh->num_imp = op_shm_unique(sh->imp_exec_node, imp_exec_list->ranks_size,
+                                sh->imp_nodes, 0);
+    sh->num_imp =
+        op_shm_unique(sh->imp_nonexec_node, imp_nonexec_list->ranks_size,
+                      sh->imp_nodes, sh->num_imp);
+
+    // tell each on-node importer where its elements start in our buffers:
+    // {exec offset, nonexec offset, size of our exec export list}
+    int *send_info = (int *)xmalloc(3 * sh->num_exp * sizeof(int));
+    int *recv_info = (int *)xmalloc(3 * sh->num_imp * sizeof(int));
+    MPI_Request *req = (MPI_Request *)xmalloc((sh->num_exp + sh->num_imp) *
+                                              sizeof(MPI_Request));
+    for (int k = 0; k < sh->num_imp; k++)
+      MPI_Irecv(&recv_info[3 * k], 3, MPI_INT, sh->imp_nodes[k], s,
+                OP_MPI_NODE, &req[k]);
+    for (int k = 0; k < sh->num_exp; k++) {
+      send_info[3 * k] = -1;
+      send_info[3 * k + 1] = -1;
+      send_info[3 * k + 2] = exp_exec_list->size;
+      for (int i = 0; i < exp_exec_list->ranks_size; i++)
+        if (sh->exp_exec_node[i] == sh->exp_nodes[k])
+          send_info[3 * k] = exp_exec_list->disps[i];
+      for (int i = 0; i < exp_nonexec_list->ranks_size; i++)
+        if (sh->exp_nonexec_node[i] == sh->exp_nodes[k])
+          send_info[3 * k + 1] = exp_nonexec_list->disps[i];
+      MPI_Isend(&send_info[3 * k], 3, MPI_INT, sh->exp_nodes[k], s,
+                OP_MPI_NODE, &req[sh->num_imp + k]);
+    }
+    MPI_Waitall(sh->num_exp + sh->num_imp, req, MPI_STATUSES_IGNORE);
+    for (int k = 0; k < sh->num_imp; k++) {
+      for (int i = 0; i < imp_exec_list->ranks_size; i++)
+        if (sh->imp_exec_node[i] == sh->imp_nodes[k])
+          sh->imp_exec_offset[i] = recv_info[3 * k];
+      // nonexec exports follow the exec exports in the exporter's window
+      for (int i = 0; i < imp_nonexec_list->ranks_size; i++)
+        if (sh->imp_nonexec_node[i] == sh->imp_nodes[k])
+          sh->imp_nonexec_offset[i] =
+              recv_info[3 * k + 2] + recv_info[3 * k + 1];
+    }
+    op_free(send_info);
+    op_free(recv_info);
+    op_free(req);
+    OP_shm_set_list[s] = sh;
+  }
+  op_free(node_ranks);
+
+  // move the export buffers of every op_dat into a shared window
+  MPI_Info info;
+  MPI_Info_create(&info);
+  MPI_Info_set(info, (char *)"alloc_shared_noncontig", (char *)"true");
+  op_dat_entry *item;
+  TAILQ_FOREACH(item, &OP_dat_list, entries) {
+    op_dat dat = item->dat;
+    op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+    op_shm_set sh = OP_shm_set_list[dat->set->index];
+    halo_list exp_exec_list = OP_export_exec_list[dat->set->index];
+    halo_list exp_nonexec_list = OP_export_nonexec_list[dat->set->index];
+
+    size_t exec_bytes = (size_t)exp_exec_list->size * dat->size;
+    size_t nonexec_bytes =
+        (size_t)(exp_nonexec_list->size +
+                 set_import_buffer_size[dat->set->index]) *
+        dat->size;
+    char *base;
+    MPI_Win_allocate_shared((MPI_Aint)(exec_bytes + nonexec_bytes), 1, info,
+                            OP_MPI_NODE, &base, &buf->shm_win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, buf->shm_win);
+    op_free(buf->buf_exec);
+    op_free(buf->buf_nonexec);
+    buf->buf_exec = base;
+    buf->buf_nonexec = base + exec_bytes;
+
+    buf->shm_base = (char **)xmalloc(node_size * sizeof(char *));
+    for (int r = 0; r < node_size; r++)
+      buf->shm_base[r] = NULL;
+    for (int k = 0; k < sh->num_imp; k++) {
+      MPI_Aint seg_size;
+      int disp_unit;
+      MPI_Win_shared_query(buf->shm_win, sh->imp_nodes[k], &seg_size,
+                           &disp_unit, &buf->shm_base[sh->imp_nodes[k]]);
+    }
+    buf->d_s_req = (MPI_Request *)xmalloc(sh->num_imp * sizeof(MPI_Request));
+    buf->d_r_req = (MPI_Request *)xmalloc(sh->num_exp * sizeof(MPI_Request));
+  }
+  MPI_Info_free(&info);
+#else
+  op_printf("OP_HALO_SHM needs MPI-3, exchanging halos by messages only\n");
+  OP_halo_shm = 0;
+#endif
+}
+
+// collective over OP_MPI_NODE, leaves buf_exec and buf_nonexec NULL
+void op_mpi_buffer_shm_free(op_mpi_buffer buf) {
+  if (buf->shm_win == MPI_WIN_NULL)
+    return;
+  MPI_Win_unlock_all(buf->shm_win);
+  MPI_Win_free(&buf->shm_win);
+  buf->buf_exec = NULL;
+  buf->buf_nonexec = NULL;
+  op_free(buf->shm_base);
+  op_free(buf->d_s_req);
+  op_free(buf->d_r_req);
+  buf->shm_base = NULL;
+  buf->d_s_req = NULL;
+  buf->d_r_req = NULL;
+}
+
+void op_halo_shm_destroy() {
+  if (OP_shm_set_list == NULL)
+    return;
+  op_dat_entry *item;
+  TAILQ_FOREACH(item, &OP_dat_list, entries) {
+    if (item->dat->mpi_buffer != NULL)
+      op_mpi_buffer_shm_free((op_mpi_buffer)(item->dat->mpi_buffer));
+  }
+  for (int s = 0; s < OP_set_index; s++) {
+    op_shm_set sh = OP_shm_set_list[s];
+    op_free(sh->exp_exec_node);
+    op_free(sh->exp_nonexec_node);
+    op_free(sh->imp_exec_node);
+    op_free(sh->imp_nonexec_node);
+    op_free(sh->imp_exec_offset);
+    op_free(sh->imp_nonexec_offset);
+    op_free(sh->exp_nodes);
+    op_free(sh->imp_nodes);
+    op_free(sh);
+  }
+  op_free(OP_shm_set_list);
+  OP_shm_set_list = NULL;
+  MPI_Comm_free(&OP_MPI_NODE);
+}
+
+/*******************************************************************************
+ * Routines to free the persistent halo requests of an op_dat
+ *******************************************************************************/
+
+void op_mpi_persistent_release(op_mpi_persistent p) {
+  for (int i = 0; i < p->s_num_req; i++)
+    MPI_Request_free(&p->s_req[i]);
+  for (int i = 0; i < p->r_num_req; i++)
+    MPI_Request_free(&p->r_req[i]);
+  op_free(p->s_req);
+  op_free(p->r_req);
+  p->s_req = NULL;
+  p->r_req = NULL;
+  p->s_num_req = 0;
+  p->r_num_req = 0;
+}
+
+void op_mpi_buffer_persistent_free(op_mpi_buffer buf) {
+  for (int i = 0; i < buf->num_persistent; i++) {
+    if (buf->persistent[i] != NULL) {
+      op_mpi_persistent_release(buf->persistent[i]);
+      op_free(buf->persistent[i]);
+    }
+  }
+  op_free(buf->persistent);
+  buf->persistent = NULL;
+  buf->num_persistent = 0;
+  buf->p_in_flight = NULL;
+}
+
 void op_halo_destroy() {
+  op_halo_shm_destroy();
+
   // remove halos from op_dats
   op_dat_entry *item;
   TAILQ_FOREACH(item, &OP_dat_list, entries) {
     op_dat dat = item->dat;
+    op_dat_set_soa(dat, 0);
     dat->data = (char *)xrealloc(dat->data, dat->set->size * dat->size);
   }
 
@@ -2043,6 +2385,7 @@ void op_halo_destroy() {
   item = NULL;
   TAILQ_FOREACH(item, &OP_dat_list, entries) {
     op_dat dat = item->dat;
+    op_mpi_buffer_persistent_free((op_mpi_buffer)(dat->mpi_buffer));
     op_free(((op_mpi_buffer)(dat->mpi_buffer))->buf_exec);
     op_free(((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec);
     op_free(((op_mpi_buffer)(dat->mpi_buffer))->s_req);
@@ -2066,191 +2409,456 @@ static void set_dirtybit(op_arg *arg, int hd) {
   }
 }
 
-void op_mpi_reduce_combined(op_arg *args, int nargs) {
-  op_timers_core(&c1, &t1);
-  int nreductions = 0;
-  for (int i = 0; i < nargs; i++) {
-    if (args[i].argtype == OP_ARG_GBL && args[i].acc != OP_READ)
-      nreductions++;
+/*******************************************************************************
+ * Fused global reductions
+ *
+ * op_mpi_reduce_combined packs every reduction of a loop into one buffer and
+ * reduces it with a single MPI_Allreduce. A user-defined MPI_Op applies each
+ * field's SUM/MIN/MAX in place. OP_WRITE fields also carry the rank that
+ * wrote each value, and the value from the highest such rank is kept
+ * (MAXLOC style), as in op_mpi_reduce_*.
+ *
+ * The buffer starts with the field layout, so that op_reduce_combine can
+ * reduce several buffers of different layouts at the same time. With
+ * OP_REDUCE_DEFER the reduction is posted with MPI_Iallreduce instead and
+ * the results are copied back to the user's globals by op_reduction_wait,
+ * or when a later loop reads one of them through an OP_READ op_arg_gbl. A
+ * later reduction into the same global supersedes the pending one, whose
+ * result for that global is dropped.
+ *******************************************************************************/
+
+#define OP_REDUCE_MAX_FIELDS 64
+#define OP_REDUCE_MAX_BYTES 4096
+#define OP_REDUCE_ALIGN 64
+#define OP_REDUCE_MAX_PENDING 8
+
+enum {
+  OP_REDUCE_DOUBLE,
+  OP_REDUCE_FLOAT,
+  OP_REDUCE_INT,
+  OP_REDUCE_UINT,
+  OP_REDUCE_LONG,
+  OP_REDUCE_LL,
+  OP_REDUCE_ULL,
+  OP_REDUCE_BOOL
+};
+
+typedef struct {
+  int type;
+  op_access acc;
+  int dim;
+  int elem_size;
+  // byte offset of the field in the packed buffer
+  int offset;
+} op_reduce_field;
+
+typedef struct {
+  MPI_Request req;
+  int active;
+  int nfields;
+  // where each field's result is copied to
+  char *data[OP_REDUCE_MAX_FIELDS];
+  int size[OP_REDUCE_MAX_FIELDS];
+  // kernel and start time the reduction is accounted to
+  int kernel;
+  double wall_t1;
+  double send[OP_REDUCE_MAX_BYTES / sizeof(double)];
+  double recv[OP_REDUCE_MAX_BYTES / sizeof(double)];
+} op_reduce_buffer;
+
+static op_reduce_buffer OP_reduce_now;
+static op_reduce_buffer *OP_reduce_pending[OP_REDUCE_MAX_PENDING];
+static int OP_reduce_next = 0;
+static int OP_reduce_num_pending = 0;
+static MPI_Op OP_reduce_op;
+// contiguous byte types, one per multiple of OP_REDUCE_ALIGN bytes, so that
+// MPI never splits the packed buffer between calls of op_reduce_combine
+static MPI_Datatype OP_reduce_types[OP_REDUCE_MAX_BYTES / OP_REDUCE_ALIGN];
+static int OP_reduce_type_created[OP_REDUCE_MAX_BYTES / OP_REDUCE_ALIGN];
+static int OP_reduce_op_created = 0;
+
+#define OP_REDUCE_FIELD(T)                                                     \
+  for (int j = 0; j < f->dim; j++) {                                           \
+    T a, b;                                                                    \
+    memcpy(&a, in + f->offset + j * sizeof(T), sizeof(T));                     \
+    memcpy(&b, inout + f->offset + j * sizeof(T), sizeof(T));                  \
+    if (f->acc == OP_INC)                                                      \
+      b += a;                                                                  \
+    else if (f->acc == OP_MIN)                                                 \
+      b = a < b ? a : b;                                                       \
+    else if (f->acc == OP_MAX)                                                 \
+      b = a > b ? a : b;                                                       \
+    else if (f->acc == OP_WRITE) {                                             \
+      int owner_a, owner_b;                                                    \
+      memcpy(&owner_a, in + f->offset + f->dim * sizeof(T) + j * sizeof(int),  \
+             sizeof(int));                                                     \
+      memcpy(&owner_b,                                                         \
+             inout + f->offset + f->dim * sizeof(T) + j * sizeof(int),         \
+             sizeof(int));                                                     \
+      if (owner_a > owner_b) {                                                 \
+        b = a;                                                                 \
+        memcpy(inout + f->offset + f->dim * sizeof(T) + j * sizeof(int),       \
+               &owner_a, sizeof(int));                                         \
+      }                                                                        \
+    }                                                                          \
+    memcpy(inout + f->offset + j * sizeof(T), &b, sizeof(T));                  \
   }
-  op_arg *arg_list = (op_arg *)xmalloc(nreductions * sizeof(op_arg));
-  nreductions = 0;
-  int nbytes = 0;
-  for (int i = 0; i < nargs; i++) {
-    if (args[i].argtype == OP_ARG_GBL && args[i].acc != OP_READ) {
-      arg_list[nreductions++] = args[i];
-      nbytes += args[i].size;
+
+static void op_reduce_combine(void *invec, void *inoutvec, int *len,
+                              MPI_Datatype *datatype) {
+  int bytes;
+  MPI_Type_size(*datatype, &bytes);
+  for (int l = 0; l < *len; l++) {
+    char *in = (char *)invec + (size_t)l * bytes;
+    char *inout = (char *)inoutvec + (size_t)l * bytes;
+    // the layout header is identical on every rank
+    int nfields;
+    memcpy(&nfields, inout, sizeof(int));
+    for (int i = 0; i < nfields; i++) {
+      op_reduce_field field;
+      op_reduce_field *f = &field;
+      memcpy(f, inout + sizeof(double) + i * sizeof(op_reduce_field),
+             sizeof(op_reduce_field));
+      if (f->type == OP_REDUCE_DOUBLE) {
+        OP_REDUCE_FIELD(double)
+      } else if (f->type == OP_REDUCE_FLOAT) {
+        OP_REDUCE_FIELD(float)
+      } else if (f->type == OP_REDUCE_INT) {
+        OP_REDUCE_FIELD(int)
+      } else if (f->type == OP_REDUCE_UINT) {
+        OP_REDUCE_FIELD(uint)
+      } else if (f->type == OP_REDUCE_LONG) {
+        OP_REDUCE_FIELD(long)
+      } else if (f->type == OP_REDUCE_LL) {
+        OP_REDUCE_FIELD(ll)
+      } else if (f->type == OP_REDUCE_ULL) {
+        OP_REDUCE_FIELD(ull)
+      } else {
+        OP_REDUCE_FIELD(bool)
+      }
     }
   }
-  char *data = (char *)xmalloc(nbytes * sizeof(char));
-  int char_counter = 0;
-  for (int i = 0; i < nreductions; i++) {
-    for (int j = 0; j < arg_list[i].size; j++)
-      data[char_counter++] = arg_list[i].data[j];
-  }
+}
 
-  int comm_size, comm_rank;
-  MPI_Comm_size(OP_MPI_WORLD, &comm_size);
-  MPI_Comm_rank(OP_MPI_WORLD, &comm_rank);
-  char *result = (char *)xmalloc(comm_size * nbytes * sizeof(char));
-  MPI_Allgather(data, nbytes, MPI_CHAR, result, nbytes, MPI_CHAR, OP_MPI_WORLD);
-
-  char_counter = 0;
-  for (int i = 0; i < nreductions; i++) {
-    if (strcmp(arg_list[i].type, "double") == 0 ||
-        strcmp(arg_list[i].type, "r8") == 0) {
-      double *output = (double *)arg_list[i].data;
-      for (int rank = 0; rank < comm_size; rank++) {
-        if (rank != comm_rank) {
-          if (arg_list[i].acc == OP_INC) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] +=
-                  ((double *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MIN) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] <
-                          ((double *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((double *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MAX) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] >
-                          ((double *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((double *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_WRITE) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] != 0.0
-                      ? output[j]
-                      : ((double *)(result + char_counter + nbytes * rank))[j];
-            }
+// maps the type of a global to its reduction type, accepting the same
+// aliases as the rest of the core
+static int op_reduce_type(const char *type) {
+  if (strcmp(type, "double") == 0 || strcmp(type, "r8") == 0 ||
+      strcmp(type, "double precision") == 0 || strcmp(type, "real(8)") == 0)
+    return OP_REDUCE_DOUBLE;
+  if (strcmp(type, "float") == 0 || strcmp(type, "r4") == 0 ||
+      strcmp(type, "real(4)") == 0 || strcmp(type, "real") == 0)
+    return OP_REDUCE_FLOAT;
+  if (strcmp(type, "int") == 0 || strcmp(type, "i4") == 0 ||
+      strcmp(type, "int(4)") == 0 || strcmp(type, "integer") == 0 ||
+      strcmp(type, "integer(4)") == 0)
+    return OP_REDUCE_INT;
+  if (strcmp(type, "uint") == 0)
+    return OP_REDUCE_UINT;
+  if (strcmp(type, "long") == 0)
+    return OP_REDUCE_LONG;
+  if (strcmp(type, "ll") == 0 || strcmp(type, "long long") == 0)
+    return OP_REDUCE_LL;
+  if (strcmp(type, "ull") == 0)
+    return OP_REDUCE_ULL;
+  if (strcmp(type, "bool") == 0 || strcmp(type, "logical") == 0)
+    return OP_REDUCE_BOOL;
+  op_printf("Error: global reduction of unknown type %s\n", type);
+  MPI_Abort(OP_MPI_WORLD, 2);
+  return -1;
+}
+
+// reduces a global of an integer type without an op_mpi_reduce_<type> on its
+// own, for reductions that do not fit the packed buffer
+static void op_reduce_single(op_arg *arg, MPI_Datatype type) {
+  int elem_size = arg->size / arg->dim;
+  if (arg->acc == OP_WRITE) {
+    int size;
+    MPI_Comm_size(OP_MPI_WORLD, &size);
+    char *result = (char *)calloc(size, arg->size);
+    MPI_Allgather(arg->data, arg->dim, type, result, arg->dim, type,
+                  OP_MPI_WORLD);
+    // as in op_mpi_reduce_int, the last rank with a non-zero value wins
+    for (int i = 1; i < size; i++) {
+      for (int j = 0; j < arg->dim; j++) {
+        char *v = result + (size_t)i * arg->size + j * elem_size;
+        for (int b = 0; b < elem_size; b++) {
+          if (v[b] != 0) {
+            memcpy(result + j * elem_size, v, elem_size);
+            break;
           }
         }
       }
     }
-    if (strcmp(arg_list[i].type, "float") == 0 ||
-        strcmp(arg_list[i].type, "r4") == 0) {
-      float *output = (float *)arg_list[i].data;
-      for (int rank = 0; rank < comm_size; rank++) {
-        if (rank != comm_rank) {
-          if (arg_list[i].acc == OP_INC) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] +=
-                  ((float *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MIN) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] <
-                          ((float *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((float *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MAX) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] >
-                          ((float *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((float *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_WRITE) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] != 0.0
-                      ? output[j]
-                      : ((float *)(result + char_counter + nbytes * rank))[j];
-            }
-          }
-        }
+    memcpy(arg->data, result, arg->size);
+    op_free(result);
+  } else {
+    MPI_Op op = arg->acc == OP_INC ? MPI_SUM
+                                   : (arg->acc == OP_MAX ? MPI_MAX : MPI_MIN);
+    MPI_Allreduce(MPI_IN_PLACE, arg->data, arg->dim, type, op, OP_MPI_WORLD);
+  }
+}
+
+// lays out and packs the reductions of args into r, reducing those that do
+// not fit one by one; returns the datatype slot of the packed buffer or -1
+static int op_reduce_pack(op_reduce_buffer *r, op_arg *args, int nargs) {
+  int comm_rank;
+  MPI_Comm_rank(OP_MPI_WORLD, &comm_rank);
+
+  int nfields = 0;
+  for (int i = 0; i < nargs; i++) {
+    if (args[i].argtype == OP_ARG_GBL && args[i].acc != OP_READ &&
+        args[i].data != NULL && nfields < OP_REDUCE_MAX_FIELDS)
+      nfields++;
+  }
+  int header = sizeof(double) + nfields * sizeof(op_reduce_field);
+  int nbytes = (header + 7) & ~7;
+
+  r->nfields = 0;
+  op_reduce_field *fields =
+      (op_reduce_field *)((char *)r->send + sizeof(double));
+  for (int i = 0; i < nargs; i++) {
+    op_arg *arg = &args[i];
+    if (arg->argtype != OP_ARG_GBL || arg->acc == OP_READ || arg->data == NULL)
+      continue;
+    int type = op_reduce_type(arg->type);
+    int elem_size = arg->size / arg->dim;
+    int bytes = arg->size + (arg->acc == OP_WRITE ? arg->dim * sizeof(int) : 0);
+    if (r->nfields == nfields || nbytes + bytes > OP_REDUCE_MAX_BYTES) {
+      // too many reductions to pack, reduce the rest one by one
+      if (type == OP_REDUCE_DOUBLE)
+        op_mpi_reduce_double(arg, (double *)arg->data);
+      else if (type == OP_REDUCE_FLOAT)
+        op_mpi_reduce_float(arg, (float *)arg->data);
+      else if (type == OP_REDUCE_INT)
+        op_mpi_reduce_int(arg, (int *)arg->data);
+      else if (type == OP_REDUCE_UINT)
+        op_reduce_single(arg, MPI_UNSIGNED);
+      else if (type == OP_REDUCE_LONG)
+        op_reduce_single(arg, MPI_LONG);
+      else if (type == OP_REDUCE_LL)
+        op_reduce_single(arg, MPI_LONG_LONG);
+      else if (type == OP_REDUCE_ULL)
+        op_reduce_single(arg, MPI_UNSIGNED_LONG_LONG);
+      else
+        op_mpi_reduce_bool(arg, (bool *)arg->data);
+      continue;
+    }
+    op_reduce_field *f = &fields[r->nfields];
+    f->type = type;
+    f->acc = arg->acc;
+    f->dim = arg->dim;
+    f->elem_size = elem_size;
+    f->offset = nbytes;
+    r->data[r->nfields] = arg->data;
+    r->size[r->nfields] = arg->size;
+    r->nfields++;
+
+    char *buf = (char *)r->send + nbytes;
+    memcpy(buf, arg->data, arg->size);
+    if (arg->acc == OP_WRITE) {
+      // owner rank of each value, -1 where this rank wrote nothing
+      for (int j = 0; j < arg->dim; j++) {
+        int owner = -1;
+        for (int b = 0; b < elem_size; b++)
+          if (arg->data[j * elem_size + b] != 0)
+            owner = comm_rank;
+        memcpy(buf + arg->size + j * sizeof(int), &owner, sizeof(int));
       }
     }
-    if (strcmp(arg_list[i].type, "int") == 0 ||
-        strcmp(arg_list[i].type, "i4") == 0) {
-      int *output = (int *)arg_list[i].data;
-      for (int rank = 0; rank < comm_size; rank++) {
-        if (rank != comm_rank) {
-          if (arg_list[i].acc == OP_INC) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] += ((int *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MIN) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] <
-                          ((int *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((int *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MAX) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] >
-                          ((int *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((int *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_WRITE) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] != 0.0
-                      ? output[j]
-                      : ((int *)(result + char_counter + nbytes * rank))[j];
-            }
-          }
-        }
+    // keep every field aligned to its largest possible element
+    nbytes += (bytes + 7) & ~7;
+  }
+  // header entries reserved for fields that fell back stay unused
+  memcpy(r->send, &r->nfields, sizeof(int));
+  if (r->nfields == 0)
+    return -1;
+
+  int slot = (nbytes + OP_REDUCE_ALIGN - 1) / OP_REDUCE_ALIGN - 1;
+  if (!OP_reduce_op_created) {
+    MPI_Op_create(op_reduce_combine, 1, &OP_reduce_op);
+    OP_reduce_op_created = 1;
+  }
+  if (!OP_reduce_type_created[slot]) {
+    MPI_Type_contiguous((slot + 1) * OP_REDUCE_ALIGN, MPI_BYTE,
+                        &OP_reduce_types[slot]);
+    MPI_Type_commit(&OP_reduce_types[slot]);
+    OP_reduce_type_created[slot] = 1;
+  }
+  return slot;
+}
+
+// whether arg is a reduction whose memory overlaps [data, data + size)
+static int op_reduce_arg_overlaps(op_arg *arg, char *data, int size) {
+  return arg->argtype == OP_ARG_GBL && arg->acc != OP_READ &&
+         arg->data != NULL && data < arg->data + arg->size &&
+         arg->data < data + size;
+}
+
+// copies the results back, except for globals that one of the nargs
+// reductions in args is about to overwrite
+static void op_reduce_unpack(op_reduce_buffer *r, op_arg *args, int nargs) {
+  op_reduce_field *fields =
+      (op_reduce_field *)((char *)r->recv + sizeof(double));
+  for (int i = 0; i < r->nfields; i++) {
+    int superseded = 0;
+    for (int n = 0; n < nargs && !superseded; n++)
+      superseded = op_reduce_arg_overlaps(&args[n], r->data[i], r->size[i]);
+    if (!superseded)
+      memcpy(r->data[i], (char *)r->recv + fields[i].offset, r->size[i]);
+  }
+}
+
+static void op_reduce_account(op_reduce_buffer *r, double wall_t1,
+                              char const *name) {
+  double cpu_t2, wall_t2;
+  op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_kern_max > 0 && r->kernel >= 0)
+    OP_kernels[r->kernel].mpi_time += wall_t2 - wall_t1;
+  if (OP_trace) {
+    op_trace_phase(NULL, wall_t1);
+    op_trace_event(name, "reduction", wall_t1, wall_t2);
+  }
+}
+
+// completes the deferred reduction in pending slot p, dropping the results
+// superseded by the reductions in args
+static void op_reduce_complete(int p, op_arg *args, int nargs) {
+  op_reduce_buffer *r = OP_reduce_pending[p];
+  double cpu_t1, wall_t1;
+  op_timers_core(&cpu_t1, &wall_t1);
+  MPI_Wait(&r->req, MPI_STATUS_IGNORE);
+  op_reduce_unpack(r, args, nargs);
+  r->active = 0;
+  OP_reduce_num_pending--;
+  op_reduce_account(r, wall_t1, "reduction wait");
+}
+
+static int op_reduce_overlaps(op_reduce_buffer *r, char *data, int size) {
+  for (int i = 0; i < r->nfields; i++)
+    if (data < r->data[i] + r->size[i] && r->data[i] < data + size)
+      return 1;
+  return 0;
+}
+
+void op_reduction_wait(void *handle) {
+  for (int p = 0; p < OP_REDUCE_MAX_PENDING && OP_reduce_num_pending > 0;
+       p++) {
+    op_reduce_buffer *r = OP_reduce_pending[p];
+    if (r == NULL || !r->active)
+      continue;
+    if (handle == NULL || op_reduce_overlaps(r, (char *)handle, 1))
+      op_reduce_complete(p, NULL, 0);
+  }
+}
+
+// completes the pending reductions into globals the loop reads; those it
+// reduces into again are left to op_mpi_reduce_combined
+void op_mpi_reduce_wait_args(int nargs, op_arg *args) {
+  if (OP_reduce_num_pending == 0)
+    return;
+  for (int p = 0; p < OP_REDUCE_MAX_PENDING; p++) {
+    op_reduce_buffer *r = OP_reduce_pending[p];
+    if (r == NULL || !r->active)
+      continue;
+    for (int n = 0; n < nargs; n++) {
+      if (args[n].argtype == OP_ARG_GBL && args[n].acc == OP_READ &&
+          args[n].data != NULL &&
+          op_reduce_overlaps(r, args[n].data, args[n].size)) {
+        op_reduce_complete(p, args, nargs);
+        break;
       }
     }
-    if (strcmp(arg_list[i].type, "bool") == 0 ||
-        strcmp(arg_list[i].type, "logical") == 0) {
-      bool *output = (bool *)arg_list[i].data;
-      for (int rank = 0; rank < comm_size; rank++) {
-        if (rank != comm_rank) {
-          if (arg_list[i].acc == OP_INC) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] += ((bool *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MIN) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] <
-                          ((bool *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((bool *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_MAX) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] >
-                          ((bool *)(result + char_counter + nbytes * rank))[j]
-                      ? output[j]
-                      : ((bool *)(result + char_counter + nbytes * rank))[j];
-            }
-          } else if (arg_list[i].acc == OP_WRITE) {
-            for (int j = 0; j < arg_list[i].dim; j++) {
-              output[j] =
-                  output[j] != 0.0
-                      ? output[j]
-                      : ((bool *)(result + char_counter + nbytes * rank))[j];
-            }
-          }
-        }
+  }
+}
+
+// completes the pending reductions into the same globals as this loop's,
+// keeping the new local values over their stale results
+static void op_reduce_supersede(op_arg *args, int nargs) {
+  if (OP_reduce_num_pending == 0)
+    return;
+  for (int p = 0; p < OP_REDUCE_MAX_PENDING; p++) {
+    op_reduce_buffer *r = OP_reduce_pending[p];
+    if (r == NULL || !r->active)
+      continue;
+    for (int n = 0; n < nargs; n++) {
+      if (args[n].argtype == OP_ARG_GBL && args[n].acc != OP_READ &&
+          args[n].data != NULL &&
+          op_reduce_overlaps(r, args[n].data, args[n].size)) {
+        op_reduce_complete(p, args, nargs);
+        break;
       }
     }
-    char_counter += arg_list[i].size;
   }
-  op_timers_core(&c2, &t2);
-  if (OP_kern_max > 0)
-    OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
-  op_free(arg_list);
-  op_free(data);
-  op_free(result);
+}
+
+void op_mpi_reduce_combined(op_arg *args, int nargs) {
+  int nreductions = 0;
+  for (int i = 0; i < nargs; i++) {
+    if (args[i].argtype == OP_ARG_GBL && args[i].acc != OP_READ &&
+        args[i].data != NULL)
+      nreductions++;
+  }
+  if (nreductions == 0)
+    return;
+  // a reduction still in flight into the same globals is superseded
+  op_reduce_supersede(args, nargs);
+
+  // local timers, the fallback in op_reduce_pack goes through
+  // op_mpi_reduce_* which use the global ones
+  double cpu_t1, wall_t1;
+  op_timers_core(&cpu_t1, &wall_t1);
+
+#if MPI_VERSION >= 3
+  if (OP_reduce_defer) {
+    // take the next slot of the ring, completing whatever still occupies it
+    int p = OP_reduce_next;
+    OP_reduce_next = (OP_reduce_next + 1) % OP_REDUCE_MAX_PENDING;
+    if (OP_reduce_pending[p] == NULL)
+      OP_reduce_pending[p] = (op_reduce_buffer *)op_calloc(
+          1, sizeof(op_reduce_buffer));
+    else if (OP_reduce_pending[p]->active)
+      op_reduce_complete(p, NULL, 0);
+    op_reduce_buffer *r = OP_reduce_pending[p];
+    int slot = op_reduce_pack(r, args, nargs);
+    if (slot < 0)
+      return;
+    MPI_Iallreduce(r->send, r->recv, 1, OP_reduce_types[slot], OP_reduce_op,
+                   OP_MPI_WORLD, &r->req);
+    r->active = 1;
+    r->kernel = OP_kern_curr;
+    OP_reduce_num_pending++;
+    op_reduce_account(r, wall_t1, "reduction post");
+    return;
+  }
+#endif
+
+  op_reduce_buffer *r = &OP_reduce_now;
+  int slot = op_reduce_pack(r, args, nargs);
+  if (slot < 0)
+    return;
+  MPI_Allreduce(r->send, r->recv, 1, OP_reduce_types[slot], OP_reduce_op,
+                OP_MPI_WORLD);
+  op_reduce_unpack(r, NULL, 0);
+  r->kernel = OP_kern_curr;
+  op_reduce_account(r, wall_t1, "reduction");
+}
+
+void op_mpi_reduce_free() {
+  op_reduction_wait(NULL);
+  for (int p = 0; p < OP_REDUCE_MAX_PENDING; p++) {
+    op_free(OP_reduce_pending[p]);
+    OP_reduce_pending[p] = NULL;
+  }
+  OP_reduce_next = 0;
+  for (int i = 0; i < OP_REDUCE_MAX_BYTES / OP_REDUCE_ALIGN; i++) {
+    if (OP_reduce_type_created[i])
+      MPI_Type_free(&OP_reduce_types[i]);
+    OP_reduce_type_created[i] = 0;
+  }
+  if (OP_reduce_op_created)
+    MPI_Op_free(&OP_reduce_op);
+  OP_reduce_op_created = 0;
 }
 
 void op_mpi_reduce_float(op_arg *arg, float *data) {
@@ -2305,6 +2913,10 @@ void op_mpi_reduce_float(op_arg *arg, float *data) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace && arg->argtype == OP_ARG_GBL && arg->acc != OP_READ) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("reduction", "reduction", t1, t2);
+  }
 }
 
 void op_mpi_reduce_double(op_arg *arg, double *data) {
@@ -2359,6 +2971,10 @@ void op_mpi_reduce_double(op_arg *arg, double *data) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace && arg->argtype == OP_ARG_GBL && arg->acc != OP_READ) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("reduction", "reduction", t1, t2);
+  }
 }
 
 void op_mpi_reduce_int(op_arg *arg, int *data) {
@@ -2413,6 +3029,10 @@ void op_mpi_reduce_int(op_arg *arg, int *data) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace && arg->argtype == OP_ARG_GBL && arg->acc != OP_READ) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("reduction", "reduction", t1, t2);
+  }
 }
 
 void op_mpi_reduce_bool(op_arg *arg, bool *data) {
@@ -2467,6 +3087,10 @@ void op_mpi_reduce_bool(op_arg *arg, bool *data) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace && arg->argtype == OP_ARG_GBL && arg->acc != OP_READ) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("reduction", "reduction", t1, t2);
+  }
 }
 
 /*******************************************************************************
@@ -2474,27 +3098,48 @@ void op_mpi_reduce_bool(op_arg *arg, bool *data) {
  *******************************************************************************/
 
 op_dat op_mpi_get_data(op_dat dat) {
-  // create new communicator for fetching
+  return op_mpi_get_data_comm(dat, op_mpi_get_data_local(dat), OP_MPI_WORLD);
+}
+
+/*******************************************************************************
+ * Routine to copy the elements of a distributed op_dat held on this process,
+ * in the partitioned order and AoS layout
+ *******************************************************************************/
+
+char *op_mpi_get_data_local(op_dat dat) {
+  // queued loops may still write dat
+  op_flush();
+  char *data = (char *)xmalloc(dat->set->size * dat->size);
+  op_dat_get_aos(dat, data, 0, dat->set->size);
+  return data;
+}
+
+/*******************************************************************************
+ * Routine to move data, the local elements of dat taken by
+ * op_mpi_get_data_local, back to the original partitioning over comm; takes
+ * ownership of data. Only reads the partitioning information, so it can run
+ * on the background output thread.
+ *******************************************************************************/
+
+op_dat op_mpi_get_data_comm(op_dat dat, char *data, MPI_Comm comm) {
   int my_rank, comm_size;
-  MPI_Comm_rank(OP_MPI_WORLD, &my_rank);
-  MPI_Comm_size(OP_MPI_WORLD, &comm_size);
+  MPI_Comm_rank(comm, &my_rank);
+  MPI_Comm_size(comm, &comm_size);
 
   //
   // make a copy of the distributed op_dat on to a distributed temporary op_dat
   //
   op_dat temp_dat = (op_dat)xmalloc(sizeof(op_dat_core));
-  char *data = (char *)xmalloc(dat->set->size * dat->size);
-  memcpy(data, dat->data, dat->set->size * dat->size);
 
   //
-  // use orig_part_range to fill in OP_part_list[set->index]->elem_part with
-  // original partitioning information
+  // use orig_part_range to find the original partition of each element
   //
+  int *elem_part = (int *)xmalloc(dat->set->size * sizeof(int));
   for (int i = 0; i < dat->set->size; i++) {
     int local_index;
-    OP_part_list[dat->set->index]->elem_part[i] = get_partition(
-        OP_part_list[dat->set->index]->g_index[i],
-        orig_part_range[dat->set->index], &local_index, comm_size);
+    elem_part[i] = get_partition(OP_part_list[dat->set->index]->g_index[i],
+                                 orig_part_range[dat->set->index],
+                                 &local_index, comm_size);
   }
 
   halo_list pe_list;
@@ -2503,18 +3148,17 @@ op_dat op_mpi_get_data(op_dat dat) {
   //
   // create export list
   //
-  part p = OP_part_list[dat->set->index];
   int count = 0;
   int cap = 1000;
   int *temp_list = (int *)xmalloc(cap * sizeof(int));
 
   for (int i = 0; i < dat->set->size; i++) {
-    if (p->elem_part[i] != my_rank) {
+    if (elem_part[i] != my_rank) {
       if (count >= cap) {
         cap = cap * 2;
         temp_list = (int *)xrealloc(temp_list, cap * sizeof(int));
       }
-      temp_list[count++] = p->elem_part[i];
+      temp_list[count++] = elem_part[i];
       temp_list[count++] = i;
     }
   }
@@ -2535,7 +3179,7 @@ op_dat op_mpi_get_data(op_dat dat) {
   sizes = (int *)xmalloc(comm_size * sizeof(int));
 
   find_neighbors_set(pe_list, neighbors, sizes, &ranks_size, my_rank, comm_size,
-                     OP_MPI_WORLD);
+                     comm);
   MPI_Request request_send[pe_list->ranks_size];
 
   int *rbuf;
@@ -2544,8 +3188,8 @@ op_dat op_mpi_get_data(op_dat dat) {
 
   for (int i = 0; i < pe_list->ranks_size; i++) {
     int *sbuf = &pe_list->list[pe_list->disps[i]];
-    MPI_Isend(sbuf, pe_list->sizes[i], MPI_INT, pe_list->ranks[i], 1,
-              OP_MPI_WORLD, &request_send[i]);
+    MPI_Isend(sbuf, pe_list->sizes[i], MPI_INT, pe_list->ranks[i], 1, comm,
+              &request_send[i]);
   }
 
   for (int i = 0; i < ranks_size; i++)
@@ -2554,8 +3198,7 @@ op_dat op_mpi_get_data(op_dat dat) {
 
   for (int i = 0; i < ranks_size; i++) {
     rbuf = (int *)xmalloc(sizes[i] * sizeof(int));
-    MPI_Recv(rbuf, sizes[i], MPI_INT, neighbors[i], 1, OP_MPI_WORLD,
-             MPI_STATUS_IGNORE);
+    MPI_Recv(rbuf, sizes[i], MPI_INT, neighbors[i], 1, comm, MPI_STATUS_IGNORE);
     memcpy(&temp_list[count], (void *)&rbuf[0], sizes[i] * sizeof(int));
     count = count + sizes[i];
     op_free(rbuf);
@@ -2581,14 +3224,14 @@ op_dat op_mpi_get_data(op_dat dat) {
              dat->size);
     }
     MPI_Isend(sbuf_char[i], dat->size * pe_list->sizes[i], MPI_CHAR,
-              pe_list->ranks[i], dat->index, OP_MPI_WORLD, &request_send[i]);
+              pe_list->ranks[i], dat->index, comm, &request_send[i]);
   }
 
   char *rbuf_char = (char *)xmalloc(dat->size * pi_list->size);
   for (int i = 0; i < pi_list->ranks_size; i++) {
     MPI_Recv(&rbuf_char[pi_list->disps[i] * dat->size],
              dat->size * pi_list->sizes[i], MPI_CHAR, pi_list->ranks[i],
-             dat->index, OP_MPI_WORLD, MPI_STATUS_IGNORE);
+             dat->index, comm, MPI_STATUS_IGNORE);
   }
 
   MPI_Waitall(pe_list->ranks_size, request_send, MPI_STATUSES_IGNORE);
@@ -2603,7 +3246,7 @@ op_dat op_mpi_get_data(op_dat dat) {
   count = 0;
   for (int i = 0; i < dat->set->size; i++) // iterate over old set size
   {
-    if (OP_part_list[dat->set->index]->elem_part[i] == my_rank) {
+    if (elem_part[i] == my_rank) {
       memcpy(&new_dat[count * dat->size], (void *)&data[dat->size * i],
              dat->size);
       count++;
@@ -2633,7 +3276,7 @@ op_dat op_mpi_get_data(op_dat dat) {
                        ->g_index[pe_list->list[pe_list->disps[i] + j]];
     }
     MPI_Isend(sbuf[i], pe_list->sizes[i], MPI_INT, pe_list->ranks[i],
-              dat->index, OP_MPI_WORLD, &request_send[i]);
+              dat->index, comm, &request_send[i]);
   }
 
   rbuf = (int *)xmalloc(sizeof(int) * pi_list->size);
@@ -2641,7 +3284,7 @@ op_dat op_mpi_get_data(op_dat dat) {
   // receive original g_index values from relevant mpi processes
   for (int i = 0; i < pi_list->ranks_size; i++) {
     MPI_Recv(&rbuf[pi_list->disps[i]], pi_list->sizes[i], MPI_INT,
-             pi_list->ranks[i], dat->index, OP_MPI_WORLD, MPI_STATUS_IGNORE);
+             pi_list->ranks[i], dat->index, comm, MPI_STATUS_IGNORE);
   }
   MPI_Waitall(pe_list->ranks_size, request_send, MPI_STATUSES_IGNORE);
   for (int i = 0; i < pe_list->ranks_size; i++)
@@ -2656,7 +3299,7 @@ op_dat op_mpi_get_data(op_dat dat) {
   count = 0;
   for (int i = 0; i < dat->set->size; i++) { // iterate over old
                                              // size of the g_index array
-    if (OP_part_list[dat->set->index]->elem_part[i] == my_rank) {
+    if (elem_part[i] == my_rank) {
       new_g_index[count] = OP_part_list[dat->set->index]->g_index[i];
       count++;
     }
@@ -2684,6 +3327,7 @@ op_dat op_mpi_get_data(op_dat dat) {
   op_free(pi_list->list);
   op_free(pi_list);
   op_free(new_g_index);
+  op_free(elem_part);
 
   // remember that the original set size is now given by count
   op_set set = (op_set)xmalloc(sizeof(op_set_core));
@@ -2729,16 +3373,20 @@ static void op_reset_halo(op_arg *arg) {
     halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
     halo_list imp_nonexec_list = OP_import_nonexec_list[dat->set->index];
 
-    // initialise import halo data to NaN
-    int double_count = imp_exec_list->size * dat->size / sizeof(double);
-    double_count += imp_nonexec_list->size * dat->size / sizeof(double);
+    // initialise import halo data to NaN, one halo per component for SoA
+    int ncomp = dat->soa ? dat->dim : 1;
+    int esz = dat->size / ncomp;
+    int stride = op_dat_soa_stride(dat);
+    int halo_bytes = (imp_exec_list->size + imp_nonexec_list->size) * esz;
+    int double_count = halo_bytes / sizeof(double);
     double *NaN = (double *)xmalloc(double_count * sizeof(double));
     for (int i = 0; i < double_count; i++)
       NaN[i] = (double)NAN; // 0.0/0.0;
 
-    int init = dat->set->size * dat->size;
-    memcpy(&(dat->data[init]), NaN, dat->size * imp_exec_list->size +
-                                        dat->size * imp_nonexec_list->size);
+    for (int c = 0; c < ncomp; c++) {
+      size_t init = ((size_t)c * stride + dat->set->size) * esz;
+      memcpy(&(dat->data[init]), NaN, halo_bytes);
+    }
     op_free(NaN);
   }
 }
@@ -2756,6 +3404,26 @@ void op_compute_moment(double t, double *first, double *second) {
   *second = times_reduced[1] / (double)comm_size;
 }
 
+int op_comm_size() {
+  int comm_size;
+  MPI_Comm_size(OP_MPI_WORLD, &comm_size);
+  return comm_size;
+}
+
+int op_comm_rank() {
+  int my_rank;
+  MPI_Comm_rank(OP_MPI_WORLD, &my_rank);
+  return my_rank;
+}
+
+/*******************************************************************************
+ * Routine to gather n doubles from every rank onto root, rank by rank
+ *******************************************************************************/
+void op_gather_double(double *local, int n, double *gathered) {
+  MPI_Gather(local, n, MPI_DOUBLE, gathered, n, MPI_DOUBLE, MPI_ROOT,
+             OP_MPI_WORLD);
+}
+
 /*******************************************************************************
  * Routine to output performance measures
  *******************************************************************************/
@@ -2855,6 +3523,28 @@ void *op_mpi_perf_time(const char *name, double time) {
 
   return (void *)kernel_entry;
 }
+/*******************************************************************************
+ * Routine to report halo exports of a kernel as (count, bytes) per op_dat
+ * index - only populated when built with COMM_PERF
+ *******************************************************************************/
+void op_mpi_perf_halo_info(const char *name, int ndats, double *info) {
+  memset(info, 0, 2 * ndats * sizeof(double));
+  if (name == NULL)
+    return;
+  op_mpi_kernel *k;
+  for (k = op_mpi_kernel_tab; k != NULL; k = (op_mpi_kernel *)k->hh.next) {
+    if (strncmp(k->name, name, NAMESIZE) != 0)
+      continue;
+    for (int i = 0; i < k->num_indices; i++) {
+      int d = k->comm_info[i]->index;
+      if (d >= 0 && d < ndats) {
+        info[2 * d] += k->comm_info[i]->count;
+        info[2 * d + 1] += k->comm_info[i]->bytes;
+      }
+    }
+    return;
+  }
+}
 #ifdef COMM_PERF
 
 /*******************************************************************************
@@ -2947,11 +3637,139 @@ void op_mpi_perf_comms(void *k_i, int nargs, op_arg *args) {
 }
 #endif
 
+/*******************************************************************************
+ * Background output thread (OP_ASYNC_IO): jobs run one at a time in the order
+ * they were submitted, over the communicator OP_MPI_OUTPUT_WORLD - every rank
+ * submits the same sequence of collective jobs, so they match up across
+ * ranks. At most OP_async_io jobs are in flight.
+ *******************************************************************************/
+
+typedef struct op_io_job {
+  void (*run)(void *);
+  void *arg;
+  struct op_io_job *next;
+} op_io_job;
+
+MPI_Comm OP_MPI_OUTPUT_WORLD = MPI_COMM_NULL;
+
+static pthread_t op_io_thread;
+static pthread_mutex_t op_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t op_io_cond = PTHREAD_COND_INITIALIZER;
+static op_io_job *op_io_head = NULL, *op_io_tail = NULL;
+static int op_io_pending = 0; // jobs submitted and not finished
+static int op_io_started = 0;
+static int op_io_stop = 0;
+
+static void *op_io_loop(void *unused) {
+  (void)unused;
+  pthread_mutex_lock(&op_io_lock);
+  while (1) {
+    while (op_io_head == NULL && !op_io_stop)
+      pthread_cond_wait(&op_io_cond, &op_io_lock);
+    if (op_io_head == NULL)
+      break;
+    op_io_job *job = op_io_head;
+    op_io_head = job->next;
+    if (op_io_head == NULL)
+      op_io_tail = NULL;
+    pthread_mutex_unlock(&op_io_lock);
+
+    job->run(job->arg);
+    op_free(job);
+
+    pthread_mutex_lock(&op_io_lock);
+    op_io_pending--;
+    pthread_cond_broadcast(&op_io_cond);
+  }
+  pthread_mutex_unlock(&op_io_lock);
+  return NULL;
+}
+
+// MPI_Init, asking for MPI_THREAD_MULTIPLE if OP_ASYNC_IO is on the command
+// line
+void op_mpi_init_thread(int *argc, char ***argv) {
+  int async_io = 0;
+  for (int n = 1; n < *argc; n++)
+    async_io = async_io || strstr((*argv)[n], "OP_ASYNC_IO") != NULL;
+  if (async_io) {
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+  } else {
+    MPI_Init(argc, argv);
+  }
+}
+
+// collective over OP_MPI_WORLD; runs the job straight away if there is no
+// output thread, or MPI does not allow calls from it
+void op_mpi_io_submit(void (*run)(void *), void *arg) {
+  if (!op_io_started && OP_async_io > 0) {
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Query_thread(&provided);
+    if (provided < MPI_THREAD_MULTIPLE) {
+      op_printf("OP_ASYNC_IO needs MPI_THREAD_MULTIPLE, writing "
+                "synchronously\n");
+      OP_async_io = 0;
+    } else {
+      MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_OUTPUT_WORLD);
+      op_io_stop = 0;
+      pthread_create(&op_io_thread, NULL, op_io_loop, NULL);
+      op_io_started = 1;
+    }
+  }
+  if (!op_io_started) {
+    if (OP_MPI_OUTPUT_WORLD == MPI_COMM_NULL)
+      MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_OUTPUT_WORLD);
+    run(arg);
+    return;
+  }
+
+  op_io_job *job = (op_io_job *)xmalloc(sizeof(op_io_job));
+  job->run = run;
+  job->arg = arg;
+  job->next = NULL;
+
+  pthread_mutex_lock(&op_io_lock);
+  while (op_io_pending >= OP_async_io)
+    pthread_cond_wait(&op_io_cond, &op_io_lock);
+  if (op_io_tail == NULL)
+    op_io_head = job;
+  else
+    op_io_tail->next = job;
+  op_io_tail = job;
+  op_io_pending++;
+  pthread_cond_broadcast(&op_io_cond);
+  pthread_mutex_unlock(&op_io_lock);
+}
+
+void op_output_wait() {
+  if (!op_io_started)
+    return;
+  pthread_mutex_lock(&op_io_lock);
+  while (op_io_pending > 0)
+    pthread_cond_wait(&op_io_cond, &op_io_lock);
+  pthread_mutex_unlock(&op_io_lock);
+}
+
+static void op_mpi_io_exit() {
+  if (op_io_started) {
+    pthread_mutex_lock(&op_io_lock);
+    op_io_stop = 1;
+    pthread_cond_broadcast(&op_io_cond);
+    pthread_mutex_unlock(&op_io_lock);
+    pthread_join(op_io_thread, NULL);
+    op_io_started = 0;
+  }
+  if (OP_MPI_OUTPUT_WORLD != MPI_COMM_NULL)
+    MPI_Comm_free(&OP_MPI_OUTPUT_WORLD);
+}
+
 /*******************************************************************************
  * Routine to exit an op2 mpi application -
  *******************************************************************************/
 
 void op_mpi_exit() {
+  // finish the writes in flight, they need the partitioning information
+  op_mpi_io_exit();
   // cleanup performance data - need to do this in some op_mpi_exit() routine
   op_mpi_kernel *kernel_entry, *tmp;
   HASH_ITER(hh, op_mpi_kernel_tab, kernel_entry, tmp) {
@@ -2965,6 +3783,10 @@ void op_mpi_exit() {
 
   // free memory allocated to halos and mpi_buffers
   op_halo_destroy();
+  op_halo_aggregate_destroy();
+  op_halo_soa_destroy();
+  op_mpi_reduce_free();
+  op_mpi_tile_free();
   // free memory used for holding partition information
   op_partition_destroy();
   // print each mpi process's timing info for each kernel
@@ -3018,6 +3840,8 @@ int op_mpi_halo_exchanges(op_set set, int nargs, op_arg *args) {
       op_arg_check(set, n, args[n], &dummy, "halo_exchange mpi");
   }
 
+  op_mpi_reduce_wait_args(nargs, args);
+
   if (OP_hybrid_gpu) {
     for (int n = 0; n < nargs; n++)
       if (args[n].opt && args[n].argtype == OP_ARG_DAT &&
@@ -3045,9 +3869,15 @@ int op_mpi_halo_exchanges(op_set set, int nargs, op_arg *args) {
   }
   op_timers_core(&c1, &t1);
   for (int n = 0; n < nargs; n++) {
+    // already posted ahead by op_mpi_chain_halo_exchanges
+    if (args[n].sent == 1)
+      continue;
     if (args[n].opt && args[n].argtype == OP_ARG_DAT) {
       if (args[n].map == OP_ID) {
-        op_exchange_halo(&args[n], exec_flag);
+        if (OP_halo_aggregate)
+          op_exchange_halo_aggregate(&args[n], exec_flag, 0);
+        else
+          op_exchange_halo(&args[n], exec_flag);
       } else {
         // Check if dat-map combination was already done or if there is a
         // mismatch (same dat, diff map)
@@ -3059,26 +3889,843 @@ int op_mpi_halo_exchanges(op_set set, int nargs, op_arg *args) {
           else if (args[n].dat == args[m].dat && args[n].map != args[m].map)
             fallback = 1;
         }
+        if (found && !fallback)
+          continue;
         // If there was a map mismatch with other argument, do full halo
-        // exchange
-        if (fallback)
+        // exchange. Otherwise, if partial halo exchange is enabled for this
+        // map, do it
+        int partial = !fallback && OP_map_partial_exchange[args[n].map->index];
+        if (OP_halo_aggregate)
+          op_exchange_halo_aggregate(&args[n], exec_flag, partial);
+        else if (partial)
+          op_exchange_halo_partial(&args[n], exec_flag);
+        else
           op_exchange_halo(&args[n], exec_flag);
-        else if (!found) { // Otherwise, if partial halo exchange is enabled for
-                           // this map, do it
-          if (OP_map_partial_exchange[args[n].map->index])
-            op_exchange_halo_partial(&args[n], exec_flag);
-          else
-            op_exchange_halo(&args[n], exec_flag);
-        }
       }
     }
   }
+  if (OP_halo_aggregate)
+    op_exchange_halo_aggregate_post();
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace) {
+    op_trace_event("halo_exchanges", "halo", t1, t2);
+    op_trace_phase("compute_core", t2);
+  }
   return size;
 }
 
+void op_mpi_chain_halo_exchanges(int nloops, op_kernel_descriptor *chain) {
+  // aggregated messages are posted and completed loop by loop
+  if (OP_halo_aggregate || nloops < 2)
+    return;
+  double cpu_t1, cpu_t2, wall_t1, wall_t2;
+  op_timers_core(&cpu_t1, &wall_t1);
+
+  // dats written by an earlier loop of the chain, or exchanged by it in a way
+  // that cannot be posted ahead, are left to the loops themselves
+  char *blocked = (char *)op_calloc(OP_dat_index, sizeof(char));
+  for (int l = 0; l < nloops; l++) {
+    int nargs = chain[l]->nargs;
+    op_arg *args = chain[l]->args;
+    int direct_flag = 1;
+    int exec_flag = 0;
+    for (int n = 0; n < nargs; n++) {
+      if (args[n].opt && args[n].argtype == OP_ARG_DAT && args[n].idx != -1)
+        direct_flag = 0;
+      if (args[n].opt && args[n].idx != -1 && args[n].acc != OP_READ)
+        exec_flag = 1;
+    }
+    for (int n = 0; n < nargs && !direct_flag; n++) {
+      if (!args[n].opt || args[n].argtype != OP_ARG_DAT ||
+          blocked[args[n].dat->index])
+        continue;
+      if (args[n].map != OP_ID &&
+          OP_map_partial_exchange[args[n].map->index]) {
+        blocked[args[n].dat->index] = 1;
+        continue;
+      }
+      // sets arg->sent, which op_mpi_halo_exchanges then skips and
+      // op_mpi_wait_all completes
+      op_exchange_halo(&args[n], exec_flag);
+    }
+    for (int n = 0; n < nargs; n++)
+      if (args[n].opt && args[n].argtype == OP_ARG_DAT &&
+          args[n].acc != OP_READ)
+        blocked[args[n].dat->index] = 1;
+  }
+  op_free(blocked);
+
+  op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_trace)
+    op_trace_event("chain_halo_exchanges", "halo", wall_t1, wall_t2);
+}
+
+/*
+ * Sparse tiling of a loop chain across processes (OP_TILE_SIZE=n). The
+ * single-layer halos only cover one loop, so each process instead runs every
+ * iteration its owned elements depend on through the chain, computing those
+ * owned by its neighbours redundantly. Working backwards from the owned
+ * elements of every set, loop l runs each iteration that writes an element
+ * still needed, and the elements these iterations touch are needed in turn.
+ * Needed elements beyond the halos are appended to the local arrays as a
+ * deep halo, with their map rows fetched from their owners. Before the chain
+ * one exchange brings every needed element that is not owned up to date, and
+ * the tiles then run without further messages. Dats stored component-major
+ * are left to the untiled path, as the deep halo would move their components.
+ */
+
+typedef struct {
+  int gid;   /* global index of the element */
+  int local; /* its position in the local arrays */
+  UT_hash_handle hh;
+} op_tile_gid_entry;
+
+typedef struct {
+  char *v;
+  int len;
+} op_tile_flags;
+
+typedef struct {
+  int n;                     /* local elements, deep halo included */
+  int cap;
+  int *gid;                  /* global index of each local element */
+  int *gofs;                 /* first global index owned by each rank */
+  op_tile_gid_entry *lookup; /* local position of the elements not owned */
+} op_tile_set_core;
+
+typedef struct {
+  int *map;               /* map->map the rows below were counted for */
+  int rows;               /* rows allocated in map->map */
+  op_tile_flags known;    /* the row of the from-element is set */
+  op_tile_flags complete; /* every row referencing the to-element is known */
+  int *rev_offs, *rev;    /* rows referencing each owned to-element */
+} op_tile_map_core;
+
+typedef struct {
+  op_dat dat;
+  char *data; /* dat->data the capacity below was counted for */
+  int cap;
+} op_tile_dat_core;
+
+typedef struct op_mpi_tile_plan_core {
+  int *sig; /* shape of the chain the plan was built for */
+  int sig_len;
+  op_tile_plan *tiles;
+  int *nowned;     /* per loop, the first iteration owned elsewhere */
+  int **send_cnt;  /* per set and rank, elements sent before the chain */
+  int **send_list; /* per set, owned elements sent, grouped by rank */
+  int **recv_cnt;
+  int **recv_list; /* per set, positions received, grouped by rank */
+  struct op_mpi_tile_plan_core *next;
+} op_mpi_tile_plan;
+
+static op_tile_set_core *OP_tile_sets = NULL;
+static op_tile_map_core *OP_tile_maps = NULL;
+static op_tile_dat_core *OP_tile_dats = NULL;
+static int OP_tile_dats_len = 0;
+static op_mpi_tile_plan *OP_mpi_tile_plans = NULL;
+
+static void op_tile_flag(op_tile_flags *f, int i) {
+  if (i >= f->len) {
+    int len = MAX(2 * f->len, i + 1);
+    f->v = (char *)op_realloc(f->v, len);
+    memset(f->v + f->len, 0, len - f->len);
+    f->len = len;
+  }
+  f->v[i] = 1;
+}
+
+static int op_tile_test(op_tile_flags *f, int i) {
+  return i < f->len && f->v[i];
+}
+
+// rank owning global index g of set s
+static int op_tile_owner(int s, int g) {
+  int nranks;
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int *gofs = OP_tile_sets[s].gofs;
+  int lo = 0, hi = nranks - 1;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (g < gofs[mid + 1])
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+// local position of global index g of set s, appended to the deep halo if new
+static int op_tile_localize(int s, int g) {
+  op_tile_set_core *ts = &OP_tile_sets[s];
+  int rank;
+  MPI_Comm_rank(OP_MPI_WORLD, &rank);
+  if (g >= ts->gofs[rank] && g < ts->gofs[rank + 1])
+    return g - ts->gofs[rank];
+  op_tile_gid_entry *e;
+  HASH_FIND_INT(ts->lookup, &g, e);
+  if (e != NULL)
+    return e->local;
+  if (ts->n == ts->cap) {
+    ts->cap = MAX(2 * ts->cap, 16);
+    ts->gid = (int *)op_realloc(ts->gid, ts->cap * sizeof(int));
+  }
+  ts->gid[ts->n] = g;
+  e = (op_tile_gid_entry *)op_malloc(sizeof(op_tile_gid_entry));
+  e->gid = g;
+  e->local = ts->n++;
+  HASH_ADD_INT(ts->lookup, gid, e);
+  return e->local;
+}
+
+// row of local from-element f of map m, allocated if beyond the map's rows
+static int *op_tile_row(op_map map, int f) {
+  op_tile_map_core *tm = &OP_tile_maps[map->index];
+  if (tm->map != map->map) {
+    tm->map = map->map;
+    tm->rows = map->from->size + map->from->exec_size;
+  }
+  if (f >= tm->rows) {
+    int rows = MAX(2 * tm->rows, f + 1);
+    int *m = (int *)op_numa_alloc(NULL, 1, rows, map->dim * sizeof(int));
+    memcpy(m, map->map, (size_t)tm->rows * map->dim * sizeof(int));
+    if (!map->user_managed)
+      op_free(map->map);
+    map->map = m;
+    map->user_managed = 0;
+    tm->map = m;
+    tm->rows = rows;
+  }
+  return map->map + (size_t)f * map->dim;
+}
+
+/*
+ * sends scnt[r] ints of sbuf, grouped by rank, to each rank r and returns
+ * the ints received, grouped by rank with rcnt[r] from rank r
+ */
+static int *op_tile_alltoallv(int *sbuf, int *scnt, int *rcnt) {
+  int nranks;
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  MPI_Alltoall(scnt, 1, MPI_INT, rcnt, 1, MPI_INT, OP_MPI_WORLD);
+  int *sdsp = (int *)op_malloc(nranks * sizeof(int));
+  int *rdsp = (int *)op_malloc(nranks * sizeof(int));
+  int stot = 0, rtot = 0;
+  for (int r = 0; r < nranks; r++) {
+    sdsp[r] = stot;
+    rdsp[r] = rtot;
+    stot += scnt[r];
+    rtot += rcnt[r];
+  }
+  int *rbuf = (int *)op_malloc(MAX(rtot, 1) * sizeof(int));
+  MPI_Alltoallv(sbuf, scnt, sdsp, MPI_INT, rbuf, rcnt, rdsp, MPI_INT,
+                OP_MPI_WORLD);
+  op_free(sdsp);
+  op_free(rdsp);
+  return rbuf;
+}
+
+/*
+ * global indices of the local elements of every set, numbered by owner and
+ * then owner-local position, with those of the halos sent over the export
+ * lists
+ */
+static void op_tile_init() {
+  int rank, nranks;
+  MPI_Comm_rank(OP_MPI_WORLD, &rank);
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int *scnt = (int *)op_malloc(nranks * sizeof(int));
+  int *rcnt = (int *)op_malloc(nranks * sizeof(int));
+  OP_tile_sets =
+      (op_tile_set_core *)op_calloc(OP_set_index, sizeof(op_tile_set_core));
+  for (int s = 0; s < OP_set_index; s++) {
+    op_set set = OP_set_list[s];
+    op_tile_set_core *ts = &OP_tile_sets[s];
+    ts->gofs = (int *)op_calloc(nranks + 1, sizeof(int));
+    MPI_Allgather(&set->size, 1, MPI_INT, ts->gofs + 1, 1, MPI_INT,
+                  OP_MPI_WORLD);
+    for (int r = 0; r < nranks; r++)
+      ts->gofs[r + 1] += ts->gofs[r];
+    ts->n = set->size + set->exec_size + set->nonexec_size;
+    ts->cap = MAX(ts->n, 1);
+    ts->gid = (int *)op_malloc(ts->cap * sizeof(int));
+    for (int i = 0; i < set->size; i++)
+      ts->gid[i] = ts->gofs[rank] + i;
+
+    for (int h = 0; h < 2; h++) {
+      halo_list exp =
+          h == 0 ? OP_export_exec_list[s] : OP_export_nonexec_list[s];
+      halo_list imp =
+          h == 0 ? OP_import_exec_list[s] : OP_import_nonexec_list[s];
+      int init = set->size + (h == 0 ? 0 : set->exec_size);
+      int *sbuf = (int *)op_malloc(MAX(exp->size, 1) * sizeof(int));
+      memset(scnt, 0, nranks * sizeof(int));
+      for (int i = 0; i < exp->ranks_size; i++) {
+        scnt[exp->ranks[i]] = exp->sizes[i];
+        for (int j = 0; j < exp->sizes[i]; j++)
+          sbuf[exp->disps[i] + j] =
+              ts->gofs[rank] + exp->list[exp->disps[i] + j];
+      }
+      int *rbuf = op_tile_alltoallv(sbuf, scnt, rcnt);
+      int off = 0;
+      for (int r = 0, i = 0; r < nranks; r++) {
+        if (i < imp->ranks_size && imp->ranks[i] == r) {
+          memcpy(ts->gid + init + imp->disps[i], rbuf + off,
+                 imp->sizes[i] * sizeof(int));
+          i++;
+        }
+        off += rcnt[r];
+      }
+      op_free(sbuf);
+      op_free(rbuf);
+    }
+    for (int i = set->size; i < ts->n; i++) {
+      op_tile_gid_entry *e =
+          (op_tile_gid_entry *)op_malloc(sizeof(op_tile_gid_entry));
+      e->gid = ts->gid[i];
+      e->local = i;
+      HASH_ADD_INT(ts->lookup, gid, e);
+    }
+  }
+  op_free(scnt);
+  op_free(rcnt);
+
+  OP_tile_maps =
+      (op_tile_map_core *)op_calloc(OP_map_index, sizeof(op_tile_map_core));
+  for (int m = 0; m < OP_map_index; m++) {
+    op_map map = OP_map_list[m];
+    op_tile_map_core *tm = &OP_tile_maps[m];
+    tm->map = map->map;
+    tm->rows = map->from->size + map->from->exec_size;
+    for (int f = tm->rows - 1; f >= 0; f--)
+      op_tile_flag(&tm->known, f);
+    for (int x = map->to->size - 1; x >= 0; x--)
+      op_tile_flag(&tm->complete, x);
+  }
+}
+
+// global indices of the nq local elements q of set s grouped by owner, with
+// their number per owner in scnt
+static int *op_tile_by_owner(int s, int const *q, int nq, int *scnt) {
+  int nranks;
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int *owner = (int *)op_malloc(MAX(nq, 1) * sizeof(int));
+  int *fill = (int *)op_calloc(nranks, sizeof(int));
+  memset(scnt, 0, nranks * sizeof(int));
+  for (int k = 0; k < nq; k++) {
+    owner[k] = op_tile_owner(s, OP_tile_sets[s].gid[q[k]]);
+    scnt[owner[k]]++;
+  }
+  for (int r = 1; r < nranks; r++)
+    fill[r] = fill[r - 1] + scnt[r - 1];
+  int *sbuf = (int *)op_malloc(MAX(nq, 1) * sizeof(int));
+  for (int k = 0; k < nq; k++) {
+    sbuf[fill[owner[k]]++] = OP_tile_sets[s].gid[q[k]];
+  }
+  op_free(owner);
+  op_free(fill);
+  return sbuf;
+}
+
+// sets the row of local from-element f of map from the global indices grow
+static void op_tile_set_row(op_map map, int f, int const *grow) {
+  int *row = op_tile_row(map, f);
+  for (int j = 0; j < map->dim; j++)
+    row[j] = op_tile_localize(map->to->index, grow[j]);
+  op_tile_flag(&OP_tile_maps[map->index].known, f);
+}
+
+// fetches the map rows of the nq local from-elements q from their owners
+static void op_tile_fetch_rows(op_map map, int *q, int nq) {
+  int rank, nranks;
+  MPI_Comm_rank(OP_MPI_WORLD, &rank);
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int fs = map->from->index, ts = map->to->index, dim = map->dim;
+  int *scnt = (int *)op_malloc(nranks * sizeof(int));
+  int *rcnt = (int *)op_malloc(nranks * sizeof(int));
+  int *sbuf = op_tile_by_owner(fs, q, nq, scnt);
+  int *rbuf = op_tile_alltoallv(sbuf, scnt, rcnt);
+  int nr = 0;
+  for (int r = 0; r < nranks; r++)
+    nr += rcnt[r];
+  // answer with the rows of the owned elements asked for
+  int *ans = (int *)op_malloc(MAX(nr * dim, 1) * sizeof(int));
+  for (int k = 0; k < nr; k++) {
+    int *row = map->map + (size_t)(rbuf[k] - OP_tile_sets[fs].gofs[rank]) * dim;
+    for (int j = 0; j < dim; j++)
+      ans[k * dim + j] = OP_tile_sets[ts].gid[row[j]];
+  }
+  for (int r = 0; r < nranks; r++) {
+    rcnt[r] *= dim;
+    scnt[r] *= dim;
+  }
+  int *rows = op_tile_alltoallv(ans, rcnt, scnt);
+  for (int k = 0; k < nq; k++)
+    op_tile_set_row(map, op_tile_localize(fs, sbuf[k]), rows + k * dim);
+  op_free(rows);
+  op_free(ans);
+  op_free(rbuf);
+  op_free(sbuf);
+  op_free(scnt);
+  op_free(rcnt);
+}
+
+/*
+ * fetches from their owners every map row referencing the nq local
+ * to-elements q, as each owner holds those of its owned elements
+ */
+static void op_tile_fetch_referencing(op_map map, int *q, int nq) {
+  int rank, nranks;
+  MPI_Comm_rank(OP_MPI_WORLD, &rank);
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int fs = map->from->index, ts = map->to->index, dim = map->dim;
+  op_tile_map_core *tm = &OP_tile_maps[map->index];
+  if (tm->rev_offs == NULL) {
+    int rows = map->from->size + map->from->exec_size;
+    tm->rev_offs = (int *)op_calloc(map->to->size + 1, sizeof(int));
+    for (int k = 0; k < rows * dim; k++)
+      if (map->map[k] < map->to->size)
+        tm->rev_offs[map->map[k] + 1]++;
+    for (int x = 0; x < map->to->size; x++)
+      tm->rev_offs[x + 1] += tm->rev_offs[x];
+    int *fill = (int *)op_malloc(MAX(map->to->size, 1) * sizeof(int));
+    memcpy(fill, tm->rev_offs, map->to->size * sizeof(int));
+    tm->rev = (int *)op_malloc(MAX(tm->rev_offs[map->to->size], 1) *
+                               sizeof(int));
+    // a row referencing an element twice is listed once
+    for (int f = 0; f < rows; f++)
+      for (int j = 0; j < dim; j++) {
+        int x = map->map[f * dim + j];
+        if (x < map->to->size &&
+            (fill[x] == tm->rev_offs[x] || tm->rev[fill[x] - 1] != f))
+          tm->rev[fill[x]++] = f;
+      }
+    for (int x = 0; x < map->to->size; x++)
+      if (fill[x] < tm->rev_offs[x + 1])
+        tm->rev[fill[x]] = -1;
+    op_free(fill);
+  }
+
+  int *scnt = (int *)op_malloc(nranks * sizeof(int));
+  int *rcnt = (int *)op_malloc(nranks * sizeof(int));
+  int *sbuf = op_tile_by_owner(ts, q, nq, scnt);
+  int *rbuf = op_tile_alltoallv(sbuf, scnt, rcnt);
+  // answer each element with the count, and the global index and row of
+  // every from-element referencing it
+  int nr = 0, nans = 0;
+  for (int r = 0; r < nranks; r++)
+    nr += rcnt[r];
+  for (int k = 0; k < nr; k++) {
+    int x = rbuf[k] - OP_tile_sets[ts].gofs[rank];
+    for (int i = tm->rev_offs[x]; i < tm->rev_offs[x + 1] && tm->rev[i] >= 0;
+         i++)
+      nans += 1 + dim;
+    nans++;
+  }
+  int *ans = (int *)op_malloc(MAX(nans, 1) * sizeof(int));
+  int *acnt = (int *)op_calloc(nranks, sizeof(int));
+  for (int r = 0, k = 0, a = 0; r < nranks; r++) {
+    int a0 = a;
+    for (int end = k + rcnt[r]; k < end; k++) {
+      int x = rbuf[k] - OP_tile_sets[ts].gofs[rank];
+      int *cnt = &ans[a++];
+      *cnt = 0;
+      for (int i = tm->rev_offs[x];
+           i < tm->rev_offs[x + 1] && tm->rev[i] >= 0; i++) {
+        int f = tm->rev[i];
+        ans[a++] = OP_tile_sets[fs].gid[f];
+        for (int j = 0; j < dim; j++)
+          ans[a++] = OP_tile_sets[ts].gid[map->map[f * dim + j]];
+        (*cnt)++;
+      }
+    }
+    acnt[r] = a - a0;
+  }
+  int *got = op_tile_alltoallv(ans, acnt, rcnt);
+  int a = 0;
+  for (int k = 0; k < nq; k++) {
+    int cnt = got[a++];
+    for (int i = 0; i < cnt; i++, a += 1 + dim) {
+      int f = op_tile_localize(fs, got[a]);
+      if (!op_tile_test(&tm->known, f))
+        op_tile_set_row(map, f, got + a + 1);
+    }
+    op_tile_flag(&tm->complete, op_tile_localize(ts, sbuf[k]));
+  }
+  op_free(got);
+  op_free(acnt);
+  op_free(ans);
+  op_free(rbuf);
+  op_free(sbuf);
+  op_free(scnt);
+  op_free(rcnt);
+}
+
+// local positions of the flagged elements among the first n, ascending
+static int *op_tile_list(op_tile_flags *f, int first, int n, int *len) {
+  int *list = (int *)op_malloc(MAX(n - first, 1) * sizeof(int));
+  *len = 0;
+  for (int i = first; i < n; i++)
+    if (op_tile_test(f, i))
+      list[(*len)++] = i;
+  return list;
+}
+
+static op_mpi_tile_plan *op_mpi_tile_plan_build(int nloops,
+                                                op_kernel_descriptor *chain) {
+  int nranks;
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  op_mpi_tile_plan *plan =
+      (op_mpi_tile_plan *)op_calloc(1, sizeof(op_mpi_tile_plan));
+  plan->nowned = (int *)op_malloc(nloops * sizeof(int));
+  int **iters = (int **)op_malloc(nloops * sizeof(int *));
+  int *niters = (int *)op_malloc(nloops * sizeof(int));
+
+  // elements needed after the chain, then before each loop going backwards
+  op_tile_flags *needed =
+      (op_tile_flags *)op_calloc(OP_set_index, sizeof(op_tile_flags));
+  char *used = (char *)op_calloc(OP_set_index, sizeof(char));
+  for (int l = 0; l < nloops; l++) {
+    used[chain[l]->set->index] = 1;
+    for (int i = 0; i < chain[l]->nargs; i++)
+      if (chain[l]->args[i].map != NULL)
+        used[chain[l]->args[i].map->to->index] = 1;
+  }
+  for (int s = 0; s < OP_set_index; s++)
+    for (int i = OP_set_list[s]->size - 1; i >= 0 && used[s]; i--)
+      op_tile_flag(&needed[s], i);
+
+  for (int l = nloops - 1; l >= 0; l--) {
+    op_set set = chain[l]->set;
+    int nargs = chain[l]->nargs;
+    op_arg *args = chain[l]->args;
+    op_tile_flags run = {NULL, 0};
+    for (int i = 0; i < nargs; i++) {
+      if (!args[i].opt)
+        continue;
+      if (args[i].argtype == OP_ARG_GBL && args[i].acc != OP_READ)
+        for (int e = 0; e < set->size; e++)
+          op_tile_flag(&run, e);
+      if (args[i].argtype != OP_ARG_DAT || args[i].acc == OP_READ)
+        continue;
+      if (args[i].map == NULL) {
+        for (int e = 0; e < OP_tile_sets[set->index].n; e++)
+          if (op_tile_test(&needed[set->index], e))
+            op_tile_flag(&run, e);
+        continue;
+      }
+      // every iteration writing a needed element must be known locally
+      op_map map = args[i].map;
+      op_tile_map_core *tm = &OP_tile_maps[map->index];
+      int nq;
+      int ts = map->to->index;
+      int *q = op_tile_list(&needed[ts], map->to->size, OP_tile_sets[ts].n,
+                            &nq);
+      int k = 0;
+      for (int j = 0; j < nq; j++)
+        if (!op_tile_test(&tm->complete, q[j]))
+          q[k++] = q[j];
+      op_tile_fetch_referencing(map, q, k);
+      op_free(q);
+      int first = args[i].idx < 0 ? 0 : args[i].idx;
+      int last = args[i].idx < 0 ? -args[i].idx : args[i].idx + 1;
+      for (int e = 0; e < OP_tile_sets[set->index].n; e++) {
+        if (!op_tile_test(&tm->known, e))
+          continue;
+        int *row = map->map + (size_t)e * map->dim;
+        for (int j = first; j < last; j++)
+          if (op_tile_test(&needed[ts], row[j]))
+            op_tile_flag(&run, e);
+      }
+    }
+    iters[l] = op_tile_list(&run, 0, OP_tile_sets[set->index].n, &niters[l]);
+    plan->nowned[l] = set->size;
+    op_free(run.v);
+
+    // the rows of the iterations to run, and the elements they touch
+    for (int i = 0; i < nargs; i++) {
+      if (!args[i].opt || args[i].argtype != OP_ARG_DAT)
+        continue;
+      op_map map = args[i].map;
+      if (map == NULL) {
+        for (int k = 0; k < niters[l]; k++)
+          op_tile_flag(&needed[set->index], iters[l][k]);
+        continue;
+      }
+      int seen = 0;
+      for (int j = 0; j < i && !seen; j++)
+        seen = args[j].opt && args[j].map == map;
+      if (!seen) {
+        int *q = (int *)op_malloc(MAX(niters[l], 1) * sizeof(int));
+        int nq = 0;
+        for (int k = 0; k < niters[l]; k++)
+          if (!op_tile_test(&OP_tile_maps[map->index].known, iters[l][k]))
+            q[nq++] = iters[l][k];
+        op_tile_fetch_rows(map, q, nq);
+        op_free(q);
+      }
+      int first = args[i].idx < 0 ? 0 : args[i].idx;
+      int last = args[i].idx < 0 ? -args[i].idx : args[i].idx + 1;
+      for (int k = 0; k < niters[l]; k++) {
+        int *row = map->map + (size_t)iters[l][k] * map->dim;
+        for (int j = first; j < last; j++)
+          op_tile_flag(&needed[map->to->index], row[j]);
+      }
+    }
+  }
+
+  // the needed elements owned elsewhere are fetched before every run
+  plan->send_cnt = (int **)op_calloc(OP_set_index, sizeof(int *));
+  plan->send_list = (int **)op_calloc(OP_set_index, sizeof(int *));
+  plan->recv_cnt = (int **)op_calloc(OP_set_index, sizeof(int *));
+  plan->recv_list = (int **)op_calloc(OP_set_index, sizeof(int *));
+  int *nelems = (int *)op_malloc(OP_set_index * sizeof(int));
+  for (int s = 0; s < OP_set_index; s++) {
+    nelems[s] = OP_tile_sets[s].n;
+    if (!used[s])
+      continue;
+    int rank;
+    MPI_Comm_rank(OP_MPI_WORLD, &rank);
+    int nq;
+    int *q = op_tile_list(&needed[s], OP_set_list[s]->size, OP_tile_sets[s].n,
+                          &nq);
+    plan->recv_cnt[s] = (int *)op_malloc(nranks * sizeof(int));
+    plan->send_cnt[s] = (int *)op_malloc(nranks * sizeof(int));
+    int *sbuf = op_tile_by_owner(s, q, nq, plan->recv_cnt[s]);
+    int *rbuf = op_tile_alltoallv(sbuf, plan->recv_cnt[s], plan->send_cnt[s]);
+    int ns = 0;
+    for (int r = 0; r < nranks; r++)
+      ns += plan->send_cnt[s][r];
+    for (int k = 0; k < ns; k++)
+      rbuf[k] -= OP_tile_sets[s].gofs[rank];
+    for (int k = 0; k < nq; k++)
+      q[k] = op_tile_localize(s, sbuf[k]);
+    plan->send_list[s] = rbuf;
+    plan->recv_list[s] = q;
+    op_free(sbuf);
+  }
+
+  plan->tiles = op_tile_plan_build(nloops, chain, iters, niters, nelems);
+  for (int l = 0; l < nloops; l++)
+    op_free(iters[l]);
+  for (int s = 0; s < OP_set_index; s++)
+    op_free(needed[s].v);
+  op_free(needed);
+  op_free(used);
+  op_free(nelems);
+  op_free(iters);
+  op_free(niters);
+  return plan;
+}
+
+static void op_mpi_tile_plan_free(op_mpi_tile_plan *plan) {
+  op_tile_plan_free(plan->tiles);
+  for (int s = 0; s < OP_set_index; s++) {
+    op_free(plan->send_cnt[s]);
+    op_free(plan->send_list[s]);
+    op_free(plan->recv_cnt[s]);
+    op_free(plan->recv_list[s]);
+  }
+  op_free(plan->send_cnt);
+  op_free(plan->send_list);
+  op_free(plan->recv_cnt);
+  op_free(plan->recv_list);
+  op_free(plan->nowned);
+  op_free(plan->sig);
+  op_free(plan);
+}
+
+// grows the storage of dat to the local elements of its set, deep halo
+// included
+static void op_tile_dat_fit(op_dat dat) {
+  if (dat->index >= OP_tile_dats_len) {
+    int len = MAX(2 * OP_tile_dats_len, dat->index + 1);
+    OP_tile_dats = (op_tile_dat_core *)op_realloc(
+        OP_tile_dats, len * sizeof(op_tile_dat_core));
+    memset(OP_tile_dats + OP_tile_dats_len, 0,
+           (len - OP_tile_dats_len) * sizeof(op_tile_dat_core));
+    OP_tile_dats_len = len;
+  }
+  op_tile_dat_core *td = &OP_tile_dats[dat->index];
+  op_set set = dat->set;
+  if (td->dat != dat || td->data != dat->data)
+    td->cap = set->size + set->exec_size + set->nonexec_size;
+  int n = OP_tile_sets[set->index].n;
+  if (n > td->cap) {
+    char *data = op_numa_alloc(NULL, 1, n, dat->size);
+    memcpy(data, dat->data, (size_t)td->cap * dat->size);
+    if (!dat->user_managed)
+      op_free(dat->data);
+    dat->data = data;
+    dat->user_managed = 0;
+    td->cap = n;
+  }
+  td->dat = dat;
+  td->data = dat->data;
+}
+
+int op_mpi_tile_chain(int nloops, op_kernel_descriptor *chain, double *time) {
+  // the deep halo would move the components of a component-major dat
+  for (int l = 0; l < nloops; l++)
+    for (int i = 0; i < chain[l]->nargs; i++)
+      if (chain[l]->args[i].opt &&
+          chain[l]->args[i].argtype == OP_ARG_DAT &&
+          chain[l]->args[i].dat->soa)
+        return 0;
+
+  if (OP_tile_sets == NULL)
+    op_tile_init();
+  int sig_len;
+  int *sig = op_tile_signature(nloops, chain, &sig_len);
+  op_mpi_tile_plan *plan = OP_mpi_tile_plans;
+  while (plan != NULL &&
+         (plan->sig_len != sig_len ||
+          memcmp(plan->sig, sig, sig_len * sizeof(int)) != 0))
+    plan = plan->next;
+  if (plan == NULL) {
+    plan = op_mpi_tile_plan_build(nloops, chain);
+    plan->sig = sig;
+    plan->sig_len = sig_len;
+    plan->next = OP_mpi_tile_plans;
+    OP_mpi_tile_plans = plan;
+  } else {
+    op_free(sig);
+  }
+
+  // the dats of the chain, in the order of their first use
+  int ndats = 0;
+  op_dat *dats = NULL;
+  for (int l = 0; l < nloops; l++) {
+    op_arg *args = chain[l]->args;
+    for (int i = 0; i < chain[l]->nargs; i++) {
+      if (!args[i].opt || args[i].argtype != OP_ARG_DAT)
+        continue;
+      int seen = 0;
+      for (int d = 0; d < ndats && !seen; d++)
+        seen = dats[d] == args[i].dat;
+      if (!seen) {
+        dats = (op_dat *)op_realloc(dats, (ndats + 1) * sizeof(op_dat));
+        dats[ndats++] = args[i].dat;
+      }
+    }
+  }
+  for (int d = 0; d < ndats; d++)
+    op_tile_dat_fit(dats[d]);
+  for (int l = 0; l < nloops; l++) {
+    op_arg *args = chain[l]->args;
+    for (int i = 0; i < chain[l]->nargs; i++) {
+      if (!args[i].opt || args[i].argtype != OP_ARG_DAT)
+        continue;
+      args[i].data = args[i].dat->data;
+      if (args[i].map != NULL)
+        args[i].map_data = args[i].map->map;
+    }
+  }
+
+  // one exchange of every needed element of every dat of the chain
+  double cpu_t1, cpu_t2, wall_t1, wall_t2;
+  op_timers_core(&cpu_t1, &wall_t1);
+  int nranks;
+  MPI_Comm_size(OP_MPI_WORLD, &nranks);
+  int *scnt = (int *)op_calloc(nranks, sizeof(int));
+  int *rcnt = (int *)op_calloc(nranks, sizeof(int));
+  int *sdsp = (int *)op_malloc(nranks * sizeof(int));
+  int *rdsp = (int *)op_malloc(nranks * sizeof(int));
+  for (int d = 0; d < ndats; d++) {
+    int s = dats[d]->set->index;
+    for (int r = 0; r < nranks; r++) {
+      scnt[r] += plan->send_cnt[s][r] * dats[d]->size;
+      rcnt[r] += plan->recv_cnt[s][r] * dats[d]->size;
+    }
+  }
+  int stot = 0, rtot = 0;
+  for (int r = 0; r < nranks; r++) {
+    sdsp[r] = stot;
+    rdsp[r] = rtot;
+    stot += scnt[r];
+    rtot += rcnt[r];
+  }
+  char *sbuf = (char *)op_malloc(MAX(stot, 1));
+  char *rbuf = (char *)op_malloc(MAX(rtot, 1));
+  for (int r = 0, off = 0; r < nranks; r++) {
+    for (int d = 0; d < ndats; d++) {
+      op_dat dat = dats[d];
+      int s = dat->set->index;
+      int first = 0;
+      for (int p = 0; p < r; p++)
+        first += plan->send_cnt[s][p];
+      for (int k = first; k < first + plan->send_cnt[s][r]; k++) {
+        memcpy(sbuf + off,
+               dat->data + (size_t)plan->send_list[s][k] * dat->size,
+               dat->size);
+        off += dat->size;
+      }
+    }
+  }
+  MPI_Alltoallv(sbuf, scnt, sdsp, MPI_CHAR, rbuf, rcnt, rdsp, MPI_CHAR,
+                OP_MPI_WORLD);
+  for (int r = 0, off = 0; r < nranks; r++) {
+    for (int d = 0; d < ndats; d++) {
+      op_dat dat = dats[d];
+      int s = dat->set->index;
+      int first = 0;
+      for (int p = 0; p < r; p++)
+        first += plan->recv_cnt[s][p];
+      for (int k = first; k < first + plan->recv_cnt[s][r]; k++) {
+        memcpy(dat->data + (size_t)plan->recv_list[s][k] * dat->size,
+               rbuf + off, dat->size);
+        off += dat->size;
+      }
+    }
+  }
+  op_free(sbuf);
+  op_free(rbuf);
+  op_free(scnt);
+  op_free(rcnt);
+  op_free(sdsp);
+  op_free(rdsp);
+  op_free(dats);
+  op_timers_core(&cpu_t2, &wall_t2);
+  if (OP_trace)
+    op_trace_event("tiled_chain_exchange", "halo", wall_t1, wall_t2);
+
+  op_tile_run(plan->tiles, chain, plan->nowned, time);
+  return 1;
+}
+
+void op_mpi_tile_free() {
+  while (OP_mpi_tile_plans != NULL) {
+    op_mpi_tile_plan *plan = OP_mpi_tile_plans;
+    OP_mpi_tile_plans = plan->next;
+    op_mpi_tile_plan_free(plan);
+  }
+  if (OP_tile_sets != NULL) {
+    for (int s = 0; s < OP_set_index; s++) {
+      op_tile_gid_entry *e, *tmp;
+      HASH_ITER(hh, OP_tile_sets[s].lookup, e, tmp) {
+        HASH_DEL(OP_tile_sets[s].lookup, e);
+        op_free(e);
+      }
+      op_free(OP_tile_sets[s].gid);
+      op_free(OP_tile_sets[s].gofs);
+    }
+    for (int m = 0; m < OP_map_index; m++) {
+      op_free(OP_tile_maps[m].known.v);
+      op_free(OP_tile_maps[m].complete.v);
+      op_free(OP_tile_maps[m].rev_offs);
+      op_free(OP_tile_maps[m].rev);
+    }
+  }
+  op_free(OP_tile_sets);
+  op_free(OP_tile_maps);
+  op_free(OP_tile_dats);
+  OP_tile_sets = NULL;
+  OP_tile_maps = NULL;
+  OP_tile_dats = NULL;
+  OP_tile_dats_len = 0;
+}
+
 int op_mpi_halo_exchanges_cuda(op_set set, int nargs, op_arg *args) {
   int size = set->size;
   int direct_flag = 1;
@@ -3089,6 +4736,8 @@ int op_mpi_halo_exchanges_cuda(op_set set, int nargs, op_arg *args) {
       op_arg_check(set, n, args[n], &dummy, "halo_exchange cuda");
   }
 
+  op_mpi_reduce_wait_args(nargs, args);
+
   for (int n = 0; n < nargs; n++)
     if (args[n].opt && args[n].argtype == OP_ARG_DAT &&
         args[n].dat->dirty_hd == 1) {
@@ -3145,6 +4794,10 @@ int op_mpi_halo_exchanges_cuda(op_set set, int nargs, op_arg *args) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace) {
+    op_trace_event("halo_exchanges", "halo", t1, t2);
+    op_trace_phase("compute_core", t2);
+  }
   return size;
 }
 
@@ -3168,12 +4821,18 @@ void op_mpi_set_dirtybit_cuda(int nargs, op_arg *args) {
 
 void op_mpi_wait_all(int nargs, op_arg *args) {
   op_timers_core(&c1, &t1);
+  op_wait_all_aggregate();
   for (int n = 0; n < nargs; n++) {
     op_wait_all(&args[n]);
   }
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("wait_all", "wait", t1, t2);
+    op_trace_phase("compute_noncore", t2);
+  }
 }
 
 void op_mpi_wait_all_cuda(int nargs, op_arg *args) {
@@ -3184,6 +4843,11 @@ void op_mpi_wait_all_cuda(int nargs, op_arg *args) {
   op_timers_core(&c2, &t2);
   if (OP_kern_max > 0)
     OP_kernels[OP_kern_curr].mpi_time += t2 - t1;
+  if (OP_trace) {
+    op_trace_phase(NULL, t1);
+    op_trace_event("wait_all", "wait", t1, t2);
+    op_trace_phase("compute_noncore", t2);
+  }
 }
 
 void op_mpi_reset_halos(int nargs, op_arg *args) {
@@ -3747,8 +5411,7 @@ void op_export_data(op_export_handle handle, op_dat dat) {
           printf("Error in OP2 packing export data %i %i\n", node,
                  dat->set->size);
 
-        memcpy(&handle->send_buf[i][j][bufp], &dat->data[node * dat->size],
-               dat->size);
+        op_dat_get_aos(dat, &handle->send_buf[i][j][bufp], node, 1);
         bufp += dat->size;
       }
 
@@ -4033,9 +5696,9 @@ void op_import_data(op_import_handle handle, op_dat dat) {
       for (int k = 0; k < handle->node_size_per_int[i]; k++) {
         memcpy(&handle->interp_dist[handle->nodelist_per_int[i][k]],
                &handle->recv_buf[i][j][k * recv_dat_size], sizeof(double));
-        memcpy(&dat->data[handle->nodelist_per_int[i][k] * dat->size],
-               &handle->recv_buf[i][j][sizeof(double) + k * recv_dat_size],
-               dat->size);
+        op_dat_put_aos(
+            dat, &handle->recv_buf[i][j][sizeof(double) + k * recv_dat_size],
+            handle->nodelist_per_int[i][k], 1);
       }
       first[i] = 0;
     } else {
@@ -4046,9 +5709,10 @@ void op_import_data(op_import_handle handle, op_dat dat) {
                  sizeof(double));
           if (dist < handle->interp_dist[handle->nodelist_per_int[i][k]]) {
             handle->interp_dist[handle->nodelist_per_int[i][k]] = dist;
-            memcpy(&dat->data[handle->nodelist_per_int[i][k] * dat->size],
-                   &handle->recv_buf[i][j][sizeof(double) + k * recv_dat_size],
-                   dat->size);
+            op_dat_put_aos(dat,
+                           &handle->recv_buf[i][j][sizeof(double) +
+                                                   k * recv_dat_size],
+                           handle->nodelist_per_int[i][k], 1);
           }
         }
       }
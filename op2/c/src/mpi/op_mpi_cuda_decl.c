@@ -67,7 +67,7 @@ void op_init_soa(int argc, char **argv, int diags, int soa) {
   OP_auto_soa = soa;
   MPI_Initialized(&flag);
   if (!flag) {
-    MPI_Init(&argc, &argv);
+    op_mpi_init_thread(&argc, &argv);
   }
   OP_MPI_WORLD = MPI_COMM_WORLD;
   OP_MPI_GLOBAL = MPI_COMM_WORLD;
@@ -157,6 +157,13 @@ op_dat op_decl_dat_char(op_set set, int dim, char const *type, int size,
   return out_dat;
 }
 
+op_dat op_decl_dat_adopt_char(op_set set, int dim, char const *type, int size,
+                              char *data, char const *name) {
+  op_dat out_dat = op_decl_dat_core(set, dim, type, size, data, name);
+  out_dat->user_managed = 0;
+  return out_dat;
+}
+
 op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
                              char const *name) {
   char *data = NULL;
@@ -203,6 +210,14 @@ op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
 
   mpi_buf->s_num_req = 0;
   mpi_buf->r_num_req = 0;
+  mpi_buf->persistent = NULL;
+  mpi_buf->num_persistent = 0;
+  mpi_buf->p_in_flight = NULL;
+  mpi_buf->shm_win = MPI_WIN_NULL;
+  mpi_buf->shm_base = NULL;
+  mpi_buf->d_s_req = NULL;
+  mpi_buf->d_r_req = NULL;
+  mpi_buf->shm_in_flight = 0;
 
   dat->mpi_buffer = mpi_buf;
 
@@ -217,6 +232,8 @@ op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
 
 int op_free_dat_temp_char(op_dat dat) {
   // need to free mpi_buffers use in this op_dat
+  op_mpi_buffer_persistent_free((op_mpi_buffer)(dat->mpi_buffer));
+  op_mpi_buffer_shm_free((op_mpi_buffer)(dat->mpi_buffer));
   free(((op_mpi_buffer)(dat->mpi_buffer))->buf_exec);
   free(((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec);
   free(((op_mpi_buffer)(dat->mpi_buffer))->s_req);
@@ -358,6 +375,13 @@ op_map op_decl_map(op_set from, op_set to, int dim, int *imap,
   // return op_decl_map_core ( from, to, dim, imap, name );
 }
 
+op_map op_decl_map_adopt(op_set from, op_set to, int dim, int *imap,
+                         char const *name) {
+  op_map out_map = op_decl_map_core(from, to, dim, imap, name);
+  out_map->user_managed = 0;
+  return out_map;
+}
+
 op_arg op_arg_dat(op_dat dat, int idx, op_map map, int dim, char const *type,
                   op_access acc) {
   return op_arg_dat_core(dat, idx, map, dim, type, acc);
@@ -533,6 +557,13 @@ op_dat op_fetch_data_file_char(op_dat dat) {
   return op_mpi_get_data(dat);
 }
 
+char *op_fetch_data_local_char(op_dat dat) {
+  // need to get data from GPU
+  op_cuda_get_data(dat);
+  // copy of the elements on this process, for a background write
+  return op_mpi_get_data_local(dat);
+}
+
 void op_fetch_data_idx_char(op_dat dat, char *usr_ptr, int low, int high) {
   // need to get data from GPU
   op_cuda_get_data(dat);
@@ -662,6 +662,23 @@ void op_wait_all(op_arg *arg) {
   arg->sent = 0;
 }
 
+// messages are not aggregated across dats on the device, fall back to the
+// per-dat exchanges
+void op_exchange_halo_aggregate(op_arg *arg, int exec_flag, int partial) {
+  if (partial)
+    op_exchange_halo_partial(arg, exec_flag);
+  else
+    op_exchange_halo(arg, exec_flag);
+}
+
+void op_exchange_halo_aggregate_post() {}
+
+void op_wait_all_aggregate() {}
+
+void op_halo_aggregate_destroy() {}
+
+void op_halo_soa_destroy() {}
+
 void op_partition(const char *lib_name, const char *lib_routine,
                   op_set prime_set, op_map prime_map, op_dat coords) {
   partition(lib_name, lib_routine, prime_set, prime_map, coords);
@@ -64,7 +64,7 @@ void op_init(int argc, char **argv, int diags) {
   int flag = 0;
   MPI_Initialized(&flag);
   if (!flag) {
-    MPI_Init(&argc, &argv);
+    op_mpi_init_thread(&argc, &argv);
   }
   OP_MPI_WORLD = MPI_COMM_WORLD;
   OP_MPI_GLOBAL = MPI_COMM_WORLD;
@@ -107,6 +107,15 @@ op_dat op_decl_dat_char(op_set set, int dim, char const *type, int size,
   return out_dat;
 }
 
+op_dat op_decl_dat_adopt_char(op_set set, int dim, char const *type, int size,
+                              char *data, char const *name) {
+  if (set == NULL || data == NULL)
+    return NULL;
+  op_dat out_dat = op_decl_dat_core(set, dim, type, size, data, name);
+  out_dat->user_managed = 0;
+  return out_dat;
+}
+
 op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
                              char const *name) {
   char *d = NULL;
@@ -117,9 +126,16 @@ op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
   int halo_size = OP_import_exec_list[set->index]->size +
                   OP_import_nonexec_list[set->index]->size;
 
-  // initialize data bits to 0
-  dat->data = (char *)calloc((set->size + halo_size) * dim * size, 1);
+  dat->soa = op_dat_soa_type(dat) && dim > 1; // zeroes need no transpose
+  // initialize data bits to 0, recycling a pooled block and its mpi_buffers
+  // if there is one
+  void *pooled_buf;
+  dat->data = op_temp_pool_alloc(dat, set->size + halo_size, &pooled_buf);
   dat->user_managed = 0;
+  if (pooled_buf != NULL) {
+    dat->mpi_buffer = pooled_buf;
+    return dat;
+  }
 
   // need to allocate mpi_buffers for this new temp_dat
   op_mpi_buffer mpi_buf = (op_mpi_buffer)xmalloc(sizeof(op_mpi_buffer_core));
@@ -142,19 +158,45 @@ op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
 
   mpi_buf->s_num_req = 0;
   mpi_buf->r_num_req = 0;
+  mpi_buf->persistent = NULL;
+  mpi_buf->num_persistent = 0;
+  mpi_buf->p_in_flight = NULL;
+  mpi_buf->shm_win = MPI_WIN_NULL;
+  mpi_buf->shm_base = NULL;
+  mpi_buf->d_s_req = NULL;
+  mpi_buf->d_r_req = NULL;
+  mpi_buf->shm_in_flight = 0;
 
   dat->mpi_buffer = mpi_buf;
 
   return dat;
 }
 
+static void op_mpi_buffer_free(void *mpi_buffer) {
+  op_mpi_buffer buf = (op_mpi_buffer)mpi_buffer;
+  op_mpi_buffer_persistent_free(buf);
+  op_mpi_buffer_shm_free(buf);
+  free(buf->buf_exec);
+  free(buf->buf_nonexec);
+  free(buf->s_req);
+  free(buf->r_req);
+  free(buf);
+}
+
 int op_free_dat_temp_char(op_dat dat) {
-  // need to free mpi_buffers used in this op_dat
-  free(((op_mpi_buffer)(dat->mpi_buffer))->buf_exec);
-  free(((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec);
-  free(((op_mpi_buffer)(dat->mpi_buffer))->s_req);
-  free(((op_mpi_buffer)(dat->mpi_buffer))->r_req);
-  free(dat->mpi_buffer);
+  op_flush();
+  op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+  int n = dat->set->size + OP_import_exec_list[dat->set->index]->size +
+          OP_import_nonexec_list[dat->set->index]->size;
+  // persistent requests are rebuilt for the next op_dat using the buffers
+  op_mpi_buffer_persistent_free(buf);
+  if (buf->shm_win == MPI_WIN_NULL) {
+    op_temp_pool_release(dat, n, buf);
+  } else {
+    // need to free mpi_buffers in a shared memory window
+    op_mpi_buffer_free(buf);
+    op_temp_pool_release(dat, n, NULL);
+  }
   return op_free_dat_temp_core(dat);
 }
 
@@ -190,6 +232,11 @@ op_dat op_fetch_data_file_char(op_dat dat) {
   return op_mpi_get_data(dat);
 }
 
+char *op_fetch_data_local_char(op_dat dat) {
+  // copy of the elements on this process, for a background write
+  return op_mpi_get_data_local(dat);
+}
+
 /*
  * No specific action is required for constants in MPI
  */
@@ -241,7 +288,8 @@ void op_print(const char *line) {
 }
 
 void op_exit() {
-
+  op_flush();
+  op_temp_pool_free(op_mpi_buffer_free);
   op_mpi_exit();
   op_rt_exit();
   op_exit_core();
@@ -273,6 +321,13 @@ op_map op_decl_map(op_set from, op_set to, int dim, int *imap,
   return out_map;
 }
 
+op_map op_decl_map_adopt(op_set from, op_set to, int dim, int *imap,
+                         char const *name) {
+  op_map out_map = op_decl_map_core(from, to, dim, imap, name);
+  out_map->user_managed = 0;
+  return out_map;
+}
+
 op_arg op_arg_dat(op_dat dat, int idx, op_map map, int dim, char const *type,
                   op_access acc) {
   return op_arg_dat_core(dat, idx, map, dim, type, acc);
@@ -294,6 +349,7 @@ void op_timers(double *cpu, double *et) {
 }
 
 void op_timing_output() {
+  op_flush();
   double max_plan_time = 0.0;
   MPI_Reduce(&OP_plan_time, &max_plan_time, 1, MPI_DOUBLE, MPI_MAX, 0,
              OP_MPI_WORLD);
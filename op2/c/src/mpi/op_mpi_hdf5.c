@@ -96,6 +96,7 @@ int compute_local_size_weight(int global_size, int mpi_comm_size,
 *******************************************************************************/
 
 op_set op_decl_set_hdf5(char const *file, char const *name) {
+  op_output_wait();
   // create new communicator
   int my_rank, comm_size;
   MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_HDF5_WORLD);
@@ -151,6 +152,7 @@ op_set op_decl_set_hdf5(char const *file, char const *name) {
 }
 
 op_set op_decl_set_hdf5_infer_size(char const *file, char const *name, char const *set_dataset_name) {
+  op_output_wait();
   // op_printf("op_decl_set_hdf5_infer_size() called in op_mpi_hdf5.c\n");
   // create new communicator
   int my_rank, comm_size;
@@ -234,6 +236,7 @@ op_set op_decl_set_hdf5_infer_size(char const *file, char const *name, char cons
 
 op_map op_decl_map_hdf5(op_set from, op_set to, int dim, char const *file,
                         char const *name) {
+  op_output_wait();
   // create new communicator
   int my_rank, comm_size;
   MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_HDF5_WORLD);
@@ -372,6 +375,7 @@ op_map op_decl_map_hdf5(op_set from, op_set to, int dim, char const *file,
 
 op_dat op_decl_dat_hdf5(op_set set, int dim, char const *type, char const *file,
                         char const *name) {
+  op_output_wait();
   // create new communicator
   int my_rank, comm_size;
   MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_HDF5_WORLD);
@@ -513,6 +517,7 @@ op_dat op_decl_dat_hdf5(op_set set, int dim, char const *type, char const *file,
 *******************************************************************************/
 void op_get_const_hdf5(char const *name, int dim, char const *type,
                        char *const_data, char const *file_name) {
+  op_output_wait();
   // create new communicator
   int my_rank, comm_size;
   MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_HDF5_WORLD);
@@ -630,6 +635,8 @@ void op_get_const_hdf5(char const *name, int dim, char const *type,
 * Routine to write all to a named hdf5 file
 *******************************************************************************/
 void op_dump_to_hdf5(char const *file_name) {
+  op_output_wait();
+  op_flush();
   op_printf("Writing to %s\n", file_name);
 
   // declare timers
@@ -846,6 +853,13 @@ void op_dump_to_hdf5(char const *file_name) {
     // create dateset path
     create_path(dat->name, file_id);
 
+    // SoA dats are written element by element, as they were declared
+    char *data = dat->data;
+    if (dat->soa) {
+      data = (char *)xmalloc((size_t)dat->set->size * dat->size);
+      op_dat_get_aos(dat, data, 0, dat->set->size);
+    }
+
     // Create the dataset with default properties and close dataspace.
     if (strcmp(dat->type, "double") == 0 ||
         strcmp(dat->type, "double:soa") == 0 ||
@@ -854,7 +868,7 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_DOUBLE, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, memspace, dataspace, plist_id,
-               dat->data);
+               data);
     } else if (strcmp(dat->type, "float") == 0 ||
                strcmp(dat->type, "float:soa") == 0 ||
                strcmp(dat->type, "real(4)") == 0 ||
@@ -862,7 +876,7 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_FLOAT, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_FLOAT, memspace, dataspace, plist_id,
-               dat->data);
+               data);
     } else if (strcmp(dat->type, "int") == 0 ||
                strcmp(dat->type, "int:soa") == 0 ||
                strcmp(dat->type, "int(4)") == 0 ||
@@ -871,24 +885,27 @@ void op_dump_to_hdf5(char const *file_name) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_INT, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_INT, memspace, dataspace, plist_id,
-               dat->data);
+               data);
     } else if ((strcmp(dat->type, "long") == 0) ||
                (strcmp(dat->type, "long:soa") == 0)) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_LONG, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_LONG, memspace, dataspace, plist_id,
-               dat->data);
+               data);
     } else if ((strcmp(dat->type, "long long") == 0) ||
                (strcmp(dat->type, "long long:soa") == 0)) {
       dset_id = H5Dcreate(file_id, dat->name, H5T_NATIVE_LLONG, dataspace,
                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
       H5Dwrite(dset_id, H5T_NATIVE_LLONG, memspace, dataspace, plist_id,
-               dat->data);
+               data);
     } else {
       op_printf("Unknown type - in op_dump_to_hdf5() writing op_dats\n");
       MPI_Abort(OP_MPI_HDF5_WORLD, 2);
     }
 
+    if (data != dat->data)
+      op_free(data);
+
     H5Dclose(dset_id);
     H5Pclose(plist_id);
     H5Sclose(memspace);
@@ -951,6 +968,7 @@ void op_dump_to_hdf5(char const *file_name) {
 *******************************************************************************/
 void op_write_const_hdf5(char const *name, int dim, char const *type,
                          char *const_data, char const *file_name) {
+  op_output_wait();
   // letting know that writing is happening ...
   op_printf("Writing '%s' to file '%s'\n", name, file_name);
 
@@ -1102,19 +1120,15 @@ void op_write_const_hdf5(char const *name, int dim, char const *type,
 * if the data set given at path does not exists in file creates data set
 *******************************************************************************/
 
-void op_fetch_data_hdf5(op_dat data, char const *file_name,
-                        char const *path_name) {
-  // letting know that writing is happening ...
-  op_printf("Writing '%s' to file '%s'\n", path_name, file_name);
-
-  // fetch data based on the backend
-  op_dat dat = op_fetch_data_file_char(data);
-
-  // create new communicator
+static void op_write_dat_hdf5(op_dat dat, char const *file_name,
+                              char const *path_name, MPI_Comm comm) {
+  // create new communicator, a local one as this may run on the background
+  // output thread
   int my_rank, comm_size;
-  MPI_Comm_dup(OP_MPI_WORLD, &OP_MPI_HDF5_WORLD);
-  MPI_Comm_rank(OP_MPI_HDF5_WORLD, &my_rank);
-  MPI_Comm_size(OP_MPI_HDF5_WORLD, &comm_size);
+  MPI_Comm io_comm;
+  MPI_Comm_dup(comm, &io_comm);
+  MPI_Comm_rank(io_comm, &my_rank);
+  MPI_Comm_size(io_comm, &comm_size);
 
   // MPI variables
   MPI_Info info = MPI_INFO_NULL;
@@ -1136,20 +1150,20 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
 
   // Set up file access property list with parallel I/O access
   plist_id = H5Pcreate(H5P_FILE_ACCESS);
-  H5Pset_fapl_mpio(plist_id, OP_MPI_HDF5_WORLD, info);
+  H5Pset_fapl_mpio(plist_id, io_comm, info);
 
   if (file_exist(file_name) == 0) {
-    MPI_Barrier(OP_MPI_WORLD);
+    MPI_Barrier(io_comm);
     if (OP_diags > 3) {
       op_printf("File %s does not exist .... creating file\n", file_name);
     }
-    MPI_Barrier(OP_MPI_HDF5_WORLD);
-    if (op_is_root()) {
+    MPI_Barrier(io_comm);
+    if (my_rank == 0) {
       FILE *fp;
       fp = fopen(file_name, "w");
       fclose(fp);
     }
-    MPI_Barrier(OP_MPI_HDF5_WORLD);
+    MPI_Barrier(io_comm);
     file_id = H5Fcreate(file_name, H5F_ACC_TRUNC, H5P_DEFAULT, plist_id);
   } else {
     if (OP_diags > 3) {
@@ -1174,7 +1188,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
       if (status < 0) {
         op_printf("Could not get properties of dataset '%s' in file '%s'\n",
                   path_name, file_name);
-        MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+        MPI_Abort(io_comm, 2);
       }
 
       // find element size of this dat with available attributes
@@ -1184,7 +1198,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
         op_printf(
             "dat.size %zu in file %s and dim %d do not match ... aborting\n",
             dat_size, file_name, dat->dim);
-        MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+        MPI_Abort(io_comm, 2);
       }
 
       // find dim with available attributes
@@ -1193,7 +1207,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
       if (dat_dim != dat->dim) {
         op_printf("dat.dim %d in file %s and dim %d do not match ... aborting\n",
                   dat_dim, file_name, dat->dim);
-        MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+        MPI_Abort(io_comm, 2);
       }
 
       // find type with available attributes
@@ -1204,7 +1218,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
       if (!op_type_equivalence(typ, dat->type)) {
         op_printf("dat.type %s in file %s and type %s do not match\n", typ,
                   file_name, dat->type);
-        MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+        MPI_Abort(io_comm, 2);
       }
 
       //
@@ -1215,7 +1229,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
       int *sizes = (int *)xmalloc(sizeof(int) * comm_size);
       int g_size = 0;
       MPI_Allgather(&dat->set->size, 1, MPI_INT, sizes, 1, MPI_INT,
-                    OP_MPI_HDF5_WORLD);
+                    io_comm);
       for (int i = 0; i < comm_size; i++)
         g_size = g_size + sizes[i];
 
@@ -1273,7 +1287,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
                  dat->data);
       else {
         op_printf("Unknown type in op_fetch_data_hdf5_file()\n");
-        MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+        MPI_Abort(io_comm, 2);
       }
 
       H5Dclose(dset_id);
@@ -1288,7 +1302,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
       op_free(dat->set);
       op_free(dat);
 
-      MPI_Comm_free(&OP_MPI_HDF5_WORLD);
+      MPI_Comm_free(&io_comm);
       return;
     } else {
       if (OP_diags > 3) {
@@ -1308,7 +1322,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
   int *sizes = (int *)xmalloc(sizeof(int) * comm_size);
   int g_size = 0;
   MPI_Allgather(&dat->set->size, 1, MPI_INT, sizes, 1, MPI_INT,
-                OP_MPI_HDF5_WORLD);
+                io_comm);
   for (int i = 0; i < comm_size; i++)
     g_size = g_size + sizes[i];
 
@@ -1377,7 +1391,7 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
              dat->data);
   } else {
     op_printf("Unknown type in op_fetch_data_hdf5_file()\n");
-    MPI_Abort(OP_MPI_HDF5_WORLD, 2);
+    MPI_Abort(io_comm, 2);
   }
 
   H5Dclose(dset_id);
@@ -1428,7 +1442,59 @@ void op_fetch_data_hdf5(op_dat data, char const *file_name,
   op_free(dat->set);
   op_free(dat);
 
-  MPI_Comm_free(&OP_MPI_HDF5_WORLD);
+  MPI_Comm_free(&io_comm);
+}
+
+/*******************************************************************************
+* Background write (OP_ASYNC_IO): the op_dat is snapshot on the calling thread,
+* its redistribution to the original ordering and the write are left to the
+* output thread. The other routines here start with op_output_wait(), so that
+* HDF5 is only used by one thread at a time
+*******************************************************************************/
+
+typedef struct {
+  op_dat_core dat; // copy of the op_dat, owning name and type
+  char *data;      // elements on this process, in the partitioned order
+  char *file_name;
+  char *path_name;
+} op_hdf5_write;
+
+static char *op_hdf5_copy_str(char const *src) {
+  char *dest = (char *)xmalloc(strlen(src) + 1);
+  return strcpy(dest, src);
+}
+
+static void op_fetch_data_hdf5_job(void *arg) {
+  op_hdf5_write *w = (op_hdf5_write *)arg;
+  op_dat dat = op_mpi_get_data_comm(&w->dat, w->data, OP_MPI_OUTPUT_WORLD);
+  op_write_dat_hdf5(dat, w->file_name, w->path_name, OP_MPI_OUTPUT_WORLD);
+  op_free((char *)w->dat.name);
+  op_free((char *)w->dat.type);
+  op_free(w->file_name);
+  op_free(w->path_name);
+  op_free(w);
+}
+
+void op_fetch_data_hdf5(op_dat data, char const *file_name,
+                        char const *path_name) {
+  // letting know that writing is happening ...
+  op_printf("Writing '%s' to file '%s'\n", path_name, file_name);
+
+  if (OP_async_io > 0) {
+    op_hdf5_write *w = (op_hdf5_write *)xmalloc(sizeof(op_hdf5_write));
+    w->dat = *data;
+    w->dat.name = op_hdf5_copy_str(data->name);
+    w->dat.type = op_hdf5_copy_str(data->type);
+    w->data = op_fetch_data_local_char(data);
+    w->file_name = op_hdf5_copy_str(file_name);
+    w->path_name = op_hdf5_copy_str(path_name);
+    op_mpi_io_submit(op_fetch_data_hdf5_job, w);
+    return;
+  }
+
+  // fetch data based on the backend
+  op_dat dat = op_fetch_data_file_char(data);
+  op_write_dat_hdf5(dat, file_name, path_name, OP_MPI_WORLD);
 }
 
 /*******************************************************************************
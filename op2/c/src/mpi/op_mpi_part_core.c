@@ -42,6 +42,7 @@
 // mpi header
 #include <mpi.h>
 
+#include <float.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -146,38 +147,34 @@ static int *create_exp_list_2(op_set set, int *temp_list, halo_list h_list,
     sizes[r] = 0;
   }
 
-  for (int r = 0; r < comm_size; r++) {
-    sizes[index] = 0;
-    disps[index] = 0;
-    int *temp_to = (int *)xmalloc((size / 3) * sizeof(int));
-    int *temp_part = (int *)xmalloc((size / 3) * sizeof(int));
-
-    for (int i = 0; i < size; i = i + 3) {
-      if (temp_list[i] == r) {
-        temp_to[sizes[index]] = temp_list[i + 1];
-        temp_part[sizes[index]] = temp_list[i + 2];
-        sizes[index]++;
-      }
-    }
-
-    if (sizes[index] > 0) {
-      ranks[index] = r;
-      // no sorting
-      total_size = total_size + sizes[index];
-      // no eleminating duplicates
-      if (index > 0)
-        disps[index] = disps[index - 1] + sizes[index - 1];
+  // bucket the entries by rank, keeping their order within a rank
+  int n = size / 3;
+  int *start = (int *)xcalloc(comm_size + 1, sizeof(int));
+  for (int i = 0; i < n; i++)
+    start[temp_list[3 * i] + 1]++;
+  for (int r = 0; r < comm_size; r++)
+    start[r + 1] += start[r];
+  int *fill = (int *)xmalloc(comm_size * sizeof(int));
+  memcpy(fill, start, comm_size * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    int pos = fill[temp_list[3 * i]]++;
+    to_list[pos] = temp_list[3 * i + 1];
+    part_list[pos] = temp_list[3 * i + 2];
+  }
 
-      // add to end of t_list and p_list
-      for (int e = 0; e < sizes[index]; e++) {
-        to_list[disps[index] + e] = temp_to[e];
-        part_list[disps[index] + e] = temp_part[e];
-      }
-      index++;
-    }
-    op_free(temp_to);
-    op_free(temp_part);
+  // no sorting, no eleminating duplicates
+  for (int r = 0; r < comm_size; r++) {
+    int count = start[r + 1] - start[r];
+    if (count == 0)
+      continue;
+    ranks[index] = r;
+    sizes[index] = count;
+    disps[index] = start[r];
+    total_size = total_size + count;
+    index++;
   }
+  op_free(fill);
+  op_free(start);
 
   h_list->set = set;
   h_list->size = total_size;
@@ -1083,28 +1080,25 @@ static void migrate_all(int my_rank, int comm_size) {
           op_free(sbuf[i]);
         op_free(sbuf);
 
-        // delete the data entirs that has been sent and create a
-        // modified data array
-        char *new_dat = (char *)xmalloc(dat->size * (set->size + imp->size));
-
+        // delete the data entirs that has been sent by compacting the
+        // retained ones in place (count <= i), then grow the array to hold
+        // the imported ones - avoids a second full copy of the data array
         count = 0;
         for (int i = 0; i < dat->set->size; i++) // iterate over old set size
         {
           if (OP_part_list[set->index]->elem_part[i] == my_rank) {
-            memcpy(&new_dat[count * dat->size],
-                   (void *)&dat->data[dat->size * i], dat->size);
+            if (count != i)
+              memmove(&dat->data[count * dat->size],
+                      (void *)&dat->data[dat->size * i], dat->size);
             count++;
           }
         }
 
-        memcpy(&new_dat[count * dat->size], (void *)rbuf,
+        dat->data =
+            (char *)xrealloc(dat->data, dat->size * (count + imp->size));
+        memcpy(&dat->data[count * dat->size], (void *)rbuf,
                dat->size * imp->size);
-        count = count + imp->size;
-        new_dat = (char *)xrealloc(new_dat, dat->size * count);
         op_free(rbuf);
-
-        op_free(dat->data);
-        dat->data = new_dat;
       }
     }
 
@@ -1164,29 +1158,25 @@ static void migrate_all(int my_rank, int comm_size) {
           op_free(sbuf[i]);
         op_free(sbuf);
 
-        // delete the mapping table entirs that has been sent and create a
-        // modified mapping table
-        int *new_map =
-            (int *)xmalloc(sizeof(int) * (set->size + imp->size) * map->dim);
-
+        // delete the mapping table entirs that has been sent by compacting
+        // the retained ones in place, then grow the table for the imports
         count = 0;
         for (int i = 0; i < map->from->size; i++) { // iterate over old size
                                                     // of the maping table
           if (OP_part_list[map->from->index]->elem_part[i] == my_rank) {
-            memcpy(&new_map[count * map->dim],
-                   (void *)&OP_map_list[map->index]->map[map->dim * i],
-                   map->dim * sizeof(int));
+            if (count != i)
+              memmove(&map->map[count * map->dim],
+                      (void *)&map->map[map->dim * i],
+                      map->dim * sizeof(int));
             count++;
           }
         }
-        memcpy(&new_map[count * map->dim], (void *)rbuf,
+        map->map = (int *)xrealloc(map->map, sizeof(int) * map->dim *
+                                                 (count + imp->size));
+        memcpy(&map->map[count * map->dim], (void *)rbuf,
                map->dim * sizeof(int) * imp->size);
-        count = count + imp->size;
-        new_map = (int *)xrealloc(new_map, sizeof(int) * count * map->dim);
 
         op_free(rbuf);
-        op_free(OP_map_list[map->index]->map);
-        OP_map_list[map->index]->map = new_map;
       }
     }
 
@@ -3512,6 +3502,838 @@ void op_partition_inertial(op_dat x_dat) {
     printf("Max total inertial partitioning time = %lf\n", max_time);
 }
 
+/*******************************************************************************
+ * Built-in partitioners - no third-party library needed
+ *
+ * RCB/RIB bisect the ranks and the coordinates together: every element carries
+ * the first part of the range of parts it may still end up in, and all ranges
+ * are split at the same time, so a level costs a few reductions of length
+ * comm_size. KWAY gathers the prime map onto the root and runs a serial
+ * multilevel k-way partitioner (heavy-edge matching, greedy graph growing,
+ * greedy boundary refinement) there.
+ *******************************************************************************/
+
+typedef struct {
+  int n;       // number of vertices
+  int *xadj;   // CSR row pointers
+  int *adjncy; // CSR neighbours
+  int *adjwgt; // edge weights
+  int *vwgt;   // vertex weights
+  int *cmap;   // vertex -> vertex of the next coarser graph
+} builtin_graph;
+
+static void builtin_graph_free(builtin_graph *g) {
+  op_free(g->xadj);
+  op_free(g->adjncy);
+  op_free(g->adjwgt);
+  op_free(g->vwgt);
+  op_free(g->cmap);
+  op_free(g);
+}
+
+// gather n rows of dim ints from every rank onto the root, in rank order
+static int *builtin_gather(int *local, int n, int dim, int *total, int my_rank,
+                           int comm_size) {
+  int *counts = (int *)xmalloc(comm_size * sizeof(int));
+  int *disps = (int *)xmalloc(comm_size * sizeof(int));
+  int *global = NULL;
+  int ln = n * dim;
+  MPI_Gather(&ln, 1, MPI_INT, counts, 1, MPI_INT, MPI_ROOT, OP_PART_WORLD);
+  *total = 0;
+  if (my_rank == MPI_ROOT) {
+    for (int r = 0; r < comm_size; r++) {
+      disps[r] = *total;
+      *total += counts[r];
+    }
+    global = (int *)xmalloc((*total + 1) * sizeof(int));
+  }
+  MPI_Gatherv(local, ln, MPI_INT, global, counts, disps, MPI_INT, MPI_ROOT,
+              OP_PART_WORLD);
+  *total = dim > 0 ? *total / dim : 0;
+  op_free(counts);
+  op_free(disps);
+  return global;
+}
+
+// print edge cut and imbalance of a gathered partition vector (root only)
+static void builtin_report(const char *routine, int *where, int n, int *map,
+                           int nfrom, int dim, int nparts) {
+  int *pwgt = (int *)xmalloc(nparts * sizeof(int));
+  for (int p = 0; p < nparts; p++)
+    pwgt[p] = 0;
+  for (int i = 0; i < n; i++)
+    pwgt[where[i]]++;
+  int max_pwgt = 0;
+  for (int p = 0; p < nparts; p++)
+    max_pwgt = MAX(max_pwgt, pwgt[p]);
+  op_free(pwgt);
+  double imbalance = n > 0 ? (double)max_pwgt * nparts / n : 1.0;
+
+  if (map == NULL) {
+    printf("BUILTIN %s partitioning: imbalance = %.3f\n", routine, imbalance);
+    return;
+  }
+
+  // a prime map element is cut if it points into more than one part
+  int cut = 0;
+  for (int e = 0; e < nfrom; e++) {
+    int p0 = -1;
+    for (int j = 0; j < dim; j++) {
+      int v = map[e * dim + j];
+      if (v < 0 || v >= n)
+        continue;
+      if (p0 < 0)
+        p0 = where[v];
+      else if (where[v] != p0) {
+        cut++;
+        break;
+      }
+    }
+  }
+  printf("BUILTIN %s partitioning: edge-cut = %d of %d, imbalance = %.3f\n",
+         routine, cut, nfrom, imbalance);
+}
+
+/*******************************************************************************
+ * Parallel recursive coordinate (or inertial) bisection of a coordinate dat
+ *******************************************************************************/
+
+void op_partition_builtin_rcb(op_dat coords, op_map prime_map, int inertial) {
+  // declare timers
+  double cpu_t1, cpu_t2, wall_t1, wall_t2;
+  double time;
+  double max_time;
+
+  op_timers(&cpu_t1, &wall_t1); // timer start for partitioning
+
+  // create new communicator for partitioning
+  int my_rank, comm_size;
+  MPI_Comm_dup(OP_MPI_WORLD, &OP_PART_WORLD);
+  MPI_Comm_rank(OP_PART_WORLD, &my_rank);
+  MPI_Comm_size(OP_PART_WORLD, &comm_size);
+
+  /*--STEP 0 - initialise partitioning data stauctures with the current (block)
+    partitioning information */
+
+  // Compute global partition range information for each set
+  int **part_range = (int **)xmalloc(OP_set_index * sizeof(int *));
+  get_part_range(part_range, my_rank, comm_size, OP_PART_WORLD);
+
+  // save the original part_range for future partition reversing
+  orig_part_range = (int **)xmalloc(OP_set_index * sizeof(int *));
+  for (int s = 0; s < OP_set_index; s++) {
+    op_set set = OP_set_list[s];
+    orig_part_range[set->index] = (int *)xmalloc(2 * comm_size * sizeof(int));
+    for (int j = 0; j < comm_size; j++) {
+      orig_part_range[set->index][2 * j] = part_range[set->index][2 * j];
+      orig_part_range[set->index][2 * j + 1] =
+          part_range[set->index][2 * j + 1];
+    }
+  }
+
+  // allocate memory for list
+  OP_part_list = (part *)xmalloc(OP_set_index * sizeof(part));
+
+  for (int s = 0; s < OP_set_index; s++) { // for each set
+    op_set set = OP_set_list[s];
+    int *g_index = (int *)xmalloc(sizeof(int) * set->size);
+    for (int i = 0; i < set->size; i++)
+      g_index[i] =
+          get_global_index(i, my_rank, part_range[set->index], comm_size);
+    decl_partition(set, g_index, NULL);
+  }
+
+  /*-----STEP 1 - Bisect all groups of parts level by level ------------------*/
+
+  op_set set = coords->set;
+  int n = set->size;
+  int dim = coords->dim;
+  double *x = (double *)coords->data;
+
+  // elements of group g end up in parts [g, g + width[g]); width is the same
+  // on every rank as all ranks split the same groups
+  int *partition = (int *)xmalloc(sizeof(int) * (n + 1));
+  int *width = (int *)xmalloc(comm_size * sizeof(int));
+  int *nlow = (int *)xmalloc(comm_size * sizeof(int));
+  for (int i = 0; i < n; i++)
+    partition[i] = 0;
+  for (int g = 0; g < comm_size; g++)
+    width[g] = 0;
+  width[0] = comm_size;
+
+  double *sum = (double *)xmalloc(comm_size * (dim + 1) * sizeof(double));
+  double *gsum = (double *)xmalloc(comm_size * (dim + 1) * sizeof(double));
+  double *mom = (double *)xmalloc(comm_size * dim * dim * sizeof(double));
+  double *gmom = (double *)xmalloc(comm_size * dim * dim * sizeof(double));
+  double *dir = (double *)xmalloc(comm_size * dim * sizeof(double));
+  double *range = (double *)xmalloc(comm_size * 2 * sizeof(double));
+  double *grange = (double *)xmalloc(comm_size * 2 * sizeof(double));
+  double *t = (double *)xmalloc(comm_size * sizeof(double));
+  double *a = (double *)xmalloc(comm_size * sizeof(double));
+  double *b = (double *)xmalloc(comm_size * sizeof(double));
+  double *target = (double *)xmalloc(comm_size * sizeof(double));
+  int *below = (int *)xmalloc(comm_size * sizeof(int));
+  int *gbelow = (int *)xmalloc(comm_size * sizeof(int));
+  double *proj = (double *)xmalloc((n + 1) * sizeof(double));
+  double *p = (double *)xmalloc(dim * sizeof(double));
+
+  int active = comm_size > 1;
+  while (active) {
+    for (int g = 0; g < comm_size; g++)
+      nlow[g] = width[g] / 2;
+
+    // centre of gravity of each group
+    for (int k = 0; k < comm_size * (dim + 1); k++)
+      sum[k] = 0.0;
+    for (int i = 0; i < n; i++) {
+      double *s = &sum[partition[i] * (dim + 1)];
+      s[dim] += 1.0;
+      for (int d = 0; d < dim; d++)
+        s[d] += x[i * dim + d];
+    }
+    MPI_Allreduce(sum, gsum, comm_size * (dim + 1), MPI_DOUBLE, MPI_SUM,
+                  OP_PART_WORLD);
+    for (int g = 0; g < comm_size; g++) {
+      double *s = &gsum[g * (dim + 1)];
+      for (int d = 0; d < dim; d++)
+        s[d] = s[dim] > 0.0 ? s[d] / s[dim] : 0.0;
+    }
+
+    // second moments: the diagonal picks the coordinate axis for RCB, the
+    // full matrix gives the principal axis for RIB
+    for (int k = 0; k < comm_size * dim * dim; k++)
+      mom[k] = 0.0;
+    for (int i = 0; i < n; i++) {
+      int g = partition[i];
+      double *c = &gsum[g * (dim + 1)];
+      double *m = &mom[g * dim * dim];
+      for (int d = 0; d < dim; d++)
+        for (int e = inertial ? 0 : d; e <= d; e++)
+          m[d * dim + e] += (x[i * dim + d] - c[d]) * (x[i * dim + e] - c[e]);
+    }
+    MPI_Allreduce(mom, gmom, comm_size * dim * dim, MPI_DOUBLE, MPI_SUM,
+                  OP_PART_WORLD);
+    for (int g = 0; g < comm_size; g++) {
+      if (width[g] < 2)
+        continue;
+      double *m = &gmom[g * dim * dim];
+      double *q = &dir[g * dim];
+      int axis = 0;
+      for (int d = 0; d < dim; d++) {
+        q[d] = 0.0;
+        if (m[d * dim + d] > m[axis * dim + axis])
+          axis = d;
+      }
+      q[axis] = 1.0;
+      if (!inertial)
+        continue;
+      for (int d = 0; d < dim; d++)
+        for (int e = d + 1; e < dim; e++)
+          m[d * dim + e] = m[e * dim + d];
+      // power iteration for the dominant eigenvector of the inertia matrix
+      for (int iter = 0; iter < 100; iter++) {
+        double norm = 0.0;
+        for (int d = 0; d < dim; d++) {
+          p[d] = 0.0;
+          for (int e = 0; e < dim; e++)
+            p[d] += m[d * dim + e] * q[e];
+          norm += p[d] * p[d];
+        }
+        if (norm == 0.0)
+          break;
+        norm = 1.0 / sqrt(norm);
+        double err = 0.0;
+        for (int d = 0; d < dim; d++) {
+          err += (p[d] * norm - q[d]) * (p[d] * norm - q[d]);
+          q[d] = p[d] * norm;
+        }
+        if (err < 1e-18)
+          break;
+      }
+    }
+
+    // project onto the splitting direction and find the range per group
+    for (int g = 0; g < comm_size; g++) {
+      range[2 * g] = DBL_MAX;
+      range[2 * g + 1] = DBL_MAX;
+    }
+    for (int i = 0; i < n; i++) {
+      int g = partition[i];
+      if (width[g] < 2)
+        continue;
+      proj[i] = 0.0;
+      for (int d = 0; d < dim; d++)
+        proj[i] += x[i * dim + d] * dir[g * dim + d];
+      range[2 * g] = MIN(range[2 * g], proj[i]);
+      range[2 * g + 1] = MIN(range[2 * g + 1], -proj[i]);
+    }
+    MPI_Allreduce(range, grange, comm_size * 2, MPI_DOUBLE, MPI_MIN,
+                  OP_PART_WORLD);
+
+    // bisect for the split value that puts nlow/width of the group below it
+    int nsplit = 0;
+    for (int g = 0; g < comm_size; g++) {
+      t[g] = 0.0;
+      if (width[g] < 2 || gsum[g * (dim + 1) + dim] == 0.0)
+        continue;
+      a[g] = grange[2 * g];
+      b[g] = -grange[2 * g + 1];
+      t[g] = b[g];
+      target[g] = floor(gsum[g * (dim + 1) + dim] * nlow[g] / width[g] + 0.5);
+      nsplit++;
+    }
+    for (int iter = 0; iter < 64 && nsplit > 0; iter++) {
+      for (int g = 0; g < comm_size; g++) {
+        below[g] = 0;
+        if (width[g] > 1 && a[g] < b[g])
+          t[g] = 0.5 * (a[g] + b[g]);
+      }
+      for (int i = 0; i < n; i++)
+        if (width[partition[i]] > 1 && proj[i] < t[partition[i]])
+          below[partition[i]]++;
+      MPI_Allreduce(below, gbelow, comm_size, MPI_INT, MPI_SUM, OP_PART_WORLD);
+      nsplit = 0;
+      for (int g = 0; g < comm_size; g++) {
+        if (width[g] < 2 || !(a[g] < b[g]))
+          continue;
+        if (gbelow[g] == (int)target[g])
+          a[g] = b[g] = t[g]; // exact split found, stop bisecting
+        else if (gbelow[g] < target[g])
+          a[g] = t[g];
+        else
+          b[g] = t[g];
+        nsplit += a[g] < b[g];
+      }
+    }
+
+    // split the groups
+    for (int i = 0; i < n; i++) {
+      int g = partition[i];
+      if (width[g] > 1 && proj[i] >= t[g])
+        partition[i] = g + nlow[g];
+    }
+    active = 0;
+    for (int g = comm_size - 1; g >= 0; g--) {
+      if (width[g] < 2)
+        continue;
+      width[g + nlow[g]] = width[g] - nlow[g];
+      width[g] = nlow[g];
+      active |= width[g] > 1 || width[g + nlow[g]] > 1;
+    }
+  }
+
+  op_free(width);
+  op_free(nlow);
+  op_free(sum);
+  op_free(gsum);
+  op_free(mom);
+  op_free(gmom);
+  op_free(dir);
+  op_free(range);
+  op_free(grange);
+  op_free(t);
+  op_free(a);
+  op_free(b);
+  op_free(target);
+  op_free(below);
+  op_free(gbelow);
+  op_free(proj);
+  op_free(p);
+
+  // initialise primary set as partitioned
+  OP_part_list[set->index]->elem_part = partition;
+  OP_part_list[set->index]->is_partitioned = 1;
+
+  // free part range
+  for (int i = 0; i < OP_set_index; i++)
+    op_free(part_range[i]);
+  op_free(part_range);
+
+  /*-STEP 2 - Partition all other sets,migrate data and renumber mapping
+   * tables-*/
+
+  // partition all other sets
+  partition_all(set, my_rank, comm_size);
+
+  // report the quality of the partitioning over the prime map's to-set,
+  // which partition_all has derived when it is not the coordinates' set;
+  // the map still holds global indices in the original block order
+  op_set rset = prime_map != NULL ? prime_map->to : set;
+  int ntotal, nfrom = 0;
+  int *gpart = builtin_gather(OP_part_list[rset->index]->elem_part, rset->size,
+                              1, &ntotal, my_rank, comm_size);
+  int *gmap = NULL;
+  if (prime_map != NULL)
+    gmap = builtin_gather(prime_map->map, prime_map->from->size,
+                          prime_map->dim, &nfrom, my_rank, comm_size);
+  if (my_rank == MPI_ROOT)
+    builtin_report(inertial ? "RIB" : "RCB", gpart, ntotal, gmap, nfrom,
+                   gmap != NULL ? prime_map->dim : 0, comm_size);
+  op_free(gpart);
+  op_free(gmap);
+
+  // migrate data, sort elements
+  migrate_all(my_rank, comm_size);
+
+  // renumber mapping tables
+  renumber_maps(my_rank, comm_size);
+
+  op_timers(&cpu_t2, &wall_t2); // timer stop for partitioning
+  // printf time for partitioning
+  time = wall_t2 - wall_t1;
+  MPI_Reduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_ROOT, OP_PART_WORLD);
+  MPI_Comm_free(&OP_PART_WORLD);
+  if (my_rank == MPI_ROOT)
+    printf("Max total builtin %s partitioning time = %lf\n",
+           inertial ? "RIB" : "RCB", max_time);
+}
+
+/*******************************************************************************
+ * Serial multilevel k-way graph partitioner used by the BUILTIN KWAY routine
+ *******************************************************************************/
+
+// graph of the to-set of a map: elements sharing a from-element are adjacent,
+// with the edge weight counting the shared from-elements
+static builtin_graph *builtin_graph_from_map(int *map, int nfrom, int dim,
+                                             int n) {
+  int *xinc = (int *)xmalloc((n + 1) * sizeof(int));
+  for (int v = 0; v <= n; v++)
+    xinc[v] = 0;
+  for (int k = 0; k < nfrom * dim; k++)
+    if (map[k] >= 0 && map[k] < n)
+      xinc[map[k] + 1]++;
+  for (int v = 0; v < n; v++)
+    xinc[v + 1] += xinc[v];
+  int *inc = (int *)xmalloc((xinc[n] + 1) * sizeof(int));
+  int *fill = (int *)xmalloc((n + 1) * sizeof(int));
+  memcpy(fill, xinc, n * sizeof(int));
+  for (int k = 0; k < nfrom * dim; k++)
+    if (map[k] >= 0 && map[k] < n)
+      inc[fill[map[k]]++] = k / dim;
+
+  builtin_graph *g = (builtin_graph *)xmalloc(sizeof(builtin_graph));
+  size_t cap = (size_t)xinc[n] * (dim - 1) + 1;
+  g->n = n;
+  g->xadj = (int *)xmalloc((n + 1) * sizeof(int));
+  g->adjncy = (int *)xmalloc(cap * sizeof(int));
+  g->adjwgt = (int *)xmalloc(cap * sizeof(int));
+  g->vwgt = (int *)xmalloc((n + 1) * sizeof(int));
+  g->cmap = NULL;
+
+  // fill[] now records the slot of each neighbour of the current vertex
+  int *mark = (int *)xmalloc((n + 1) * sizeof(int));
+  for (int v = 0; v < n; v++)
+    mark[v] = -1;
+  int count = 0;
+  for (int v = 0; v < n; v++) {
+    g->xadj[v] = count;
+    g->vwgt[v] = 1;
+    for (int k = xinc[v]; k < xinc[v + 1]; k++) {
+      for (int j = 0; j < dim; j++) {
+        int u = map[inc[k] * dim + j];
+        if (u < 0 || u >= n || u == v)
+          continue;
+        if (mark[u] != v) {
+          mark[u] = v;
+          fill[u] = count;
+          g->adjncy[count] = u;
+          g->adjwgt[count++] = 1;
+        } else {
+          g->adjwgt[fill[u]]++;
+        }
+      }
+    }
+  }
+  g->xadj[n] = count;
+  op_free(xinc);
+  op_free(inc);
+  op_free(fill);
+  op_free(mark);
+  return g;
+}
+
+// coarsen by heavy-edge matching, visiting the vertices in random order
+static builtin_graph *builtin_coarsen(builtin_graph *g, int maxvwgt,
+                                      unsigned int *seed) {
+  int n = g->n;
+  int *perm = (int *)xmalloc((n + 1) * sizeof(int));
+  int *match = (int *)xmalloc((n + 1) * sizeof(int));
+  for (int v = 0; v < n; v++) {
+    perm[v] = v;
+    match[v] = -1;
+  }
+  for (int v = n - 1; v > 0; v--) {
+    *seed = *seed * 1103515245u + 12345u;
+    int k = (int)((*seed >> 8) % (unsigned int)(v + 1));
+    int tmp = perm[v];
+    perm[v] = perm[k];
+    perm[k] = tmp;
+  }
+
+  g->cmap = (int *)xmalloc((n + 1) * sizeof(int));
+  int *leader = (int *)xmalloc((n + 1) * sizeof(int));
+  int nc = 0;
+  for (int k = 0; k < n; k++) {
+    int v = perm[k];
+    if (match[v] != -1)
+      continue;
+    int best = v, best_wgt = -1;
+    for (int j = g->xadj[v]; j < g->xadj[v + 1]; j++) {
+      int u = g->adjncy[j];
+      if (match[u] == -1 && g->adjwgt[j] > best_wgt &&
+          g->vwgt[v] + g->vwgt[u] <= maxvwgt) {
+        best = u;
+        best_wgt = g->adjwgt[j];
+      }
+    }
+    match[v] = best;
+    match[best] = v;
+    g->cmap[v] = g->cmap[best] = nc;
+    leader[nc++] = v;
+  }
+
+  builtin_graph *c = (builtin_graph *)xmalloc(sizeof(builtin_graph));
+  c->n = nc;
+  c->xadj = (int *)xmalloc((nc + 1) * sizeof(int));
+  c->adjncy = (int *)xmalloc((g->xadj[n] + 1) * sizeof(int));
+  c->adjwgt = (int *)xmalloc((g->xadj[n] + 1) * sizeof(int));
+  c->vwgt = (int *)xmalloc((nc + 1) * sizeof(int));
+  c->cmap = NULL;
+
+  int *mark = perm; // reuse as a coarse vertex -> slot table
+  for (int v = 0; v < nc; v++)
+    mark[v] = -1;
+  int count = 0;
+  for (int cv = 0; cv < nc; cv++) {
+    int v = leader[cv];
+    int start = count;
+    c->xadj[cv] = count;
+    c->vwgt[cv] = g->vwgt[v] + (match[v] != v ? g->vwgt[match[v]] : 0);
+    for (int s = 0; s < 2; s++) {
+      int w = s == 0 ? v : match[v];
+      if (s == 1 && w == v)
+        break;
+      for (int j = g->xadj[w]; j < g->xadj[w + 1]; j++) {
+        int cu = g->cmap[g->adjncy[j]];
+        if (cu == cv)
+          continue;
+        if (mark[cu] < start) {
+          mark[cu] = count;
+          c->adjncy[count] = cu;
+          c->adjwgt[count++] = g->adjwgt[j];
+        } else {
+          c->adjwgt[mark[cu]] += g->adjwgt[j];
+        }
+      }
+    }
+  }
+  c->xadj[nc] = count;
+  op_free(perm);
+  op_free(match);
+  op_free(leader);
+  return c;
+}
+
+// initial partitioning of the coarsest graph by greedy graph growing: each
+// part starts from a pseudo-peripheral free vertex and repeatedly takes the
+// frontier vertex most strongly connected to it
+static void builtin_grow(builtin_graph *g, int nparts, int *where, int start) {
+  int n = g->n;
+  int *queue = (int *)xmalloc((n + 1) * sizeof(int));
+  int *frontier = (int *)xmalloc((n + 1) * sizeof(int));
+  int *conn = (int *)xmalloc((n + 1) * sizeof(int));
+  double remaining = 0.0;
+  for (int v = 0; v < n; v++) {
+    where[v] = -1;
+    conn[v] = -1; // -1 : not on the frontier
+    remaining += g->vwgt[v];
+  }
+  int scan = 0;
+  for (int p = 0; p < nparts; p++) {
+    if (p == nparts - 1) {
+      for (int v = 0; v < n; v++)
+        if (where[v] == -1)
+          where[v] = p;
+      break;
+    }
+    double target = remaining / (nparts - p);
+    double pwgt = 0.0;
+    int nfrontier = 0;
+    while (pwgt < target) {
+      if (nfrontier == 0) {
+        while (scan < n && where[(start + scan) % n] != -1)
+          scan++;
+        if (scan == n)
+          break;
+        int first = (start + scan) % n;
+        // the last free vertex reached by a BFS is far from the others
+        int head = 0, tail = 0;
+        queue[tail++] = first;
+        where[first] = -2;
+        while (head < tail) {
+          int v = queue[head++];
+          for (int j = g->xadj[v]; j < g->xadj[v + 1]; j++)
+            if (where[g->adjncy[j]] == -1) {
+              where[g->adjncy[j]] = -2;
+              queue[tail++] = g->adjncy[j];
+            }
+        }
+        for (int k = 0; k < tail; k++)
+          where[queue[k]] = -1;
+        frontier[nfrontier++] = queue[tail - 1];
+        conn[queue[tail - 1]] = 0;
+      }
+      int best = 0;
+      for (int k = 1; k < nfrontier; k++)
+        if (conn[frontier[k]] > conn[frontier[best]])
+          best = k;
+      int v = frontier[best];
+      frontier[best] = frontier[--nfrontier];
+      conn[v] = -1;
+      where[v] = p;
+      pwgt += g->vwgt[v];
+      for (int j = g->xadj[v]; j < g->xadj[v + 1]; j++) {
+        int u = g->adjncy[j];
+        if (where[u] != -1)
+          continue;
+        if (conn[u] < 0) {
+          conn[u] = 0;
+          frontier[nfrontier++] = u;
+        }
+        conn[u] += g->adjwgt[j];
+      }
+    }
+    for (int k = 0; k < nfrontier; k++)
+      conn[frontier[k]] = -1;
+    remaining -= pwgt;
+  }
+  op_free(queue);
+  op_free(frontier);
+  op_free(conn);
+}
+
+// greedy boundary refinement: move vertices to the neighbouring part that
+// most reduces the cut, or that relieves an overweight part
+static void builtin_refine(builtin_graph *g, int nparts, int *where,
+                           int maxpwgt) {
+  int n = g->n;
+  int *pwgt = (int *)xmalloc(nparts * sizeof(int));
+  int *conn = (int *)xmalloc(nparts * sizeof(int));
+  int *touched = (int *)xmalloc(nparts * sizeof(int));
+  for (int p = 0; p < nparts; p++) {
+    pwgt[p] = 0;
+    conn[p] = 0;
+  }
+  for (int v = 0; v < n; v++)
+    pwgt[where[v]] += g->vwgt[v];
+
+  for (int pass = 0; pass < 8; pass++) {
+    int moved = 0;
+    for (int v = 0; v < n; v++) {
+      int from = where[v], ntouched = 0;
+      for (int j = g->xadj[v]; j < g->xadj[v + 1]; j++) {
+        int p = where[g->adjncy[j]];
+        if (conn[p] == 0)
+          touched[ntouched++] = p;
+        conn[p] += g->adjwgt[j];
+      }
+      int to = from, best_gain = 0;
+      for (int k = 0; k < ntouched; k++) {
+        int p = touched[k];
+        if (p == from || pwgt[p] + g->vwgt[v] > maxpwgt)
+          continue;
+        int gain = conn[p] - conn[from];
+        if (to == from || gain > best_gain ||
+            (gain == best_gain && pwgt[p] < pwgt[to])) {
+          to = p;
+          best_gain = gain;
+        }
+      }
+      if (to != from &&
+          (best_gain > 0 || pwgt[from] > maxpwgt ||
+           (best_gain == 0 && pwgt[to] + g->vwgt[v] < pwgt[from]))) {
+        where[v] = to;
+        pwgt[from] -= g->vwgt[v];
+        pwgt[to] += g->vwgt[v];
+        moved++;
+      }
+      for (int k = 0; k < ntouched; k++)
+        conn[touched[k]] = 0;
+    }
+    if (moved == 0)
+      break;
+  }
+  op_free(pwgt);
+  op_free(conn);
+  op_free(touched);
+}
+
+static void builtin_kway(builtin_graph *graph, int nparts, int *where) {
+  builtin_graph *levels[64];
+  int nlevels = 1;
+  levels[0] = graph;
+  int maxpwgt = (int)ceil(1.03 * graph->n / nparts);
+  int coarsen_to = MAX(20 * nparts, 100);
+  unsigned int seed = 4321u;
+
+  while (levels[nlevels - 1]->n > coarsen_to && nlevels < 64) {
+    builtin_graph *g = levels[nlevels - 1];
+    builtin_graph *c =
+        builtin_coarsen(g, MAX(1, (int)(1.5 * graph->n / coarsen_to)), &seed);
+    levels[nlevels++] = c;
+    if (c->n > 0.95 * g->n) // matching no longer shrinks the graph
+      break;
+  }
+
+  builtin_graph *coarsest = levels[nlevels - 1];
+  int *cwhere = (int *)xmalloc((coarsest->n + 1) * sizeof(int));
+  int *trial = (int *)xmalloc((coarsest->n + 1) * sizeof(int));
+  int best_cut = -1;
+  for (int t = 0; t < 4; t++) { // keep the best of a few growing trials
+    builtin_grow(coarsest, nparts, trial, (int)((long)t * coarsest->n / 4));
+    builtin_refine(coarsest, nparts, trial, maxpwgt);
+    int cut = 0;
+    for (int v = 0; v < coarsest->n; v++)
+      for (int j = coarsest->xadj[v]; j < coarsest->xadj[v + 1]; j++)
+        if (trial[coarsest->adjncy[j]] != trial[v])
+          cut += coarsest->adjwgt[j];
+    if (best_cut < 0 || cut < best_cut) {
+      best_cut = cut;
+      memcpy(cwhere, trial, coarsest->n * sizeof(int));
+    }
+  }
+  op_free(trial);
+
+  for (int l = nlevels - 2; l >= 0; l--) {
+    builtin_graph *g = levels[l];
+    int *fwhere = l == 0 ? where : (int *)xmalloc((g->n + 1) * sizeof(int));
+    for (int v = 0; v < g->n; v++)
+      fwhere[v] = cwhere[g->cmap[v]];
+    op_free(cwhere);
+    builtin_graph_free(levels[l + 1]);
+    builtin_refine(g, nparts, fwhere, maxpwgt);
+    cwhere = fwhere;
+  }
+  if (nlevels == 1) {
+    memcpy(where, cwhere, graph->n * sizeof(int));
+    op_free(cwhere);
+  }
+}
+
+/*******************************************************************************
+ * Multilevel k-way partitioning of the to-set of a primary map
+ *******************************************************************************/
+
+void op_partition_builtin_kway(op_map primary_map) {
+  // declare timers
+  double cpu_t1, cpu_t2, wall_t1, wall_t2;
+  double time;
+  double max_time;
+
+  op_timers(&cpu_t1, &wall_t1); // timer start for partitioning
+
+  // create new communicator for partitioning
+  int my_rank, comm_size;
+  MPI_Comm_dup(OP_MPI_WORLD, &OP_PART_WORLD);
+  MPI_Comm_rank(OP_PART_WORLD, &my_rank);
+  MPI_Comm_size(OP_PART_WORLD, &comm_size);
+
+  /*--STEP 0 - initialise partitioning data stauctures with the current (block)
+    partitioning information */
+
+  // Compute global partition range information for each set
+  int **part_range = (int **)xmalloc(OP_set_index * sizeof(int *));
+  get_part_range(part_range, my_rank, comm_size, OP_PART_WORLD);
+
+  // save the original part_range for future partition reversing
+  orig_part_range = (int **)xmalloc(OP_set_index * sizeof(int *));
+  for (int s = 0; s < OP_set_index; s++) {
+    op_set set = OP_set_list[s];
+    orig_part_range[set->index] = (int *)xmalloc(2 * comm_size * sizeof(int));
+    for (int j = 0; j < comm_size; j++) {
+      orig_part_range[set->index][2 * j] = part_range[set->index][2 * j];
+      orig_part_range[set->index][2 * j + 1] =
+          part_range[set->index][2 * j + 1];
+    }
+  }
+
+  // allocate memory for list
+  OP_part_list = (part *)xmalloc(OP_set_index * sizeof(part));
+
+  for (int s = 0; s < OP_set_index; s++) { // for each set
+    op_set set = OP_set_list[s];
+    int *g_index = (int *)xmalloc(sizeof(int) * set->size);
+    for (int i = 0; i < set->size; i++)
+      g_index[i] =
+          get_global_index(i, my_rank, part_range[set->index], comm_size);
+    decl_partition(set, g_index, NULL);
+  }
+
+  /*--STEP 1 - Gather the primary map on the root and partition its graph ---*/
+
+  op_set to_set = primary_map->to;
+  int *range = part_range[to_set->index];
+  int nfrom;
+  int *gmap = builtin_gather(primary_map->map, primary_map->from->size,
+                             primary_map->dim, &nfrom, my_rank, comm_size);
+
+  int *counts = (int *)xmalloc(comm_size * sizeof(int));
+  int *disps = (int *)xmalloc(comm_size * sizeof(int));
+  for (int r = 0; r < comm_size; r++) {
+    disps[r] = range[2 * r];
+    counts[r] = range[2 * r + 1] - range[2 * r] + 1;
+  }
+  int ntotal = range[2 * (comm_size - 1) + 1] + 1;
+
+  int *gpart = NULL;
+  if (my_rank == MPI_ROOT) {
+    gpart = (int *)xmalloc((ntotal + 1) * sizeof(int));
+    builtin_graph *graph =
+        builtin_graph_from_map(gmap, nfrom, primary_map->dim, ntotal);
+    builtin_kway(graph, comm_size, gpart);
+    builtin_graph_free(graph);
+    builtin_report("KWAY", gpart, ntotal, gmap, nfrom, primary_map->dim,
+                   comm_size);
+  }
+  op_free(gmap);
+
+  int *partition = (int *)xmalloc(sizeof(int) * (to_set->size + 1));
+  MPI_Scatterv(gpart, counts, disps, MPI_INT, partition, to_set->size,
+               MPI_INT, MPI_ROOT, OP_PART_WORLD);
+  op_free(gpart);
+  op_free(counts);
+  op_free(disps);
+
+  // initialise primary set as partitioned
+  OP_part_list[to_set->index]->elem_part = partition;
+  OP_part_list[to_set->index]->is_partitioned = 1;
+
+  // free part range
+  for (int i = 0; i < OP_set_index; i++)
+    op_free(part_range[i]);
+  op_free(part_range);
+
+  /*-STEP 2 - Partition all other sets,migrate data and renumber mapping
+   * tables-*/
+
+  // partition all other sets
+  partition_all(to_set, my_rank, comm_size);
+
+  // migrate data, sort elements
+  migrate_all(my_rank, comm_size);
+
+  // renumber mapping tables
+  renumber_maps(my_rank, comm_size);
+
+  op_timers(&cpu_t2, &wall_t2); // timer stop for partitioning
+  // printf time for partitioning
+  time = wall_t2 - wall_t1;
+  MPI_Reduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_ROOT, OP_PART_WORLD);
+  MPI_Comm_free(&OP_PART_WORLD);
+  if (my_rank == MPI_ROOT)
+    printf("Max total builtin KWAY partitioning time = %lf\n", max_time);
+}
+
 /*******************************************************************************
 * Toplevel partitioning selection function - also triggers halo creation
 *******************************************************************************/
@@ -3674,6 +4496,35 @@ void partition(const char *lib_name, const char *lib_routine, op_set prime_set,
       op_printf("Reverting to trivial block partitioning\n");
       partial_halo_flag = 0;
     }
+  } else if (strcmp(lib_name, "BUILTIN") == 0) {
+    op_printf("Selected Partitioning Library : %s\n", lib_name);
+    if (strcmp(lib_routine, "RCB") == 0 || strcmp(lib_routine, "RIB") == 0) {
+      op_printf("Selected Partitioning Routine : %s\n", lib_routine);
+      if (data != NULL && data->data != NULL &&
+          strncmp(data->type, "double", 6) == 0)
+        op_partition_builtin_rcb(data, prime_map,
+                                 strcmp(lib_routine, "RIB") == 0);
+      else {
+        op_printf("Partitioning coordinates: NULL or not double - "
+                  "UNSUPPORTED Partitioner Specification\n");
+        op_printf("Reverting to trivial block partitioning\n");
+        partial_halo_flag = 0;
+      }
+    } else if (strcmp(lib_routine, "KWAY") == 0) {
+      op_printf("Selected Partitioning Routine : %s\n", lib_routine);
+      if (prime_map != NULL)
+        op_partition_builtin_kway(prime_map);
+      else {
+        op_printf("Partitioning prime_map : NULL - UNSUPPORTED Partitioner "
+                  "Specification\n");
+        op_printf("Reverting to trivial block partitioning\n");
+        partial_halo_flag = 0;
+      }
+    } else {
+      op_printf("Partitioning Routine : %s UNSUPPORTED\n", lib_routine);
+      op_printf("Reverting to trivial block partitioning\n");
+      partial_halo_flag = 0;
+    }
   } else {
     op_printf("Partitioning Library : %s UNSUPPORTED\n", lib_name);
     op_printf("Ignoring input routine : %s\n", lib_routine);
@@ -3701,6 +4552,9 @@ void partition(const char *lib_name, const char *lib_routine, op_set prime_set,
       OP_map_partial_exchange[i] = 0;
   }
 
+  if (OP_halo_shm)
+    op_halo_shm_create();
+
 #ifdef DEBUG // sanity check to identify if the partitioning results in ophan
              // elements
   int ctr = 0;
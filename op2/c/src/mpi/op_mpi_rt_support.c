@@ -41,6 +41,9 @@
 
 // mpi header
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <op_lib_c.h>
 #include <op_lib_core.h>
@@ -54,6 +57,426 @@ void op_upload_dat(op_dat dat) {}
 
 void op_download_dat(op_dat dat) {}
 
+/*******************************************************************************
+ * Halo pack/unpack kernels
+ *
+ * The common element sizes get their own loop so that the per-element memcpy
+ * has a constant size and compiles to plain (vector) loads and stores instead
+ * of a library call. Long lists are split across OpenMP threads when the
+ * library is built with OpenMP and the call is not already inside a parallel
+ * region.
+ *******************************************************************************/
+
+#define OP_HALO_PACK_OMP_MIN 4096
+
+static int op_halo_pack_threaded(int n) {
+#ifdef _OPENMP
+  return n >= OP_HALO_PACK_OMP_MIN && omp_get_max_threads() > 1 &&
+         !omp_in_parallel();
+#else
+  return 0;
+#endif
+}
+
+#ifdef _OPENMP
+#define OP_HALO_OMP_FOR _Pragma("omp parallel for if (threaded)")
+#else
+#define OP_HALO_OMP_FOR
+#endif
+
+#define OP_HALO_GATHER_LOOP(S)                                                 \
+  OP_HALO_OMP_FOR for (int i = 0; i < n; i++)                                  \
+      memcpy(&dst[(size_t)i * (S)], &src[(size_t)list[i] * (S)], (S))
+
+#define OP_HALO_SCATTER_LOOP(S)                                                \
+  OP_HALO_OMP_FOR for (int i = 0; i < n; i++)                                  \
+      memcpy(&dst[(size_t)list[i] * (S)], &src[(size_t)i * (S)], (S))
+
+// dst[i] = src[list[i]] for n elements of size bytes
+static void op_halo_gather(char *dst, const char *src, const int *list, int n,
+                           int size) {
+  int threaded = op_halo_pack_threaded(n);
+  (void)threaded;
+  switch (size) {
+  case 4:
+    OP_HALO_GATHER_LOOP(4);
+    break;
+  case 8:
+    OP_HALO_GATHER_LOOP(8);
+    break;
+  case 16:
+    OP_HALO_GATHER_LOOP(16);
+    break;
+  case 32:
+    OP_HALO_GATHER_LOOP(32);
+    break;
+  case 64:
+    OP_HALO_GATHER_LOOP(64);
+    break;
+  default:
+    OP_HALO_GATHER_LOOP(size);
+  }
+}
+
+// dst[list[i]] = src[i] for n elements of size bytes
+static void op_halo_scatter(char *dst, const char *src, const int *list, int n,
+                            int size) {
+  int threaded = op_halo_pack_threaded(n);
+  (void)threaded;
+  switch (size) {
+  case 4:
+    OP_HALO_SCATTER_LOOP(4);
+    break;
+  case 8:
+    OP_HALO_SCATTER_LOOP(8);
+    break;
+  case 16:
+    OP_HALO_SCATTER_LOOP(16);
+    break;
+  case 32:
+    OP_HALO_SCATTER_LOOP(32);
+    break;
+  case 64:
+    OP_HALO_SCATTER_LOOP(64);
+    break;
+  default:
+    OP_HALO_SCATTER_LOOP(size);
+  }
+}
+
+/*******************************************************************************
+ * Halo pack/unpack of SoA op_dats
+ *
+ * Halo messages always carry whole elements, one after the other, whatever the
+ * host layout of the op_dat. A dat stored component-major is packed and
+ * unpacked component by component, and receives straight into its halo use a
+ * strided datatype that spreads each incoming element over the components.
+ *******************************************************************************/
+
+static MPI_Datatype *soa_types = NULL;
+static int soa_num_types = 0;
+
+// dst[i] = element list[i] of dat for n elements
+static void op_dat_halo_gather(char *dst, op_dat dat, const int *list, int n) {
+  if (!dat->soa) {
+    op_halo_gather(dst, dat->data, list, n, dat->size);
+    return;
+  }
+  int stride = op_dat_soa_stride(dat);
+  int esz = dat->size / dat->dim;
+  int threaded = op_halo_pack_threaded(n);
+  (void)threaded;
+#ifdef _OPENMP
+#pragma omp parallel for if (threaded)
+#endif
+  for (int i = 0; i < n; i++)
+    for (int d = 0; d < dat->dim; d++)
+      memcpy(&dst[(size_t)i * dat->size + d * esz],
+             &dat->data[((size_t)d * stride + list[i]) * esz], esz);
+}
+
+// element list[i] of dat = src[i] for n elements
+static void op_dat_halo_scatter(op_dat dat, const char *src, const int *list,
+                                int n) {
+  if (!dat->soa) {
+    op_halo_scatter(dat->data, src, list, n, dat->size);
+    return;
+  }
+  int stride = op_dat_soa_stride(dat);
+  int esz = dat->size / dat->dim;
+  int threaded = op_halo_pack_threaded(n);
+  (void)threaded;
+#ifdef _OPENMP
+#pragma omp parallel for if (threaded)
+#endif
+  for (int i = 0; i < n; i++)
+    for (int d = 0; d < dat->dim; d++)
+      memcpy(&dat->data[((size_t)d * stride + list[i]) * esz],
+             &src[(size_t)i * dat->size + d * esz], esz);
+}
+
+// buffer, count and datatype receiving n elements of dat in place, starting
+// at element first
+static char *op_dat_halo_recv(op_dat dat, int first, int n, int *count,
+                              MPI_Datatype *type) {
+  if (!dat->soa) {
+    *count = n * dat->size;
+    *type = MPI_CHAR;
+    return &dat->data[(size_t)first * dat->size];
+  }
+
+  if (dat->index >= soa_num_types) {
+    soa_types = (MPI_Datatype *)op_realloc(
+        soa_types, (dat->index + 1) * sizeof(MPI_Datatype));
+    for (int i = soa_num_types; i <= dat->index; i++)
+      soa_types[i] = MPI_DATATYPE_NULL;
+    soa_num_types = dat->index + 1;
+  }
+  int esz = dat->size / dat->dim;
+  if (soa_types[dat->index] == MPI_DATATYPE_NULL) {
+    // one element: dim components of esz bytes, a component array apart,
+    // with the extent of one component so that element i + 1 follows i
+    MPI_Datatype elem;
+    MPI_Type_vector(dat->dim, esz, op_dat_soa_stride(dat) * esz, MPI_CHAR,
+                    &elem);
+    MPI_Type_create_resized(elem, 0, esz, &soa_types[dat->index]);
+    MPI_Type_commit(&soa_types[dat->index]);
+    MPI_Type_free(&elem);
+  }
+  *count = n;
+  *type = soa_types[dat->index];
+  return &dat->data[(size_t)first * esz];
+}
+
+static void op_dat_halo_irecv(op_dat dat, int first, int n, int rank,
+                              MPI_Request *req) {
+  int count;
+  MPI_Datatype type;
+  char *buf = op_dat_halo_recv(dat, first, n, &count, &type);
+  MPI_Irecv(buf, count, type, rank, dat->index, OP_MPI_WORLD, req);
+}
+
+void op_halo_soa_destroy() {
+  for (int i = 0; i < soa_num_types; i++)
+    if (soa_types[i] != MPI_DATATYPE_NULL)
+      MPI_Type_free(&soa_types[i]);
+  op_free(soa_types);
+  soa_types = NULL;
+  soa_num_types = 0;
+}
+
+/*******************************************************************************
+ * Persistent halo requests (OP_HALO_PERSISTENT)
+ *
+ * Neighbour lists and buffers of an op_dat do not change once the halos are
+ * built, so the sends and receives of each exchange are set up only once with
+ * MPI_Send_init/MPI_Recv_init, and each exchange just packs and starts them
+ * in the order op_exchange_halo would post them.
+ *******************************************************************************/
+
+static void op_persistent_send_init(op_mpi_persistent p, op_dat dat,
+                                    halo_list exp_list, char *buf) {
+  for (int i = 0; i < exp_list->ranks_size; i++)
+    MPI_Send_init(&buf[exp_list->disps[i] * dat->size],
+                  dat->size * exp_list->sizes[i], MPI_CHAR, exp_list->ranks[i],
+                  dat->index, OP_MPI_WORLD, &p->s_req[p->s_num_req++]);
+}
+
+static void op_persistent_recv_init(op_mpi_persistent p, op_dat dat,
+                                    halo_list imp_list, char *buf) {
+  for (int i = 0; i < imp_list->ranks_size; i++)
+    MPI_Recv_init(&buf[imp_list->disps[i] * dat->size],
+                  dat->size * imp_list->sizes[i], MPI_CHAR, imp_list->ranks[i],
+                  dat->index, OP_MPI_WORLD, &p->r_req[p->r_num_req++]);
+}
+
+static void op_persistent_recv_init_halo(op_mpi_persistent p, op_dat dat,
+                                         halo_list imp_list, int first) {
+  for (int i = 0; i < imp_list->ranks_size; i++) {
+    int count;
+    MPI_Datatype type;
+    char *buf = op_dat_halo_recv(dat, first + imp_list->disps[i],
+                                 imp_list->sizes[i], &count, &type);
+    MPI_Recv_init(buf, count, type, imp_list->ranks[i], dat->index,
+                  OP_MPI_WORLD, &p->r_req[p->r_num_req++]);
+  }
+}
+
+// persistent requests of the full exchange of dat (map == NULL) or of its
+// partial exchange over map, built on first use or when a buffer has moved
+static op_mpi_persistent op_persistent_requests(op_dat dat, op_map map) {
+  op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+  int slot = map == NULL ? 0 : 1 + map->index;
+
+  if (slot >= buf->num_persistent) {
+    buf->persistent = (op_mpi_persistent *)op_realloc(
+        buf->persistent, (slot + 1) * sizeof(op_mpi_persistent));
+    for (int i = buf->num_persistent; i <= slot; i++)
+      buf->persistent[i] = NULL;
+    buf->num_persistent = slot + 1;
+  }
+
+  op_mpi_persistent p = buf->persistent[slot];
+  if (p != NULL && p->data == dat->data && p->buf_exec == buf->buf_exec &&
+      p->buf_nonexec == buf->buf_nonexec)
+    return p;
+
+  if (p == NULL) {
+    p = (op_mpi_persistent)op_malloc(sizeof(op_mpi_persistent_core));
+    p->s_req = NULL;
+    p->r_req = NULL;
+    p->s_num_req = 0;
+    p->r_num_req = 0;
+    buf->persistent[slot] = p;
+  } else {
+    op_mpi_persistent_release(p);
+  }
+  p->data = dat->data;
+  p->buf_exec = buf->buf_exec;
+  p->buf_nonexec = buf->buf_nonexec;
+
+  if (map == NULL) {
+    halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
+    halo_list imp_nonexec_list = OP_import_nonexec_list[dat->set->index];
+    halo_list exp_exec_list = OP_export_exec_list[dat->set->index];
+    halo_list exp_nonexec_list = OP_export_nonexec_list[dat->set->index];
+
+    p->s_req = (MPI_Request *)op_malloc(
+        (exp_exec_list->ranks_size + exp_nonexec_list->ranks_size) *
+        sizeof(MPI_Request));
+    p->r_req = (MPI_Request *)op_malloc(
+        (imp_exec_list->ranks_size + imp_nonexec_list->ranks_size) *
+        sizeof(MPI_Request));
+
+    // same tags, message order and placement as op_exchange_halo, the
+    // requests are started in this order
+    op_persistent_send_init(p, dat, exp_exec_list, buf->buf_exec);
+    op_persistent_recv_init_halo(p, dat, imp_exec_list, dat->set->size);
+    op_persistent_send_init(p, dat, exp_nonexec_list, buf->buf_nonexec);
+    op_persistent_recv_init_halo(p, dat, imp_nonexec_list,
+                                 dat->set->size + imp_exec_list->size);
+  } else {
+    halo_list imp_nonexec_list = OP_import_nonexec_permap[map->index];
+    halo_list exp_nonexec_list = OP_export_nonexec_permap[map->index];
+
+    p->s_req = (MPI_Request *)op_malloc(exp_nonexec_list->ranks_size *
+                                        sizeof(MPI_Request));
+    p->r_req = (MPI_Request *)op_malloc(imp_nonexec_list->ranks_size *
+                                        sizeof(MPI_Request));
+
+    // same message order and placement as op_exchange_halo_partial
+    op_persistent_send_init(p, dat, exp_nonexec_list, buf->buf_nonexec);
+    op_persistent_recv_init(
+        p, dat, imp_nonexec_list,
+        &buf->buf_nonexec[exp_nonexec_list->size * dat->size]);
+  }
+  return p;
+}
+
+static void op_exchange_halo_persistent(op_dat dat, op_map map) {
+  op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+  op_mpi_persistent p = op_persistent_requests(dat, map);
+
+  if (map == NULL) {
+    halo_list exp_exec_list = OP_export_exec_list[dat->set->index];
+    op_dat_halo_gather(buf->buf_exec, dat, exp_exec_list->list,
+                       exp_exec_list->size);
+    halo_list exp_nonexec_list = OP_export_nonexec_list[dat->set->index];
+    op_dat_halo_gather(buf->buf_nonexec, dat, exp_nonexec_list->list,
+                       exp_nonexec_list->size);
+  } else {
+    halo_list exp_nonexec_list = OP_export_nonexec_permap[map->index];
+    op_dat_halo_gather(buf->buf_nonexec, dat, exp_nonexec_list->list,
+                       exp_nonexec_list->size);
+  }
+
+  // MPI_Startall may start the requests in any order, while the exec and
+  // nonexec messages to one neighbour share a tag and are told apart by
+  // their order alone
+  for (int i = 0; i < p->r_num_req; i++)
+    MPI_Start(&p->r_req[i]);
+  for (int i = 0; i < p->s_num_req; i++)
+    MPI_Start(&p->s_req[i]);
+  buf->p_in_flight = p;
+}
+
+/*******************************************************************************
+ * On-node halo exchange through shared memory (OP_HALO_SHM)
+ *
+ * The export buffers live in a shared window (see op_halo_shm_create). After
+ * packing, the exporter sends a zero-byte ready flag to each on-node importer,
+ * which then copies its elements straight out of the exporter's buffer in
+ * op_wait_all and answers with a zero-byte done flag, so that the exporter
+ * does not repack its buffer while it is still being read. The flags use tags
+ * 2 * dat->index (ready) and 2 * dat->index + 1 (done) on OP_MPI_NODE.
+ *******************************************************************************/
+
+static void op_exchange_halo_shm(op_dat dat) {
+  op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+  op_shm_set sh = OP_shm_set_list[dat->set->index];
+  halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
+  halo_list imp_nonexec_list = OP_import_nonexec_list[dat->set->index];
+  halo_list exp_exec_list = OP_export_exec_list[dat->set->index];
+  halo_list exp_nonexec_list = OP_export_nonexec_list[dat->set->index];
+
+  op_dat_halo_gather(buf->buf_exec, dat, exp_exec_list->list,
+                     exp_exec_list->size);
+  op_dat_halo_gather(buf->buf_nonexec, dat, exp_nonexec_list->list,
+                     exp_nonexec_list->size);
+  MPI_Win_sync(buf->shm_win);
+
+  // off-node neighbours, as in op_exchange_halo
+  for (int i = 0; i < exp_exec_list->ranks_size; i++)
+    if (sh->exp_exec_node[i] < 0)
+      MPI_Isend(&buf->buf_exec[exp_exec_list->disps[i] * dat->size],
+                dat->size * exp_exec_list->sizes[i], MPI_CHAR,
+                exp_exec_list->ranks[i], dat->index, OP_MPI_WORLD,
+                &buf->s_req[buf->s_num_req++]);
+  int init = dat->set->size;
+  for (int i = 0; i < imp_exec_list->ranks_size; i++)
+    if (sh->imp_exec_node[i] < 0)
+      op_dat_halo_irecv(dat, init + imp_exec_list->disps[i],
+                        imp_exec_list->sizes[i], imp_exec_list->ranks[i],
+                        &buf->r_req[buf->r_num_req++]);
+  for (int i = 0; i < exp_nonexec_list->ranks_size; i++)
+    if (sh->exp_nonexec_node[i] < 0)
+      MPI_Isend(&buf->buf_nonexec[exp_nonexec_list->disps[i] * dat->size],
+                dat->size * exp_nonexec_list->sizes[i], MPI_CHAR,
+                exp_nonexec_list->ranks[i], dat->index, OP_MPI_WORLD,
+                &buf->s_req[buf->s_num_req++]);
+  int nonexec_init = dat->set->size + imp_exec_list->size;
+  for (int i = 0; i < imp_nonexec_list->ranks_size; i++)
+    if (sh->imp_nonexec_node[i] < 0)
+      op_dat_halo_irecv(dat, nonexec_init + imp_nonexec_list->disps[i],
+                        imp_nonexec_list->sizes[i], imp_nonexec_list->ranks[i],
+                        &buf->r_req[buf->r_num_req++]);
+
+  // on-node neighbours only exchange flags
+  for (int k = 0; k < sh->num_exp; k++) {
+    MPI_Isend(NULL, 0, MPI_CHAR, sh->exp_nodes[k], 2 * dat->index,
+              OP_MPI_NODE, &buf->s_req[buf->s_num_req++]);
+    MPI_Irecv(NULL, 0, MPI_CHAR, sh->exp_nodes[k], 2 * dat->index + 1,
+              OP_MPI_NODE, &buf->d_r_req[k]);
+  }
+  for (int k = 0; k < sh->num_imp; k++)
+    MPI_Irecv(NULL, 0, MPI_CHAR, sh->imp_nodes[k], 2 * dat->index,
+              OP_MPI_NODE, &buf->r_req[buf->r_num_req++]);
+  buf->shm_in_flight = 1;
+}
+
+// called once the ready flags have arrived
+static void op_wait_all_shm(op_dat dat) {
+  op_mpi_buffer buf = (op_mpi_buffer)(dat->mpi_buffer);
+  op_shm_set sh = OP_shm_set_list[dat->set->index];
+  halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
+  halo_list imp_nonexec_list = OP_import_nonexec_list[dat->set->index];
+
+  MPI_Win_sync(buf->shm_win);
+  for (int i = 0; i < imp_exec_list->ranks_size; i++) {
+    int node = sh->imp_exec_node[i];
+    if (node >= 0)
+      op_dat_put_aos(dat,
+                     &buf->shm_base[node][sh->imp_exec_offset[i] * dat->size],
+                     dat->set->size + imp_exec_list->disps[i],
+                     imp_exec_list->sizes[i]);
+  }
+  for (int i = 0; i < imp_nonexec_list->ranks_size; i++) {
+    int node = sh->imp_nonexec_node[i];
+    if (node >= 0)
+      op_dat_put_aos(
+          dat, &buf->shm_base[node][sh->imp_nonexec_offset[i] * dat->size],
+          dat->set->size + imp_exec_list->size + imp_nonexec_list->disps[i],
+          imp_nonexec_list->sizes[i]);
+  }
+
+  for (int k = 0; k < sh->num_imp; k++)
+    MPI_Isend(NULL, 0, MPI_CHAR, sh->imp_nodes[k], 2 * dat->index + 1,
+              OP_MPI_NODE, &buf->d_s_req[k]);
+  MPI_Waitall(sh->num_imp, buf->d_s_req, MPI_STATUSES_IGNORE);
+  MPI_Waitall(sh->num_exp, buf->d_r_req, MPI_STATUSES_IGNORE);
+  buf->shm_in_flight = 0;
+}
+
 /*******************************************************************************
  * Main MPI Halo Exchange Function
  *******************************************************************************/
@@ -84,6 +507,18 @@ void op_exchange_halo(op_arg *arg, int exec_flag) {
   if ((arg->acc == OP_READ ||
        arg->acc == OP_RW /* good for debug || arg->acc == OP_INC*/) &&
       (dat->dirtybit == 1)) {
+    if (((op_mpi_buffer)(dat->mpi_buffer))->shm_win != MPI_WIN_NULL) {
+      op_exchange_halo_shm(dat);
+      dat->dirtybit = 0;
+      arg->sent = 1;
+      return;
+    }
+    if (OP_halo_persistent) {
+      op_exchange_halo_persistent(dat, NULL);
+      dat->dirtybit = 0;
+      arg->sent = 1;
+      return;
+    }
     //    printf("Exchanging Halo of data array %10s\n",dat->name);
     halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
     halo_list imp_nonexec_list = OP_import_nonexec_list[dat->set->index];
@@ -103,15 +538,9 @@ void op_exchange_halo(op_arg *arg, int exec_flag) {
       MPI_Abort(OP_MPI_WORLD, 2);
     }
 
-    int set_elem_index;
+    op_dat_halo_gather(((op_mpi_buffer)(dat->mpi_buffer))->buf_exec, dat,
+                       exp_exec_list->list, exp_exec_list->size);
     for (int i = 0; i < exp_exec_list->ranks_size; i++) {
-      for (int j = 0; j < exp_exec_list->sizes[i]; j++) {
-        set_elem_index = exp_exec_list->list[exp_exec_list->disps[i] + j];
-        memcpy(&((op_mpi_buffer)(dat->mpi_buffer))
-                    ->buf_exec[exp_exec_list->disps[i] * dat->size +
-                               j * dat->size],
-               (void *)&dat->data[dat->size * (set_elem_index)], dat->size);
-      }
       //      printf("export exec from %d to %d data %10s, number of elements of
       //      size %d | sending:\n ",
       //             my_rank, exp_exec_list->ranks[i],
@@ -124,17 +553,17 @@ void op_exchange_halo(op_arg *arg, int exec_flag) {
                      ->s_req[((op_mpi_buffer)(dat->mpi_buffer))->s_num_req++]);
     }
 
-    int init = dat->set->size * dat->size;
+    int init = dat->set->size;
     for (int i = 0; i < imp_exec_list->ranks_size; i++) {
       //      printf("import exec on to %d from %d data %10s, number of elements
       //      of size %d | recieving:\n ",
       //           my_rank, imp_exec_list->ranks[i], dat->name,
       //           imp_exec_list->sizes[i]);
-      MPI_Irecv(&(dat->data[init + imp_exec_list->disps[i] * dat->size]),
-                dat->size * imp_exec_list->sizes[i], MPI_CHAR,
-                imp_exec_list->ranks[i], dat->index, OP_MPI_WORLD,
-                &((op_mpi_buffer)(dat->mpi_buffer))
-                     ->r_req[((op_mpi_buffer)(dat->mpi_buffer))->r_num_req++]);
+      op_dat_halo_irecv(
+          dat, init + imp_exec_list->disps[i], imp_exec_list->sizes[i],
+          imp_exec_list->ranks[i],
+          &((op_mpi_buffer)(dat->mpi_buffer))
+               ->r_req[((op_mpi_buffer)(dat->mpi_buffer))->r_num_req++]);
     }
 
     //-----second exchange nonexec elements related to this data array------
@@ -150,14 +579,9 @@ void op_exchange_halo(op_arg *arg, int exec_flag) {
 
     int rank;
     MPI_Comm_rank(OP_MPI_WORLD, &rank);
+    op_dat_halo_gather(((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec, dat,
+                       exp_nonexec_list->list, exp_nonexec_list->size);
     for (int i = 0; i < exp_nonexec_list->ranks_size; i++) {
-      for (int j = 0; j < exp_nonexec_list->sizes[i]; j++) {
-        set_elem_index = exp_nonexec_list->list[exp_nonexec_list->disps[i] + j];
-        memcpy(&((op_mpi_buffer)(dat->mpi_buffer))
-                    ->buf_nonexec[exp_nonexec_list->disps[i] * dat->size +
-                                  j * dat->size],
-               (void *)&dat->data[dat->size * (set_elem_index)], dat->size);
-      }
       //      printf("export from %d to %d data %10s, number of elements of size
       //      %d | sending:\n ",
       //                my_rank, exp_nonexec_list->ranks[i],
@@ -170,16 +594,15 @@ void op_exchange_halo(op_arg *arg, int exec_flag) {
                      ->s_req[((op_mpi_buffer)(dat->mpi_buffer))->s_num_req++]);
     }
 
-    int nonexec_init = (dat->set->size + imp_exec_list->size) * dat->size;
+    int nonexec_init = dat->set->size + imp_exec_list->size;
     for (int i = 0; i < imp_nonexec_list->ranks_size; i++) {
       //      printf("import on to %d from %d data %10s, number of elements of
       //      size %d | recieving:\n ",
       //            my_rank, imp_nonexec_list->ranks[i], dat->name,
       //            imp_nonexec_list->sizes[i]);
-      MPI_Irecv(
-          &(dat->data[nonexec_init + imp_nonexec_list->disps[i] * dat->size]),
-          dat->size * imp_nonexec_list->sizes[i], MPI_CHAR,
-          imp_nonexec_list->ranks[i], dat->index, OP_MPI_WORLD,
+      op_dat_halo_irecv(
+          dat, nonexec_init + imp_nonexec_list->disps[i],
+          imp_nonexec_list->sizes[i], imp_nonexec_list->ranks[i],
           &((op_mpi_buffer)(dat->mpi_buffer))
                ->r_req[((op_mpi_buffer)(dat->mpi_buffer))->r_num_req++]);
     }
@@ -206,6 +629,11 @@ void op_exchange_halo_partial(op_arg *arg, int exec_flag) {
   if ((arg->acc == OP_READ ||
        arg->acc == OP_RW /* good for debug || arg->acc == OP_INC*/) &&
       (dat->dirtybit == 1)) {
+    if (OP_halo_persistent) {
+      op_exchange_halo_persistent(dat, arg->map);
+      arg->sent = 1;
+      return;
+    }
     halo_list imp_nonexec_list = OP_import_nonexec_permap[arg->map->index];
     halo_list exp_nonexec_list = OP_export_nonexec_permap[arg->map->index];
     //-------exchange nonexec elements related to this data array and
@@ -221,15 +649,9 @@ void op_exchange_halo_partial(op_arg *arg, int exec_flag) {
       MPI_Abort(OP_MPI_WORLD, 2);
     }
 
-    int set_elem_index;
+    op_dat_halo_gather(((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec, dat,
+                       exp_nonexec_list->list, exp_nonexec_list->size);
     for (int i = 0; i < exp_nonexec_list->ranks_size; i++) {
-      for (int j = 0; j < exp_nonexec_list->sizes[i]; j++) {
-        set_elem_index = exp_nonexec_list->list[exp_nonexec_list->disps[i] + j];
-        memcpy(&((op_mpi_buffer)(dat->mpi_buffer))
-                    ->buf_nonexec[exp_nonexec_list->disps[i] * dat->size +
-                                  j * dat->size],
-               (void *)&dat->data[dat->size * (set_elem_index)], dat->size);
-      }
       MPI_Isend(&((op_mpi_buffer)(dat->mpi_buffer))
                      ->buf_nonexec[exp_nonexec_list->disps[i] * dat->size],
                 dat->size * exp_nonexec_list->sizes[i], MPI_CHAR,
@@ -255,6 +677,247 @@ void op_exchange_halo_partial(op_arg *arg, int exec_flag) {
   }
 }
 
+/*******************************************************************************
+ * Aggregated halo exchange (OP_HALO_AGGREGATE)
+ *
+ * The dats of a loop are registered one by one with op_exchange_halo_aggregate
+ * and op_exchange_halo_aggregate_post then packs all of them, exec and nonexec
+ * parts alike, into a single buffer per neighbouring rank, so only one
+ * Isend/Irecv pair is posted per neighbour. Every rank registers the same
+ * segments in the same order (the loop and its args are the same everywhere),
+ * which is what allows the receiver to unpack its buffer in the order the
+ * sender packed it.
+ *******************************************************************************/
+
+#define OP_HALO_AGGREGATE_TAG 32767
+
+typedef struct {
+  op_arg *arg;
+  halo_list exp_list;
+  halo_list imp_list;
+  // first halo element the import list is received into, or -1 to scatter
+  // through imp_list->list (partial exchanges)
+  int imp_base;
+} op_halo_segment;
+
+static op_halo_segment *agg_segs = NULL;
+static int agg_num_segs = 0, agg_max_segs = 0;
+
+static int *agg_ranks = NULL, *agg_send_disps = NULL, *agg_recv_disps = NULL;
+static int agg_num_ranks = 0, agg_max_ranks = 0;
+static MPI_Request *agg_s_req = NULL, *agg_r_req = NULL;
+static int agg_s_num_req = 0, agg_r_num_req = 0;
+
+static char *agg_send_buf = NULL, *agg_recv_buf = NULL;
+static size_t agg_send_cap = 0, agg_recv_cap = 0;
+static int agg_in_flight = 0;
+
+static void op_halo_aggregate_add_segment(op_arg *arg, halo_list exp_list,
+                                          halo_list imp_list, int imp_base) {
+  if (compare_sets(imp_list->set, arg->dat->set) == 0) {
+    printf("Error: Import list and set mismatch\n");
+    MPI_Abort(OP_MPI_WORLD, 2);
+  }
+  if (compare_sets(exp_list->set, arg->dat->set) == 0) {
+    printf("Error: Export list and set mismatch\n");
+    MPI_Abort(OP_MPI_WORLD, 2);
+  }
+  if (agg_num_segs == agg_max_segs) {
+    agg_max_segs = agg_max_segs == 0 ? 16 : 2 * agg_max_segs;
+    agg_segs = (op_halo_segment *)op_realloc(
+        agg_segs, agg_max_segs * sizeof(op_halo_segment));
+  }
+  op_halo_segment *seg = &agg_segs[agg_num_segs++];
+  seg->arg = arg;
+  seg->exp_list = exp_list;
+  seg->imp_list = imp_list;
+  seg->imp_base = imp_base;
+}
+
+// slot of a neighbouring rank in agg_ranks, appending it if not yet present
+static int op_halo_aggregate_slot(int rank) {
+  for (int k = 0; k < agg_num_ranks; k++)
+    if (agg_ranks[k] == rank)
+      return k;
+  if (agg_num_ranks == agg_max_ranks) {
+    agg_max_ranks = agg_max_ranks == 0 ? 16 : 2 * agg_max_ranks;
+    agg_ranks = (int *)op_realloc(agg_ranks, agg_max_ranks * sizeof(int));
+    agg_send_disps =
+        (int *)op_realloc(agg_send_disps, (agg_max_ranks + 1) * sizeof(int));
+    agg_recv_disps =
+        (int *)op_realloc(agg_recv_disps, (agg_max_ranks + 1) * sizeof(int));
+    agg_s_req = (MPI_Request *)op_realloc(agg_s_req,
+                                          agg_max_ranks * sizeof(MPI_Request));
+    agg_r_req = (MPI_Request *)op_realloc(agg_r_req,
+                                          agg_max_ranks * sizeof(MPI_Request));
+  }
+  agg_ranks[agg_num_ranks] = rank;
+  return agg_num_ranks++;
+}
+
+void op_exchange_halo_aggregate(op_arg *arg, int exec_flag, int partial) {
+  op_dat dat = arg->dat;
+
+  if (arg->opt == 0)
+    return;
+
+  if (arg->sent == 1) {
+    printf("Error: Halo exchange already in flight for dat %s\n", dat->name);
+    fflush(stdout);
+    MPI_Abort(OP_MPI_WORLD, 2);
+  }
+  if (!partial && exec_flag == 0 && arg->idx == -1)
+    return;
+
+  arg->sent = 0; // reset flag
+
+  if ((arg->acc == OP_READ || arg->acc == OP_RW) && (dat->dirtybit == 1)) {
+    if (partial) {
+      op_halo_aggregate_add_segment(
+          arg, OP_export_nonexec_permap[arg->map->index],
+          OP_import_nonexec_permap[arg->map->index], -1);
+    } else {
+      halo_list imp_exec_list = OP_import_exec_list[dat->set->index];
+      op_halo_aggregate_add_segment(arg, OP_export_exec_list[dat->set->index],
+                                    imp_exec_list, dat->set->size);
+      op_halo_aggregate_add_segment(
+          arg, OP_export_nonexec_list[dat->set->index],
+          OP_import_nonexec_list[dat->set->index],
+          dat->set->size + imp_exec_list->size);
+      // clear dirty bit
+      dat->dirtybit = 0;
+    }
+    arg->sent = 1;
+  }
+}
+
+void op_exchange_halo_aggregate_post() {
+  if (agg_num_segs == 0)
+    return;
+
+  // per-neighbour message sizes in bytes
+  agg_num_ranks = 0;
+  for (int s = 0; s < agg_num_segs; s++) {
+    halo_list exp_list = agg_segs[s].exp_list;
+    halo_list imp_list = agg_segs[s].imp_list;
+    for (int i = 0; i < exp_list->ranks_size; i++)
+      op_halo_aggregate_slot(exp_list->ranks[i]);
+    for (int i = 0; i < imp_list->ranks_size; i++)
+      op_halo_aggregate_slot(imp_list->ranks[i]);
+  }
+  agg_in_flight = 1;
+  agg_s_num_req = agg_r_num_req = 0;
+  if (agg_num_ranks == 0)
+    return;
+  for (int k = 0; k <= agg_num_ranks; k++) {
+    agg_send_disps[k] = 0;
+    agg_recv_disps[k] = 0;
+  }
+  for (int s = 0; s < agg_num_segs; s++) {
+    halo_list exp_list = agg_segs[s].exp_list;
+    halo_list imp_list = agg_segs[s].imp_list;
+    int size = agg_segs[s].arg->dat->size;
+    for (int i = 0; i < exp_list->ranks_size; i++)
+      agg_send_disps[op_halo_aggregate_slot(exp_list->ranks[i]) + 1] +=
+          exp_list->sizes[i] * size;
+    for (int i = 0; i < imp_list->ranks_size; i++)
+      agg_recv_disps[op_halo_aggregate_slot(imp_list->ranks[i]) + 1] +=
+          imp_list->sizes[i] * size;
+  }
+  for (int k = 0; k < agg_num_ranks; k++) {
+    agg_send_disps[k + 1] += agg_send_disps[k];
+    agg_recv_disps[k + 1] += agg_recv_disps[k];
+  }
+  if ((size_t)agg_send_disps[agg_num_ranks] > agg_send_cap) {
+    agg_send_cap = agg_send_disps[agg_num_ranks];
+    agg_send_buf = (char *)op_realloc(agg_send_buf, agg_send_cap);
+  }
+  if ((size_t)agg_recv_disps[agg_num_ranks] > agg_recv_cap) {
+    agg_recv_cap = agg_recv_disps[agg_num_ranks];
+    agg_recv_buf = (char *)op_realloc(agg_recv_buf, agg_recv_cap);
+  }
+
+  // post the receives first, then pack segment by segment and send
+  for (int k = 0; k < agg_num_ranks; k++) {
+    int bytes = agg_recv_disps[k + 1] - agg_recv_disps[k];
+    if (bytes > 0)
+      MPI_Irecv(&agg_recv_buf[agg_recv_disps[k]], bytes, MPI_CHAR,
+                agg_ranks[k], OP_HALO_AGGREGATE_TAG, OP_MPI_WORLD,
+                &agg_r_req[agg_r_num_req++]);
+  }
+
+  for (int s = 0; s < agg_num_segs; s++) {
+    op_dat dat = agg_segs[s].arg->dat;
+    halo_list exp_list = agg_segs[s].exp_list;
+    for (int i = 0; i < exp_list->ranks_size; i++) {
+      int k = op_halo_aggregate_slot(exp_list->ranks[i]);
+      op_dat_halo_gather(&agg_send_buf[agg_send_disps[k]], dat,
+                         &exp_list->list[exp_list->disps[i]],
+                         exp_list->sizes[i]);
+      // once packed, agg_send_disps[k] holds the end of slot k
+      agg_send_disps[k] += exp_list->sizes[i] * dat->size;
+    }
+  }
+
+  for (int k = 0; k < agg_num_ranks; k++) {
+    int start = k == 0 ? 0 : agg_send_disps[k - 1];
+    int bytes = agg_send_disps[k] - start;
+    if (bytes > 0)
+      MPI_Isend(&agg_send_buf[start], bytes, MPI_CHAR, agg_ranks[k],
+                OP_HALO_AGGREGATE_TAG, OP_MPI_WORLD,
+                &agg_s_req[agg_s_num_req++]);
+  }
+}
+
+void op_wait_all_aggregate() {
+  if (!agg_in_flight)
+    return;
+
+  MPI_Waitall(agg_r_num_req, agg_r_req, MPI_STATUSES_IGNORE);
+
+  // unpack in the same segment order the neighbours packed in
+  for (int s = 0; s < agg_num_segs; s++) {
+    op_dat dat = agg_segs[s].arg->dat;
+    halo_list imp_list = agg_segs[s].imp_list;
+    int imp_base = agg_segs[s].imp_base;
+    for (int i = 0; i < imp_list->ranks_size; i++) {
+      int k = op_halo_aggregate_slot(imp_list->ranks[i]);
+      char *buf = &agg_recv_buf[agg_recv_disps[k]];
+      if (imp_base >= 0) {
+        op_dat_put_aos(dat, buf, imp_base + imp_list->disps[i],
+                       imp_list->sizes[i]);
+      } else {
+        op_dat_halo_scatter(dat, buf, &imp_list->list[imp_list->disps[i]],
+                            imp_list->sizes[i]);
+      }
+      agg_recv_disps[k] += imp_list->sizes[i] * dat->size;
+    }
+    agg_segs[s].arg->sent = 2; // set flag to indicate completed comm
+  }
+
+  MPI_Waitall(agg_s_num_req, agg_s_req, MPI_STATUSES_IGNORE);
+  agg_num_segs = 0;
+  agg_in_flight = 0;
+}
+
+void op_halo_aggregate_destroy() {
+  op_free(agg_segs);
+  op_free(agg_ranks);
+  op_free(agg_send_disps);
+  op_free(agg_recv_disps);
+  op_free(agg_s_req);
+  op_free(agg_r_req);
+  op_free(agg_send_buf);
+  op_free(agg_recv_buf);
+  agg_segs = NULL;
+  agg_ranks = agg_send_disps = agg_recv_disps = NULL;
+  agg_s_req = agg_r_req = NULL;
+  agg_send_buf = agg_recv_buf = NULL;
+  agg_num_segs = agg_max_segs = agg_num_ranks = agg_max_ranks = 0;
+  agg_send_cap = agg_recv_cap = 0;
+  agg_in_flight = 0;
+}
+
 void op_exchange_halo_cuda(op_arg *arg, int exec_flag) {}
 
 void op_exchange_halo_partial_cuda(op_arg *arg, int exec_flag) {}
@@ -272,6 +935,14 @@ void op_wait_all(op_arg *arg) {
                 ((op_mpi_buffer)(dat->mpi_buffer))->r_req, MPI_STATUSES_IGNORE);
     ((op_mpi_buffer)(dat->mpi_buffer))->s_num_req = 0;
     ((op_mpi_buffer)(dat->mpi_buffer))->r_num_req = 0;
+    op_mpi_persistent p = ((op_mpi_buffer)(dat->mpi_buffer))->p_in_flight;
+    if (p != NULL) {
+      MPI_Waitall(p->s_num_req, p->s_req, MPI_STATUSES_IGNORE);
+      MPI_Waitall(p->r_num_req, p->r_req, MPI_STATUSES_IGNORE);
+      ((op_mpi_buffer)(dat->mpi_buffer))->p_in_flight = NULL;
+    }
+    if (((op_mpi_buffer)(dat->mpi_buffer))->shm_in_flight)
+      op_wait_all_shm(dat);
     arg->sent = 2; // set flag to indicate completed comm
     if (arg->map != OP_ID && OP_map_partial_exchange[arg->map->index]) {
       int my_rank;
@@ -280,11 +951,8 @@ void op_wait_all(op_arg *arg) {
       int init = OP_export_nonexec_permap[arg->map->index]->size;
       char *buffer =
           &((op_mpi_buffer)(dat->mpi_buffer))->buf_nonexec[init * dat->size];
-      for (int i = 0; i < imp_nonexec_list->size; i++) {
-        int set_elem_index = imp_nonexec_list->list[i];
-        memcpy((void *)&dat->data[dat->size * (set_elem_index)],
-               &buffer[i * dat->size], dat->size);
-      }
+      op_dat_halo_scatter(dat, buffer, imp_nonexec_list->list,
+                          imp_nonexec_list->size);
     }
   }
 }
@@ -294,6 +962,22 @@ void op_wait_all_cuda(op_arg *arg) {}
 void op_partition(const char *lib_name, const char *lib_routine,
                   op_set prime_set, op_map prime_map, op_dat coords) {
   partition(lib_name, lib_routine, prime_set, prime_map, coords);
+
+  // SoA dats go component-major once their halos are in place, and with
+  // OP_NUMA the migrated dats and maps move to first-touched pages
+  op_dat_entry *item;
+  TAILQ_FOREACH(item, &OP_dat_list, entries) {
+    if (op_dat_soa_type(item->dat))
+      op_dat_set_soa(item->dat, 1);
+    else if (OP_numa)
+      op_dat_numa_place(item->dat);
+  }
+  if (OP_numa) {
+    for (int m = 0; m < OP_map_index; m++) {
+      op_set from = OP_map_list[m]->from;
+      op_map_numa_place(OP_map_list[m], from->size + from->exec_size);
+    }
+  }
 }
 
 void op_move_to_device() {}
@@ -65,7 +65,23 @@ void op_mpi_init_soa(int argc, char **argv, int diags, int global, int local,
 
 op_dat op_decl_dat_char(op_set set, int dim, char const *type, int size,
                         char *data, char const *name) {
-  return op_decl_dat_core(set, dim, type, size, data, name);
+  op_dat dat = op_decl_dat_core(set, dim, type, size, data, name);
+  if (op_dat_soa_type(dat))
+    op_dat_set_soa(dat, 1);
+  else if (OP_numa)
+    op_dat_numa_place(dat);
+  return dat;
+}
+
+op_dat op_decl_dat_adopt_char(op_set set, int dim, char const *type, int size,
+                              char *data, char const *name) {
+  op_dat dat = op_decl_dat_core(set, dim, type, size, data, name);
+  dat->user_managed = 0;
+  if (op_dat_soa_type(dat))
+    op_dat_set_soa(dat, 1);
+  else if (OP_numa)
+    op_dat_numa_place(dat);
+  return dat;
 }
 
 op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
@@ -73,19 +89,24 @@ op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
   char *data = NULL;
   op_dat dat = op_decl_dat_temp_core(set, dim, type, size, data, name);
 
-  dat->data =
-      (char *)calloc(set->size * dim * size, 1); // initialize data bits to 0
+  dat->soa = op_dat_soa_type(dat) && dim > 1; // zeroes need no transpose
+  // initialize data bits to 0, recycling a pooled block if there is one
+  void *mpi_buffer;
+  dat->data = op_temp_pool_alloc(dat, set->size, &mpi_buffer);
   dat->user_managed = 0;
   return dat;
 }
 
-int op_free_dat_temp_char(op_dat dat) { return op_free_dat_temp_core(dat); }
+int op_free_dat_temp_char(op_dat dat) {
+  op_temp_pool_release(dat, dat->set->size, NULL);
+  return op_free_dat_temp_core(dat);
+}
 
 void op_upload_all() {}
 
 void op_fetch_data_char(op_dat dat, char *usr_ptr) {
   // need to copy data into memory pointed to by usr_ptr
-  memcpy((void *)usr_ptr, (void *)dat->data, dat->set->size * dat->size);
+  op_dat_get_aos(dat, usr_ptr, 0, dat->set->size);
 }
 
 void op_fetch_data_idx_char(op_dat dat, char *usr_ptr, int low, int high) {
@@ -95,8 +116,7 @@ void op_fetch_data_idx_char(op_dat dat, char *usr_ptr, int low, int high) {
     exit(2);
   }
   // need to copy data into memory pointed to by usr_ptr
-  memcpy((void *)usr_ptr, (void *)&dat->data[low * dat->size],
-         (high + 1) * dat->size);
+  op_dat_get_aos(dat, usr_ptr, low, high - low + 1);
 }
 
 /*
@@ -157,7 +177,19 @@ op_set op_decl_set(int size, char const *name) {
 
 op_map op_decl_map(op_set from, op_set to, int dim, int *imap,
                    char const *name) {
-  return op_decl_map_core(from, to, dim, imap, name);
+  op_map map = op_decl_map_core(from, to, dim, imap, name);
+  if (OP_numa)
+    op_map_numa_place(map, from->size);
+  return map;
+}
+
+op_map op_decl_map_adopt(op_set from, op_set to, int dim, int *imap,
+                         char const *name) {
+  op_map map = op_decl_map_core(from, to, dim, imap, name);
+  map->user_managed = 0;
+  if (OP_numa)
+    op_map_numa_place(map, from->size);
+  return map;
 }
 
 op_arg op_arg_dat(op_dat dat, int idx, op_map map, int dim, char const *type,
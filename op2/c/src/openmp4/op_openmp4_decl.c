@@ -71,6 +71,13 @@ op_dat op_decl_dat_char(op_set set, int dim, char const *type, int size,
 }
 
 
+op_dat op_decl_dat_adopt_char(op_set set, int dim, char const *type, int size,
+                              char *data, char const *name) {
+  op_dat dat = op_decl_dat_char(set, dim, type, size, data, name);
+  dat->user_managed = 0;
+  return dat;
+}
+
 op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
                              char const *name) {
   char *data = NULL;
@@ -131,6 +138,13 @@ op_map op_decl_map(op_set from, op_set to, int dim, int *imap,
   return map;
 }
 
+op_map op_decl_map_adopt(op_set from, op_set to, int dim, int *imap,
+                         char const *name) {
+  op_map map = op_decl_map(from, to, dim, imap, name);
+  map->user_managed = 0;
+  return map;
+}
+
 op_arg op_arg_dat(op_dat dat, int idx, op_map map, int dim, char const *type,
                   op_access acc) {
   return op_arg_dat_core(dat, idx, map, dim, type, acc);
@@ -165,6 +179,12 @@ int getSetSizeFromOpArg(op_arg *arg) {
 
 void op_renumber(op_map base) { (void)base; }
 
+void op_renumber_method(op_map base, char const *method, op_dat coords) {
+  (void)base;
+  (void)method;
+  (void)coords;
+}
+
 int getHybridGPU() { return OP_hybrid_gpu; }
 
 void op_exit() {
@@ -66,20 +66,45 @@ op_map op_decl_map(op_set from, op_set to, int dim, int *imap,
   return op_decl_map_core(from, to, dim, imap, name);
 }
 
+op_map op_decl_map_adopt(op_set from, op_set to, int dim, int *imap,
+                         char const *name) {
+  op_map map = op_decl_map_core(from, to, dim, imap, name);
+  map->user_managed = 0;
+  return map;
+}
+
 op_dat op_decl_dat_char(op_set set, int dim, char const *type, int size,
                         char *data, char const *name) {
-  return op_decl_dat_core(set, dim, type, size, data, name);
+  op_dat dat = op_decl_dat_core(set, dim, type, size, data, name);
+  if (op_dat_soa_type(dat))
+    op_dat_set_soa(dat, 1);
+  return dat;
+}
+
+op_dat op_decl_dat_adopt_char(op_set set, int dim, char const *type, int size,
+                              char *data, char const *name) {
+  op_dat dat = op_decl_dat_core(set, dim, type, size, data, name);
+  dat->user_managed = 0;
+  if (op_dat_soa_type(dat))
+    op_dat_set_soa(dat, 1);
+  return dat;
 }
 
-int op_free_dat_temp_char(op_dat dat) { return op_free_dat_temp_core(dat); }
+int op_free_dat_temp_char(op_dat dat) {
+  op_flush();
+  op_temp_pool_release(dat, dat->set->size, NULL);
+  return op_free_dat_temp_core(dat);
+}
 
 op_dat op_decl_dat_temp_char(op_set set, int dim, char const *type, int size,
                              char const *name) {
   char *data = NULL;
   op_dat dat = op_decl_dat_temp_core(set, dim, type, size, data, name);
 
-  dat->data =
-      (char *)op_calloc(set->size * dim * size, 1); // initialize data bits to 0
+  dat->soa = op_dat_soa_type(dat) && dim > 1; // zeroes need no transpose
+  // initialize data bits to 0, recycling a pooled block if there is one
+  void *mpi_buffer;
+  dat->data = op_temp_pool_alloc(dat, set->size, &mpi_buffer);
   dat->user_managed = 0;
   return dat;
 }
@@ -136,18 +161,19 @@ op_arg op_arg_gbl_char(char *data, int dim, const char *type, int size,
 void op_upload_all() {}
 
 void op_fetch_data_char(op_dat dat, char *usr_ptr) {
-  memcpy((void *)usr_ptr, (void *)dat->data, dat->set->size * dat->size);
+  op_flush();
+  op_dat_get_aos(dat, usr_ptr, 0, dat->set->size);
 }
 
 void op_fetch_data_idx_char(op_dat dat, char *usr_ptr, int low, int high) {
+  op_flush();
   if (low < 0 || high > dat->set->size - 1) {
     printf("op_fetch_data: Indices not within range of elements held in %s\n",
            dat->name);
     exit(2);
   }
   // need to copy data into memory pointed to by usr_ptr
-  memcpy((void *)usr_ptr, (void *)&dat->data[low * dat->size],
-         (high + 1) * dat->size);
+  op_dat_get_aos(dat, usr_ptr, low, high - low + 1);
 }
 
 int op_get_size(op_set set) { return set->size; }
@@ -163,14 +189,22 @@ void op_print(const char *line) { printf("%s\n", line); }
 
 void op_timers(double *cpu, double *et) { op_timers_core(cpu, et); }
 
-void op_exit() { op_exit_core(); }
+void op_exit() {
+  op_flush();
+  op_exit_core();
+}
 
-void op_timing_output() { op_timing_output_core(); }
+void op_timing_output() {
+  op_flush();
+  op_timing_output_core();
+}
 
 void op_print_dat_to_binfile(op_dat dat, const char *file_name) {
+  op_flush();
   op_print_dat_to_binfile_core(dat, file_name);
 }
 
 void op_print_dat_to_txtfile(op_dat dat, const char *file_name) {
+  op_flush();
   op_print_dat_to_txtfile_core(dat, file_name);
 }
@@ -113,6 +113,60 @@ def get_stride_string(g_m,maps,mapnames,name):
     idx = mapnames.index(mapnames[g_m])
     return 'opDat'+str(idx)+'_'+name+'_stride_OP2CONSTANT'
 
+def get_soa_strides(nargs,maps,mapnames,soaflags,name):
+  """Stride variables used by the SoA arguments of a kernel, each paired
+  with the index of an argument whose set gives its value"""
+  OP_ID   = 1;  OP_GBL   = 2;  OP_MAP = 3;
+  strides = []
+  for g_m in range(0,nargs):
+    if soaflags[g_m] and maps[g_m] <> OP_GBL:
+      stride = get_stride_string(g_m,maps,mapnames,name)
+      if not stride in [s[0] for s in strides]:
+        strides = strides + [(stride, g_m)]
+  return strides
+
+def get_soa_kernel(kernel, name, suffix, unique_args, maps, mapnames, skip):
+  """Host copy of the user kernel, renamed to name+suffix, in which the
+  arguments flagged in kernel['soaflags'] and not listed in skip index
+  their components with the SoA stride of their op_dat"""
+  OP_ID   = 1;  OP_GBL   = 2;  OP_MAP = 3;
+
+  f = open(kernel['decl_filepath'], 'r')
+  kernel_text = f.read()
+  f.close()
+
+  kernel_text = comment_remover(kernel_text)
+  kernel_text = remove_trailing_w_space(kernel_text)
+
+  p = re.compile('void\\s+\\b'+name+'\\b')
+  i = p.search(kernel_text).start()
+  j = kernel_text[i:].find('{')
+  k = para_parse(kernel_text, i+j, '{', '}')
+  signature_text = kernel_text[i:i+j]
+  l = signature_text[0:].find('(')
+  head_text = signature_text[0:l].strip()
+  m = para_parse(signature_text, 0, '(', ')')
+  signature_text = signature_text[l+1:m]
+  body_text = kernel_text[i+j+1:k]
+
+  for i in range(0,kernel['nargs']):
+    if not kernel['soaflags'][i] or i in skip:
+      continue
+    var = signature_text.split(',')[i].strip().replace('*','')
+    length = len(re.compile('\\s+\\b').split(var))
+    var2 = re.compile('\\s+\\b').split(var)[length-1].strip()
+    stride = get_stride_string(unique_args[i]-1,maps,mapnames,name)
+    if int(kernel['idxs'][i]) < 0 and kernel['maps'][i] == OP_MAP:
+      body_text = re.sub(r'\b'+var2+'(\[[^\]]\])\[([\\s\+\*A-Za-z0-9]*)\]', \
+                         var2+r'\1[(\2)*'+stride+']', body_text)
+    else:
+      body_text = re.sub('\*\\b'+var2+'\\b\\s*(?!\[)', var2+'[0]', body_text)
+      body_text = re.sub(r'\b'+var2+'\[([\\s\+\*A-Za-z0-9]*)\]', \
+                         var2+r'[(\1)*'+stride+']', body_text)
+
+  head_text = re.sub(r'\b'+name+r'\b', name+suffix, head_text)
+  return 'inline '+head_text+'('+signature_text+') {'+body_text+'}\n'
+
 arithmetic_regex_pattern = r'^[ \(\)\+\-\*\\\.\%0-9]+$'
 
 def op_parse_macro_defs(text):
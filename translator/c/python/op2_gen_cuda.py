@@ -668,6 +668,7 @@ def op2_gen_cuda(master, date, consts, kernels, sets):
     comm(' initialise timers')
     code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
     code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
     code('')
 
     IF('set->size > 0')
@@ -917,6 +918,8 @@ def op2_gen_cuda(master, date, consts, kernels, sets):
 
     comm('update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
 
     if ninds == 0:
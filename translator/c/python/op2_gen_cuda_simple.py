@@ -817,6 +817,7 @@ def op2_gen_cuda_simple(master, date, consts, kernels,sets, macro_defs):
     code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
     code('op_timing_realloc('+str(nk)+');')
     code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
     code('')
@@ -865,12 +866,13 @@ def op2_gen_cuda_simple(master, date, consts, kernels,sets, macro_defs):
 # kernel call for indirect version
 #
     if ninds>0:
+      code('static op_plan_handle plan_handle = OP_PLAN_HANDLE_INIT;')
       if inc_stage==1 and ind_inc:
-        code('op_plan *Plan = op_plan_get_stage(name,set,part_size,nargs,args,ninds,inds,OP_STAGE_INC);')
+        code('op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_STAGE_INC,1);')
       elif op_color2:
-        code('op_plan *Plan = op_plan_get_stage(name,set,part_size,nargs,args,ninds,inds,OP_COLOR2);')
+        code('op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_COLOR2,1);')
       else:
-        code('op_plan *Plan = op_plan_get(name,set,part_size,nargs,args,ninds,inds);')
+        code('op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,1);')
       code('')
 
 
@@ -1127,6 +1129,8 @@ def op2_gen_cuda_simple(master, date, consts, kernels,sets, macro_defs):
     code('cutilSafeCall(cudaDeviceSynchronize());')
     comm('update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
 
     if ninds == 0:
@@ -13,6 +13,7 @@ import re
 import datetime
 import glob
 import os
+import op2_gen_common
 
 def comm(line):
   global file_text, FORTRAN, CPP
@@ -165,6 +166,14 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
     name, nargs, dims, maps, var, typs, accs, idxs, inds, soaflags, optflags, decl_filepath, \
             ninds, inddims, indaccs, indtyps, invinds, mapnames, invmapinds, mapinds, nmaps, nargs_novec, \
             unique_args, vectorised, cumulative_indirect_index = op2_gen_common.create_kernel_info(kernels[nk])
+
+    # element offset multiplier and component offset for SoA arguments
+    def soa_stride(g_m, aos):
+      return '' if soaflags[g_m] else aos
+    def soa_comp(g_m, d):
+      if soaflags[g_m]:
+        return str(d)+' * '+op2_gen_common.get_stride_string(g_m,maps,mapnames,name)
+      return str(d)
 #
 # set three logicals
 #
@@ -207,6 +216,21 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
     file_text += kernel_text
     f.close()
 
+#
+# SoA version, indexing the components of SoA arguments with the stride
+# of their op_dat
+#
+    soa = sum(soaflags) > 0
+    kernel_name = name
+    if soa:
+      kernel_name = name+'_soa'
+      strides = op2_gen_common.get_soa_strides(nargs,maps,mapnames,soaflags,name)
+      code('')
+      comm('user function -- SoA strides')
+      for stride in strides:
+        code('static int '+stride[0]+';')
+      file_text += op2_gen_common.get_soa_kernel(kernels[nk],name,'_soa',unique_args,maps,mapnames,[])
+
 #
 # Modified vectorisable version if its an indirect kernel
 # - direct kernels can be vectorised without modification
@@ -266,6 +290,13 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
 
           var = var + '[*][SIMD_VEC]'
           #var = var + '[restrict][SIMD_VEC]'
+        elif maps[i] == OP_ID and soaflags[i]:
+          length = len(re.compile('\\s+\\b').split(var.replace('*','')))
+          var2 = re.compile('\\s+\\b').split(var.replace('*',''))[length-1].strip()
+          stride = op2_gen_common.get_stride_string(i,maps,mapnames,name)
+          body_text = re.sub('\*\\b'+var2+'\\b\\s*(?!\[)', var2+'[0]', body_text)
+          body_text = re.sub(r'\b'+var2+'\[([\\s\+\*A-Za-z0-9]*)\]', \
+                             var2+r'[(\1)*'+stride+']', body_text)
         new_signature_text +=  var+', '
 
 
@@ -350,16 +381,6 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
 
 
 
-#
-# start timing
-#
-    code('')
-    comm(' initialise timers')
-    code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
-    code('op_timing_realloc('+str(nk)+');')
-    code('op_timers_core(&cpu_t1, &wall_t1);')
-    code('')
-
 #
 #   indirect bits
 #
@@ -377,6 +398,20 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
       code('printf(" kernel routine w/o indirection:  '+ name + '");')
       ENDIF()
 
+#
+# start timing
+#
+    if soa:
+      for stride in strides:
+        code(stride[0]+' = getSetSizeFromOpArg(&args['+str(stride[1])+']);')
+
+    code('')
+    comm(' initialise timers')
+    code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
+    code('op_timing_realloc('+str(nk)+');')
+    code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
+
     code('')
     code('int exec_size = op_mpi_halo_exchanges(set, nargs, args);')
 
@@ -418,13 +453,13 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
         for g_m in range(0,nargs):
           if maps[g_m] == OP_MAP :
             if (accs[g_m] == OP_READ or accs[g_m] == OP_RW or accs[g_m] == OP_WRITE):#and (not mapinds[g_m] in k):
-              code('int idx'+str(g_m)+'_DIM = DIM * arg'+str(invmapinds[inds[g_m]-1])+'.map_data[(n+i) * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
+              code('int idx'+str(g_m)+'_DIM = '+soa_stride(g_m,'DIM * ')+'arg'+str(invmapinds[inds[g_m]-1])+'.map_data[(n+i) * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
       code('')
       for g_m in range(0,nargs):
           if maps[g_m] == OP_MAP :
             if (accs[g_m] == OP_READ or accs[g_m] == OP_RW):#and (not mapinds[g_m] in k):
               for d in range(0,int(dims[g_m])):
-                code('dat'+str(g_m)+'['+str(d)+'][i] = (ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+str(d)+'];')
+                code('dat'+str(g_m)+'['+str(d)+'][i] = (ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+soa_comp(g_m,d)+'];')
               code('')
             elif (accs[g_m] == OP_INC):
               for d in range(0,int(dims[g_m])):
@@ -444,7 +479,7 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+' * (n+i)],'
+          line = line + indent + '&(ptr'+str(g_m)+')['+soa_stride(g_m,str(dims[g_m])+' * ')+'(n+i)],'
         elif maps[g_m] == OP_GBL and accs[g_m] == OP_READ:
           line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data,'
         elif maps[g_m] == OP_GBL and accs[g_m] == OP_INC:
@@ -460,17 +495,17 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
         for g_m in range(0,nargs):
           if maps[g_m] == OP_MAP :
             if (accs[g_m] == OP_INC or accs[g_m] == OP_RW or accs[g_m] == OP_WRITE):#and (not mapinds[g_m] in k):
-              code('int idx'+str(g_m)+'_DIM = DIM * arg'+str(invmapinds[inds[g_m]-1])+'.map_data[(n+i) * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
+              code('int idx'+str(g_m)+'_DIM = '+soa_stride(g_m,'DIM * ')+'arg'+str(invmapinds[inds[g_m]-1])+'.map_data[(n+i) * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
       code('')
       for g_m in range(0,nargs):
           if maps[g_m] == OP_MAP :
             if (accs[g_m] == OP_INC ):
               for d in range(0,int(dims[g_m])):
-                code('(ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+str(d)+'] += dat'+str(g_m)+'['+str(d)+'][i];')
+                code('(ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+soa_comp(g_m,d)+'] += dat'+str(g_m)+'['+str(d)+'][i];')
               code('')
             if (accs[g_m] == OP_WRITE or accs[g_m] == OP_RW):
               for d in range(0,int(dims[g_m])):
-                code('(ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+str(d)+'] = dat'+str(g_m)+'['+str(d)+'][i];')
+                code('(ptr'+str(g_m)+')[idx'+str(g_m)+'_DIM + '+soa_comp(g_m,d)+'] = dat'+str(g_m)+'['+str(d)+'][i];')
               code('')
       ENDFOR()
 
@@ -511,13 +546,13 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
             k = k + [mapinds[g_m]]
             code('int map'+str(mapinds[g_m])+'idx = arg'+str(invmapinds[inds[g_m]-1])+'.map_data[n * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
       code('')
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+' * n]'
+          line = line + indent + '&(ptr'+str(g_m)+')['+soa_stride(g_m,str(dims[g_m])+' * ')+'n]'
         if maps[g_m] == OP_MAP:
-          line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+' * map'+str(mapinds[g_m])+'idx]'
+          line = line + indent + '&(ptr'+str(g_m)+')['+soa_stride(g_m,str(dims[g_m])+' * ')+'map'+str(mapinds[g_m])+'idx]'
         if maps[g_m] == OP_GBL:
           line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
         if g_m < nargs-1:
@@ -547,11 +582,11 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
 
       code('#pragma simd')
       FOR('i','0','SIMD_VEC')
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+' * (n+i)]'
+          line = line + indent + '&(ptr'+str(g_m)+')['+soa_stride(g_m,str(dims[g_m])+' * ')+'(n+i)]'
         if maps[g_m] == OP_MAP:
           line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+' * map'+str(mapinds[g_m])+'idx]'
         if maps[g_m] == OP_GBL:
@@ -583,11 +618,11 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
       depth = depth -2
       code('#endif')
       depth = depth +2
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(ptr'+str(g_m)+')['+str(dims[g_m])+'*n]'
+          line = line + indent + '&(ptr'+str(g_m)+')['+soa_stride(g_m,str(dims[g_m])+'*')+'n]'
         if maps[g_m] == OP_GBL:
           line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
         if g_m < nargs-1:
@@ -608,12 +643,10 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
 #
 # combine reduction data from multiple OpenMP threads
 #
-    comm(' combine reduction data')
-    for g_m in range(0,nargs):
-      if maps[g_m]==OP_GBL and accs[g_m]<>OP_READ:
-        code('op_mpi_reduce(&ARG,('+typs[g_m]+'*)ARG.data);')
-
     code('op_mpi_set_dirtybit(nargs, args);')
+    comm(' combine reduction data')
+    if any(maps[g_m]==OP_GBL and accs[g_m]<>OP_READ for g_m in range(0,nargs)):
+      code('op_mpi_reduce_combined(args, nargs);')
     code('')
 
 #
@@ -622,6 +655,8 @@ def op2_gen_mpi_vec(master, date, consts, kernels):
 
     comm(' update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
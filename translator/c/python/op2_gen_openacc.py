@@ -280,6 +280,7 @@ def op2_gen_openacc(master, date, consts, kernels):
     code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
     code('op_timing_realloc('+str(nk)+');')
     code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
     code('')
@@ -577,6 +578,8 @@ def op2_gen_openacc(master, date, consts, kernels):
 
     comm(' update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
 
     if ninds == 0:
@@ -542,6 +542,7 @@ def op2_gen_openmp(master, date, consts, kernels):
     comm(' initialise timers')
     code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
     code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
     code('')
 
 #
@@ -697,8 +698,8 @@ def op2_gen_openmp(master, date, consts, kernels):
         else:
           print 'internal error: invalid reduction option'
         ENDFOR()
-      if maps[g_m]==OP_GBL and accs[g_m]<>OP_READ:
-        code('op_mpi_reduce(&ARG,ARGh);')
+    if any(maps[g_m]==OP_GBL and accs[g_m]<>OP_READ for g_m in range(0,nargs)):
+      code('op_mpi_reduce_combined(args, nargs);')
 
     code('op_mpi_set_dirtybit(nargs, args);')
     code('')
@@ -709,6 +710,8 @@ def op2_gen_openmp(master, date, consts, kernels):
 
     comm(' update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('op_timing_realloc('+str(nk)+');')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
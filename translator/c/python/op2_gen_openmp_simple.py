@@ -84,6 +84,16 @@ def ENDIF():
   elif CPP:
     code('}')
 
+def ELSE():
+  global file_text, FORTRAN, CPP, g_m
+  global depth
+  depth -= 2
+  if FORTRAN:
+    code('else')
+  elif CPP:
+    code('} else {')
+  depth += 2
+
 
 def op2_gen_openmp_simple(master, date, consts, kernels):
 
@@ -110,6 +120,10 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
             ninds, inddims, indaccs, indtyps, invinds, mapnames, invmapinds, mapinds, nmaps, nargs_novec, \
             unique_args, vectorised, cumulative_indirect_index = op2_gen_common.create_kernel_info(kernels[nk])
 
+    # element offset multiplier: none for SoA arguments
+    def soa_stride(g_m, aos):
+      return '' if soaflags[g_m] else aos
+
     optidxs = [0]*nargs
     indopts = [-1]*nargs
     nopts = 0
@@ -140,6 +154,16 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
         j = i
     reduct = j >= 0
 
+#
+# indirect increments can be done with atomics instead of colouring,
+# as long as there are no other indirect writes
+#
+    j = -1
+    for i in range(0,nargs):
+      if maps[i] == OP_MAP and (accs[i] == OP_RW or accs[i] == OP_WRITE):
+        j = i
+    atomic_inc = ind_inc and j < 0
+
 ##########################################################################
 #  start with the user kernel function
 ##########################################################################
@@ -157,6 +181,30 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
     elif CPP:
       code('#include "../'+decl_filepath+'"')
 
+    #SoA arguments: the kernel indexes their components with the stride of
+    #their op_dat and is handed the first component of the element; the
+    #atomic variant keeps the thread-local increments of indirect OP_INC
+    #arguments in AoS order
+    soa = sum(soaflags) > 0
+    kernel_name = name
+    kernel_name_l = name
+    if soa:
+      kernel_name = name+'_soa'
+      strides = op2_gen_common.get_soa_strides(nargs,maps,mapnames,soaflags,name)
+      code('')
+      comm('user function -- SoA strides')
+      for stride in strides:
+        code('static int '+stride[0]+';')
+      file_text += op2_gen_common.get_soa_kernel(kernels[nk],name,'_soa',unique_args,maps,mapnames,[])
+      kernel_name_l = kernel_name
+      if atomic_inc:
+        skip = [i for i in range(0,len(unique_args)) \
+                if maps[unique_args[i]-1] == OP_MAP and accs[unique_args[i]-1] == OP_INC \
+                and soaflags[unique_args[i]-1]]
+        if len(skip) > 0:
+          kernel_name_l = name+'_soa_l'
+          file_text += op2_gen_common.get_soa_kernel(kernels[nk],name,'_soa_l',unique_args,maps,mapnames,skip)
+
 ##########################################################################
 # then C++ stub function
 ##########################################################################
@@ -209,11 +257,16 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
 #
 # start timing
 #
+    if soa:
+      for stride in strides:
+        code(stride[0]+' = getSetSizeFromOpArg(&args['+str(stride[1])+']);')
+
     code('')
     comm(' initialise timers')
     code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
     code('op_timing_realloc('+str(nk)+');')
     code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
     code('')
 
 #
@@ -240,6 +293,14 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
       code('#endif')
       code('')
       code('int set_size = op_mpi_halo_exchanges(set, nargs, args);')
+      if atomic_inc:
+        code('')
+        comm(' use atomic increments instead of colouring?')
+        code('#ifdef OP_ATOMICS_'+ str(nk))
+        code('  int atomics = OP_ATOMICS_'+str(nk)+';')
+        code('#else')
+        code('  int atomics = OP_atomics;')
+        code('#endif')
 
 #
 # direct bit
@@ -289,98 +350,177 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
 # kernel call for indirect version
 #
     if ninds>0:
-      code('op_plan *Plan = op_plan_get_stage_upload(name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);')
-      code('')
-      comm(' execute plan')
-      code('int block_offset = 0;')
-      FOR('col','0','Plan->ncolors')
-      IF('col==Plan->ncolors_core')
-      code('op_mpi_wait_all(nargs, args);')
-      ENDIF()
-      code('int nblocks = Plan->ncolblk[col];')
-      code('')
-      code('#pragma omp parallel for')
-      FOR('blockIdx','0','nblocks')
-      code('int blockId  = Plan->blkmap[blockIdx + block_offset];')
-      code('int nelem    = Plan->nelems[blockId];')
-      code('int offset_b = Plan->offset[blockId];')
-      FOR('n','offset_b','offset_b+nelem')
-      if nmaps > 0:
-        k = []
-        for g_m in range(0,nargs):
-          if maps[g_m] == OP_MAP and (not mapinds[g_m] in k):
-            k = k + [mapinds[g_m]]
-            code('int map'+str(mapinds[g_m])+'idx = arg'+str(invmapinds[inds[g_m]-1])+\
-              '.map_data[n * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
-      code('')
-      for g_m in range (0,nargs):
-        u = [i for i in range(0,len(unique_args)) if unique_args[i]-1 == g_m]
-        if len(u) > 0 and vectorised[g_m] > 0:
-          if accs[g_m] == OP_READ:
-            line = 'const TYP* ARG_vec[] = {\n'
-          else:
-            line = 'TYP* ARG_vec[] = {\n'
-
-          v = [int(vectorised[i] == vectorised[g_m]) for i in range(0,len(vectorised))]
-          first = [i for i in range(0,len(v)) if v[i] == 1]
-          first = first[0]
-
-          indent = ' '*(depth+2)
-          for k in range(0,sum(v)):
-            line = line + indent + ' &((TYP*)arg'+str(first)+'.data)[DIM * map'+str(mapinds[g_m+k])+'idx],\n'
-          line = line[:-2]+'};'
-          code(line)
-      code('')
-      line = name+'('
-      indent = '\n'+' '*(depth+2)
-      for g_m in range(0,nargs):
-        if maps[g_m] == OP_ID:
-          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+str(dims[g_m])+' * n]'
-        if maps[g_m] == OP_MAP:
-          if vectorised[g_m]:
-            if g_m+1 in unique_args:
-                line = line + indent + 'arg'+str(g_m)+'_vec'
-          else:
-            line = line + indent + '&(('+typs[g_m]+'*)arg'+str(invinds[inds[g_m]-1])+'.data)['+str(dims[g_m])+' * map'+str(mapinds[g_m])+'idx]'
-        if maps[g_m] == OP_GBL:
-          if accs[g_m] <> OP_READ and accs[g_m] <> OP_WRITE:
-            line = line + indent +'&arg'+str(g_m)+'_l[64*omp_get_thread_num()]'
-          else:
-            line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
-        if g_m < nargs-1:
-          if g_m+1 in unique_args and not g_m+1 == unique_args[-1]:
-            line = line +','
+      if atomic_inc:
+        modes = [1, 0]
+      else:
+        modes = [0]
+      for atomic in modes:
+        if atomic:
+          IF('atomics')
+          comm(' execute as a single parallel loop, with atomic increments')
+          FOR('round','0','3')
+          IF('round==1 && set_size != set->core_size')
+          code('op_mpi_wait_all(nargs, args);')
+          ENDIF()
+          code('int start = round==0 ? 0 : (round==1 ? set->core_size : set->size);')
+          code('int end   = round==0 ? set->core_size : (round==1 ? set->size : set_size);')
+          code('')
+          code('#pragma omp parallel for')
+          FOR('n','start','end')
         else:
-           line = line +');'
-      code(line)
-      ENDFOR()
-      ENDFOR()
-      code('')
+          if atomic_inc:
+            ELSE()
+          code('static op_plan_handle plan_handle = OP_PLAN_HANDLE_INIT;')
+          code('op_plan *Plan = op_plan_get_handle(&plan_handle,name,set,part_size,nargs,args,ninds,inds,OP_STAGE_ALL,0);')
+          code('')
+          comm(' execute plan')
+          code('int block_offset = 0;')
+          FOR('col','0','Plan->ncolors')
+          IF('col==Plan->ncolors_core')
+          code('op_mpi_wait_all(nargs, args);')
+          ENDIF()
+          code('int nblocks = Plan->ncolblk[col];')
+          code('')
+          code('#pragma omp parallel for')
+          FOR('blockIdx','0','nblocks')
+          code('int blockId  = Plan->blkmap[blockIdx + block_offset];')
+          code('int nelem    = Plan->nelems[blockId];')
+          code('int offset_b = Plan->offset[blockId];')
+          FOR('n','offset_b','offset_b+nelem')
+        if nmaps > 0:
+          k = []
+          for g_m in range(0,nargs):
+            if maps[g_m] == OP_MAP and (not mapinds[g_m] in k):
+              k = k + [mapinds[g_m]]
+              code('int map'+str(mapinds[g_m])+'idx = arg'+str(invmapinds[inds[g_m]-1])+\
+                '.map_data[n * arg'+str(invmapinds[inds[g_m]-1])+'.map->dim + '+str(idxs[g_m])+'];')
+        code('')
+        for g_m in range (0,nargs):
+          u = [i for i in range(0,len(unique_args)) if unique_args[i]-1 == g_m]
+          if len(u) > 0 and vectorised[g_m] > 0:
+            v = [int(vectorised[i] == vectorised[g_m]) for i in range(0,len(vectorised))]
+            first = [i for i in range(0,len(v)) if v[i] == 1]
+            first = first[0]
+
+            if accs[g_m] == OP_READ:
+              line = 'const TYP* ARG_vec[] = {\n'
+            else:
+              line = 'TYP* ARG_vec[] = {\n'
 
-      if reduct:
-        comm(' combine reduction data')
-        IF('col == Plan->ncolors_owned-1')
-        for m in range(0,nargs):
-          if maps[m] == OP_GBL and accs[m] <> OP_READ:
-            FOR('thr','0','nthreads')
-            if accs[m]==OP_INC:
-              FOR('d','0','DIM')
-              code('ARGh[d] += ARG_l[d+thr*64];')
-              ENDFOR()
-            elif accs[m]==OP_MIN:
-              FOR('d','0','DIM')
-              code('ARGh[d]  = MIN(ARGh[d],ARG_l[d+thr*64]);')
-              ENDFOR()
-            elif  accs[m]==OP_MAX:
-              FOR('d','0','DIM')
-              code('ARGh[d]  = MAX(ARGh[d],ARG_l[d+thr*64]);')
+            indent = ' '*(depth+2)
+            if atomic and accs[g_m] == OP_INC:
+              code('TYP ARG_l['+str(sum(v))+' * DIM];')
+              FOR('d','0',str(sum(v))+' * DIM')
+              code('ARG_l[d] = ZERO_TYP;')
               ENDFOR()
+              for k in range(0,sum(v)):
+                line = line + indent + ' &ARG_l[DIM * '+str(k)+'],\n'
             else:
-              error('internal error: invalid reduction option')
+              for k in range(0,sum(v)):
+                line = line + indent + ' &((TYP*)arg'+str(first)+'.data)['+soa_stride(g_m,'DIM * ')+'map'+str(mapinds[g_m+k])+'idx],\n'
+            line = line[:-2]+'};'
+            code(line)
+          elif atomic and maps[g_m] == OP_MAP and accs[g_m] == OP_INC and not vectorised[g_m]:
+            code('TYP ARG_l[DIM];')
+            FOR('d','0','DIM')
+            code('ARG_l[d] = ZERO_TYP;')
             ENDFOR()
+        code('')
+        if atomic:
+          line = kernel_name_l+'('
+        else:
+          line = kernel_name+'('
+        indent = '\n'+' '*(depth+2)
+        for g_m in range(0,nargs):
+          if maps[g_m] == OP_ID:
+            line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+soa_stride(g_m,str(dims[g_m])+' * ')+'n]'
+          if maps[g_m] == OP_MAP:
+            if vectorised[g_m]:
+              if g_m+1 in unique_args:
+                  line = line + indent + 'arg'+str(g_m)+'_vec'
+            elif atomic and accs[g_m] == OP_INC:
+              line = line + indent + 'arg'+str(g_m)+'_l'
+            else:
+              line = line + indent + '&(('+typs[g_m]+'*)arg'+str(invinds[inds[g_m]-1])+'.data)['+soa_stride(g_m,str(dims[g_m])+' * ')+'map'+str(mapinds[g_m])+'idx]'
+          if maps[g_m] == OP_GBL:
+            if accs[g_m] <> OP_READ and accs[g_m] <> OP_WRITE:
+              line = line + indent +'&arg'+str(g_m)+'_l[64*omp_get_thread_num()]'
+            else:
+              line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
+          if g_m < nargs-1:
+            if g_m+1 in unique_args and not g_m+1 == unique_args[-1]:
+              line = line +','
+          else:
+             line = line +');'
+        code(line)
+
+        if atomic:
+          code('')
+          for g_m in range(0,nargs):
+            if maps[g_m] == OP_MAP and accs[g_m] == OP_INC:
+              if vectorised[g_m]:
+                v = [int(vectorised[i] == vectorised[g_m]) for i in range(0,len(vectorised))]
+                first = [i for i in range(0,len(v)) if v[i] == 1]
+                first = first[0]
+                k = g_m - first
+                if soaflags[g_m]:
+                  offset = 'map'+str(mapinds[g_m])+'idx + d * '+op2_gen_common.get_stride_string(g_m,maps,mapnames,name)
+                else:
+                  offset = 'DIM * map'+str(mapinds[g_m])+'idx + d'
+                FOR('d','0','DIM')
+                code('#pragma omp atomic')
+                code('((TYP*)arg'+str(first)+'.data)['+offset+'] += arg'+str(first)+'_l[DIM * '+str(k)+' + d];')
+                ENDFOR()
+              else:
+                if soaflags[g_m]:
+                  offset = 'map'+str(mapinds[g_m])+'idx + d * '+op2_gen_common.get_stride_string(g_m,maps,mapnames,name)
+                else:
+                  offset = 'DIM * map'+str(mapinds[g_m])+'idx + d'
+                FOR('d','0','DIM')
+                code('#pragma omp atomic')
+                code('((TYP*)arg'+str(invinds[inds[g_m]-1])+'.data)['+offset+'] += ARG_l[d];')
+                ENDFOR()
+          ENDFOR()
+          code('')
+        else:
+          ENDFOR()
+          ENDFOR()
+          code('')
+
+        if reduct:
+          comm(' combine reduction data')
+          if atomic:
+            IF('round == 1')
+          else:
+            IF('col == Plan->ncolors_owned-1')
+          for m in range(0,nargs):
+            if maps[m] == OP_GBL and accs[m] <> OP_READ:
+              FOR('thr','0','nthreads')
+              if accs[m]==OP_INC:
+                FOR('d','0','DIM')
+                code('ARGh[d] += ARG_l[d+thr*64];')
+                ENDFOR()
+              elif accs[m]==OP_MIN:
+                FOR('d','0','DIM')
+                code('ARGh[d]  = MIN(ARGh[d],ARG_l[d+thr*64]);')
+                ENDFOR()
+              elif  accs[m]==OP_MAX:
+                FOR('d','0','DIM')
+                code('ARGh[d]  = MAX(ARGh[d],ARG_l[d+thr*64]);')
+                ENDFOR()
+              else:
+                error('internal error: invalid reduction option')
+              ENDFOR()
+          ENDIF()
+        if atomic:
+          ENDFOR()
+        else:
+          code('block_offset += nblocks;');
+          ENDFOR()
+          code('OP_kernels['+str(nk)+'].transfer  += Plan->transfer;')
+          code('OP_kernels['+str(nk)+'].transfer2 += Plan->transfer2;')
+      if atomic_inc:
         ENDIF()
-      code('block_offset += nblocks;');
-      ENDIF()
 
 #
 # kernel call for direct version
@@ -392,11 +532,11 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
       code('int start  = (set->size* thr)/nthreads;')
       code('int finish = (set->size*(thr+1))/nthreads;')
       FOR('n','start','finish')
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+str(dims[g_m])+'*n]'
+          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+soa_stride(g_m,str(dims[g_m])+'*')+'n]'
         if maps[g_m] == OP_GBL:
           if accs[g_m] <> OP_READ and accs[g_m] <> OP_WRITE:
             line = line + indent +'&arg'+str(g_m)+'_l[64*omp_get_thread_num()]'
@@ -410,10 +550,6 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
       ENDFOR()
       ENDFOR()
 
-    if ninds>0:
-      code('OP_kernels['+str(nk)+'].transfer  += Plan->transfer;')
-      code('OP_kernels['+str(nk)+'].transfer2 += Plan->transfer2;')
-
     ENDIF()
     code('')
 
@@ -445,8 +581,8 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
         else:
           print 'internal error: invalid reduction option'
         ENDFOR()
-      if maps[g_m]==OP_GBL and accs[g_m]<>OP_READ:
-        code('op_mpi_reduce(&ARG,ARGh);')
+    if any(maps[g_m]==OP_GBL and accs[g_m]<>OP_READ for g_m in range(0,nargs)):
+      code('op_mpi_reduce_combined(args, nargs);')
 
     code('op_mpi_set_dirtybit(nargs, args);')
     code('')
@@ -457,6 +593,8 @@ def op2_gen_openmp_simple(master, date, consts, kernels):
 
     comm(' update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
@@ -110,6 +110,10 @@ def op2_gen_seq(master, date, consts, kernels):
             ninds, inddims, indaccs, indtyps, invinds, mapnames, invmapinds, mapinds, nmaps, nargs_novec, \
             unique_args, vectorised, cumulative_indirect_index = op2_gen_common.create_kernel_info(kernels[nk])
 
+    # element offset multiplier: none for SoA arguments
+    def soa_stride(g_m, aos):
+      return '' if soaflags[g_m] else aos
+
     optidxs = [0]*nargs
     indopts = [-1]*nargs
     nopts = 0
@@ -156,6 +160,19 @@ def op2_gen_seq(master, date, consts, kernels):
     elif CPP:
       code('#include "../'+decl_filepath+'"')
 
+    #SoA arguments: the kernel indexes their components with the stride of
+    #their op_dat and is handed the first component of the element
+    soa = sum(soaflags) > 0
+    kernel_name = name
+    if soa:
+      kernel_name = name+'_soa'
+      strides = op2_gen_common.get_soa_strides(nargs,maps,mapnames,soaflags,name)
+      code('')
+      comm('user function -- SoA strides')
+      for stride in strides:
+        code('static int '+stride[0]+';')
+      file_text += op2_gen_common.get_soa_kernel(kernels[nk],name,'_soa',unique_args,maps,mapnames,[])
+
 ##########################################################################
 # then C++ stub function
 ##########################################################################
@@ -201,16 +218,6 @@ def op2_gen_seq(master, date, consts, kernels):
       else:
         code('args['+str(g_m)+'] = ARG;')
 
-#
-# start timing
-#
-    code('')
-    comm(' initialise timers')
-    code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
-    code('op_timing_realloc('+str(nk)+');')
-    code('op_timers_core(&cpu_t1, &wall_t1);')
-    code('')
-
 #
 #   indirect bits
 #
@@ -228,6 +235,20 @@ def op2_gen_seq(master, date, consts, kernels):
       code('printf(" kernel routine w/o indirection:  '+ name + '");')
       ENDIF()
 
+#
+# start timing
+#
+    if soa:
+      for stride in strides:
+        code(stride[0]+' = getSetSizeFromOpArg(&args['+str(stride[1])+']);')
+
+    code('')
+    comm(' initialise timers')
+    code('double cpu_t1, cpu_t2, wall_t1, wall_t2;')
+    code('op_timing_realloc('+str(nk)+');')
+    code('op_timers_core(&cpu_t1, &wall_t1);')
+    code('if (OP_instrument) op_instrument_begin();')
+
     code('')
     code('int set_size = op_mpi_halo_exchanges(set, nargs, args);')
 
@@ -264,22 +285,22 @@ def op2_gen_seq(master, date, consts, kernels):
         
           indent = ' '*(depth+2)
           for k in range(0,sum(v)):
-            line = line + indent + ' &((TYP*)arg'+str(first)+'.data)[DIM * map'+str(mapinds[g_m+k])+'idx],\n'
+            line = line + indent + ' &((TYP*)arg'+str(first)+'.data)['+soa_stride(g_m,'DIM * ')+'map'+str(mapinds[g_m+k])+'idx],\n'
           line = line[:-2]+'};'
           code(line)
       code('')
 
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+str(dims[g_m])+' * n]'
+          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+soa_stride(g_m,str(dims[g_m])+' * ')+'n]'
         if maps[g_m] == OP_MAP: 
           if vectorised[g_m]:
             if g_m+1 in unique_args:
                 line = line + indent + 'arg'+str(g_m)+'_vec'
           else:
-            line = line + indent + '&(('+typs[g_m]+'*)arg'+str(invinds[inds[g_m]-1])+'.data)['+str(dims[g_m])+' * map'+str(mapinds[g_m])+'idx]'
+            line = line + indent + '&(('+typs[g_m]+'*)arg'+str(invinds[inds[g_m]-1])+'.data)['+soa_stride(g_m,str(dims[g_m])+' * ')+'map'+str(mapinds[g_m])+'idx]'
         if maps[g_m] == OP_GBL:
           line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
         if g_m < nargs-1: 
@@ -295,11 +316,11 @@ def op2_gen_seq(master, date, consts, kernels):
 #
     else:
       FOR('n','0','set_size')
-      line = name+'('
+      line = kernel_name+'('
       indent = '\n'+' '*(depth+2)
       for g_m in range(0,nargs):
         if maps[g_m] == OP_ID:
-          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+str(dims[g_m])+'*n]'
+          line = line + indent + '&(('+typs[g_m]+'*)arg'+str(g_m)+'.data)['+soa_stride(g_m,str(dims[g_m])+'*')+'n]'
         if maps[g_m] == OP_GBL:
           line = line + indent +'('+typs[g_m]+'*)arg'+str(g_m)+'.data'
         if g_m < nargs-1:
@@ -321,21 +342,10 @@ def op2_gen_seq(master, date, consts, kernels):
 #
 # combine reduction data from multiple OpenMP threads
 #
-    comm(' combine reduction data')
-    for g_m in range(0,nargs):
-      if maps[g_m]==OP_GBL and accs[g_m]<>OP_READ:
-#        code('op_mpi_reduce(&ARG,('+typs[g_m]+'*)ARG.data);')
-        if typs[g_m] == 'double': #need for both direct and indirect
-          code('op_mpi_reduce_double(&ARG,('+typs[g_m]+'*)ARG.data);')
-        elif typs[g_m] == 'float':
-          code('op_mpi_reduce_float(&ARG,('+typs[g_m]+'*)ARG.data);')
-        elif typs[g_m] == 'int':
-          code('op_mpi_reduce_int(&ARG,('+typs[g_m]+'*)ARG.data);')
-        else:
-          print 'Type '+typs[g_m]+' not supported in OpenACC code generator, please add it'
-          exit(-1)
-
     code('op_mpi_set_dirtybit(nargs, args);')
+    comm(' combine reduction data')
+    if any(maps[g_m]==OP_GBL and accs[g_m]<>OP_READ for g_m in range(0,nargs)):
+      code('op_mpi_reduce_combined(args, nargs);')
     code('')
 
 #
@@ -344,6 +354,8 @@ def op2_gen_seq(master, date, consts, kernels):
 
     comm(' update kernel record')
     code('op_timers_core(&cpu_t2, &wall_t2);')
+    code('if (OP_instrument) op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);')
+    code('if (OP_trace) op_trace_loop(name, wall_t1, wall_t2);')
     code('OP_kernels[' +str(nk)+ '].name      = name;')
     code('OP_kernels[' +str(nk)+ '].count    += 1;')
     code('OP_kernels[' +str(nk)+ '].time     += wall_t2 - wall_t1;')
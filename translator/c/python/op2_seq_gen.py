@@ -146,7 +146,8 @@ for nargs in range (1,maxargs+1):
 
     f.write('  // initialise timers\n')
     f.write('  double cpu_t1, cpu_t2, wall_t1, wall_t2;\n')
-    f.write('  op_timers_core(&cpu_t1, &wall_t1);\n\n')
+    f.write('  op_timers_core(&cpu_t1, &wall_t1);\n')
+    f.write('  if (OP_instrument) op_instrument_begin();\n\n')
 
     f.write('  // MPI halo exchange and dirty bit setting, if needed\n')
     f.write('  int n_upper = op_mpi_halo_exchanges(set, '+str(nargs)+', args);\n\n')
@@ -178,12 +179,14 @@ for nargs in range (1,maxargs+1):
     f.write('  op_mpi_set_dirtybit('+str(nargs)+', args);\n\n')
 
     f.write('  //global reduction for MPI execution, if needed \n')
-    f.write('  //p_a simply used to determine type for MPI reduction\n')
-    for n in range (0, nargs):
-        f.write('  op_mpi_reduce(&arg'+str(n)+',(T'+str(n)+' *)p_a['+str(n)+']);\n')
+    f.write('  op_mpi_reduce_combined(args, '+str(nargs)+');\n')
 
     f.write('\n  // update timer record\n')
     f.write('  op_timers_core(&cpu_t2, &wall_t2);\n')
+    f.write('  if (OP_instrument)\n')
+    f.write('    op_instrument_end(name, set, '+str(nargs)+', args, wall_t2 - wall_t1);\n')
+    f.write('  if (OP_trace)\n')
+    f.write('    op_trace_loop(name, wall_t1, wall_t2);\n')
     f.write('#ifdef COMM_PERF\n')
     f.write('  void *k_i = op_mpi_perf_time(name, wall_t2 - wall_t1);\n')
     f.write('  op_mpi_perf_comms(k_i, '+str(nargs)+', args);\n')